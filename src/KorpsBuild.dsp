@@ -59,10 +59,22 @@ LINK32=link.exe
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\astar.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\atg.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\ballistics.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\bullets.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\camera.cpp
 # End Source File
 # Begin Source File
@@ -91,6 +103,10 @@ SOURCE=.\gameloop.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\jobs.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\load.cpp
 # End Source File
 # Begin Source File
@@ -143,6 +159,10 @@ SOURCE=.\script.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\snapshot.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\sounds.cpp
 # End Source File
 # Begin Source File
@@ -157,16 +177,32 @@ SOURCE=.\texture.cpp
 
 SOURCE=.\ui.cpp
 # End Source File
+# Begin Source File
+
+SOURCE=.\visibility.cpp
+# End Source File
 # End Group
 # Begin Group "Header Files"
 
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\astar.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\atg.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\ballistics.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\bullets.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\camera.h
 # End Source File
 # Begin Source File
@@ -195,6 +231,10 @@ SOURCE=.\gameloop.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\jobs.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\load.h
 # End Source File
 # Begin Source File
@@ -247,6 +287,10 @@ SOURCE=.\script.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\snapshot.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\sounds.h
 # End Source File
 # Begin Source File
@@ -261,6 +305,10 @@ SOURCE=.\texture.h
 
 SOURCE=.\ui.h
 # End Source File
+# Begin Source File
+
+SOURCE=.\visibility.h
+# End Source File
 # End Group
 # Begin Group "Resource Files"
 
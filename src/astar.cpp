@@ -0,0 +1,1989 @@
+/*******************************************************************************
+                      Pathfinding Module - Implementation
+*******************************************************************************/
+#include "main.h"
+#include "astar.h"
+#include "console.h"
+#include "metrics.h"
+#include "misc.h"
+#include "objunit.h"
+#include "scenery.h"
+
+#define AS_INFINITY                 1.0e30f // Unreached cost
+
+/*******************************************************************************
+    Open List Routines (indexed binary min-heap on f value)
+*******************************************************************************/
+
+inline void heap_up(int* heap, int* heap_index, float* f, int pos)
+{
+    int item = heap[pos];
+    int parent;
+    
+    while(pos > 0)
+    {
+        parent = (pos - 1) >> 1;
+        if(f[heap[parent]] <= f[item])
+            break;
+        heap[pos] = heap[parent];
+        heap_index[heap[pos]] = pos;
+        pos = parent;
+    }
+    heap[pos] = item;
+    heap_index[item] = pos;
+}
+
+inline void heap_push(int* heap, int* heap_index, float* f, int &size,
+    int item)
+{
+    heap[size] = item;
+    heap_up(heap, heap_index, f, size++);
+}
+
+inline int heap_pop(int* heap, int* heap_index, float* f, int &size)
+{
+    int top = heap[0];
+    int item;
+    int pos = 0;
+    int child;
+    
+    item = heap[--size];
+    
+    if(size > 0)
+    {
+        while((child = (pos << 1) + 1) < size)
+        {
+            if(child + 1 < size && f[heap[child + 1]] < f[heap[child]])
+                child++;
+            if(f[item] <= f[heap[child]])
+                break;
+            heap[pos] = heap[child];
+            heap_index[heap[pos]] = pos;
+            pos = child;
+        }
+        heap[pos] = item;
+        heap_index[item] = pos;
+    }
+    
+    heap_index[top] = -2;                   // Closed
+    
+    return top;
+}
+
+/*******************************************************************************
+    function    :   astar_module::astar_module
+    arguments   :   <none>
+    purpose     :   Constructor.
+    notes       :   <none>
+*******************************************************************************/
+astar_module::astar_module()
+{
+    int i;
+    
+    grid_width = grid_height = 0;
+    cell_cost = NULL;
+    
+    cluster_width = cluster_height = 0;
+    cluster_head = NULL;
+    cell_node = NULL;
+    node = NULL;
+    node_count = node_capacity = 0;
+    
+    for(i = 0; i < AS_CACHE_SIZE; i++)
+    {
+        cache[i].start_cell = cache[i].goal_cell = -1;
+        cache[i].path = NULL;
+        cache[i].last_used = 0;
+    }
+    cache_clock = 0;
+    
+    memset(&workspace, 0, sizeof(as_workspace));
+    
+    rq_head = rq_tail = NULL;
+    request_mutex = NULL;
+    request_cond = NULL;
+    cache_mutex = NULL;
+    for(i = 0; i < AS_WORKER_THREADS; i++)
+    {
+        worker[i].module = this;
+        worker[i].thread = NULL;
+        memset(&worker[i].workspace, 0, sizeof(as_workspace));
+    }
+    worker_count = 0;
+    workers_quit = false;
+}
+
+/*******************************************************************************
+    function    :   astar_module::~astar_module
+    arguments   :   <none>
+    purpose     :   Deconstructor.
+    notes       :   <none>
+*******************************************************************************/
+astar_module::~astar_module()
+{
+    free_graph();
+}
+
+/*******************************************************************************
+    function    :   astar_module::build_grid
+    arguments   :   <none>
+    purpose     :   Builds the PF grid cost multipliers from the blockmap raster.
+    notes       :   Each PF cell takes the worst blockmap value of the raster
+                    cells it covers, and is given the inverse of the speed
+                    multiplier used by the motor device as its cost.
+*******************************************************************************/
+void astar_module::build_grid()
+{
+    int x, z;
+    int rx, rz;
+    int rx_min, rz_min;
+    int rx_max, rz_max;
+    int worst;
+    float cell_raster = (float)AS_CELL_SIZE / (float)SC_RASTER_SIZE;
+    GLubyte* raster = map.getBlockmapRaster();
+    int raster_width = map.getRasterWidth();
+    int raster_height = map.getRasterHeight();
+    
+    grid_width = (int)ceil(map.getMapWidth() / AS_CELL_SIZE);
+    grid_height = (int)ceil(map.getMapHeight() / AS_CELL_SIZE);
+    if(grid_width < 1) grid_width = 1;
+    if(grid_height < 1) grid_height = 1;
+    
+    cell_cost = new float[grid_width * grid_height];
+    
+    for(z = 0; z < grid_height; z++)
+    {
+        rz_min = (int)(z * cell_raster);
+        rz_max = (int)ceil((z + 1) * cell_raster);
+        if(rz_max > raster_height) rz_max = raster_height;
+        
+        for(x = 0; x < grid_width; x++)
+        {
+            rx_min = (int)(x * cell_raster);
+            rx_max = (int)ceil((x + 1) * cell_raster);
+            if(rx_max > raster_width) rx_max = raster_width;
+            
+            // Find worst blockmap value in cell
+            worst = 0;
+            if(raster)
+            {
+                for(rz = rz_min; rz < rz_max; rz++)
+                    for(rx = rx_min; rx < rx_max; rx++)
+                        if(raster[rz * raster_width + rx] > worst)
+                            worst = raster[rz * raster_width + rx];
+            }
+            else
+            {
+                worst = map.getBlockmap(((float)x + 0.5) * AS_CELL_SIZE,
+                    ((float)z + 0.5) * AS_CELL_SIZE);
+            }
+            
+            if(worst >= AS_BLOCKED)
+                cell_cost[z * grid_width + x] = -1.0;
+            else
+                cell_cost[z * grid_width + x] =
+                    255.0 / (float)(255 - worst);
+        }
+    }
+}
+
+/*******************************************************************************
+    function    :   astar_module::add_node
+    arguments   :   cell - PF cell of transition
+    purpose     :   Adds an abstract node at the passed cell, or returns the
+                    node already there.
+    notes       :   <none>
+*******************************************************************************/
+int astar_module::add_node(int cell)
+{
+    as_node* new_node;
+    int cluster;
+    
+    if(cell_node[cell] != -1)
+        return cell_node[cell];
+    
+    // Grow node array if needed
+    if(node_count >= node_capacity)
+    {
+        node_capacity = (node_capacity ? node_capacity * 2 : 256);
+        new_node = new as_node[node_capacity];
+        if(node)
+        {
+            memcpy(new_node, node, sizeof(as_node) * node_count);
+            delete [] node;
+        }
+        node = new_node;
+    }
+    
+    cluster = cluster_of(cell);
+    
+    node[node_count].cell = cell;
+    node[node_count].cluster = cluster;
+    node[node_count].cluster_next = cluster_head[cluster];
+    node[node_count].edges = NULL;
+    cluster_head[cluster] = node_count;
+    cell_node[cell] = node_count;
+    
+    return node_count++;
+}
+
+/*******************************************************************************
+    function    :   astar_module::add_edge
+    arguments   :   from - Node edge leaves from
+                    to - Node edge leads to
+                    cost - Traversal cost
+    purpose     :   Adds a directed edge to the abstract graph.
+    notes       :   <none>
+*******************************************************************************/
+void astar_module::add_edge(int from, int to, float cost)
+{
+    as_edge* new_edge = new as_edge;
+    
+    new_edge->node = to;
+    new_edge->cost = cost;
+    new_edge->next = node[from].edges;
+    node[from].edges = new_edge;
+}
+
+/*******************************************************************************
+    function    :   astar_module::build_entrances
+    arguments   :   <none>
+    purpose     :   Places transition nodes along each open run of each cluster
+                    border and connects them across the border.
+    notes       :   A run narrower than AS_ENTRANCE_SPLIT gets a transition at
+                    its middle, a wider run gets one at each of its ends.
+*******************************************************************************/
+void astar_module::build_entrances()
+{
+    int cx, cz;
+    int i, j;
+    int run_start;
+    int run_end;
+    int edge_start;
+    int edge_end;
+    int border;
+    int a, b;
+    int na, nb;
+    int pick[2];
+    int picks;
+    int k;
+    bool open;
+    
+    for(cz = 0; cz < cluster_height; cz++)
+    {
+        for(cx = 0; cx < cluster_width; cx++)
+        {
+            // Two borders per cluster: right (i = 0) and bottom (i = 1)
+            for(i = 0; i < 2; i++)
+            {
+                if(i == 0)
+                {
+                    border = (cx + 1) * AS_CLUSTER_SIZE - 1;
+                    if(border + 1 >= grid_width)
+                        continue;
+                    edge_start = cz * AS_CLUSTER_SIZE;
+                    edge_end = (cz + 1) * AS_CLUSTER_SIZE;
+                    if(edge_end > grid_height) edge_end = grid_height;
+                }
+                else
+                {
+                    border = (cz + 1) * AS_CLUSTER_SIZE - 1;
+                    if(border + 1 >= grid_height)
+                        continue;
+                    edge_start = cx * AS_CLUSTER_SIZE;
+                    edge_end = (cx + 1) * AS_CLUSTER_SIZE;
+                    if(edge_end > grid_width) edge_end = grid_width;
+                }
+                
+                run_start = -1;
+                for(j = edge_start; j <= edge_end; j++)
+                {
+                    // Check open on both sides of border
+                    open = false;
+                    if(j < edge_end)
+                    {
+                        if(i == 0)
+                        {
+                            a = j * grid_width + border;
+                            b = a + 1;
+                        }
+                        else
+                        {
+                            a = border * grid_width + j;
+                            b = a + grid_width;
+                        }
+                        open = (cell_cost[a] >= 0.0 && cell_cost[b] >= 0.0);
+                    }
+                    
+                    if(open && run_start == -1)
+                        run_start = j;
+                    else if(!open && run_start != -1)
+                    {
+                        run_end = j - 1;
+                        
+                        if(run_end - run_start + 1 < AS_ENTRANCE_SPLIT)
+                        {
+                            pick[0] = (run_start + run_end) / 2;
+                            picks = 1;
+                        }
+                        else
+                        {
+                            pick[0] = run_start;
+                            pick[1] = run_end;
+                            picks = 2;
+                        }
+                        
+                        for(k = 0; k < picks; k++)
+                        {
+                            if(i == 0)
+                            {
+                                a = pick[k] * grid_width + border;
+                                b = a + 1;
+                            }
+                            else
+                            {
+                                a = border * grid_width + pick[k];
+                                b = a + grid_width;
+                            }
+                            
+                            na = add_node(a);
+                            nb = add_node(b);
+                            add_edge(na, nb, step_cost(a, b, false));
+                            add_edge(nb, na, step_cost(b, a, false));
+                        }
+                        
+                        run_start = -1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*******************************************************************************
+    function    :   astar_module::build_intra_edges
+    arguments   :   <none>
+    purpose     :   Connects the transition nodes of each cluster to each other
+                    using local A* path costs.
+    notes       :   <none>
+*******************************************************************************/
+void astar_module::build_intra_edges()
+{
+    int cluster;
+    int a, b;
+    float cost;
+    
+    for(cluster = 0; cluster < cluster_width * cluster_height; cluster++)
+    {
+        for(a = cluster_head[cluster]; a != -1; a = node[a].cluster_next)
+        {
+            for(b = node[a].cluster_next; b != -1; b = node[b].cluster_next)
+            {
+                cost = search_grid(&workspace, node[a].cell, node[b].cell,
+                    cluster);
+                
+                if(cost >= 0.0)
+                {
+                    add_edge(a, b, cost);
+                    add_edge(b, a, cost);
+                }
+            }
+        }
+    }
+}
+
+/*******************************************************************************
+    function    :   astar_module::free_graph
+    arguments   :   <none>
+    purpose     :   Frees the PF grid, abstract graph, workspace, and cache.
+    notes       :   Workers are stopped (and pending requests dropped) first.
+*******************************************************************************/
+void astar_module::free_graph()
+{
+    int i;
+    as_edge* curr_edge;
+    as_edge* next_edge;
+    
+    stop_workers();
+    cache_clear();
+    free_workspace(&workspace);
+    
+    for(i = 0; i < node_count; i++)
+    {
+        for(curr_edge = node[i].edges; curr_edge; curr_edge = next_edge)
+        {
+            next_edge = curr_edge->next;
+            delete curr_edge;
+        }
+    }
+    
+    if(node)
+        delete [] node;
+    node = NULL;
+    node_count = node_capacity = 0;
+    
+    if(cell_node)
+        delete [] cell_node;
+    cell_node = NULL;
+    
+    if(cluster_head)
+        delete [] cluster_head;
+    cluster_head = NULL;
+    cluster_width = cluster_height = 0;
+    
+    if(cell_cost)
+        delete [] cell_cost;
+    cell_cost = NULL;
+    grid_width = grid_height = 0;
+}
+
+/*******************************************************************************
+    function    :   astar_module::worker_thread
+    arguments   :   data - Worker (as_worker*) the thread runs as
+    purpose     :   Worker thread body. Takes pending requests off of the queue
+                    in order and solves them until told to quit.
+    notes       :   Only the request's state and path are written here (the
+                    state under the request mutex); the rest of a request is
+                    left alone once queued, and done requests are only freed
+                    by update.
+*******************************************************************************/
+int astar_module::worker_thread(void* data)
+{
+    as_worker* self = (as_worker*)data;
+    astar_module* module = self->module;
+    as_request* group[AS_FLOW_MAX_UNITS];
+    int count;
+    int i;
+    
+    SDL_mutexP(module->request_mutex);
+    
+    while(!module->workers_quit)
+    {
+        if((count = module->take_requests(group)) == 0)
+        {
+            SDL_CondWait(module->request_cond, module->request_mutex);
+            continue;
+        }
+        
+        SDL_mutexV(module->request_mutex);
+        
+        module->solve_requests(&self->workspace, group, count);
+        
+        SDL_mutexP(module->request_mutex);
+        for(i = 0; i < count; i++)
+            group[i]->state = AS_REQ_DONE;
+    }
+    
+    SDL_mutexV(module->request_mutex);
+    
+    return 0;
+}
+
+/*******************************************************************************
+    function    :   astar_module::start_workers
+    arguments   :   <none>
+    purpose     :   Creates the request queue locks and starts the workers.
+    notes       :   If no threads can be made, requests are instead solved by
+                    update under the AS_SOLVE_BUDGET time budget.
+*******************************************************************************/
+void astar_module::start_workers()
+{
+    int i;
+    
+    request_mutex = SDL_CreateMutex();
+    request_cond = SDL_CreateCond();
+    cache_mutex = SDL_CreateMutex();
+    workers_quit = false;
+    worker_count = 0;
+    
+    if(!request_mutex || !request_cond || !cache_mutex)
+    {
+        write_error("PF: Could not create path request locks.");
+        exit(1);
+    }
+    
+    for(i = 0; i < AS_WORKER_THREADS; i++)
+    {
+        alloc_workspace(&worker[worker_count].workspace);
+        worker[worker_count].thread = SDL_CreateThread(worker_thread,
+            (void*)&worker[worker_count]);
+        
+        if(!worker[worker_count].thread)
+        {
+            free_workspace(&worker[worker_count].workspace);
+            break;
+        }
+        
+        worker_count++;
+    }
+}
+
+/*******************************************************************************
+    function    :   astar_module::stop_workers
+    arguments   :   <none>
+    purpose     :   Stops the workers, drops all requests, and frees the
+                    request queue locks.
+    notes       :   <none>
+*******************************************************************************/
+void astar_module::stop_workers()
+{
+    int i;
+    
+    if(!request_mutex)
+        return;
+    
+    SDL_mutexP(request_mutex);
+    workers_quit = true;
+    SDL_CondBroadcast(request_cond);
+    SDL_mutexV(request_mutex);
+    
+    for(i = 0; i < worker_count; i++)
+    {
+        SDL_WaitThread(worker[i].thread, NULL);
+        worker[i].thread = NULL;
+        free_workspace(&worker[i].workspace);
+    }
+    worker_count = 0;
+    
+    free_requests();
+    
+    SDL_DestroyMutex(request_mutex);
+    SDL_DestroyCond(request_cond);
+    SDL_DestroyMutex(cache_mutex);
+    request_mutex = NULL;
+    request_cond = NULL;
+    cache_mutex = NULL;
+}
+
+/*******************************************************************************
+    function    :   astar_module::free_requests
+    arguments   :   <none>
+    purpose     :   Frees all requests in the request queue.
+    notes       :   Workers must not be running.
+*******************************************************************************/
+void astar_module::free_requests()
+{
+    as_request* curr;
+    
+    while((curr = rq_head) != NULL)
+    {
+        rq_head = rq_head->next;
+        freePath(curr->path);
+        delete curr;
+    }
+    rq_tail = NULL;
+}
+
+/*******************************************************************************
+    function    :   astar_module::take_requests
+    arguments   :   group - Array (AS_FLOW_MAX_UNITS long) to fill
+    purpose     :   Takes the first pending request off of the queue, along with
+                    any others whose goals lie in the same area, marking them
+                    as being solved. Returns the number taken.
+    notes       :   Request mutex must be held.
+*******************************************************************************/
+int astar_module::take_requests(as_request** group)
+{
+    as_request* curr;
+    int count = 0;
+    int goal_x = 0, goal_z = 0;
+    int x, z;
+    
+    for(curr = rq_head; curr && count < AS_FLOW_MAX_UNITS; curr = curr->next)
+    {
+        if(curr->state != AS_REQ_PENDING || curr->unit == NULL)
+            continue;
+        
+        x = (int)(curr->end[0] / AS_CELL_SIZE);
+        z = (int)(curr->end[2] / AS_CELL_SIZE);
+        
+        if(count == 0)
+        {
+            goal_x = x;
+            goal_z = z;
+        }
+        else if(abs(x - goal_x) > AS_FLOW_AREA || abs(z - goal_z) > AS_FLOW_AREA)
+            continue;
+        
+        curr->state = AS_REQ_SOLVING;
+        group[count++] = curr;
+    }
+    
+    return count;
+}
+
+/*******************************************************************************
+    function    :   astar_module::solve_requests
+    arguments   :   ws - Workspace to search with
+                    group - Requests to solve
+                    count - Number of requests
+    purpose     :   Solves a group of requests taken by take_requests, with a
+                    flow field if there are enough of them.
+    notes       :   <none>
+*******************************************************************************/
+void astar_module::solve_requests(as_workspace* ws, as_request** group,
+    int count)
+{
+    int i;
+    
+    if(count >= AS_FLOW_MIN_UNITS)
+        flow_paths(ws, group, count);
+    else
+        for(i = 0; i < count; i++)
+            group[i]->path = find_path(ws, group[i]->start, group[i]->end);
+}
+
+/*******************************************************************************
+    function    :   astar_module::flow_paths
+    arguments   :   ws - Workspace to search with
+                    group - Requests to solve
+                    count - Number of requests
+    purpose     :   Solves a group of requests sharing a goal area with a single
+                    flow field.
+    notes       :   1) The integration field is a Dijkstra flood out from every
+                       goal in the group, stopped once every start is reached.
+                       Its parent links then point each cell down its shortest
+                       route to the nearest goal.
+                    2) Each unit follows the field from its start to the goal it
+                       reaches, then a short local A* takes it on to its own
+                       goal (or, failing that, a regular search is done).
+                       Paths are smoothed as usual, but not cached.
+*******************************************************************************/
+void astar_module::flow_paths(as_workspace* ws, as_request** group, int count)
+{
+    int start_cell[AS_FLOW_MAX_UNITS];
+    int end_cell[AS_FLOW_MAX_UNITS];
+    int goal_cell[AS_FLOW_MAX_UNITS];
+    int* descent[AS_FLOW_MAX_UNITS];
+    int descent_count[AS_FLOW_MAX_UNITS];
+    int remaining = 0;
+    int curr;
+    int reached;
+    int i, j;
+    int x_min, z_min;
+    int x_max, z_max;
+    bool found;
+    
+    next_stamp(ws);
+    ws->heap_size = 0;
+    
+    // Seed field with every goal
+    for(i = 0; i < count; i++)
+    {
+        group[i]->path = NULL;
+        descent[i] = NULL;
+        descent_count[i] = 0;
+        
+        start_cell[i] = snap_cell(cell_at(group[i]->start[0],
+            group[i]->start[2]));
+        end_cell[i] = cell_at(group[i]->end[0], group[i]->end[2]);
+        goal_cell[i] = snap_cell(end_cell[i]);
+        
+        if(start_cell[i] == -1 || goal_cell[i] == -1)
+        {
+            start_cell[i] = goal_cell[i] = -1;
+            continue;
+        }
+        
+        remaining++;
+        
+        if(ws->stamp[goal_cell[i]] != ws->stamp_id)
+        {
+            ws->stamp[goal_cell[i]] = ws->stamp_id;
+            ws->g[goal_cell[i]] = ws->f[goal_cell[i]] = 0.0;
+            ws->parent[goal_cell[i]] = -1;
+            heap_push(ws->heap, ws->heap_index, ws->f, ws->heap_size,
+                goal_cell[i]);
+        }
+    }
+    
+    // Integration field
+    while(ws->heap_size > 0 && remaining > 0)
+    {
+        curr = heap_pop(ws->heap, ws->heap_index, ws->f, ws->heap_size);
+        
+        for(i = 0; i < count; i++)
+            if(start_cell[i] == curr)
+                remaining--;
+        
+        expand_cell(ws, curr, -1, 0, 0, grid_width - 1, grid_height - 1);
+    }
+    
+    // Follow field down from each start (before the field is overwritten)
+    for(i = 0; i < count; i++)
+    {
+        if(start_cell[i] == -1 || ws->stamp[start_cell[i]] != ws->stamp_id ||
+           ws->heap_index[start_cell[i]] != -2)
+            continue;
+        
+        for(curr = start_cell[i]; curr != -1; curr = ws->parent[curr])
+            descent_count[i]++;
+        
+        descent[i] = new int[descent_count[i]];
+        j = 0;
+        for(curr = start_cell[i]; curr != -1; curr = ws->parent[curr])
+            descent[i][j++] = curr;
+    }
+    
+    // Take each path on from the goal reached to its own goal
+    for(i = 0; i < count; i++)
+    {
+        if(!descent[i])
+            continue;
+        
+        ws->cell_count = 0;
+        for(j = 0; j < descent_count[i]; j++)
+            push_cell(ws, descent[i][j]);
+        
+        reached = descent[i][descent_count[i] - 1];
+        found = true;
+        
+        if(reached != goal_cell[i])
+        {
+            x_min = reached % grid_width;
+            x_max = goal_cell[i] % grid_width;
+            if(x_min > x_max) { j = x_min; x_min = x_max; x_max = j; }
+            z_min = reached / grid_width;
+            z_max = goal_cell[i] / grid_width;
+            if(z_min > z_max) { j = z_min; z_min = z_max; z_max = j; }
+            
+            if(search_grid(ws, reached, goal_cell[i],
+                   x_min - AS_FLOW_AREA, z_min - AS_FLOW_AREA,
+                   x_max + AS_FLOW_AREA, z_max + AS_FLOW_AREA) >= 0.0)
+                append_parents(ws, reached, goal_cell[i]);
+            else
+                found = false;
+        }
+        
+        if(found)
+            group[i]->path = build_path(ws, group[i]->end,
+                goal_cell[i] == end_cell[i]);
+        else
+            group[i]->path = find_path(ws, group[i]->start, group[i]->end);
+        
+        delete [] descent[i];
+    }
+}
+
+/*******************************************************************************
+    function    :   astar_module::alloc_workspace
+    arguments   :   ws - Workspace to allocate
+    purpose     :   Allocates the search data of a workspace for the current
+                    grid and abstract graph.
+    notes       :   The abstract arrays hold two extra slots for the temporary
+                    start and goal nodes of a query.
+*******************************************************************************/
+void astar_module::alloc_workspace(as_workspace* ws)
+{
+    int cells = grid_width * grid_height;
+    int nodes = node_count + 2;
+    
+    ws->stamp_id = 0;
+    ws->link_id = 0;
+    
+    ws->stamp = new unsigned int[cells];
+    ws->g = new float[cells];
+    ws->f = new float[cells];
+    ws->parent = new int[cells];
+    ws->heap_index = new int[cells];
+    ws->heap = new int[cells];
+    ws->heap_size = 0;
+    memset(ws->stamp, 0, sizeof(unsigned int) * cells);
+    
+    ws->a_stamp = new unsigned int[nodes];
+    ws->a_g = new float[nodes];
+    ws->a_f = new float[nodes];
+    ws->a_parent = new int[nodes];
+    ws->a_heap_index = new int[nodes];
+    ws->a_heap = new int[nodes];
+    ws->a_heap_size = 0;
+    ws->goal_link = new float[nodes];
+    ws->goal_stamp = new unsigned int[nodes];
+    memset(ws->a_stamp, 0, sizeof(unsigned int) * nodes);
+    memset(ws->goal_stamp, 0, sizeof(unsigned int) * nodes);
+    
+    ws->cell_capacity = 256;
+    ws->cells = new int[ws->cell_capacity];
+    ws->cell_count = 0;
+}
+
+/*******************************************************************************
+    function    :   astar_module::free_workspace
+    arguments   :   ws - Workspace to free
+    purpose     :   Frees the search data of a workspace.
+    notes       :   <none>
+*******************************************************************************/
+void astar_module::free_workspace(as_workspace* ws)
+{
+    if(ws->stamp) delete [] ws->stamp;
+    if(ws->g) delete [] ws->g;
+    if(ws->f) delete [] ws->f;
+    if(ws->parent) delete [] ws->parent;
+    if(ws->heap_index) delete [] ws->heap_index;
+    if(ws->heap) delete [] ws->heap;
+    
+    if(ws->a_stamp) delete [] ws->a_stamp;
+    if(ws->a_g) delete [] ws->a_g;
+    if(ws->a_f) delete [] ws->a_f;
+    if(ws->a_parent) delete [] ws->a_parent;
+    if(ws->a_heap_index) delete [] ws->a_heap_index;
+    if(ws->a_heap) delete [] ws->a_heap;
+    if(ws->goal_link) delete [] ws->goal_link;
+    if(ws->goal_stamp) delete [] ws->goal_stamp;
+    
+    if(ws->cells) delete [] ws->cells;
+    
+    memset(ws, 0, sizeof(as_workspace));
+}
+
+/*******************************************************************************
+    function    :   astar_module::next_stamp
+    arguments   :   ws - Workspace
+    purpose     :   Advances the search stamp, invalidating all search data.
+    notes       :   Stamps are cleared on wrap around.
+*******************************************************************************/
+void astar_module::next_stamp(as_workspace* ws)
+{
+    if(++ws->stamp_id == 0)
+    {
+        memset(ws->stamp, 0, sizeof(unsigned int) * grid_width * grid_height);
+        memset(ws->a_stamp, 0, sizeof(unsigned int) * (node_count + 2));
+        ws->stamp_id = 1;
+    }
+}
+
+/*******************************************************************************
+    function    :   astar_module::push_cell
+    arguments   :   ws - Workspace
+                    cell - PF cell to append
+    purpose     :   Appends a cell onto the workspace's refined path.
+    notes       :   <none>
+*******************************************************************************/
+void astar_module::push_cell(as_workspace* ws, int cell)
+{
+    int* new_cells;
+    
+    if(ws->cell_count >= ws->cell_capacity)
+    {
+        new_cells = new int[ws->cell_capacity * 2];
+        memcpy(new_cells, ws->cells, sizeof(int) * ws->cell_count);
+        delete [] ws->cells;
+        ws->cells = new_cells;
+        ws->cell_capacity *= 2;
+    }
+    
+    ws->cells[ws->cell_count++] = cell;
+}
+
+/*******************************************************************************
+    function    :   astar_module::heuristic
+    arguments   :   from - PF cell
+                    to - PF cell
+    purpose     :   Returns the octile distance between two cells at the lowest
+                    possible cost multiplier.
+    notes       :   <none>
+*******************************************************************************/
+float astar_module::heuristic(int from, int to)
+{
+    int dx = abs((from % grid_width) - (to % grid_width));
+    int dz = abs((from / grid_width) - (to / grid_width));
+    
+    return (float)AS_CELL_SIZE * ((float)(dx + dz) +
+        (1.41421356f - 2.0f) * (float)(dx < dz ? dx : dz));
+}
+
+/*******************************************************************************
+    function    :   astar_module::expand_cell
+    arguments   :   ws - Workspace
+                    curr - PF cell being expanded (closed)
+                    goal - PF cell being searched for (-1 for none)
+                    x_min, z_min, x_max, z_max - Cell bounds of search
+    purpose     :   Relaxes the neighbors of a cell, adding them onto the open
+                    list as needed.
+    notes       :   Moves are 8-connected, with diagonals not allowed to cut the
+                    corner of a blocked cell. With no goal, the search is a
+                    plain Dijkstra flood.
+*******************************************************************************/
+void astar_module::expand_cell(as_workspace* ws, int curr, int goal,
+    int x_min, int z_min, int x_max, int z_max)
+{
+    int cx = curr % grid_width;
+    int cz = curr / grid_width;
+    int nx, nz;
+    int dx, dz;
+    int next;
+    float g;
+    
+    for(dz = -1; dz <= 1; dz++)
+    {
+        nz = cz + dz;
+        if(nz < z_min || nz > z_max)
+            continue;
+        
+        for(dx = -1; dx <= 1; dx++)
+        {
+            nx = cx + dx;
+            if((dx == 0 && dz == 0) || nx < x_min || nx > x_max)
+                continue;
+            
+            next = nz * grid_width + nx;
+            if(cell_cost[next] < 0.0)
+                continue;
+            
+            // No cutting corners of blocked cells
+            if(dx != 0 && dz != 0 &&
+               (cell_cost[cz * grid_width + nx] < 0.0 ||
+                cell_cost[nz * grid_width + cx] < 0.0))
+                continue;
+            
+            if(ws->stamp[next] != ws->stamp_id)
+            {
+                ws->stamp[next] = ws->stamp_id;
+                ws->g[next] = AS_INFINITY;
+                ws->heap_index[next] = -1;
+            }
+            else if(ws->heap_index[next] == -2)
+                continue;
+            
+            g = ws->g[curr] + step_cost(curr, next, dx != 0 && dz != 0);
+            
+            if(g < ws->g[next])
+            {
+                ws->g[next] = g;
+                ws->f[next] = (goal != -1 ? g + heuristic(next, goal) : g);
+                ws->parent[next] = curr;
+                
+                if(ws->heap_index[next] == -1)
+                    heap_push(ws->heap, ws->heap_index, ws->f,
+                        ws->heap_size, next);
+                else
+                    heap_up(ws->heap, ws->heap_index, ws->f,
+                        ws->heap_index[next]);
+            }
+        }
+    }
+}
+
+/*******************************************************************************
+    function    :   astar_module::search_grid
+    arguments   :   ws - Workspace
+                    start - PF cell to start from
+                    goal - PF cell to reach
+                    x_min, z_min, x_max, z_max - Cell bounds to confine search to
+    purpose     :   Runs A* on the PF grid between two cells, returning the cost
+                    of the path found or -1 if none.
+    notes       :   The parent array of the workspace holds the path found until
+                    the next search.
+*******************************************************************************/
+float astar_module::search_grid(as_workspace* ws, int start, int goal,
+    int x_min, int z_min, int x_max, int z_max)
+{
+    int curr;
+    
+    if(x_min < 0) x_min = 0;
+    if(z_min < 0) z_min = 0;
+    if(x_max >= grid_width) x_max = grid_width - 1;
+    if(z_max >= grid_height) z_max = grid_height - 1;
+    
+    next_stamp(ws);
+    ws->heap_size = 0;
+    
+    ws->stamp[start] = ws->stamp_id;
+    ws->g[start] = 0.0;
+    ws->f[start] = heuristic(start, goal);
+    ws->parent[start] = -1;
+    heap_push(ws->heap, ws->heap_index, ws->f, ws->heap_size, start);
+    
+    while(ws->heap_size > 0)
+    {
+        curr = heap_pop(ws->heap, ws->heap_index, ws->f, ws->heap_size);
+        
+        if(curr == goal)
+            return ws->g[curr];
+        
+        expand_cell(ws, curr, goal, x_min, z_min, x_max, z_max);
+    }
+    
+    return -1.0;
+}
+
+/*******************************************************************************
+    function    :   astar_module::search_grid
+    arguments   :   ws - Workspace
+                    start - PF cell to start from
+                    goal - PF cell to reach
+                    cluster - Cluster to confine search to (-1 for none)
+    purpose     :   Runs A* on the PF grid between two cells within a cluster.
+    notes       :   <none>
+*******************************************************************************/
+float astar_module::search_grid(as_workspace* ws, int start, int goal,
+    int cluster)
+{
+    int x_min = 0, z_min = 0;
+    
+    if(cluster == -1)
+        return search_grid(ws, start, goal, 0, 0, grid_width - 1,
+            grid_height - 1);
+    
+    x_min = (cluster % cluster_width) * AS_CLUSTER_SIZE;
+    z_min = (cluster / cluster_width) * AS_CLUSTER_SIZE;
+    
+    return search_grid(ws, start, goal, x_min, z_min,
+        x_min + AS_CLUSTER_SIZE - 1, z_min + AS_CLUSTER_SIZE - 1);
+}
+
+/*******************************************************************************
+    function    :   astar_module::append_grid_path
+    arguments   :   ws - Workspace
+                    start - PF cell to start from
+                    goal - PF cell to reach
+                    cluster - Cluster to confine search to (-1 for none)
+    purpose     :   Runs a grid search and appends the cells of the path found
+                    (less the start cell) onto the workspace's refined path.
+    notes       :   <none>
+*******************************************************************************/
+bool astar_module::append_grid_path(as_workspace* ws, int start, int goal,
+    int cluster)
+{
+    if(search_grid(ws, start, goal, cluster) < 0.0)
+        return false;
+    
+    append_parents(ws, start, goal);
+    
+    return true;
+}
+
+/*******************************************************************************
+    function    :   astar_module::append_parents
+    arguments   :   ws - Workspace
+                    start - PF cell searched from
+                    goal - PF cell reached
+    purpose     :   Appends the cells of the last path searched (less the start
+                    cell) onto the workspace's refined path.
+    notes       :   <none>
+*******************************************************************************/
+void astar_module::append_parents(as_workspace* ws, int start, int goal)
+{
+    int curr;
+    int count = 0;
+    int i;
+    
+    // Count cells, then write them in from the back
+    for(curr = goal; curr != start; curr = ws->parent[curr])
+        count++;
+    
+    for(i = 0; i < count; i++)
+        push_cell(ws, -1);
+    
+    i = ws->cell_count - 1;
+    for(curr = goal; curr != start; curr = ws->parent[curr])
+        ws->cells[i--] = curr;
+}
+
+/*******************************************************************************
+    function    :   astar_module::search
+    arguments   :   ws - Workspace
+                    start - PF cell to start from
+                    goal - PF cell to reach
+    purpose     :   Runs the hierarchical search between two cells, leaving the
+                    refined path (start cell first) in the workspace.
+    notes       :   The start and goal are linked into the abstract graph as
+                    temporary nodes (node_count and node_count + 1) for the
+                    length of the query only.
+*******************************************************************************/
+bool astar_module::search(as_workspace* ws, int start, int goal)
+{
+    int start_node = node_count;
+    int goal_node = node_count + 1;
+    int start_cluster = cluster_of(start);
+    int goal_cluster = cluster_of(goal);
+    as_edge* start_edges = NULL;
+    as_edge* curr_edge;
+    as_edge* next_edge;
+    int* abstract_path = NULL;
+    int abstract_count = 0;
+    unsigned int abstract_stamp;
+    int curr;
+    int next;
+    int cell_a, cell_b;
+    int i;
+    float cost;
+    float g;
+    bool found = false;
+    
+    ws->cell_count = 0;
+    push_cell(ws, start);
+    
+    if(start == goal)
+        return true;
+    
+    // Same cluster: try a direct local search first
+    if(start_cluster == goal_cluster &&
+       append_grid_path(ws, start, goal, start_cluster))
+        return true;
+    
+    // Link start to the transitions of its cluster
+    for(i = cluster_head[start_cluster]; i != -1; i = node[i].cluster_next)
+    {
+        if(node[i].cell == start)
+            cost = 0.0;
+        else
+            cost = search_grid(ws, start, node[i].cell, start_cluster);
+        
+        if(cost >= 0.0)
+        {
+            curr_edge = new as_edge;
+            curr_edge->node = i;
+            curr_edge->cost = cost;
+            curr_edge->next = start_edges;
+            start_edges = curr_edge;
+        }
+    }
+    
+    // Link the transitions of the goal's cluster to goal
+    if(++ws->link_id == 0)
+    {
+        memset(ws->goal_stamp, 0, sizeof(unsigned int) * (node_count + 2));
+        ws->link_id = 1;
+    }
+    for(i = cluster_head[goal_cluster]; i != -1; i = node[i].cluster_next)
+    {
+        if(node[i].cell == goal)
+            cost = 0.0;
+        else
+            cost = search_grid(ws, node[i].cell, goal, goal_cluster);
+        
+        if(cost >= 0.0)
+        {
+            ws->goal_stamp[i] = ws->link_id;
+            ws->goal_link[i] = cost;
+        }
+    }
+    
+    // Abstract search
+    if(start_edges)
+    {
+        next_stamp(ws);
+        abstract_stamp = ws->stamp_id;
+        ws->a_heap_size = 0;
+        
+        ws->a_stamp[start_node] = abstract_stamp;
+        ws->a_g[start_node] = 0.0;
+        ws->a_f[start_node] = heuristic(start, goal);
+        ws->a_parent[start_node] = -1;
+        heap_push(ws->a_heap, ws->a_heap_index, ws->a_f, ws->a_heap_size,
+            start_node);
+        
+        while(ws->a_heap_size > 0)
+        {
+            curr = heap_pop(ws->a_heap, ws->a_heap_index, ws->a_f,
+                ws->a_heap_size);
+            
+            if(curr == goal_node)
+            {
+                found = true;
+                break;
+            }
+            
+            curr_edge = (curr == start_node ? start_edges : node[curr].edges);
+            
+            // Walk edges, and (as last "edge") the goal link if present
+            for(;;)
+            {
+                if(curr_edge)
+                {
+                    next = curr_edge->node;
+                    g = ws->a_g[curr] + curr_edge->cost;
+                }
+                else if(curr != start_node && ws->goal_stamp[curr] ==
+                        ws->link_id)
+                {
+                    next = goal_node;
+                    g = ws->a_g[curr] + ws->goal_link[curr];
+                }
+                else
+                    break;
+                
+                if(ws->a_stamp[next] != abstract_stamp)
+                {
+                    ws->a_stamp[next] = abstract_stamp;
+                    ws->a_g[next] = AS_INFINITY;
+                    ws->a_heap_index[next] = -1;
+                }
+                
+                if(ws->a_heap_index[next] != -2 && g < ws->a_g[next])
+                {
+                    ws->a_g[next] = g;
+                    ws->a_f[next] = g + heuristic(next == goal_node ? goal :
+                        node[next].cell, goal);
+                    ws->a_parent[next] = curr;
+                    
+                    if(ws->a_heap_index[next] == -1)
+                        heap_push(ws->a_heap, ws->a_heap_index, ws->a_f,
+                            ws->a_heap_size, next);
+                    else
+                        heap_up(ws->a_heap, ws->a_heap_index, ws->a_f,
+                            ws->a_heap_index[next]);
+                }
+                
+                if(curr_edge)
+                    curr_edge = curr_edge->next;
+                else
+                    break;
+            }
+        }
+    }
+    
+    for(curr_edge = start_edges; curr_edge; curr_edge = next_edge)
+    {
+        next_edge = curr_edge->next;
+        delete curr_edge;
+    }
+    
+    if(!found)
+        return false;
+    
+    // Pull out abstract path (goal to start)
+    for(curr = goal_node; curr != -1; curr = ws->a_parent[curr])
+        abstract_count++;
+    abstract_path = new int[abstract_count];
+    i = abstract_count - 1;
+    for(curr = goal_node; curr != -1; curr = ws->a_parent[curr])
+        abstract_path[i--] = curr;
+    
+    // Refine each abstract edge into PF cells
+    for(i = 1; i < abstract_count && found; i++)
+    {
+        cell_a = (abstract_path[i-1] == start_node ? start :
+            node[abstract_path[i-1]].cell);
+        cell_b = (abstract_path[i] == goal_node ? goal :
+            node[abstract_path[i]].cell);
+        
+        if(cell_a == cell_b)
+            continue;
+        
+        if(cluster_of(cell_a) == cluster_of(cell_b))
+            found = append_grid_path(ws, cell_a, cell_b, cluster_of(cell_a));
+        else
+            push_cell(ws, cell_b);          // Inter-edge (adjacent cells)
+    }
+    
+    delete [] abstract_path;
+    
+    return found;
+}
+
+/*******************************************************************************
+    function    :   astar_module::snap_cell
+    arguments   :   cell - PF cell
+    purpose     :   Returns the nearest open cell to the passed cell, or -1 if
+                    there is none within AS_GOAL_SNAP cells.
+    notes       :   <none>
+*******************************************************************************/
+int astar_module::snap_cell(int cell)
+{
+    int cx = cell % grid_width;
+    int cz = cell / grid_width;
+    int x, z;
+    int r;
+    int best = -1;
+    int dist;
+    int best_dist = 0;
+    
+    if(cell_cost[cell] >= 0.0)
+        return cell;
+    
+    for(r = 1; r <= AS_GOAL_SNAP && best == -1; r++)
+    {
+        for(z = cz - r; z <= cz + r; z++)
+        {
+            if(z < 0 || z >= grid_height)
+                continue;
+            
+            for(x = cx - r; x <= cx + r; x++)
+            {
+                if(x < 0 || x >= grid_width ||
+                   (abs(x - cx) != r && abs(z - cz) != r))
+                    continue;
+                
+                if(cell_cost[z * grid_width + x] >= 0.0)
+                {
+                    dist = (x - cx) * (x - cx) + (z - cz) * (z - cz);
+                    if(best == -1 || dist < best_dist)
+                    {
+                        best = z * grid_width + x;
+                        best_dist = dist;
+                    }
+                }
+            }
+        }
+    }
+    
+    return best;
+}
+
+/*******************************************************************************
+    function    :   astar_module::line_clear
+    arguments   :   from_x, from_z - Line start (in PF cells)
+                    to_x, to_z - Line end (in PF cells)
+                    maxCost - Highest cost multiplier allowed along line
+    purpose     :   Determines if a straight line only crosses open cells no
+                    more costly than maxCost.
+    notes       :   Every cell the line touches is visited (grid DDA). A line
+                    passing exactly through a cell corner must have both of the
+                    cells beside the corner open, as with diagonal moves.
+*******************************************************************************/
+bool astar_module::line_clear(float from_x, float from_z, float to_x,
+    float to_z, float maxCost)
+{
+    int x = (int)from_x;
+    int z = (int)from_z;
+    int end_x = (int)to_x;
+    int end_z = (int)to_z;
+    int step_x = (to_x > from_x ? 1 : -1);
+    int step_z = (to_z > from_z ? 1 : -1);
+    float dx = fabsf(to_x - from_x);
+    float dz = fabsf(to_z - from_z);
+    float t_delta_x = (dx > 0.0 ? 1.0 / dx : AS_INFINITY);
+    float t_delta_z = (dz > 0.0 ? 1.0 / dz : AS_INFINITY);
+    float t_max_x;
+    float t_max_z;
+    float cost;
+    
+    t_max_x = (step_x > 0 ? (float)(x + 1) - from_x : from_x - (float)x) *
+        t_delta_x;
+    t_max_z = (step_z > 0 ? (float)(z + 1) - from_z : from_z - (float)z) *
+        t_delta_z;
+    
+    while(x != end_x || z != end_z)
+    {
+        if(t_max_x > 1.0 && t_max_z > 1.0)
+            break;                          // End point on a cell edge
+        
+        if(fabsf(t_max_x - t_max_z) < FP_ERROR)
+        {
+            // Passing through corner, check both side cells
+            cost = cell_cost[z * grid_width + x + step_x];
+            if(cost < 0.0 || cost > maxCost + FP_ERROR)
+                return false;
+            cost = cell_cost[(z + step_z) * grid_width + x];
+            if(cost < 0.0 || cost > maxCost + FP_ERROR)
+                return false;
+            
+            x += step_x;
+            z += step_z;
+            t_max_x += t_delta_x;
+            t_max_z += t_delta_z;
+        }
+        else if(t_max_x < t_max_z)
+        {
+            x += step_x;
+            t_max_x += t_delta_x;
+        }
+        else
+        {
+            z += step_z;
+            t_max_z += t_delta_z;
+        }
+        
+        if(x < 0 || x >= grid_width || z < 0 || z >= grid_height)
+            return false;
+        
+        cost = cell_cost[z * grid_width + x];
+        if(cost < 0.0 || cost > maxCost + FP_ERROR)
+            return false;
+    }
+    
+    return true;
+}
+
+/*******************************************************************************
+    function    :   astar_module::build_path
+    arguments   :   ws - Workspace holding refined path
+                    goalPos - Exact goal position
+                    exactGoal - If goalPos is to end the path
+    purpose     :   Smooths the refined path and converts it to a path list.
+    notes       :   The start cell is not included in the path list. The goal
+                    position replaces the last cell center if it can be reached
+                    in a straight line, otherwise it is added after it.
+*******************************************************************************/
+as_path_node* astar_module::build_path(as_workspace* ws, kVector goalPos,
+    bool exactGoal)
+{
+    as_path_node* head = NULL;
+    as_path_node* tail = NULL;
+    as_path_node* new_node;
+    int anchor = 0;
+    int last_anchor = 0;
+    int best;
+    int j;
+    float max_cost = 0.0;
+    
+    while(anchor < ws->cell_count - 1)
+    {
+        // String pull as far ahead as a clear, no-costlier line allows
+        best = anchor + 1;
+        max_cost = cell_cost[ws->cells[anchor]];
+        if(cell_cost[ws->cells[best]] > max_cost)
+            max_cost = cell_cost[ws->cells[best]];
+        
+        for(j = anchor + 2; j < ws->cell_count &&
+            j - anchor <= AS_SMOOTH_SPAN; j++)
+        {
+            if(cell_cost[ws->cells[j]] > max_cost)
+                max_cost = cell_cost[ws->cells[j]];
+            
+            if(!line_clear(
+                   (float)(ws->cells[anchor] % grid_width) + 0.5,
+                   (float)(ws->cells[anchor] / grid_width) + 0.5,
+                   (float)(ws->cells[j] % grid_width) + 0.5,
+                   (float)(ws->cells[j] / grid_width) + 0.5, max_cost))
+                break;
+            best = j;
+        }
+        
+        new_node = new as_path_node;
+        new_node->pos = kVector(
+            ((float)(ws->cells[best] % grid_width) + 0.5) * AS_CELL_SIZE, 0.0,
+            ((float)(ws->cells[best] / grid_width) + 0.5) * AS_CELL_SIZE);
+        new_node->next = NULL;
+        
+        if(tail)
+            tail->next = new_node;
+        else
+            head = new_node;
+        tail = new_node;
+        
+        last_anchor = anchor;
+        anchor = best;
+    }
+    
+    if(exactGoal)
+    {
+        if(tail && line_clear(
+               (float)(ws->cells[last_anchor] % grid_width) + 0.5,
+               (float)(ws->cells[last_anchor] / grid_width) + 0.5,
+               goalPos[0] / AS_CELL_SIZE, goalPos[2] / AS_CELL_SIZE, max_cost))
+            tail->pos = goalPos;            // Goal replaces last cell center
+        else
+        {
+            new_node = new as_path_node;
+            new_node->pos = goalPos;
+            new_node->next = NULL;
+            
+            if(tail)
+                tail->next = new_node;
+            else
+                head = new_node;
+        }
+    }
+    
+    return head;
+}
+
+/*******************************************************************************
+    function    :   astar_module::copy_path
+    arguments   :   path - Path list
+    purpose     :   Returns a NEW copy of the passed path list.
+    notes       :   <none>
+*******************************************************************************/
+as_path_node* astar_module::copy_path(as_path_node* path)
+{
+    as_path_node* head = NULL;
+    as_path_node* tail = NULL;
+    as_path_node* new_node;
+    
+    for(; path; path = path->next)
+    {
+        new_node = new as_path_node;
+        new_node->pos = path->pos;
+        new_node->next = NULL;
+        
+        if(tail)
+            tail->next = new_node;
+        else
+            head = new_node;
+        tail = new_node;
+    }
+    
+    return head;
+}
+
+/*******************************************************************************
+    function    :   astar_module::cache_lookup
+    arguments   :   start - Start PF cell
+                    goal - Goal PF cell
+    purpose     :   Returns a NEW copy of a cached path, or NULL if not cached.
+    notes       :   Thread safe.
+*******************************************************************************/
+as_path_node* astar_module::cache_lookup(int start, int goal)
+{
+    int i;
+    as_path_node* path = NULL;
+    
+    if(cache_mutex)
+        SDL_mutexP(cache_mutex);
+    
+    for(i = 0; i < AS_CACHE_SIZE; i++)
+    {
+        if(cache[i].path && cache[i].start_cell == start &&
+           cache[i].goal_cell == goal)
+        {
+            cache[i].last_used = ++cache_clock;
+            path = copy_path(cache[i].path);
+            break;
+        }
+    }
+    
+    if(cache_mutex)
+        SDL_mutexV(cache_mutex);
+    
+    return path;
+}
+
+/*******************************************************************************
+    function    :   astar_module::cache_store
+    arguments   :   start - Start PF cell
+                    goal - Goal PF cell
+                    path - Path list
+    purpose     :   Stores a copy of the passed path in the path cache, in place
+                    of the least recently used entry.
+    notes       :   Thread safe.
+*******************************************************************************/
+void astar_module::cache_store(int start, int goal, as_path_node* path)
+{
+    int i;
+    int oldest = 0;
+    as_path_node* copy = copy_path(path);
+    
+    if(cache_mutex)
+        SDL_mutexP(cache_mutex);
+    
+    for(i = 1; i < AS_CACHE_SIZE; i++)
+        if(cache[i].last_used < cache[oldest].last_used)
+            oldest = i;
+    
+    freePath(cache[oldest].path);
+    cache[oldest].start_cell = start;
+    cache[oldest].goal_cell = goal;
+    cache[oldest].path = copy;
+    cache[oldest].last_used = ++cache_clock;
+    
+    if(cache_mutex)
+        SDL_mutexV(cache_mutex);
+}
+
+/*******************************************************************************
+    function    :   astar_module::cache_clear
+    arguments   :   <none>
+    purpose     :   Empties the path cache.
+    notes       :   <none>
+*******************************************************************************/
+void astar_module::cache_clear()
+{
+    int i;
+    
+    for(i = 0; i < AS_CACHE_SIZE; i++)
+    {
+        freePath(cache[i].path);
+        cache[i].path = NULL;
+        cache[i].start_cell = cache[i].goal_cell = -1;
+        cache[i].last_used = 0;
+    }
+    cache_clock = 0;
+}
+
+/*******************************************************************************
+    function    :   astar_module::cell_at
+    arguments   :   x_val, z_val - Position (m)
+    purpose     :   Returns the PF cell at the passed position.
+    notes       :   Positions off the map are clamped to the map's edge.
+*******************************************************************************/
+inline int astar_module::cell_at(float x_val, float z_val)
+{
+    int x = (int)(x_val / AS_CELL_SIZE);
+    int z = (int)(z_val / AS_CELL_SIZE);
+    
+    if(x < 0) x = 0; else if(x >= grid_width) x = grid_width - 1;
+    if(z < 0) z = 0; else if(z >= grid_height) z = grid_height - 1;
+    
+    return z * grid_width + x;
+}
+
+/*******************************************************************************
+    function    :   astar_module::buildGraph
+    arguments   :   <none>
+    purpose     :   Builds the PF grid and abstract graph for the current map.
+    notes       :   Must be called after the scenery has been built.
+*******************************************************************************/
+void astar_module::buildGraph()
+{
+    int i;
+    
+    free_graph();
+    
+    build_grid();
+    
+    cluster_width = (grid_width + AS_CLUSTER_SIZE - 1) / AS_CLUSTER_SIZE;
+    cluster_height = (grid_height + AS_CLUSTER_SIZE - 1) / AS_CLUSTER_SIZE;
+    
+    cluster_head = new int[cluster_width * cluster_height];
+    for(i = 0; i < cluster_width * cluster_height; i++)
+        cluster_head[i] = -1;
+    
+    cell_node = new int[grid_width * grid_height];
+    for(i = 0; i < grid_width * grid_height; i++)
+        cell_node[i] = -1;
+    
+    build_entrances();
+    
+    // Intra edges need the grid half of the workspace only, so the workspace
+    // is allocated now that the node count is final.
+    alloc_workspace(&workspace);
+    
+    build_intra_edges();
+    
+    start_workers();
+}
+
+/*******************************************************************************
+    function    :   astar_module::find_path
+    arguments   :   ws - Workspace to search with
+                    start - Position to path from
+                    end - Position to path to
+    purpose     :   Finds a path between two positions, returning it as a NEW
+                    path list (start not included), or NULL if none.
+    notes       :   1) If the end position is blocked, the path leads to the
+                       nearest open cell instead. A blocked start position
+                       (such as the end of a chained request) is likewise
+                       moved to the nearest open cell.
+                    2) Safe to call from any thread with its own workspace.
+*******************************************************************************/
+as_path_node* astar_module::find_path(as_workspace* ws, kVector start,
+    kVector end)
+{
+    int start_cell;
+    int goal_cell;
+    int end_cell;
+    as_path_node* path;
+    
+    if(!cell_cost)
+        return NULL;
+    
+    start_cell = snap_cell(cell_at(start[0], start[2]));
+    end_cell = cell_at(end[0], end[2]);
+    goal_cell = snap_cell(end_cell);
+    
+    if(start_cell == -1 || goal_cell == -1)
+        return NULL;
+    
+    if((path = cache_lookup(start_cell, goal_cell)))
+    {
+        if(goal_cell == end_cell)
+        {
+            // Path may have been cached for another point in the goal cell
+            as_path_node* last = path;
+            while(last->next)
+                last = last->next;
+            last->pos = end;
+        }
+        return path;
+    }
+    
+    if(!search(ws, start_cell, goal_cell))
+        return NULL;
+    
+    path = build_path(ws, end, goal_cell == end_cell);
+    
+    if(path)
+        cache_store(start_cell, goal_cell, path);
+    
+    return path;
+}
+
+/*******************************************************************************
+    function    :   astar_module::apply_path
+    arguments   :   unit - Unit to apply path to
+                    path - Path list (NULL if none found)
+                    end - Position pathed to
+                    modifiers - Waypoint modifiers
+    purpose     :   Appends a path onto the unit's waypoint list, or the end
+                    position as a direct waypoint if there is no path.
+    notes       :   Only the first waypoint is left untransmitted, so that the
+                    whole path is received as a single order.
+*******************************************************************************/
+void astar_module::apply_path(moving_object* unit, as_path_node* path,
+    kVector end, unsigned int modifiers)
+{
+    as_path_node* curr;
+    
+    if(!path)
+    {
+        unit->addWaypoint(end, modifiers);
+        return;
+    }
+    
+    unit->addWaypoint(path->pos, modifiers | WP_MOD_PF_ASSIGNED);
+    for(curr = path->next; curr; curr = curr->next)
+        unit->addWaypoint(curr->pos,
+            modifiers | WP_MOD_PF_ASSIGNED | WP_MOD_TRANSMITTED);
+}
+
+/*******************************************************************************
+    function    :   astar_module::findPath
+    arguments   :   start - Position to path from
+                    end - Position to path to
+    purpose     :   Finds a path between two positions, returning it as a NEW
+                    path list (start not included), or NULL if none.
+    notes       :   If the end position is blocked, the path leads to the
+                    nearest open cell instead.
+*******************************************************************************/
+as_path_node* astar_module::findPath(kVector start, kVector end)
+{
+    return find_path(&workspace, start, end);
+}
+
+/*******************************************************************************
+    function    :   astar_module::generatePath
+    arguments   :   start - Position to path from
+                    end - Position to path to
+    purpose     :   Finds a path between two positions and returns the point at
+                    which it ends (the start position if no path was found).
+    notes       :   <none>
+*******************************************************************************/
+kVector astar_module::generatePath(kVector start, kVector end)
+{
+    as_path_node* path = findPath(start, end);
+    as_path_node* last;
+    kVector end_point = start;
+    
+    if(path)
+    {
+        for(last = path; last->next; last = last->next) ;
+        end_point = last->pos;
+        end_point[1] = map.getHeight(end_point[0], end_point[2]);
+        freePath(path);
+    }
+    
+    return end_point;
+}
+
+/*******************************************************************************
+    function    :   astar_module::freePath
+    arguments   :   path - Path list
+    purpose     :   Frees a path list returned from findPath.
+    notes       :   <none>
+*******************************************************************************/
+void astar_module::freePath(as_path_node* path)
+{
+    as_path_node* next;
+    
+    for(; path; path = next)
+    {
+        next = path->next;
+        delete path;
+    }
+}
+
+/*******************************************************************************
+    function    :   astar_module::requestPath
+    arguments   :   unit - Unit to path for
+                    end - Position to path to
+                    modifiers - Waypoint modifiers
+    purpose     :   Queues a path request for the worker threads. Once solved,
+                    the path is appended onto the unit's waypoint list (see
+                    apply_path), during the next update.
+    notes       :   1) Requests for the same unit are applied in the order made,
+                       each starting from where the last one ends.
+                    2) Requests are held back from the workers until the next
+                       update, so that a tick's orders can be grouped.
+*******************************************************************************/
+void astar_module::requestPath(moving_object* unit, kVector end,
+    unsigned int modifiers)
+{
+    as_request* new_request;
+    as_request* curr;
+    
+    if(!request_mutex)
+    {
+        // No graph built, so no pathfinding
+        unit->addWaypoint(end, modifiers);
+        return;
+    }
+    
+    new_request = new as_request;
+    new_request->unit = unit;
+    new_request->start = (unit->wl_tail ? unit->wl_tail->waypoint : unit->pos);
+    new_request->end = end;
+    new_request->modifiers = modifiers;
+    new_request->state = AS_REQ_QUEUED;
+    new_request->path = NULL;
+    new_request->next = NULL;
+    
+    SDL_mutexP(request_mutex);
+    
+    // Chain onto the end of any request still queued for this unit
+    for(curr = rq_head; curr; curr = curr->next)
+        if(curr->unit == unit)
+            new_request->start = curr->end;
+    
+    if(rq_tail)
+        rq_tail->next = new_request;
+    else
+        rq_head = new_request;
+    rq_tail = new_request;
+    
+    SDL_mutexV(request_mutex);
+}
+
+/*******************************************************************************
+    function    :   astar_module::cancelPaths
+    arguments   :   unit - Unit to cancel requests of
+    purpose     :   Cancels all queued path requests of the passed unit.
+    notes       :   Requests being solved are left in the queue (as cancelled)
+                    until their worker is done with them.
+*******************************************************************************/
+void astar_module::cancelPaths(moving_object* unit)
+{
+    as_request* curr;
+    
+    if(!request_mutex)
+        return;
+    
+    SDL_mutexP(request_mutex);
+    for(curr = rq_head; curr; curr = curr->next)
+        if(curr->unit == unit)
+            curr->unit = NULL;
+    SDL_mutexV(request_mutex);
+}
+
+/*******************************************************************************
+    function    :   astar_module::update
+    arguments   :   <none>
+    purpose     :   Applies finished path requests to their units, and drops
+                    cancelled ones.
+    notes       :   1) At most AS_APPLY_BUDGET paths are applied per call, and a
+                       request is held back while an earlier request of the
+                       same unit is unfinished.
+                    2) Requests made since the last call are first released
+                       to the workers.
+                    3) Without workers, pending requests are solved here, for
+                       up to AS_SOLVE_BUDGET ms per call.
+*******************************************************************************/
+void astar_module::update()
+{
+    as_request* prev;
+    as_request* curr;
+    as_request* next;
+    as_request* check;
+    as_request* apply_head = NULL;
+    as_request* apply_tail = NULL;
+    as_request* group[AS_FLOW_MAX_UNITS];
+    int count;
+    int applied = 0;
+    int i;
+    Uint32 start_time;
+    bool held;
+    bool released = false;
+    
+    if(!request_mutex || !rq_head)
+        return;
+    
+    // Release last tick's requests to the workers
+    SDL_mutexP(request_mutex);
+    for(curr = rq_head; curr; curr = curr->next)
+    {
+        if(curr->state == AS_REQ_QUEUED)
+        {
+            curr->state = AS_REQ_PENDING;
+            released = true;
+        }
+    }
+    if(released)
+        SDL_CondBroadcast(request_cond);
+    SDL_mutexV(request_mutex);
+    
+    // Solve here if there are no workers to do so
+    if(worker_count == 0)
+    {
+        start_time = SDL_GetTicks();
+        do
+        {
+            SDL_mutexP(request_mutex);
+            count = take_requests(group);
+            SDL_mutexV(request_mutex);
+            
+            if(count == 0)
+                break;
+            
+            solve_requests(&workspace, group, count);
+            
+            for(i = 0; i < count; i++)
+                group[i]->state = AS_REQ_DONE;
+        } while(SDL_GetTicks() - start_time < AS_SOLVE_BUDGET);
+    }
+    
+    // Pull finished requests off of the queue
+    SDL_mutexP(request_mutex);
+    
+    prev = NULL;
+    for(curr = rq_head; curr; curr = next)
+    {
+        next = curr->next;
+        
+        if(curr->unit == NULL)
+        {
+            if(curr->state == AS_REQ_SOLVING)
+            {
+                prev = curr;
+                continue;                   // Worker still has it
+            }
+        }
+        else
+        {
+            held = (curr->state != AS_REQ_DONE ||
+                applied >= AS_APPLY_BUDGET);
+            
+            for(check = rq_head; check != curr && !held; check = check->next)
+                if(check->unit == curr->unit)
+                    held = true;
+            
+            if(held)
+            {
+                prev = curr;
+                continue;
+            }
+            
+            applied++;
+        }
+        
+        // Unlink
+        if(prev)
+            prev->next = next;
+        else
+            rq_head = next;
+        if(rq_tail == curr)
+            rq_tail = prev;
+        
+        curr->next = NULL;
+        if(apply_tail)
+            apply_tail->next = curr;
+        else
+            apply_head = curr;
+        apply_tail = curr;
+    }
+    
+    SDL_mutexV(request_mutex);
+    
+    // Apply outside of the lock (addWaypoint may kill waypoints/requests)
+    for(curr = apply_head; curr; curr = next)
+    {
+        next = curr->next;
+        
+        if(curr->unit)
+            apply_path(curr->unit, curr->path, curr->end, curr->modifiers);
+        
+        freePath(curr->path);
+        delete curr;
+    }
+}
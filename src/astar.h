@@ -0,0 +1,272 @@
+/*******************************************************************************
+                        Pathfinding Module - Definition
+*******************************************************************************/
+#ifndef ASTAR_H
+#define ASTAR_H
+
+#include "metrics.h"
+#include "objunit.h"
+
+// Pathfinding Grid & Abstraction
+#define AS_CELL_SIZE                3.0     // PF grid cell size (m)
+#define AS_CLUSTER_SIZE             10      // PF cells across/down a cluster
+#define AS_ENTRANCE_SPLIT           6       // Entrance width using 2 transitions
+#define AS_BLOCKED                  255     // Blockmap value of impassable
+#define AS_GOAL_SNAP                5       // Cells searched for an open goal
+#define AS_SMOOTH_SPAN              40      // Max cells skipped when smoothing
+#define AS_CACHE_SIZE               32      // Paths kept in path cache
+
+// Path Requests
+#define AS_WORKER_THREADS           2       // Path solving worker threads
+#define AS_APPLY_BUDGET             8       // Max results applied per tick
+#define AS_SOLVE_BUDGET             2       // Max ms solving per tick (no workers)
+
+#define AS_REQ_QUEUED               0       // Request made this tick
+#define AS_REQ_PENDING              1       // Request waiting for a worker
+#define AS_REQ_SOLVING              2       // Request being solved
+#define AS_REQ_DONE                 3       // Request solved, awaiting apply
+
+// Flow Fields
+#define AS_FLOW_MIN_UNITS           3       // Requests sharing goal area for flow
+#define AS_FLOW_AREA                10      // Goal area half size (cells)
+#define AS_FLOW_MAX_UNITS           32      // Max requests solved per flow field
+
+// Path Node (returned path list, LL)
+struct as_path_node
+{
+    kVector pos;                        // Waypoint position
+    as_path_node* next;
+};
+
+// Path Request (request queue, LL)
+struct as_request
+{
+    moving_object* unit;                // Unit to apply to (NULL if cancelled)
+    kVector start;                      // Position to path from
+    kVector end;                        // Position to path to
+    unsigned int modifiers;             // Waypoint modifiers
+    int state;                          // Request state
+    as_path_node* path;                 // Path found (once done)
+    as_request* next;
+};
+
+// Search Workspace (scratch data for a single search at a time)
+struct as_workspace
+{
+    unsigned int stamp_id;              // Current search stamp
+    
+    // Grid search data (per PF cell)
+    unsigned int* stamp;                // Stamp of last search touching cell
+    float* g;                           // Cost from start
+    float* f;                           // Cost from start + heuristic
+    int* parent;                        // Parent cell
+    int* heap_index;                    // Index in open list (-1 none, -2 closed)
+    int* heap;                          // Open list (binary heap)
+    int heap_size;
+    
+    // Abstract search data (per abstract node, + start & goal)
+    unsigned int* a_stamp;
+    float* a_g;
+    float* a_f;
+    int* a_parent;
+    int* a_heap_index;
+    int* a_heap;
+    int a_heap_size;
+    float* goal_link;                   // Cost of node to goal (if linked)
+    unsigned int* goal_stamp;           // Query stamp of goal link
+    unsigned int link_id;               // Current query stamp
+    
+    // Path cells (refined path)
+    int* cells;
+    int cell_count;
+    int cell_capacity;
+};
+
+/*******************************************************************************
+    class       :   astar_module
+    purpose     :   Pathfinding service for ground units. Paths are found with
+                    hierarchical A* (HPA*) over a coarse grid built from the
+                    scenery blockmap, where each grid cell's traversal cost is
+                    taken from the blockmap speed multiplier (so roads are
+                    preferred over fields, fields over woods, and so on).
+    notes       :   1) The map is cut into clusters of AS_CLUSTER_SIZE cells.
+                       Transition nodes are placed on the open runs of each
+                       cluster border, and connected to each other inside of
+                       each cluster by local A* costs. Queries search this
+                       small abstract graph and then refine each leg with a
+                       local A* confined to a single cluster.
+                    2) Refined paths are smoothed by string pulling, which is
+                       only allowed over cells no more costly than the ones
+                       skipped, so that smoothing never cuts a road corner.
+                    3) Recent queries are kept in a small path cache keyed on
+                       start and goal cell, since platoon orders tend to
+                       repeat the same query.
+                    4) Paths are returned as NEW allocations (see freePath).
+                       Paths solved for a unit's request are appended onto
+                       its waypoint list, each waypoint tagged with
+                       WP_MOD_PF_ASSIGNED.
+                    5) requestPath queues the query for the worker threads
+                       instead, which solve against the PF grid (a snapshot of
+                       the blockmap that is not touched after buildGraph), and
+                       update applies finished paths to their units on the
+                       next object tick, at most AS_APPLY_BUDGET per tick.
+                    6) Requests made in the same tick whose goals share an
+                       area (such as a platoon's moveTo orders) are solved
+                       together with one flow field: a single Dijkstra flood
+                       out from all of their goals, which each unit then
+                       follows down from its start, instead of one search per
+                       unit.
+*******************************************************************************/
+class astar_module
+{
+    private:
+        // Abstract graph edge (LL)
+        struct as_edge
+        {
+            int node;                   // Node edge leads to
+            float cost;                 // Traversal cost
+            as_edge* next;
+        };
+        
+        // Abstract graph node (cluster transition)
+        struct as_node
+        {
+            int cell;                   // PF cell of node
+            int cluster;                // Cluster of node
+            int cluster_next;           // Next node in cluster (-1 end)
+            as_edge* edges;             // Edge list
+        };
+        
+        // Worker thread
+        struct as_worker
+        {
+            astar_module* module;       // Owning module
+            SDL_Thread* thread;
+            as_workspace workspace;     // Worker's own search workspace
+        };
+        
+        // Path cache entry
+        struct as_cache_entry
+        {
+            int start_cell;
+            int goal_cell;
+            as_path_node* path;         // Cached path (NULL if unused)
+            unsigned int last_used;     // Cache clock at last use
+        };
+        
+        /* Pathfinding Grid */
+        int grid_width;                 // PF cells across/down map
+        int grid_height;
+        float* cell_cost;               // Cost multiplier per cell (<0 blocked)
+        
+        /* Abstract Graph */
+        int cluster_width;              // Clusters across/down map
+        int cluster_height;
+        int* cluster_head;              // First node in each cluster (-1 none)
+        int* cell_node;                 // Node at each PF cell (-1 none)
+        as_node* node;                  // Abstract nodes
+        int node_count;
+        int node_capacity;
+        
+        /* Path Cache */
+        as_cache_entry cache[AS_CACHE_SIZE];
+        unsigned int cache_clock;
+        
+        /* Search Workspace */
+        as_workspace workspace;         // Main thread's search workspace
+        
+        /* Path Requests */
+        as_request* rq_head;            // Request queue (in order requested)
+        as_request* rq_tail;
+        SDL_mutex* request_mutex;       // Guards request queue
+        SDL_cond* request_cond;         // Signals new requests/quit
+        SDL_mutex* cache_mutex;         // Guards path cache
+        as_worker worker[AS_WORKER_THREADS];
+        int worker_count;               // Workers running
+        bool workers_quit;              // Set to stop workers
+        
+        /* Building Routines */
+        void build_grid();
+        void build_entrances();
+        void build_intra_edges();
+        int add_node(int cell);
+        void add_edge(int from, int to, float cost);
+        void free_graph();
+        
+        /* Worker Routines */
+        static int worker_thread(void* data);
+        void start_workers();
+        void stop_workers();
+        void free_requests();
+        int take_requests(as_request** group);
+        void solve_requests(as_workspace* ws, as_request** group, int count);
+        void flow_paths(as_workspace* ws, as_request** group, int count);
+        
+        /* Workspace Routines */
+        void alloc_workspace(as_workspace* ws);
+        void free_workspace(as_workspace* ws);
+        void next_stamp(as_workspace* ws);
+        void push_cell(as_workspace* ws, int cell);
+        
+        /* Search Routines */
+        inline float step_cost(int from, int to, bool diagonal)
+            { return (diagonal ? 1.41421356f : 1.0f) * (float)AS_CELL_SIZE *
+                  0.5f * (cell_cost[from] + cell_cost[to]); }
+        float heuristic(int from, int to);
+        void expand_cell(as_workspace* ws, int curr, int goal, int x_min,
+            int z_min, int x_max, int z_max);
+        float search_grid(as_workspace* ws, int start, int goal, int x_min,
+            int z_min, int x_max, int z_max);
+        float search_grid(as_workspace* ws, int start, int goal, int cluster);
+        bool append_grid_path(as_workspace* ws, int start, int goal, int cluster);
+        void append_parents(as_workspace* ws, int start, int goal);
+        bool search(as_workspace* ws, int start, int goal);
+        int snap_cell(int cell);
+        bool line_clear(float from_x, float from_z, float to_x, float to_z,
+            float maxCost);
+        as_path_node* build_path(as_workspace* ws, kVector goalPos, bool exactGoal);
+        as_path_node* find_path(as_workspace* ws, kVector start, kVector end);
+        void apply_path(moving_object* unit, as_path_node* path, kVector end,
+            unsigned int modifiers);
+        
+        /* Cache Routines */
+        as_path_node* copy_path(as_path_node* path);
+        as_path_node* cache_lookup(int start, int goal);
+        void cache_store(int start, int goal, as_path_node* path);
+        void cache_clear();
+        
+        /* Misc. Routines */
+        inline int cell_at(float x_val, float z_val);
+        inline int cluster_of(int cell)
+            { return ((cell / grid_width) / AS_CLUSTER_SIZE) * cluster_width +
+                  ((cell % grid_width) / AS_CLUSTER_SIZE); }
+    
+    public:
+        astar_module();                 // Constructor
+        ~astar_module();                // Deconstructor
+        
+        /* Building Routine */
+        void buildGraph();              // Builds PF grid & abstract graph
+        
+        /* Pathfinding Routines */
+        as_path_node* findPath(kVector start, kVector end);
+        kVector generatePath(kVector start, kVector end);
+        void freePath(as_path_node* path);
+        
+        /* Path Request Routines */
+        void requestPath(moving_object* unit, kVector end,
+            unsigned int modifiers = WP_MOD_FORWARD);
+        void cancelPaths(moving_object* unit);
+        
+        /* Update Routine */
+        void update();                  // Applies finished path requests
+        
+        /* Accessors */
+        bool isBuilt() { return cell_cost != NULL; }
+        int getGridWidth() { return grid_width; }
+        int getGridHeight() { return grid_height; }
+};
+
+extern astar_module astar;
+
+#endif
@@ -15,6 +15,7 @@
 #include "objmodules.h"
 #include "projectile.h"
 #include "scenery.h"
+#include "snapshot.h"
 #include "sounds.h"
 
 /*******************************************************************************
@@ -209,12 +210,14 @@ void atg_object::initATG()
                     attachmentLevelTo - conversion to this attachment level
     purpose     :   Function that perform transformations based on attachment
                     levels for 3D coordinate transforms.
-    notes       :   <none>
+    notes       :   1) Every level is a single pass through a matrix cached by
+                       updateMatrices (inverse passes for transforms to gun
+                       levels), so repeated queries cost no GL calls.
+                    2) The gun mount matricies carry the mantlet's recoil, the
+                       rest of the gun's recoil is applied to the position.
 *******************************************************************************/
 kVector atg_object::transform(kVector position, int attachLevelFrom, int attachLevelTo)
 {
-    GLfloat matrix[16];
-    
     if(attachLevelFrom == attachLevelTo)
         return position;
     
@@ -240,13 +243,8 @@ kVector atg_object::transform(kVector position, int attachLevelFrom, int attachL
                 case OBJ_ATTACH_GUN3:
                 case OBJ_ATTACH_GUN4:
                 case OBJ_ATTACH_GUN5:
-                    glMatrixMode(GL_MODELVIEW);
-                    glPushMatrix();
-                    glLoadMatrixf(gun_matrix[0]);
-                    glTranslatef(0.0, 0.0, -gun[0].getGunRecoil());
-                    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-                    glPopMatrix();
-                    return transformed(position, (float*)matrix);
+                    position[2] -= gun[0].getGunRecoil();       // Recoil gun
+                    return transformed(position, (float*)gun_matrix[0]);
                     break;
                 
                 default:
@@ -263,19 +261,7 @@ kVector atg_object::transform(kVector position, int attachLevelFrom, int attachL
                 case OBJ_ATTACH_GUNMNT3:
                 case OBJ_ATTACH_GUNMNT4:
                 case OBJ_ATTACH_GUNMNT5:
-                    glMatrixMode(GL_MODELVIEW);
-                    glPushMatrix();
-                    glLoadIdentity();
-                    // Gun is attached to main hull (enabled gun transverse)
-                    glTranslatef(gun[0].getGunPivotV()[0],
-                                 gun[0].getGunPivotV()[1],
-                                 gun[0].getGunPivotV()[2]);
-                    glRotatef(gun[0].getTransverse() * radToDeg, 0.0, 1.0, 0.0);
-                    glRotatef((gun[0].getElevate() * radToDeg) - 90.0, 1.0, 0.0, 0.0);
-                    glTranslatef(0.0, 0.0, 0.5 * -gun[0].getGunRecoil());  // Recoil gun mantlet
-                    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-                    glPopMatrix();
-                    return transformed(position, (float*)matrix);
+                    return transformed(position, (float*)gun_local_matrix[0]);
                     break;
                 
                 case OBJ_ATTACH_GUN1:
@@ -283,20 +269,8 @@ kVector atg_object::transform(kVector position, int attachLevelFrom, int attachL
                 case OBJ_ATTACH_GUN3:
                 case OBJ_ATTACH_GUN4:
                 case OBJ_ATTACH_GUN5:
-                    glMatrixMode(GL_MODELVIEW);
-                    glPushMatrix();
-                    glLoadIdentity();
-                    // Gun is attached to main hull (enabled gun transverse)
-                    glTranslatef(gun[0].getGunPivotV()[0],
-                                 gun[0].getGunPivotV()[1],
-                                 gun[0].getGunPivotV()[2]);
-                    glRotatef(gun[0].getTransverse() * radToDeg, 0.0, 1.0, 0.0);
-                    glRotatef((gun[0].getElevate() * radToDeg) - 90.0, 1.0, 0.0, 0.0);
-                    glTranslatef(0.0, 0.0, 0.5 * -gun[0].getGunRecoil());  // Recoil gun mantlet
-                    glTranslatef(0.0, 0.0, -gun[0].getGunRecoil());     // Recoil gun
-                    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-                    glPopMatrix();
-                    return transformed(position, (float*)matrix);
+                    position[2] -= gun[0].getGunRecoil();       // Recoil gun
+                    return transformed(position, (float*)gun_local_matrix[0]);
                     break;
                 
                 default:
@@ -313,19 +287,7 @@ kVector atg_object::transform(kVector position, int attachLevelFrom, int attachL
             switch(attachLevelFrom)
             {
                 case OBJ_ATTACH_HULL:
-                    glMatrixMode(GL_MODELVIEW);
-                    glPushMatrix();
-                    glLoadIdentity();
-                    // Gun is attached to main hull (enabled gun transverse)
-                    glTranslatef(0.0, 0.0, 0.5 * gun[0].getGunRecoil());  // Recoil gun mantlet
-                    glRotatef(-((gun[0].getElevate() * radToDeg) - 90.0), 1.0, 0.0, 0.0);
-                    glRotatef(-gun[0].getTransverse() * radToDeg, 0.0, 1.0, 0.0);
-                    glTranslatef(-gun[0].getGunPivotV()[0],
-                                 -gun[0].getGunPivotV()[1],
-                                 -gun[0].getGunPivotV()[2]);
-                    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-                    glPopMatrix();
-                    return transformed(position, (float*)matrix);
+                    return untransformed(position, (float*)gun_local_matrix[0]);
                     break;
                 
                 case OBJ_ATTACH_GUNMNT1:
@@ -357,20 +319,9 @@ kVector atg_object::transform(kVector position, int attachLevelFrom, int attachL
             switch(attachLevelFrom)
             {
                 case OBJ_ATTACH_HULL:
-                    glMatrixMode(GL_MODELVIEW);
-                    glPushMatrix();
-                    glLoadIdentity();
-                    // Gun is attached to main hull (enabled gun transverse)
-                    glTranslatef(0.0, 0.0, gun[0].getGunRecoil());
-                    glTranslatef(0.0, 0.0, 0.5 * gun[0].getGunRecoil());  // Recoil gun mantlet
-                    glRotatef(-((gun[0].getElevate() * radToDeg) - 90.0), 1.0, 0.0, 0.0);
-                    glRotatef(-gun[0].getTransverse() * radToDeg, 0.0, 1.0, 0.0);
-                    glTranslatef(-gun[0].getGunPivotV()[0],
-                                 -gun[0].getGunPivotV()[1],
-                                 -gun[0].getGunPivotV()[2]);
-                    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-                    glPopMatrix();
-                    return transformed(position, (float*)matrix);
+                    position = untransformed(position, (float*)gun_local_matrix[0]);
+                    position[2] += gun[0].getGunRecoil();       // Recoil gun
+                    return position;
                     break;
                 
                 case OBJ_ATTACH_GUNMNT1:
@@ -400,13 +351,69 @@ kVector atg_object::transform(kVector position, int attachLevelFrom, int attachL
     }
 }
 
+/*******************************************************************************
+    function    :   atg_object::updateMatrices
+    arguments   :   <none>
+    purpose     :   Updates the cached hull and gun mount matricies, rebuilding
+                    only those whose hull or gun has moved since they were last
+                    built.
+    notes       :   The gun mount carries half of the gun's recoil (the recoil
+                    of the gun mantlet), so recoil also moves it.
+*******************************************************************************/
+void atg_object::updateMatrices()
+{
+    bool hull_moved;
+    bool gun_moved;
+    
+    // Update Hull Matrix
+    hull_moved = updateHullMatrix();
+    
+    // Update Gun Matrix
+    gun_moved = gunMoved(0, 0.5 * gun[0].getGunRecoil());
+    if(gun_moved)
+    {
+        // Gun is attached to main hull (enabled gun transverse)
+        matrixIdentity(gun_local_matrix[0]);
+        matrixTranslate(gun_local_matrix[0], gun[0].getGunPivotV()[0],
+            gun[0].getGunPivotV()[1], gun[0].getGunPivotV()[2]);
+        matrixRotateY(gun_local_matrix[0], gun[0].getTransverse());
+        matrixRotateX(gun_local_matrix[0], gun[0].getElevate() - PIHALF);
+        matrixTranslate(gun_local_matrix[0], 0.0, 0.0,
+            0.5 * -gun[0].getGunRecoil());      // Recoil gun mantlet
+    }
+    
+    if(gun_moved || hull_moved)
+        matrixMultiply(gun_matrix[0], hull_matrix, gun_local_matrix[0]);
+    
+    matrix_dirty = false;
+}
+
 /*******************************************************************************
     function    :   atg_object::update
     arguments   :   deltaT - number of seconds elapsed since last update
     purpose     :   Updates the ATG object model.
-    notes       :   <none>
+    notes       :   The object handler runs these steps itself, one pass over
+                    all ATGs (or all unit modules) each, in this same order.
 *******************************************************************************/
 void atg_object::update(float deltaT)
+{
+    updateBegin(deltaT);
+    
+    // Update unit modules
+    updateUnit(deltaT);
+    updateWeapons(deltaT);
+    
+    updateEnd(deltaT);
+}
+
+/*******************************************************************************
+    function    :   atg_object::updateBegin
+    arguments   :   deltaT - number of seconds elapsed since last update
+    purpose     :   ATG update done before the unit modules are updated
+                    (orientation on the terrain).
+    notes       :   <none>
+*******************************************************************************/
+void atg_object::updateBegin(float deltaT)
 {
     kVector front_left(size[0]/2.0, 0.0, size[2]/2.0);
     kVector front_right(-size[0]/2.0, 0.0, size[2]/2.0);
@@ -415,6 +422,7 @@ void atg_object::update(float deltaT)
     float desired_pitch;
     float desired_roll;
     float desired_height;
+    float corner_x[4], corner_z[4], corner_y[4];    // Batched height query
     
     // Transforms vectors based on orientation matrix
     front_left.transform((float*)hull_matrix);
@@ -422,11 +430,16 @@ void atg_object::update(float deltaT)
     rear_left.transform((float*)hull_matrix);
     rear_right.transform((float*)hull_matrix);
     
-    // Get new height values for transformed values
-    front_left[1] = map.getOverlayHeight(front_left[0], front_left[2]);
-    front_right[1] = map.getOverlayHeight(front_right[0], front_right[2]);
-    rear_left[1] = map.getOverlayHeight(rear_left[0], rear_left[2]);
-    rear_right[1] = map.getOverlayHeight(rear_right[0], rear_right[2]);
+    // Get new height values for transformed values (batched)
+    corner_x[0] = front_left[0];   corner_z[0] = front_left[2];
+    corner_x[1] = front_right[0];  corner_z[1] = front_right[2];
+    corner_x[2] = rear_left[0];    corner_z[2] = rear_left[2];
+    corner_x[3] = rear_right[0];   corner_z[3] = rear_right[2];
+    map.getOverlayHeights(4, corner_x, corner_z, corner_y);
+    front_left[1] = corner_y[0];
+    front_right[1] = corner_y[1];
+    rear_left[1] = corner_y[2];
+    rear_right[1] = corner_y[3];
     
     // Pitch Recalculation
     desired_pitch = PIHALF - (((
@@ -518,78 +531,75 @@ void atg_object::update(float deltaT)
         else
             dir[2] -= 0.1 * deltaT;
     }
+}
+
+/*******************************************************************************
+    function    :   atg_object::updateEnd
+    arguments   :   deltaT - number of seconds elapsed since last update
+    purpose     :   ATG update done after the unit modules are updated.
+    notes       :   <none>
+*******************************************************************************/
+void atg_object::updateEnd(float deltaT)
+{
+    // Update Matricies
+    updateMatrices();
+}
+
+/*******************************************************************************
+    function    :   atg_object::snapshot
+    arguments   :   snap - Render snapshot record to fill
+    purpose     :   Records what is displayed of our ATG object.
+    notes       :   <none>
+*******************************************************************************/
+void atg_object::snapshot(snap_object* snap)
+{
+    int i;
     
-    // Update unit modules
-    updateUnit(deltaT);
-    updateWeapons(deltaT);
+    object::snapshot(snap);
     
-    // Update Matricies
-    glMatrixMode(GL_MODELVIEW);
+    snap->kind = SNAP_OBJ_ATG;
+    snap->selected = selected;
+    snap->hull_dspList = hull_dspList;
+    snap->selected_dspList = selected_dspList;
+    
+    snap->gun_count = gun_count;
+    for(i = 0; i < gun_count; i++)
+    {
+        matrixCopy((float*)snap->gun_matrix[i], (float*)gun_matrix[i]);
+        snap->gun_mant_dspList[i] = gun_mant_dspList[i];
+        snap->gun_dspList[i] = gun_dspList[i];
+        snap->gun_recoil[i] = gun[i].getGunRecoil();
+    }
+}
+
+/*******************************************************************************
+    function    :   atg_object::display
+    arguments   :   snap - Render snapshot record of ATG
+    purpose     :   Base display function which displays our ATG object.
+    notes       :   Culling is done by the snapshot module.
+*******************************************************************************/
+void atg_object::display(snap_object* snap)
+{
     glPushMatrix();
     
-    glLoadIdentity();
+    glMultMatrixf(snap->hull_matrix);
     
-    // Update Hull Matrix
-    glTranslatef(pos[0], pos[1], pos[2]);
-    glRotatef(dir[2] * radToDeg, 0.0, 1.0, 0.0);
-    glRotatef((dir[1] * radToDeg) - 90.0, 1.0, 0.0, 0.0);
-    glRotatef(roll * radToDeg, 0.0, 0.0, 1.0);
+    glCallList(snap->hull_dspList);
     
-    glGetFloatv(GL_MODELVIEW_MATRIX, hull_matrix);
+    // If object is selected, display the "selected" visual
+    if(snap->selected)
+        glCallList(snap->selected_dspList);
+    
+    glPopMatrix();
     
-    // Update Gun Matrix
     glPushMatrix();
     
-    // Gun is attached to main hull (enabled gun transverse)
-    glTranslatef(gun[0].getGunPivotV()[0],
-                 gun[0].getGunPivotV()[1],
-                 gun[0].getGunPivotV()[2]);
-    glRotatef(gun[0].getTransverse() * radToDeg, 0.0, 1.0, 0.0);
-    glRotatef((gun[0].getElevate() * radToDeg) - 90.0, 1.0, 0.0, 0.0);
-    glTranslatef(0.0, 0.0, 0.5 * -gun[0].getGunRecoil());  // Recoil gun mantlet
-    glGetFloatv(GL_MODELVIEW_MATRIX, gun_matrix[0]);
+    glMultMatrixf(snap->gun_matrix[0]);
     
-    glPopMatrix();
+    glCallList(snap->gun_mant_dspList[0]);
     
-    glPopMatrix();
+    glTranslatef(0.0, 0.0, -snap->gun_recoil[0]);      // Recoil gun
+    glCallList(snap->gun_dspList[0]);
     
-    // Camera culling
-    draw = camera.sphereInView(pos(), radius);
-}
-
-/*******************************************************************************
-    function    :   atg_object::display
-    arguments   :   <none>
-    purpose     :   Base display function which displays our tank object.
-    notes       :   <none>
-*******************************************************************************/
-void atg_object::display()
-{
-    // If we are inside of drawing view (via frustum culling) then draw.
-    // Otherwise we don't waste time sending the info down to the GPU.
-    if(draw)
-    {
-        glPushMatrix();
-        
-        glMultMatrixf(hull_matrix);
-        
-        glCallList(hull_dspList);
-        
-        // If object is selected, display the "selected" visual
-        if(selected)
-            glCallList(selected_dspList);
-        
-        glPopMatrix();
-        
-        glPushMatrix();
-        
-        glMultMatrixf(gun_matrix[0]);
-        
-        glCallList(gun_mant_dspList[0]);
-        
-        glTranslatef(0.0, 0.0, -gun[0].getGunRecoil());        // Recoil gun
-        glCallList(gun_dspList[0]);
-        
-        glPopMatrix();
-    }
+    glPopMatrix();
 }
@@ -31,10 +31,14 @@ struct atg_object : public firing_object
     
     /* Metrics */
     kVector transform(kVector position, int attachLevelFrom = OBJ_ATTACH_HULL, int attachLevelTo = OBJ_ATTACH_WORLD);
+    void updateMatrices();
     
     /* Base Update & Display Routines */
     void update(float deltaT);
-    void display();
+    void updateBegin(float deltaT); // (before unit modules)
+    void updateEnd(float deltaT);   // (after unit modules)
+    void snapshot(snap_object* snap);
+    static void display(snap_object* snap);
 };
 
 #endif
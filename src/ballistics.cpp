@@ -0,0 +1,408 @@
+/*******************************************************************************
+                      Ballistics Module - Implementation
+*******************************************************************************/
+#include "main.h"
+#include "ballistics.h"
+#include "database.h"
+#include "jobs.h"
+#include "metrics.h"
+#include "projectile.h"
+
+/*******************************************************************************
+    function    :   table_lerp
+    arguments   :   data - Range table column
+                    range - Range to read at (within table)
+    purpose     :   Linearly interpolates a range table column.
+    notes       :   <none>
+*******************************************************************************/
+inline float table_lerp(float* data, float range)
+{
+    float f = range / BL_TABLE_STEP;
+    int i = (int)f;
+
+    if(i < 0)
+        return data[0];
+    if(i >= BL_TABLE_SIZE - 1)
+        return data[BL_TABLE_SIZE - 1];
+
+    f -= (float)i;
+    return data[i] + (data[i + 1] - data[i]) * f;
+}
+
+/*******************************************************************************
+    function    :   ballistic_module::ballistic_module
+    arguments   :   <none>
+    purpose     :   Constructor.
+    notes       :   <none>
+*******************************************************************************/
+ballistic_module::ballistic_module()
+{
+    table_head = NULL;
+    ammo_head = NULL;
+}
+
+/*******************************************************************************
+    function    :   ballistic_module::~ballistic_module
+    arguments   :   <none>
+    purpose     :   Deconstructor.
+    notes       :   <none>
+*******************************************************************************/
+ballistic_module::~ballistic_module()
+{
+    clearAmmoTables();
+    clearRangeTables();
+}
+
+/*******************************************************************************
+    Solution Routines
+*******************************************************************************/
+
+/*******************************************************************************
+    function    :   ballistic_module::solveElevation
+    arguments   :   velocity - Muzzle velocity
+                    range - Horizontal distance to target
+                    height - Height of target over muzzle
+                    tanElevate - Tangent of elevation (returned)
+    purpose     :   Solves the low arc elevation that hits the target. Returns
+                    false if the target is out of reach at this velocity.
+    notes       :   The root is taken in the form without the difference of
+                    v^2 and the discriminant's root, which loses all precision
+                    in float for flat fire.
+*******************************************************************************/
+bool ballistic_module::solveElevation(float velocity, float range,
+    float height, float &tanElevate)
+{
+    float v_sqrd = velocity * velocity;
+    float gx_sqrd = BL_GRAVITY * range * range;
+    float disc;
+
+    if(range < FP_ERROR || velocity < FP_ERROR)
+        return false;
+
+    disc = v_sqrd * v_sqrd - BL_GRAVITY * (gx_sqrd + 2.0f * height * v_sqrd);
+    if(disc < 0.0)
+        return false;
+
+    tanElevate = (gx_sqrd + 2.0f * height * v_sqrd) /
+        (range * (v_sqrd + sqrt(disc)));
+
+    return true;
+}
+
+/*******************************************************************************
+    Range Table Routines
+*******************************************************************************/
+
+/*******************************************************************************
+    function    :   ballistic_module::build_table
+    arguments   :   table - Range table (with velocity set)
+    purpose     :   Fills in a range table for level fire.
+    notes       :   Ranges out of reach are filled in with the max range (45
+                    degree) shot.
+*******************************************************************************/
+void ballistic_module::build_table(bl_range_table* table)
+{
+    float range;
+    float tan_elevate;
+    int i;
+
+    for(i = 0; i < BL_TABLE_SIZE; i++)
+    {
+        range = (float)i * BL_TABLE_STEP;
+
+        if(i == 0)
+            tan_elevate = 0.0;
+        else if(!solveElevation(table->velocity, range, 0.0, tan_elevate))
+            tan_elevate = 1.0;
+
+        table->tan_elevate[i] = tan_elevate;
+        table->time[i] = timeOfFlight(table->velocity, range, tan_elevate);
+        table->drop[i] = 0.5f * BL_GRAVITY * table->time[i] * table->time[i];
+    }
+}
+
+/*******************************************************************************
+    function    :   ballistic_module::getRangeTable
+    arguments   :   velocity - Muzzle velocity
+    purpose     :   Returns the range table for the velocity, building it if
+                    this velocity hasn't been asked for yet.
+    notes       :   1) Callers should hold on to the table, as finding it is a
+                       list search.
+                    2) The list is locked (JS_LOCK_RANGE_TABLE), as sights ask
+                       for tables from jobs. Tables are never removed, so one
+                       found may be used after unlocking.
+*******************************************************************************/
+bl_range_table* ballistic_module::getRangeTable(float velocity)
+{
+    bl_range_table* curr;
+
+    if(velocity < FP_ERROR)
+        return NULL;
+
+    jobs.lock(JS_LOCK_RANGE_TABLE);
+
+    for(curr = table_head; curr; curr = curr->next)
+        if(curr->velocity == velocity)
+            break;
+
+    if(curr == NULL)
+    {
+        curr = new bl_range_table;
+        curr->velocity = velocity;
+        build_table(curr);
+        curr->next = table_head;
+        table_head = curr;
+    }
+
+    jobs.unlock(JS_LOCK_RANGE_TABLE);
+
+    return curr;
+}
+
+/*******************************************************************************
+    function    :   ballistic_module::tableElevate
+    arguments   :   table - Range table
+                    range - Range to read at
+    purpose     :   Returns the tangent of elevation to hit level at the range.
+    notes       :   Ranges beyond the table are solved directly.
+*******************************************************************************/
+float ballistic_module::tableElevate(bl_range_table* table, float range)
+{
+    float tan_elevate;
+
+    if(range < BL_TABLE_RANGE)
+        return table_lerp(table->tan_elevate, range);
+
+    if(!solveElevation(table->velocity, range, 0.0, tan_elevate))
+        tan_elevate = 1.0;
+    return tan_elevate;
+}
+
+/*******************************************************************************
+    function    :   ballistic_module::tableTime
+    arguments   :   table - Range table
+                    range - Range to read at
+    purpose     :   Returns the time of flight to the range.
+    notes       :   Ranges beyond the table are solved directly.
+*******************************************************************************/
+float ballistic_module::tableTime(bl_range_table* table, float range)
+{
+    if(range < BL_TABLE_RANGE)
+        return table_lerp(table->time, range);
+
+    return timeOfFlight(table->velocity, range, tableElevate(table, range));
+}
+
+/*******************************************************************************
+    function    :   ballistic_module::tableDrop
+    arguments   :   table - Range table
+                    range - Range to read at
+    purpose     :   Returns the drop below the line of bore at the range.
+    notes       :   Ranges beyond the table are solved directly.
+*******************************************************************************/
+float ballistic_module::tableDrop(bl_range_table* table, float range)
+{
+    float time;
+
+    if(range < BL_TABLE_RANGE)
+        return table_lerp(table->drop, range);
+
+    time = tableTime(table, range);
+    return 0.5f * BL_GRAVITY * time * time;
+}
+
+/*******************************************************************************
+    function    :   ballistic_module::clearRangeTables
+    arguments   :   <none>
+    purpose     :   Frees all range tables.
+    notes       :   Any table pointers held on to become invalid (including
+                    those of the ammo tables).
+*******************************************************************************/
+void ballistic_module::clearRangeTables()
+{
+    bl_range_table* curr;
+
+    while(table_head)
+    {
+        curr = table_head;
+        table_head = table_head->next;
+        delete curr;
+    }
+}
+
+/*******************************************************************************
+    Ammo Table Routines
+*******************************************************************************/
+
+/*******************************************************************************
+    function    :   ballistic_module::build_ammo_table
+    arguments   :   round - Round name (DB table)
+    purpose     :   Builds the ammo table for a round from its DB entries.
+                    Returns NULL if the round's entries are incomplete.
+    notes       :   Incomplete rounds are skipped quietly, as the DB carries a
+                    few placeholders (e.g. "x" velocities). Firing one is still
+                    reported by the projectile.
+*******************************************************************************/
+bl_ammo_table* ballistic_module::build_ammo_table(char* round)
+{
+    char* temp;
+    char* type;
+    char* velocity;
+    char* weight;
+    char* rha_curve;
+    bl_ammo_table* table;
+    float distance;
+    int i, j;
+
+    type = db.query(round, "TYPE");
+    velocity = db.query(round, "VELOCITY");
+    weight = db.query(round, "WEIGHT");
+    rha_curve = db.query(round, "PEN_RHA_CURVE");
+    if(type == NULL || ammoType(type) == AMMO_TYPE_UNKNOWN ||
+       velocity == NULL || atof(velocity) <= 0.0 ||
+       weight == NULL || rha_curve == NULL)
+        return NULL;
+
+    table = new bl_ammo_table;
+    table->round = round;
+    table->type = ammoType(type);
+    table->velocity = atof(velocity);
+    table->weight = atof(weight);
+
+    // Penetration curves (RHA required, FHS falls back on RHA using the
+    // Russian tests: about a 1.05 gain for capped ammo and 0.87 otherwise).
+    table->pen_at_pb[BL_ARMOR_RHA] = atof(db.query(round, "PEN_RHA_AT_PB"));
+    table->pen_curve[BL_ARMOR_RHA] = atof(rha_curve);
+
+    temp = db.query(round, "PEN_FHS_AT_PB");
+    if(temp)
+        table->pen_at_pb[BL_ARMOR_FHS] = atof(temp);
+    else
+    {
+        table->pen_at_pb[BL_ARMOR_FHS] = table->pen_at_pb[BL_ARMOR_RHA];
+        if(table->type == AMMO_TYPE_APC || table->type == AMMO_TYPE_APCBC)
+            table->pen_at_pb[BL_ARMOR_FHS] *= 1.05;
+        else if(table->type == AMMO_TYPE_AP || table->type == AMMO_TYPE_APCR ||
+                table->type == AMMO_TYPE_API)
+            table->pen_at_pb[BL_ARMOR_FHS] *= 0.87;
+    }
+
+    temp = db.query(round, "PEN_FHS_CURVE");
+    table->pen_curve[BL_ARMOR_FHS] = (temp ? atof(temp) :
+        table->pen_curve[BL_ARMOR_RHA]);
+
+    // Fill in penetration and remaining velocity by distance traveled
+    for(i = 0; i < 2; i++)
+        for(j = 0; j < BL_TABLE_SIZE; j++)
+        {
+            distance = (float)j * BL_TABLE_STEP;
+            table->penetration[i][j] = table->pen_at_pb[i] *
+                powf(table->pen_curve[i], distance);
+            table->speed[i][j] = table->velocity *
+                powf(table->pen_curve[i], distance);
+        }
+
+    // Flight is shared with every round of the same (adjusted) velocity
+    table->range_table = getRangeTable(table->velocity * PROJ_VEL_MULTIPLIER);
+
+    return table;
+}
+
+/*******************************************************************************
+    function    :   ballistic_module::buildAmmoTables
+    arguments   :   <none>
+    purpose     :   Builds ammo tables for every round in the DB (every table
+                    with a PEN_RHA_AT_PB entry).
+    notes       :   Must be called after the DB has loaded.
+*******************************************************************************/
+void ballistic_module::buildAmmoTables()
+{
+    char* rounds[BL_MAX_AMMO];
+    int round_count;
+    bl_ammo_table* table;
+    int i;
+
+    clearAmmoTables();
+
+    round_count = db.listTables("PEN_RHA_AT_PB", rounds, BL_MAX_AMMO);
+
+    for(i = 0; i < round_count; i++)
+        if((table = build_ammo_table(rounds[i])))
+        {
+            table->next = ammo_head;
+            ammo_head = table;
+        }
+}
+
+/*******************************************************************************
+    function    :   ballistic_module::getAmmoTable
+    arguments   :   round - Round name (DB table)
+    purpose     :   Returns the ammo table of the round (NULL if none).
+    notes       :   Callers should hold on to the table, as finding it is a
+                    list search.
+*******************************************************************************/
+bl_ammo_table* ballistic_module::getAmmoTable(char* round)
+{
+    bl_ammo_table* curr;
+
+    if(round == NULL)
+        return NULL;
+
+    for(curr = ammo_head; curr; curr = curr->next)
+        if(curr->round == round || strcmp(curr->round, round) == 0)
+            return curr;
+
+    return NULL;
+}
+
+/*******************************************************************************
+    function    :   ballistic_module::ammoPenetration
+    arguments   :   table - Ammo table
+                    armor - Armor column (BL_ARMOR_x)
+                    distance - Distance traveled
+    purpose     :   Returns the thickness the round penetrates at the distance.
+    notes       :   Distances beyond the table use the curve directly.
+*******************************************************************************/
+float ballistic_module::ammoPenetration(bl_ammo_table* table, int armor,
+    float distance)
+{
+    if(distance < BL_TABLE_RANGE)
+        return table_lerp(table->penetration[armor], distance);
+
+    return table->pen_at_pb[armor] * powf(table->pen_curve[armor], distance);
+}
+
+/*******************************************************************************
+    function    :   ballistic_module::ammoVelocity
+    arguments   :   table - Ammo table
+                    armor - Armor column (BL_ARMOR_x)
+                    distance - Distance traveled
+    purpose     :   Returns the round's remaining velocity at the distance.
+    notes       :   Distances beyond the table use the curve directly.
+*******************************************************************************/
+float ballistic_module::ammoVelocity(bl_ammo_table* table, int armor,
+    float distance)
+{
+    if(distance < BL_TABLE_RANGE)
+        return table_lerp(table->speed[armor], distance);
+
+    return table->velocity * powf(table->pen_curve[armor], distance);
+}
+
+/*******************************************************************************
+    function    :   ballistic_module::clearAmmoTables
+    arguments   :   <none>
+    purpose     :   Frees all ammo tables.
+    notes       :   Any table pointers held on to become invalid.
+*******************************************************************************/
+void ballistic_module::clearAmmoTables()
+{
+    bl_ammo_table* curr;
+
+    while(ammo_head)
+    {
+        curr = ammo_head;
+        ammo_head = ammo_head->next;
+        delete curr;
+    }
+}
@@ -0,0 +1,100 @@
+/*******************************************************************************
+                        Ballistics Module - Definition
+*******************************************************************************/
+#ifndef BALLISTICS_H
+#define BALLISTICS_H
+
+#include "metrics.h"
+
+#define BL_GRAVITY                  9.81    // Gravity (m/s^2, as in proj_object)
+#define BL_TABLE_RANGE              4000.0  // Range covered by range tables (m)
+#define BL_TABLE_STEP               25.0    // Range table spacing (m)
+#define BL_TABLE_SIZE               161     // Range table entries (range/step+1)
+#define BL_MAX_AMMO                 128     // Max round types given tables
+
+#define BL_ARMOR_RHA                0       // RHA (and cast) penetration column
+#define BL_ARMOR_FHS                1       // FHS penetration column
+
+// Range Table (per muzzle velocity, LL)
+struct bl_range_table
+{
+    float velocity;                     // Muzzle velocity (as adjusted)
+    float tan_elevate[BL_TABLE_SIZE];   // Elevation (tangent) to hit level
+    float time[BL_TABLE_SIZE];          // Time of flight
+    float drop[BL_TABLE_SIZE];          // Drop below line of bore
+    bl_range_table* next;
+};
+
+// Ammo Table (per round type, LL)
+struct bl_ammo_table
+{
+    char* round;                        // Round name (DB table)
+    short type;                         // Round type (AMMO_TYPE_xxxx)
+    float velocity;                     // Muzzle velocity (as in DB)
+    float weight;                       // Round weight
+    float pen_at_pb[2];                 // Penetration at PB (per BL_ARMOR_x)
+    float pen_curve[2];                 // Penetration curve (per BL_ARMOR_x)
+    float penetration[2][BL_TABLE_SIZE];    // Penetration by travel distance
+    float speed[2][BL_TABLE_SIZE];      // Remaining velocity by travel distance
+    bl_range_table* range_table;        // Flight by range (adjusted velocity)
+    bl_ammo_table* next;
+};
+
+/*******************************************************************************
+    class       :   ballistic_module
+    purpose     :   Fire solution service. Solves the elevation a gun needs to
+                    put a round on a target in closed form, and keeps range
+                    tables of level fire for each muzzle velocity in use.
+    notes       :   1) Trajectories are solved without drag, matching the
+                       flight of proj_object, so solutions are exact. All
+                       velocities are taken after PROJ_VEL_MULTIPLIER.
+                    2) The elevation solved is the low (direct fire) arc. With
+                       the muzzle at the origin, range x and height y, tan of
+                       the elevation is a root of a quadratic:
+                       (g x^2 / 2v^2) tan^2 - x tan + (y + g x^2 / 2v^2) = 0
+                    3) Range tables are built the first time a velocity is
+                       asked for, and are read by linear interpolation.
+                    4) Ammo tables are built for every round in the DB once it
+                       has loaded (see buildAmmoTables), holding penetration and
+                       remaining velocity by distance traveled off of the DB's
+                       penetration curves, along with the round's range table.
+                       The FHS column falls back on the RHA curve the same way
+                       the penetration calculator always has.
+*******************************************************************************/
+class ballistic_module
+{
+    private:
+        bl_range_table* table_head;     // Range tables
+        bl_ammo_table* ammo_head;       // Ammo tables
+
+        void build_table(bl_range_table* table);
+        bl_ammo_table* build_ammo_table(char* round);
+
+    public:
+        ballistic_module();             // Constructor
+        ~ballistic_module();            // Deconstructor
+
+        /* Solution Routines */
+        bool solveElevation(float velocity, float range, float height,
+            float &tanElevate);
+        float timeOfFlight(float velocity, float range, float tanElevate)
+            { return range * sqrt(1.0f + tanElevate * tanElevate) / velocity; }
+
+        /* Range Table Routines */
+        bl_range_table* getRangeTable(float velocity);
+        float tableElevate(bl_range_table* table, float range);
+        float tableTime(bl_range_table* table, float range);
+        float tableDrop(bl_range_table* table, float range);
+        void clearRangeTables();
+
+        /* Ammo Table Routines */
+        void buildAmmoTables();
+        bl_ammo_table* getAmmoTable(char* round);
+        float ammoPenetration(bl_ammo_table* table, int armor, float distance);
+        float ammoVelocity(bl_ammo_table* table, int armor, float distance);
+        void clearAmmoTables();
+};
+
+extern ballistic_module ballistics;
+
+#endif
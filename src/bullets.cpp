@@ -0,0 +1,621 @@
+/*******************************************************************************
+                     MG Bullet Pool Module - Implementation
+*******************************************************************************/
+#include "main.h"
+#include "bullets.h"
+#include "ballistics.h"
+#include "camera.h"
+#include "database.h"
+#include "effects.h"
+#include "metrics.h"
+#include "model.h"
+#include "object.h"
+#include "objhandler.h"
+#include "projectile.h"
+#include "scenery.h"
+#include "snapshot.h"
+
+/*******************************************************************************
+    function    :   bullet_module::bullet_module
+    arguments   :   <none>
+    purpose     :   Constructor.
+    notes       :   <none>
+*******************************************************************************/
+bullet_module::bullet_module()
+{
+    round_count = 0;
+    count = 0;
+    target = new object* [BLT_MAX_TARGETS];
+    target_max = BLT_MAX_TARGETS;
+    target_count = 0;
+}
+
+/*******************************************************************************
+    function    :   bullet_module::~bullet_module
+    arguments   :   <none>
+    purpose     :   Deconstructor.
+    notes       :   <none>
+*******************************************************************************/
+bullet_module::~bullet_module()
+{
+    int i;
+
+    for(i = 0; i < round_count; i++)
+        if(rounds[i].round)
+            free(rounds[i].round);
+
+    delete [] target;
+}
+
+/*******************************************************************************
+    function    :   bullet_module::getRound
+    arguments   :   roundType - Type of round (DB)
+    purpose     :   Returns the round entry to fire the given round into the
+                    pool with, looking the round up the first time it is seen.
+    notes       :   Returns -1 if the round is not pooled (too large, explosive,
+                    or not defined), in which case it is to be fired as a
+                    proj_object.
+*******************************************************************************/
+int bullet_module::getRound(char* roundType)
+{
+    bl_ammo_table* ammo_table;
+    char* temp;
+    int i;
+
+    // See if round has already been looked up
+    for(i = 0; i < round_count; i++)
+        if(strcmp(rounds[i].round, roundType) == 0)
+            return (rounds[i].pooled ? i : -1);
+
+    if(round_count >= BLT_MAX_ROUNDS)
+        return -1;
+
+    // Look up round (not pooled unless everything checks out)
+    rounds[round_count].round = strdup(roundType);
+    rounds[round_count].pooled = false;
+    rounds[round_count].type = AMMO_TYPE_UNKNOWN;
+    rounds[round_count].caliber = 0.0;
+    rounds[round_count].speed = 0.0;
+    rounds[round_count].modifiers = AMMO_MOD_STANDARD;
+    i = round_count++;
+
+    ammo_table = ballistics.getAmmoTable(roundType);
+    if(ammo_table == NULL)
+        return -1;
+    rounds[i].type = ammo_table->type;
+    rounds[i].speed = ammo_table->velocity * PROJ_VEL_MULTIPLIER;
+
+    temp = db.query(roundType, "CALIBER");
+    if(temp == NULL)
+        return -1;
+    rounds[i].caliber = atof(temp);
+
+    temp = db.query(roundType, "MODIFIERS");
+    if(temp == NULL)
+        return -1;
+    if(strstr(temp, "TRACER"))
+    {
+        if(strstr(temp, "YELLOW"))
+            rounds[i].modifiers |= AMMO_MOD_YELLOW_TRACER;
+        else if(strstr(temp, "WHITE"))
+            rounds[i].modifiers |= AMMO_MOD_WHITE_TRACER;
+        else if(strstr(temp, "RED"))
+            rounds[i].modifiers |= AMMO_MOD_RED_TRACER;
+        else if(strstr(temp, "GREEN"))
+            rounds[i].modifiers |= AMMO_MOD_GREEN_TRACER;
+    }
+
+    // Only plain small-calibre rounds are pooled
+    switch(rounds[i].type)
+    {
+        case AMMO_TYPE_AP:
+        case AMMO_TYPE_APC:
+        case AMMO_TYPE_APBC:
+        case AMMO_TYPE_APCBC:
+        case AMMO_TYPE_APCR:
+            if(rounds[i].caliber < BLT_MAX_CALIBER && !strstr(temp, "HE_BURSTER"))
+                rounds[i].pooled = true;
+            break;
+
+        default:
+            break;
+    }
+
+    return (rounds[i].pooled ? i : -1);
+}
+
+/*******************************************************************************
+    function    :   bullet_module::addBullet
+    arguments   :   roundID - round entry (from getRound)
+                    parentPtr - pointer to firing object (excluded from hits)
+                    position - start position of bullet
+                    direction - starting direction of bullet (cart.)
+                    bulletModifiers - modifiers to add to the round's own
+    purpose     :   Fires a bullet into the pool.
+    notes       :   1) Returns false if the pool is full (bullet not fired).
+                    2) Dispersion is added the same as proj_object::initProj.
+*******************************************************************************/
+bool bullet_module::addBullet(int roundID, object* parentPtr, kVector position,
+    kVector direction, unsigned short bulletModifiers)
+{
+    int i, j;
+
+    if(roundID < 0 || roundID >= round_count || count >= BLT_MAX_BULLETS)
+        return false;
+
+    i = count++;
+
+    // Assign velocity to direction vector as well as incorporate the random
+    // dispersion effect for new bullets.
+    direction.convertTo(CS_SPHERICAL);
+    direction[0] = rounds[roundID].speed;
+    direction[1] += ((((float)rand() / (float)RAND_MAX) * PROJ_FIRE_DISPERSION) -
+                (PROJ_FIRE_DISPERSION / 2.0)) * degToRad;
+    direction[2] += ((((float)rand() / (float)RAND_MAX) * PROJ_FIRE_DISPERSION) -
+                (PROJ_FIRE_DISPERSION / 2.0)) * degToRad;
+    direction.convertTo(CS_CARTESIAN);
+
+    pos_x[i] = last_x[i] = position[0];
+    pos_y[i] = last_y[i] = position[1];
+    pos_z[i] = last_z[i] = position[2];
+    vel_x[i] = direction[0];
+    vel_y[i] = direction[1];
+    vel_z[i] = direction[2];
+    travel[i] = 0.0;
+    remove_timer[i] = BLT_LIFE_TIME;
+    tracer_timer[i] = 0.0;
+    tracer_depth[i] = BLT_TRACER_TAIL;
+    flags[i] = BLT_FLAG_FLIGHT;
+    modifiers[i] = rounds[roundID].modifiers | bulletModifiers;
+    round[i] = roundID;
+    parent[i] = objects.getHandle(parentPtr);
+    tail_head[i] = 0;
+
+    // Initialize all tracer tail positions to starting position
+    for(j = 0; j < BLT_TRACER_TAIL; j++)
+    {
+        tail[i][j][0] = position[0];
+        tail[i][j][1] = position[1];
+        tail[i][j][2] = position[2];
+    }
+
+    return true;
+}
+
+/*******************************************************************************
+    function    :   bullet_module::remove_bullet
+    arguments   :   bullet - bullet index
+    purpose     :   Removes a bullet from the pool, moving the last bullet into
+                    its place.
+    notes       :   <none>
+*******************************************************************************/
+void bullet_module::remove_bullet(int bullet)
+{
+    int last = --count;
+
+    if(bullet == last)
+        return;
+
+    pos_x[bullet] = pos_x[last];
+    pos_y[bullet] = pos_y[last];
+    pos_z[bullet] = pos_z[last];
+    vel_x[bullet] = vel_x[last];
+    vel_y[bullet] = vel_y[last];
+    vel_z[bullet] = vel_z[last];
+    last_x[bullet] = last_x[last];
+    last_y[bullet] = last_y[last];
+    last_z[bullet] = last_z[last];
+    travel[bullet] = travel[last];
+    remove_timer[bullet] = remove_timer[last];
+    tracer_timer[bullet] = tracer_timer[last];
+    tracer_depth[bullet] = tracer_depth[last];
+    flags[bullet] = flags[last];
+    modifiers[bullet] = modifiers[last];
+    round[bullet] = round[last];
+    parent[bullet] = parent[last];
+    memcpy(tail[bullet], tail[last], sizeof(tail[0]));
+    tail_head[bullet] = tail_head[last];
+}
+
+/*******************************************************************************
+    function    :   bullet_module::advance_tail
+    arguments   :   bullet - bullet index
+    purpose     :   Advances a bullet's tracer tail by one position, as
+                    proj_object::advanceTracer.
+    notes       :   <none>
+*******************************************************************************/
+void bullet_module::advance_tail(int bullet)
+{
+    float* newest = tail_at(bullet, 0);
+
+    tail_head[bullet] = (tail_head[bullet] + BLT_TRACER_TAIL - 1) %
+        BLT_TRACER_TAIL;
+
+    tail[bullet][tail_head[bullet]][0] = newest[0];
+    tail[bullet][tail_head[bullet]][1] = newest[1];
+    tail[bullet][tail_head[bullet]][2] = newest[2];
+}
+
+/*******************************************************************************
+    function    :   bullet_module::segment_hits_box
+    arguments   :   objPtr - object to test against
+                    segStart - start of segment (WCS)
+                    segEnd - end of segment (WCS)
+    purpose     :   Determines if a segment passes through an object's bounding
+                    box (taken from its model, oriented by its hull matrix).
+    notes       :   Segment is brought into the object's LCS and clipped against
+                    each pair of box faces in turn (slab test).
+*******************************************************************************/
+bool bullet_module::segment_hits_box(object* objPtr, kVector segStart,
+    kVector segEnd)
+{
+    float* min_size = models.getMinSize(objPtr->model_id);
+    float* max_size = models.getMaxSize(objPtr->model_id);
+    kVector start = untransformed(segStart, objPtr->hull_matrix);
+    kVector step = untransformed(segEnd, objPtr->hull_matrix) - start;
+    float t_enter = 0.0;
+    float t_exit = 1.0;
+    float t_one, t_two, temp;
+    int i;
+
+    for(i = 0; i < 3; i++)
+    {
+        if(fabsf(step[i]) < FP_ERROR)
+        {
+            // Parallel to these faces, so must start between them
+            if(start[i] < min_size[i] || start[i] > max_size[i])
+                return false;
+        }
+        else
+        {
+            t_one = (min_size[i] - start[i]) / step[i];
+            t_two = (max_size[i] - start[i]) / step[i];
+            if(t_one > t_two)
+            {
+                temp = t_one;
+                t_one = t_two;
+                t_two = temp;
+            }
+
+            if(t_one > t_enter)
+                t_enter = t_one;
+            if(t_two < t_exit)
+                t_exit = t_two;
+
+            if(t_enter > t_exit)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/*******************************************************************************
+    function    :   bullet_module::promote
+    arguments   :   bullet - bullet index
+                    targetPtr - object whose box the bullet entered
+    purpose     :   Replaces a bullet with a full proj_object, placed at the
+                    start of the step that entered the target's box, so that
+                    the projectile CD pass can handle the hit on its meshes.
+    notes       :   1) The bullet is removed from the pool either way (if the
+                       projectile cannot be allocated, the bullet is lost).
+                    2) Flight state (velocity, distance traveled, time left,
+                       tracer tail) is carried over.
+                    3) The firing object is kept by handle, as it may have
+                       been removed since firing (it is then passed as NULL).
+*******************************************************************************/
+void bullet_module::promote(int bullet, object* targetPtr)
+{
+    proj_object* proj_ptr;
+    kVector position(last_x[bullet], last_y[bullet], last_z[bullet]);
+    kVector velocity(vel_x[bullet], vel_y[bullet], vel_z[bullet]);
+    float* tail_pos;
+    int i;
+
+    proj_ptr = (proj_object*)objects.addObject(OBJ_TYPE_PROJECTILE);
+
+    if(proj_ptr)
+    {
+        // initProj builds the CDTL, which will hold the target since the
+        // round starts just short of it headed its way.
+        proj_ptr->initProj(objects.getObject(parent[bullet]),
+            rounds[round[bullet]].round, position, velocity);
+
+        proj_ptr->dir = velocity;
+        proj_ptr->obj_modifiers = modifiers[bullet];
+        proj_ptr->travel_distance = travel[bullet];
+        proj_ptr->remove_timer = remove_timer[bullet];
+        proj_ptr->tracer_timer = tracer_timer[bullet];
+        proj_ptr->tracer_head = 0;
+        for(i = 0; i < PROJ_MAX_TRACER_TAIL; i++)
+        {
+            tail_pos = tail_at(bullet,
+                (i < BLT_TRACER_TAIL ? i : BLT_TRACER_TAIL - 1));
+            proj_ptr->tracer_tail_pos[i][0] = tail_pos[0];
+            proj_ptr->tracer_tail_pos[i][1] = tail_pos[1];
+            proj_ptr->tracer_tail_pos[i][2] = tail_pos[2];
+        }
+    }
+
+    remove_bullet(bullet);
+}
+
+/*******************************************************************************
+    function    :   bullet_module::strike
+    arguments   :   bullet - bullet index
+                    groundCollision - bullet struck ground (else scenery)
+    purpose     :   Stops a bullet that struck the ground or scenery and adds the
+                    strike effect.
+    notes       :   <none>
+*******************************************************************************/
+void bullet_module::strike(int bullet, bool groundCollision)
+{
+    kVector position(pos_x[bullet], pos_y[bullet], pos_z[bullet]);
+
+    flags[bullet] &= ~BLT_FLAG_FLIGHT;
+
+    if(groundCollision)
+        effects.addEffect(SE_MG_GROUND, position);
+    else
+        effects.addEffect(SE_MG_GROUND_SMOKE, position);
+}
+
+/*******************************************************************************
+    function    :   bullet_module::update
+    arguments   :   deltaT - number of seconds elapsed since last update
+    purpose     :   Updates all bullets in the pool.
+    notes       :   1) All bullets in flight are integrated first, in one pass,
+                       then each step taken is checked against the ground,
+                       scenery and units (see class notes).
+                    2) Tracer tails are handled as proj_object handles them
+                       for MG bullets. Culling is done by the snapshot module.
+*******************************************************************************/
+void bullet_module::update(float deltaT)
+{
+    int i, j;
+    kVector seg_start;
+    kVector seg_end;
+    kVector impact_pos;
+    kVector offset;
+    kVector step;
+    float* tail_pos;
+    float t;
+    float radius;
+    bool removed;
+
+    if(count == 0)
+        return;
+
+    // Integrate bullets in flight
+    for(i = 0; i < count; i++)
+    {
+        if(!(flags[i] & BLT_FLAG_FLIGHT))
+            continue;
+
+        last_x[i] = pos_x[i];
+        last_y[i] = pos_y[i];
+        last_z[i] = pos_z[i];
+        vel_y[i] += (-9.81 * deltaT);
+        pos_x[i] += vel_x[i] * deltaT;
+        pos_y[i] += vel_y[i] * deltaT;
+        pos_z[i] += vel_z[i] * deltaT;
+        travel[i] += rounds[round[i]].speed * deltaT;
+        remove_timer[i] -= deltaT;
+    }
+
+    // Gather units to test against (growing list if short)
+    target_count = objects.getCDTargets(target, target_max);
+    if(target_count > target_max)
+    {
+        delete [] target;
+        target_max = target_count * 2;
+        target = new object* [target_max];
+        target_count = objects.getCDTargets(target, target_max);
+    }
+
+    // Check steps and update tracer tails (going backwards since a bullet
+    // removed is replaced by the last bullet, which is then already done).
+    for(i = count - 1; i >= 0; i--)
+    {
+        if(flags[i] & BLT_FLAG_FLIGHT)
+        {
+            seg_start = kVector(last_x[i], last_y[i], last_z[i]);
+            seg_end = kVector(pos_x[i], pos_y[i], pos_z[i]);
+            step = seg_end - seg_start;
+            removed = false;
+
+            // Check for bullet entering a unit's box anywhere along the step
+            for(j = 0; j < target_count; j++)
+            {
+                if(target[j]->obj_handle == parent[i])
+                    continue;
+
+                // Closest point of step to unit, against its collision sphere
+                offset = target[j]->pos - seg_start;
+                t = (offset[0] * step[0] + offset[1] * step[1] +
+                     offset[2] * step[2]) /
+                    (step[0] * step[0] + step[1] * step[1] +
+                     step[2] * step[2] + FP_ERROR);
+                if(t < 0.0)
+                    t = 0.0;
+                else if(t > 1.0)
+                    t = 1.0;
+                offset = offset - (step * t);
+                radius = fabsf(target[j]->radius);
+
+                if(offset[0] * offset[0] + offset[1] * offset[1] +
+                   offset[2] * offset[2] <= radius * radius &&
+                   segment_hits_box(target[j], seg_start, seg_end))
+                {
+                    promote(i, target[j]);
+                    removed = true;
+                    break;
+                }
+            }
+            if(removed)
+                continue;
+
+            // Check for bullet passing into the ground anywhere along the step
+            if(map.segmentIntersect(seg_start, seg_end, impact_pos))
+            {
+                pos_x[i] = impact_pos[0];
+                pos_y[i] = impact_pos[1];
+                pos_z[i] = impact_pos[2];
+                strike(i, true);
+            }
+            else if(map.sceneryCollision(seg_end))
+                strike(i, false);
+            else if(remove_timer[i] <= 0.0)
+                flags[i] &= ~BLT_FLAG_FLIGHT;
+
+            // Bullets without tracers are done once out of flight
+            if(!(modifiers[i] & AMMO_MOD_TRACER))
+            {
+                if(!(flags[i] & BLT_FLAG_FLIGHT))
+                {
+                    remove_bullet(i);
+                    continue;
+                }
+            }
+            else
+            {
+                // Advance tracer tail
+                tracer_timer[i] += deltaT;
+                while(tracer_timer[i] > PROJ_TRACER_TIMER)
+                {
+                    advance_tail(i);
+                    tracer_timer[i] -= PROJ_TRACER_TIMER;
+                }
+
+                // Always update first position
+                tail_pos = tail_at(i, 0);
+                tail_pos[0] = pos_x[i];
+                tail_pos[1] = pos_y[i];
+                tail_pos[2] = pos_z[i];
+            }
+        }
+        else
+        {
+            // Tracer tail runs off after flight
+            tracer_timer[i] += deltaT;
+            while(tracer_timer[i] >= PROJ_TRACER_TIMER)
+            {
+                advance_tail(i);
+                tracer_timer[i] -= PROJ_TRACER_TIMER;
+                tracer_depth[i]--;
+            }
+
+            if(tracer_depth[i] <= 0)
+            {
+                remove_bullet(i);
+                continue;
+            }
+        }
+    }
+}
+
+/*******************************************************************************
+    function    :   bullet_module::snapshot
+    arguments   :   snap - Render snapshot to fill
+    purpose     :   Records all bullets into a render snapshot.
+    notes       :   Culling is done by the snapshot module.
+*******************************************************************************/
+void bullet_module::snapshot(render_snapshot* snap)
+{
+    snap_bullet* rec;
+    float* tail_pos;
+    int i, j;
+
+    for(i = 0; i < count; i++)
+    {
+        rec = snap->addBullet();
+        rec->pos[0] = pos_x[i];
+        rec->pos[1] = pos_y[i];
+        rec->pos[2] = pos_z[i];
+        rec->last[0] = last_x[i];
+        rec->last[1] = last_y[i];
+        rec->last[2] = last_z[i];
+        rec->vel[0] = vel_x[i];
+        rec->vel[1] = vel_y[i];
+        rec->vel[2] = vel_z[i];
+        rec->caliber = rounds[round[i]].caliber;
+        rec->modifiers = modifiers[i];
+        rec->flags = flags[i];
+
+        for(j = 0; j < BLT_TRACER_TAIL; j++)
+        {
+            tail_pos = tail_at(i, j);
+            rec->tail[j][0] = tail_pos[0];
+            rec->tail[j][1] = tail_pos[1];
+            rec->tail[j][2] = tail_pos[2];
+        }
+    }
+}
+
+/*******************************************************************************
+    function    :   bullet_module::display
+    arguments   :   bullet - Bullet record (of a render snapshot)
+                    position - Position bullet is drawn at
+                    camPos - Camera position of frame
+    purpose     :   Display routine.
+    notes       :   1) Tracer blips and tails are not drawn here, but gathered
+                       into the tracer pass (see tracer_pass).
+                    2) The snapshot module blends the position over the
+                       bullet's last step, as objects are drawn between
+                       snapshots, and culls against it.
+*******************************************************************************/
+void bullet_module::display(snap_bullet* bullet, float* position, float* camPos)
+{
+    static int modlib_id = models.getModelID("shell");
+    kVector direction;
+    float distance;
+    float base_size;
+    float size;
+    float caliber;
+    float blip[3];
+    float* tail_pos[BLT_TRACER_TAIL];
+    int j;
+
+    // Draw bullet in flight
+    if(bullet->flags & BLT_FLAG_FLIGHT)
+    {
+        direction = vectorIn(kVector(bullet->vel[0], bullet->vel[1],
+            bullet->vel[2]), CS_SPHERICAL);
+        caliber = bullet->caliber * 2.0;
+
+        glPushMatrix();
+        glTranslatef(position[0], position[1], position[2]);
+        glRotatef(direction[2] * radToDeg, 0.0, 1.0, 0.0);
+        glRotatef(direction[1] * radToDeg, 1.0, 0.0, 0.0);
+        glScalef(caliber, caliber, caliber);
+        models.drawModel(modlib_id, MDL_DRW_VERTEXARRAY);
+        glPopMatrix();
+    }
+
+    // Gather tracer blip and tail into the tracer pass
+    if(!(bullet->modifiers & AMMO_MOD_TRACER))
+        return;
+
+    // Sadly, when working with point sizes, we must compute distance.
+    distance =
+        sqrt(((camPos[0] - position[0]) * (camPos[0] - position[0])) +
+        ((camPos[1] - position[1]) * (camPos[1] - position[1])) +
+        ((camPos[2] - position[2]) * (camPos[2] - position[2])));
+    base_size = distance * -0.0055;             // Change size with distance
+
+    if(bullet->flags & BLT_FLAG_FLIGHT)
+    {
+        size = 2.75 + base_size;
+        if(size < 0.25)
+            size = 0.25;
+        blip[0] = position[0];
+        blip[1] = position[1] - 0.02;
+        blip[2] = position[2];
+        tracers.addBlip(bullet->modifiers, size, blip);
+    }
+
+    for(j = 0; j < BLT_TRACER_TAIL; j++)
+        tail_pos[j] = bullet->tail[j];
+    tracers.addTail(bullet->modifiers, PROJ_TAIL_MG_SMOKE, 3.0 + base_size,
+        tail_pos);
+}
@@ -0,0 +1,129 @@
+/*******************************************************************************
+                       MG Bullet Pool Module - Definition
+*******************************************************************************/
+#ifndef BULLETS_H
+#define BULLETS_H
+
+#include "metrics.h"
+#include "object.h"
+#include "objhandler.h"
+
+// Pool Limits
+#define BLT_MAX_BULLETS             1024    // Max MG bullets in flight
+#define BLT_MAX_ROUNDS              32      // Max round types looked up
+#define BLT_MAX_TARGETS             (OBJ_MAX_TANK + OBJ_MAX_VEHICLE + \
+                                     OBJ_MAX_ATG + OBJ_MAX_ATR + \
+                                     OBJ_MAX_STATIC)    // (initial, grows)
+
+// Bullet Rounds
+#define BLT_MAX_CALIBER             1.5     // Rounds under this are pooled (cm)
+#define BLT_TRACER_TAIL             7       // Tracer tail length (as MG drawn)
+#define BLT_LIFE_TIME               6.0     // Time in flight (s, as proj_object)
+
+// Bullet Flags
+#define BLT_FLAG_FLIGHT             0x01    // Bullet is in flight/moving
+
+struct snap_bullet;                     // Bullet record (snapshot.h)
+struct render_snapshot;                 // Render snapshot (snapshot.h)
+
+// Round Entry (per round type looked up)
+struct blt_round
+{
+    char* round;                        // Round name (DB table)
+    bool pooled;                        // Round is fired into the pool
+    short type;                         // Round type (AMMO_TYPE_xxxx)
+    float caliber;                      // Caliber (in cm)
+    float speed;                        // Velocity (after PROJ_VEL_MULTIPLIER)
+    unsigned short modifiers;           // Round modifiers (AMMO_MOD_xxxx)
+};
+
+/*******************************************************************************
+    class       :   bullet_module
+    purpose     :   Lightweight flight model for small-calibre (MG) fire. Bullets
+                    are kept apart from the object handler, and only the ones
+                    which actually strike a unit are handed over to the CDR
+                    as full projectiles.
+    notes       :   1) Bullets are stored as parallel arrays (one per field) and
+                       packed, so integration is one tight loop over the pool.
+                       Removing a bullet moves the last bullet into its slot.
+                    2) Each step taken is tested as a segment against the
+                       collision sphere of every unit, then against the unit's
+                       bounding box. A bullet which enters a box is promoted,
+                       i.e. replaced by a proj_object starting at the beginning
+                       of that step, which the CDR then handles as it always
+                       has (meshes, penetration, ricochet).
+                    3) Ground and scenery strikes are handled here, with the
+                       same effects proj_object gives MG bullets.
+                    4) Only non-explosive rounds under BLT_MAX_CALIBER are
+                       pooled. Round types are looked up once and kept, so
+                       firing needs no DB queries.
+*******************************************************************************/
+class bullet_module
+{
+    private:
+        blt_round rounds[BLT_MAX_ROUNDS];   // Round types looked up
+        int round_count;                // Round types looked up
+
+        /* Bullet Pool (packed, by field) */
+        int count;                      // Bullets in pool
+        float pos_x[BLT_MAX_BULLETS];   // Position
+        float pos_y[BLT_MAX_BULLETS];
+        float pos_z[BLT_MAX_BULLETS];
+        float vel_x[BLT_MAX_BULLETS];   // Velocity (direction scaled)
+        float vel_y[BLT_MAX_BULLETS];
+        float vel_z[BLT_MAX_BULLETS];
+        float last_x[BLT_MAX_BULLETS];  // Position at start of step
+        float last_y[BLT_MAX_BULLETS];
+        float last_z[BLT_MAX_BULLETS];
+        float travel[BLT_MAX_BULLETS];  // Distance traveled (in m)
+        float remove_timer[BLT_MAX_BULLETS];    // Time left in flight (in s)
+        float tracer_timer[BLT_MAX_BULLETS];    // Tracer tail timer
+        short tracer_depth[BLT_MAX_BULLETS];    // Tracer tail left to draw
+        unsigned char flags[BLT_MAX_BULLETS];   // Bullet flags (BLT_FLAG_xxx)
+        unsigned short modifiers[BLT_MAX_BULLETS];  // Modifiers (AMMO_MOD_xxx)
+        short round[BLT_MAX_BULLETS];   // Round entry
+        unsigned int parent[BLT_MAX_BULLETS];   // Firing object handle (excluded)
+        float tail[BLT_MAX_BULLETS][BLT_TRACER_TAIL][3];    // Tracer tail
+        unsigned char tail_head[BLT_MAX_BULLETS];   // Newest tail position
+
+        /* Targets (gathered each update) */
+        object** target;                // Units
+        int target_max;                 // Size of target list
+        int target_count;               // Units gathered
+
+        /* Pool Routines */
+        float* tail_at(int bullet, int position)
+            { return tail[bullet][(tail_head[bullet] + position) % BLT_TRACER_TAIL]; }
+        void advance_tail(int bullet);
+        void remove_bullet(int bullet);
+        bool segment_hits_box(object* objPtr, kVector segStart,
+            kVector segEnd);
+        void promote(int bullet, object* targetPtr);
+        void strike(int bullet, bool groundCollision);
+
+    public:
+        bullet_module();                // Constructor
+        ~bullet_module();               // Deconstructor
+
+        /* Round Routines */
+        int getRound(char* roundType);
+        float getRoundCaliber(int roundID)
+            { return rounds[roundID].caliber; }
+
+        /* Bullet Routines */
+        bool addBullet(int roundID, object* parentPtr, kVector position,
+            kVector direction, unsigned short bulletModifiers);
+        int getBulletCount()
+            { return count; }
+        void clear()
+            { count = 0; }
+
+        /* Base Update, Snapshot and Display Routines */
+        void update(float deltaT);
+        void snapshot(render_snapshot* snap);
+        void display(snap_bullet* bullet, float* position, float* camPos);
+};
+
+extern bullet_module bullets;
+
+#endif
@@ -279,7 +279,7 @@ void camera_module::playerControl(bool enable)
 *******************************************************************************/
 bool camera_module::pointInView(float pos[3])
 {
-    static int i;
+    int i;
     
     // Determine if the point is outside of the viewing frustum by checking it
     // against all 6 sides.
@@ -304,7 +304,7 @@ bool camera_module::pointInView(float pos[3])
 *******************************************************************************/
 bool camera_module::sphereInView(float pos[3], float radius)
 {
-    static int i;
+    int i;
     
     // Determine if the sphere (including it's radius) is outside of the
     // viewing frustum by checking it against all 6 sides.
@@ -329,7 +329,8 @@ bool camera_module::sphereInView(float pos[3], float radius)
     purpose     :   Returns the direction vector formed from clicking on the
                     screen at some position. Useful for many different apps.
     notes       :   Uses the linear algebra concept of linear transformation
-                    to go from one coordinate system to another.
+                    to go from one coordinate system to another. Does not
+                    touch the GL matrix stack.
 *******************************************************************************/
 kVector camera_module::vectorAt(int x, int y)
 {
@@ -337,9 +338,9 @@ kVector camera_module::vectorAt(int x, int y)
     float clip_height;          // Clipping window height
     float clip_width;           // Clipping window width
     
-    GLfloat modelview[16];      // Modelview matrix storage
-    GLfloat clip_point[4];      // Clipping point
-    GLfloat world_point[4];     // World  point
+    float sin_a, cos_a;         // Rotation sine/cosine
+    float clip_point[4];        // Clipping point
+    float world_point[4];       // World  point
     
     // Determine screen offsets in normalized coords.
     y_off = (((float)y / (game_setup.screen_height - 1)) - 0.5) * 2.0;
@@ -359,34 +360,23 @@ kVector camera_module::vectorAt(int x, int y)
     clip_point[2] = clip_height * y_off;
     clip_point[3] = 1.0;
     
-    // Build our matrix for the linear transformation
-    glMatrixMode(GL_MODELVIEW);     // Do this in our modelview matrix
-    
-    glPushMatrix();     // Save current matrix
-    
-    glLoadIdentity();
-    
-    glTranslatef(pos[0], pos[1], pos[2]);           // Position translate
-    glRotatef(dir[2] * radToDeg, 0.0, 1.0, 0.0);    // Yaw rotate
-    glRotatef(dir[1] * radToDeg, 1.0, 0.0, 0.0);    // Pitch rotate
-    
-    // Grab modelview matrix
-    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
-    
-    glPopMatrix();      // Restore matrix
-    
-    // Matrix Multiply - 4x4 matMult 1x4
-    for (int i = 0; i < 4; i++)
-        world_point[i] = modelview[0 + i] * clip_point[0] +
-                         modelview[4 + i] * clip_point[1] +
-                         modelview[8 + i] * clip_point[2] +
-                         modelview[12 + i] * clip_point[3];
-    
-    // Return difference between the world coordinate point and the camera
-    // point to get the direction vector.
-    return kVector((world_point[0] - pos[0]),
-                   (world_point[1] - pos[1]),
-                   (world_point[2] - pos[2]));
+    // Apply the pitch rotation (about x) and then the yaw rotation (about y),
+    // as glRotatef would, but computed directly so that no GL matrix stack
+    // access is needed (picking calls this several times per click).
+    sin_a = sin(dir[1]);
+    cos_a = cos(dir[1]);
+    world_point[0] = clip_point[0];
+    world_point[1] = (clip_point[1] * cos_a) - (clip_point[2] * sin_a);
+    world_point[2] = (clip_point[1] * sin_a) + (clip_point[2] * cos_a);
+    
+    sin_a = sin(dir[2]);
+    cos_a = cos(dir[2]);
+    clip_point[0] = (world_point[0] * cos_a) + (world_point[2] * sin_a);
+    clip_point[1] = world_point[1];
+    clip_point[2] = (world_point[2] * cos_a) - (world_point[0] * sin_a);
+    
+    // Rotated point is the direction vector (position translate is implied).
+    return kVector(clip_point[0], clip_point[1], clip_point[2]);
 }
 
 /*******************************************************************************
@@ -4,6 +4,7 @@
 #include "main.h"
 #include "collision.h"
 #include "atg.h"
+#include "ballistics.h"
 #include "console.h"
 #include "database.h"
 #include "effects.h"
@@ -27,8 +28,12 @@ collision_module::collision_module()
     ofstream fout;
     
     // Initialize some values
-    acl_head = NULL;
-    acl_pending = NULL;
+    acl_heap = new ac_node* [CD_ACL_INITIAL];
+    acl_count = 0;
+    acl_size = CD_ACL_INITIAL;
+    acl_sequence = 0;
+    cdr_clock = 0.0;
+    acn_free = NULL;
     pen_log = true;
     
     // Create collision log header
@@ -47,21 +52,18 @@ collision_module::~collision_module()
 {
     // Kill all the ACNs
     ac_node* curr;
+    int i;
     
-    curr = acl_head;
-    while(curr)
-    {
-        acl_head = acl_head->next;
-        delete curr;
-        curr = acl_head;
-    }
+    for(i = 0; i < acl_count; i++)
+        delete acl_heap[i];
+    delete [] acl_heap;
     
-    curr = acl_pending;
+    curr = acn_free;
     while(curr)
     {
-        acl_pending = acl_pending->next;
+        acn_free = acn_free->next;
         delete curr;
-        curr = acl_pending;
+        curr = acn_free;
     }
 }
 
@@ -74,7 +76,8 @@ collision_module::~collision_module()
     purpose     :   Builds the local coordinate system inversing matrix between
                     object one's hull matrix to object two's attachment matrix.
     notes       :   Provides the matrix which converts from one's LCS to two's
-                    LCS. Required for some of the ops we're doing here.
+                    LCS. Required for some of the ops we're doing here. Built
+                    on the CPU, so it is safe to call from job worker threads.
 *******************************************************************************/
 void collision_module::buildLCSIM(object* obj_one_ptr, object* obj_two_ptr,
     int attachment, GLfloat* matrix)
@@ -82,10 +85,10 @@ void collision_module::buildLCSIM(object* obj_one_ptr, object* obj_two_ptr,
     tank_object* tank_ptr;
     atg_object* atg_ptr;
     
-    // Save modelview matrix stack
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
+    GLfloat inverse[16];
+    
+    // Build the inverse of object two's attachment matrix
+    matrixIdentity(inverse);
     
     // Switch to inversing build based on object type
     switch(obj_two_ptr->obj_type)
@@ -101,7 +104,7 @@ void collision_module::buildLCSIM(object* obj_one_ptr, object* obj_two_ptr,
                 int gun = attachment - OBJ_ATTACH_GUN_OFF;
                 
                 // Build
-                glTranslatef(0.0, 0.0, tank_ptr->gun[gun].getGunRecoil());
+                matrixTranslate(inverse, 0.0, 0.0, tank_ptr->gun[gun].getGunRecoil());
                 
                 // Update attachment for next level
                 attachment = OBJ_ATTACH_GUNMNT_OFF + gun;
@@ -113,10 +116,10 @@ void collision_module::buildLCSIM(object* obj_one_ptr, object* obj_two_ptr,
                 int gun = attachment - OBJ_ATTACH_GUNMNT_OFF;
                 
                 // Build
-                glRotatef(-((tank_ptr->gun[gun].getElevate() * radToDeg) - 90.0), 1.0, 0.0, 0.0);
+                matrixRotateX(inverse, -(tank_ptr->gun[gun].getElevate() - PIHALF));
                 if(tank_ptr->gun[gun].getGunAttach() == OBJ_ATTACH_HULL)
-                    glRotatef(-(tank_ptr->gun[gun].getTransverse() * radToDeg), 0.0, 1.0, 0.0);
-                glTranslatef(-tank_ptr->gun[gun].getGunPivotV()[0], -tank_ptr->gun[gun].getGunPivotV()[1], -tank_ptr->gun[gun].getGunPivotV()[2]);
+                    matrixRotateY(inverse, -(tank_ptr->gun[gun].getTransverse()));
+                matrixTranslate(inverse, -tank_ptr->gun[gun].getGunPivotV()[0], -tank_ptr->gun[gun].getGunPivotV()[1], -tank_ptr->gun[gun].getGunPivotV()[2]);
                 
                 // Update attachment for next level
                 attachment = tank_ptr->gun[gun].getGunAttach();
@@ -128,14 +131,14 @@ void collision_module::buildLCSIM(object* obj_one_ptr, object* obj_two_ptr,
                 int turret = attachment - OBJ_ATTACH_TURRET_OFF;
                 
                 // Build
-                glRotatef(-(tank_ptr->turret_rotation[turret] * radToDeg), 0.0, 1.0, 0.0);
-                glTranslatef(-tank_ptr->turret_pivot[turret][0], -tank_ptr->turret_pivot[turret][1], -tank_ptr->turret_pivot[turret][2]);  
+                matrixRotateY(inverse, -(tank_ptr->turret_rotation[turret]));
+                matrixTranslate(inverse, -tank_ptr->turret_pivot[turret][0], -tank_ptr->turret_pivot[turret][1], -tank_ptr->turret_pivot[turret][2]);  
             }
             // Build for base hull (orientation) attach
-            glRotatef(-(tank_ptr->roll * radToDeg), 0.0, 0.0, 1.0);
-            glRotatef(-((tank_ptr->dir[1] * radToDeg) - 90.0), 1.0, 0.0, 0.0);
-            glRotatef(-(tank_ptr->dir[2] * radToDeg), 0.0, 1.0, 0.0);
-            glTranslatef(-tank_ptr->pos[0], -tank_ptr->pos[1], -tank_ptr->pos[2]);
+            matrixRotateZ(inverse, -(tank_ptr->roll));
+            matrixRotateX(inverse, -(tank_ptr->dir[1] - PIHALF));
+            matrixRotateY(inverse, -(tank_ptr->dir[2]));
+            matrixTranslate(inverse, -tank_ptr->pos[0], -tank_ptr->pos[1], -tank_ptr->pos[2]);
             break;
         
         case OBJ_TYPE_ATG:
@@ -146,7 +149,7 @@ void collision_module::buildLCSIM(object* obj_one_ptr, object* obj_two_ptr,
             if(attachment >= OBJ_ATTACH_GUN_OFF)
             {
                 // Build
-                glTranslatef(0.0, 0.0, atg_ptr->gun[0].getGunRecoil());
+                matrixTranslate(inverse, 0.0, 0.0, atg_ptr->gun[0].getGunRecoil());
                 
                 // Update attachment for next level
                 attachment = OBJ_ATTACH_GUNMNT1;
@@ -155,16 +158,16 @@ void collision_module::buildLCSIM(object* obj_one_ptr, object* obj_two_ptr,
             if(attachment >= OBJ_ATTACH_GUNMNT_OFF)
             {
                 // Build
-                glTranslatef(0.0, 0.0, 0.5 * atg_ptr->gun[0].getGunRecoil());
-                glRotatef(-((atg_ptr->gun[0].getElevate() * radToDeg) - 90.0), 1.0, 0.0, 0.0);
-                glRotatef(-(atg_ptr->gun[0].getTransverse() * radToDeg), 0.0, 1.0, 0.0);
-                glTranslatef(-atg_ptr->gun[0].getGunPivotV()[0], -atg_ptr->gun[0].getGunPivotV()[1], -atg_ptr->gun[0].getGunPivotV()[2]);
+                matrixTranslate(inverse, 0.0, 0.0, 0.5 * atg_ptr->gun[0].getGunRecoil());
+                matrixRotateX(inverse, -(atg_ptr->gun[0].getElevate() - PIHALF));
+                matrixRotateY(inverse, -(atg_ptr->gun[0].getTransverse()));
+                matrixTranslate(inverse, -atg_ptr->gun[0].getGunPivotV()[0], -atg_ptr->gun[0].getGunPivotV()[1], -atg_ptr->gun[0].getGunPivotV()[2]);
             }
             // Build for base hull (orientation) attach
-            glRotatef(-(atg_ptr->roll * radToDeg), 0.0, 0.0, 1.0);
-            glRotatef(-((atg_ptr->dir[1] * radToDeg) - 90.0), 1.0, 0.0, 0.0);
-            glRotatef(-(atg_ptr->dir[2] * radToDeg), 0.0, 1.0, 0.0);
-            glTranslatef(-atg_ptr->pos[0], -atg_ptr->pos[1], -atg_ptr->pos[2]);
+            matrixRotateZ(inverse, -(atg_ptr->roll));
+            matrixRotateX(inverse, -(atg_ptr->dir[1] - PIHALF));
+            matrixRotateY(inverse, -(atg_ptr->dir[2]));
+            matrixTranslate(inverse, -atg_ptr->pos[0], -atg_ptr->pos[1], -atg_ptr->pos[2]);
             break;
         
         case OBJ_TYPE_VEHICLE:
@@ -174,17 +177,15 @@ void collision_module::buildLCSIM(object* obj_one_ptr, object* obj_two_ptr,
         case OBJ_TYPE_STATIC:
         default:
             // Build for base hull (orientation) attach
-            glRotatef(-obj_two_ptr->roll * radToDeg, 0.0, 0.0, 1.0);
-            glRotatef(-((obj_two_ptr->dir[1] * radToDeg) - 90.0), 1.0, 0.0, 0.0);
-            glRotatef(-obj_two_ptr->dir[2] * radToDeg, 0.0, 1.0, 0.0);
-            glTranslatef(-obj_two_ptr->pos[0], -obj_two_ptr->pos[1], -obj_two_ptr->pos[2]);
+            matrixRotateZ(inverse, -obj_two_ptr->roll);
+            matrixRotateX(inverse, -(obj_two_ptr->dir[1] - PIHALF));
+            matrixRotateY(inverse, -obj_two_ptr->dir[2]);
+            matrixTranslate(inverse, -obj_two_ptr->pos[0], -obj_two_ptr->pos[1], -obj_two_ptr->pos[2]);
             break;
     }
     
-    // Multiply by object one's hull matrix, save into *matrix, pop matrix stack
-    glMultMatrixf(obj_one_ptr->hull_matrix);
-    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-    glPopMatrix();
+    // Multiply by object one's hull matrix, save into *matrix
+    matrixMultiply(matrix, inverse, obj_one_ptr->hull_matrix);
 }
 
 /*******************************************************************************
@@ -358,7 +359,7 @@ cr_data* collision_module::penetration_calculator(proj_object* proj_ptr,
     
     float pen_at_pb = 0.0;              // Curve #s
     float pen_curve = 0.0;
-    float vel_at_mz = 0.0;
+    int pen_column;                     // Ammo table column (BL_ARMOR_x)
     
     float A, B;                         // Spare variables
     
@@ -457,113 +458,28 @@ cr_data* collision_module::penetration_calculator(proj_object* proj_ptr,
     // Grab shell diameter (converting from cm to mm)
     shell_diameter = proj_ptr->diameter * 10.0;
     
-    // Grab shell penetration curve data
-    if(armor_type == ARMOR_TYPE_RHA || armor_type == ARMOR_TYPE_CAST)
-    {
-        temp = db.query(proj_ptr->obj_model, "PEN_RHA_AT_PB");
-        if(temp)
-            pen_at_pb = atof(temp);
-        else
-        {
-            sprintf(buffer, "CR: Penetration curves not defined for projectile type \"%s\".",
-                proj_ptr->obj_model);
-            write_error(buffer);
-            delete cr_dr;
-            return NULL;
-        }
-        
-        temp = db.query(proj_ptr->obj_model, "PEN_RHA_CURVE");
-        if(temp)
-            pen_curve = atof(temp);
-        else
-        {
-            sprintf(buffer, "CR: Penetration curves not defined for projectile type \"%s\".",
-                proj_ptr->obj_model);
-            write_error(buffer);
-            delete cr_dr;
-            return NULL;
-        }
-    }
-    else if(armor_type == ARMOR_TYPE_FHS)
-    {
-        temp = db.query(proj_ptr->obj_model, "PEN_FHS_AT_PB");
-        if(temp)
-            pen_at_pb = atof(temp);
-        else
-        {
-            temp = db.query(proj_ptr->obj_model, "PEN_RHA_AT_PB");
-            if(temp)
-            {
-                pen_at_pb = atof(temp);
-                
-                // If only the RHA is defined, yet FHS is being attacked, we
-                // fill in the "blank" by using the Russian tests which show
-                // about a 1.05 gain for capped ammo and 0.87 otherwise. We
-                // only do this to the pen_at_pb since curve doesn't matter.
-                if(shell_type == AMMO_TYPE_APC || shell_type == AMMO_TYPE_APCBC)
-                    pen_at_pb *= 1.05;
-                else if(shell_type == AMMO_TYPE_AP || shell_type == AMMO_TYPE_APCR || shell_type == AMMO_TYPE_API)
-                    pen_at_pb *= 0.87;
-            }
-        }
-        // If temp is still NULL, then neither FHS or RHA were defined
-        if(temp == NULL)
-        {
-            sprintf(buffer, "CR: Penetration curves not defined for projectile type \"%s\".",
-                proj_ptr->obj_model);
-            write_error(buffer);
-            delete cr_dr;
-            return NULL;
-        }
-        
-        temp = db.query(proj_ptr->obj_model, "PEN_FHS_CURVE");
-        if(temp)
-            pen_curve = atof(temp);
-        else
-        {
-            temp = db.query(proj_ptr->obj_model, "PEN_RHA_CURVE");
-            if(temp)
-                pen_curve = atof(temp);
-        }        
-        // If temp is still NULL, then neither FHS or RHA were defined
-        if(temp == NULL)
-        {
-            sprintf(buffer, "CR: Penetration curves not defined for projectile type \"%s\".",
-                proj_ptr->obj_model);
-            write_error(buffer);
-            delete cr_dr;
-            return NULL;
-        }
-    }
-    
-    // Grab muzzle velocity of shell (velocity rating of shell will not work
-    // correctly with the formulas we have here-in if it isn't m.v.).
-    temp = db.query(proj_ptr->obj_model, "VELOCITY");
-    if(temp)
-        vel_at_mz = atof(temp);
-    else
+    // Grab shell ballistic tables (built at DB load), and select the
+    // penetration column for the armor type being attacked.
+    if(proj_ptr->ammo_table == NULL)
     {
-        // Check for valid entry in DB
-        sprintf(buffer, "CR: Velocity for round \"%s\" not defined.",
+        sprintf(buffer, "CR: Penetration curves not defined for projectile type \"%s\".",
             proj_ptr->obj_model);
         write_error(buffer);
         delete cr_dr;
         return NULL;
     }
     
-    // Grab shell weight
-    temp = db.query(proj_ptr->obj_model, "WEIGHT");
-    if(temp)
-        shell_weight = atof(temp);
+    if(armor_type == ARMOR_TYPE_FHS)
+        pen_column = BL_ARMOR_FHS;
     else
-    {
-        // Check for valid entry in DB
-        sprintf(buffer, "CR: Weight for round \"%s\" not defined.",
-            proj_ptr->obj_model);
-        write_error(buffer);
-        delete cr_dr;
-        return NULL;
-    }
+        pen_column = BL_ARMOR_RHA;
+    
+    // Grab shell penetration curve data
+    pen_at_pb = proj_ptr->ammo_table->pen_at_pb[pen_column];
+    pen_curve = proj_ptr->ammo_table->pen_curve[pen_column];
+    
+    // Grab shell weight
+    shell_weight = proj_ptr->ammo_table->weight;
     
     /* BEGIN DATA CALCULATIONS */
     
@@ -571,14 +487,16 @@ cr_data* collision_module::penetration_calculator(proj_object* proj_ptr,
     // thus a portion of the code here splits into two pieces to appropriately
     // handle several situations.
     
-    // Calculate thickness penetrated via penetration curve.
-    cr_dr->penetration = pen_at_pb * powf(pen_curve, travel_distance);
+    // Calculate thickness penetrated via penetration curve (from table).
+    cr_dr->penetration = ballistics.ammoPenetration(proj_ptr->ammo_table,
+        pen_column, travel_distance);
     
     // Calculate shell striking velocity via penetration curve as well (since
     // penetration and shell velocity are hand-in-hand). Obviously this won't
     // tell us the correct number for HEAT shells (since pen_curve == 1.0).
     // This value is only used for a few minor calculations.
-    shell_velocity = vel_at_mz * powf(pen_curve, travel_distance);
+    shell_velocity = ballistics.ammoVelocity(proj_ptr->ammo_table,
+        pen_column, travel_distance);
     
     // Calculate impacting kinetic energy.
     cr_dr->impact_ke = 0.5 * shell_weight * shell_velocity * shell_velocity;
@@ -861,7 +779,8 @@ cr_data* collision_module::penetration_calculator(proj_object* proj_ptr,
                         
                         // Compute the resultant velocity after richochet
                         // based on the offset we just computed.
-                        cr_dr->result_velocity = vel_at_mz * powf(pen_curve,
+                        cr_dr->result_velocity = ballistics.ammoVelocity(
+                            proj_ptr->ammo_table, pen_column,
                             travel_distance + cr_dr->distance_offset);
                         
                         // Compute resultant KE from above computed.
@@ -1235,15 +1154,17 @@ bool collision_module::checkMeshAABB(kVector rayPos, kVector rayDir,
                     mesh - Model library mesh #
                     t_min - Cutoff value for T (no T less than are "passed")
                     t_max - Cutoff value for T (no T greater than are "passed")
+                    cdReport - CD data report to fill in (if hit)
     purpose     :   Performs the incredibly computational polygon based
                     collision check against the model library mesh.
-    notes       :   <none>
+    notes       :   Returns true and fills in cdReport on a hit. cdReport is
+                    left untouched otherwise.
 *******************************************************************************/
-cd_data* collision_module::checkMeshPB(kVector rayPos, kVector rayDir,
-    int id, int mesh, float t_min, float t_max)
+bool collision_module::checkMeshPB(kVector rayPos, kVector rayDir,
+    int id, int mesh, float t_min, float t_max, cd_data &cdReport)
 {
     int i;
-    cd_data* cd_dr = NULL;
+    bool hit = false;
     int vertex_count = models.getVertexCount(id, mesh);
     GLfloat** vertex_data = models.getVertexData(id, mesh);
     GLfloat** normal_data = models.getNormalData(id, mesh);
@@ -1296,9 +1217,8 @@ cd_data* collision_module::checkMeshPB(kVector rayPos, kVector rayDir,
                     // T found
                     t = t_curr;
                     
-                    // Create cdc data report
-                    if(cd_dr == NULL)
-                        cd_dr = new cd_data;
+                    // Flag hit for cdc data report
+                    hit = true;
                     
                     // Record which vertex we were on
                     vertex_inter = i;
@@ -1308,40 +1228,39 @@ cd_data* collision_module::checkMeshPB(kVector rayPos, kVector rayDir,
     }
     
     // Create CD data report
-    if(cd_dr != NULL)
+    if(hit)
     {
-        // Copy over values to CD data report
-        cd_dr->rayPos = rayPos;
-        cd_dr->rayDir = rayDir;
-        cd_dr->id = id;
-        cd_dr->mesh = mesh;
-        cd_dr->attachment = OBJ_ATTACH_HULL;     // Temporary value
-        cd_dr->t = t;
-        cd_dr->impactPoint = rayPos + (rayDir * t);
         // Determine impact angle (0 to PI/90)
-        cd_dr->impactAngle = fabsf(PI - 
-            fabsf(angleBetweenNormals(kVector(normal_data[vertex_inter]),
+        kVector normal(normal_data[vertex_inter]);
+        float impact_angle = fabsf(PI - fabsf(angleBetweenNormals(normal,
             rayDir)));
-        // Determine reflection vector
-        cd_dr->reflection = rayDir -
-            (kVector(normal_data[vertex_inter]) * 2.0f * dotProduct(rayDir,
-                kVector(normal_data[vertex_inter])));
         
         // Handle situations where the impact angle is greater than PI/2.
-        if(cd_dr->impactAngle > PIHALF)
-            cd_dr->impactAngle = fabsf(PI - cd_dr->impactAngle);
-    }
-    
-    // Handle situations where the CDD report comes in as saying the impact
-    // angle was greater than PI/2, in which case something REALLY crazy is
-    // going on to cause such a thing.
-    if(cd_dr && cd_dr->impactAngle > PIHALF)
-    {
-        delete cd_dr;
-        cd_dr = NULL;
+        if(impact_angle > PIHALF)
+            impact_angle = fabsf(PI - impact_angle);
+        
+        // Handle situations where the CDD report comes in as saying the
+        // impact angle was greater than PI/2, in which case something REALLY
+        // crazy is going on to cause such a thing.
+        if(impact_angle > PIHALF)
+            return false;
+        
+        // Copy over values to CD data report
+        cdReport.rayPos = rayPos;
+        cdReport.rayDir = rayDir;
+        cdReport.id = id;
+        cdReport.mesh = mesh;
+        cdReport.attachment = OBJ_ATTACH_HULL;   // Temporary value
+        cdReport.modifiers = CD_MOD_NONE;
+        cdReport.t = t;
+        cdReport.impactPoint = rayPos + (rayDir * t);
+        cdReport.impactAngle = impact_angle;
+        // Determine reflection vector
+        cdReport.reflection = rayDir -
+            (normal * 2.0f * dotProduct(rayDir, normal));
     }
     
-    return cd_dr;
+    return hit;
 }
 
 /*******************************************************************************
@@ -1353,36 +1272,26 @@ cd_data* collision_module::checkMeshPB(kVector rayPos, kVector rayDir,
     notes       :   <none>
 *******************************************************************************/
 inline int check_mesh(kVector ray_pos, kVector ray_dir, int id, int mesh,
-    int attach, float &t_best, cd_data* &cd_dr,
-    cd_data* &cd_dr_best, int mesh_exclude)
+    int attach, float &t_best, cd_data &cd_dr,
+    cd_data &cd_dr_best, int mesh_exclude)
 {
-    cd_dr = NULL;
-    
     if(mesh != -1 && mesh != mesh_exclude)  // Make sure mesh checks out
     {
         // Check against the AABB of the mesh
         if(cdr.checkMeshAABB(ray_pos, ray_dir, id, mesh, FP_ERROR, t_best))
         {
-            // Do a polygon based check against the mesh
-            cd_dr = cdr.checkMeshPB(ray_pos, ray_dir, id, mesh, FP_ERROR, t_best);
-            if(cd_dr != NULL)
+            // Do a polygon based check against the mesh (only hits better
+            // than t_best are reported, so any hit is the new best)
+            if(cdr.checkMeshPB(ray_pos, ray_dir, id, mesh, FP_ERROR, t_best, cd_dr))
             {
-                cd_dr->attachment = attach;    // Set the attachemnt value
-                if(cd_dr->t < t_best)          // Check for best T value
-                {
-                    if(cd_dr_best != NULL)
-                        delete cd_dr_best;
-                    t_best = cd_dr->t;
-                    cd_dr_best = cd_dr;
-                }
-                else
-                    delete cd_dr;              // Won't change its ptr
+                cd_dr.attachment = attach;      // Set the attachemnt value
+                t_best = cd_dr.t;
+                cd_dr_best = cd_dr;
+                return 1;
             }
         }
     }
     
-    if(cd_dr != NULL)
-        return 1;
     return 0;
 }
 
@@ -1395,11 +1304,9 @@ inline int check_mesh(kVector ray_pos, kVector ray_dir, int id, int mesh,
     notes       :   <none>
 *******************************************************************************/
 inline int check_mesh(kVector ray_pos, kVector ray_dir, int id, char* slab,
-    int attach, float &t_best, cd_data* &cd_dr,
-    cd_data* &cd_dr_best, int mesh_exclude)
+    int attach, float &t_best, cd_data &cd_dr,
+    cd_data &cd_dr_best, int mesh_exclude)
 {
-    cd_dr = NULL;
-    
     int mesh = models.getMeshID(id, slab);  // Get mesh ID number
     
     if(mesh != -1 && mesh != mesh_exclude)  // Make sure mesh checks out
@@ -1407,26 +1314,18 @@ inline int check_mesh(kVector ray_pos, kVector ray_dir, int id, char* slab,
         // Check against the AABB of the mesh
         if(cdr.checkMeshAABB(ray_pos, ray_dir, id, mesh, FP_ERROR, t_best))
         {
-            // Do a polygon based check against the mesh
-            cd_dr = cdr.checkMeshPB(ray_pos, ray_dir, id, mesh, FP_ERROR, t_best);
-            if(cd_dr != NULL)
+            // Do a polygon based check against the mesh (only hits better
+            // than t_best are reported, so any hit is the new best)
+            if(cdr.checkMeshPB(ray_pos, ray_dir, id, mesh, FP_ERROR, t_best, cd_dr))
             {
-                cd_dr->attachment = attach;      // Set the attachemnt value
-                if(cd_dr->t < t_best)            // Check for best T value
-                {
-                    if(cd_dr_best != NULL)
-                        delete cd_dr_best;
-                    t_best = cd_dr->t;
-                    cd_dr_best = cd_dr;
-                }
-                else
-                    delete cd_dr;
+                cd_dr.attachment = attach;      // Set the attachemnt value
+                t_best = cd_dr.t;
+                cd_dr_best = cd_dr;
+                return 1;
             }
         }
     }
     
-    if(cd_dr != NULL)
-        return 1;
     return 0;
 }
 
@@ -1440,13 +1339,48 @@ inline int check_mesh(kVector ray_pos, kVector ray_dir, int id, char* slab,
                     meshExclude - Excludes mesh specified from testing. If all
                                   meshes wish to be tested against, pass the
                                   value of CD_EXCLUDE_NO_MESHES.
+    purpose     :   Checks the object meshes between the two objects and returns
+                    a pooled ACN with the collision data report held within if
+                    penetration does occur, otherwise returns NULL. ACN is used
+                    in junction with an addACN call afterwords (ACN is returned
+                    to determine collision or not to the calling system).
+    notes       :   1) An ACN is returned, that is an Anticipated Collision
+                       Node, a node which the CDR system can use to predict
+                       collisions and respond to them at the appropriate time
+                       if added into the system after the function returns.
+                       The ACN is returned so that the calling system can be
+                       notified of collision (ACN != NULL) or not (ACN == NULL).
+                    2) The returned value is a pooled ACN, unless of course
+                       a collision does not happen, in which NULL is returned.
+                       addACN will effectively handle its release from that
+                       point - otherwise it must be released with killACN.
+*******************************************************************************/
+ac_node* collision_module::checkMeshes(object* objOnePtr, object* objTwoPtr,
+    float moveBack, int meshExclude)
+{
+    cd_data cd_report;
+    
+    if(checkMeshes(objOnePtr, objTwoPtr, moveBack, meshExclude, cd_report))
+        return buildACN(objOnePtr, objTwoPtr, cd_report);
+    
+    return NULL;
+}
+
+/*******************************************************************************
+    function    :   collision_module::checkMeshes
+    arguments   :   objOnePtr - Object one which is colliding into object two
+                    objTwoPtr - Object two which is being collided into by one
+                    moveBack - How much the object should be "backed off"
+                               slightly to correctly perform CDR onto (which
+                               effectively sets the t minimum value).
+                    meshExclude - Excludes mesh specified from testing. If all
+                                  meshes wish to be tested against, pass the
+                                  value of CD_EXCLUDE_NO_MESHES.
+                    cdReport - CD data report to fill in (if collision)
     purpose     :   Checks the object meshes between the two objects in an
                     efficient and heuristic manner to determine which mesh
-                    is going to be collided with. Returns a newly created ACN
-                    with collision data report held within if penetration does
-                    occur, otherwise returns NULL. ACN is used in junction with
-                    an addACN call afterwords (ACN is returned to determine
-                    collision or not to the calling system).
+                    is going to be collided with. Returns true and fills in
+                    cdReport if penetration does occur, otherwise returns false.
     notes       :   NOTICE: Due to the absoluely insane nature of the way things
                             need to be checked, comments are left to a minimum
                             since even with them it would still be confusing.
@@ -1458,22 +1392,15 @@ inline int check_mesh(kVector ray_pos, kVector ray_dir, int id, char* slab,
                        e.g. when the test object "goes into" the other object.
                        Default value should be set to CD_T_START, otherwise
                        any other value is acceptable. Synonomous with t_min.
-                    2) An ACN is returned, that is an Anticipated Collision
-                       Node, a node which the CDR system can use to predict
-                       collisions and respond to them at the appropriate time
-                       if added into the system after the function returns.
-                       The ACN is returned so that the calling system can be
-                       notified of collision (ACN != NULL) or not (ACN == NULL).
-                    3) The returned value is a NEW allocation, unless of course
-                       a collision does not happen, in which NULL is returned.
-                       addACN will effectively handle the deallocation from
-                       that point - otherwise its the calling system's problem.
+                    2) Only reads object and model data and changes no module
+                       state, so it may be run from job worker threads (see
+                       object_handler::cdProjPass) while objects hold still.
 *******************************************************************************/
-ac_node* collision_module::checkMeshes(object* objOnePtr, object* objTwoPtr,
-    float moveBack = CD_T_OFFSET, int meshExclude = CD_EXCLUDE_NO_MESHES)
+bool collision_module::checkMeshes(object* objOnePtr, object* objTwoPtr,
+    float moveBack, int meshExclude, cd_data &cdReport)
 {
-    cd_data* cd_dr = NULL;
-    cd_data* cd_dr_best = NULL;
+    cd_data cd_dr;                                  // Scratch report
+    cd_data cd_dr_best;                             // Best report so far
     unsigned short cd_modifiers = CD_MOD_NONE;
     
     float t_best = CD_T_START;                      // Starts at t_max
@@ -2116,37 +2043,49 @@ ac_node* collision_module::checkMeshes(object* objOnePtr, object* objTwoPtr,
         
         // Does not currently check anything but projectiles
         default:
-            return NULL;
+            return false;
             break;
     }
     
-    // Sees if an ACN should be returned    
-    if(cd_dr_best != NULL)
+    // Sees if a collision should be reported
+    if(t_best < CD_T_START)
     {
-        cd_dr_best->t -= moveBack;
-        cd_dr_best->modifiers = cd_modifiers;
-        return buildACN(objOnePtr, objTwoPtr, cd_dr_best);
+        cdReport = cd_dr_best;
+        cdReport.t -= moveBack;
+        cdReport.modifiers = cd_modifiers;
+        return true;
     }
     else if(cd_modifiers & CD_MOD_EXT_CREW_HIT)
     {
         // do crew-hit CR
     }
     
-    return NULL;
+    return false;
 }
 
 /*******************************************************************************
     function    :   collision_module::buildACN
     arguments   :   objOnePtr - Pointer to object doing the colliding
                     objTwoPtr - Pointer to object being collided with
-                    cdDataReport - Pointer to the CD data report
+                    cdDataReport - CD data report (copied into ACN)
     purpose     :   Creates an ACN based on the passed parameters.
-    notes       :   Returns a NEW allocation.
+    notes       :   Returns an ACN off of the free list if one is available,
+                    otherwise a NEW allocation, which is to be released with
+                    killACN (or handed to addACN) rather than deleted.
 *******************************************************************************/
 ac_node* collision_module::buildACN(object* objOnePtr, object* objTwoPtr,
-    cd_data* cdDataReport)
+    cd_data &cdDataReport)
 {
-    ac_node* ACN = new ac_node;
+    ac_node* ACN;
+    
+    // Grab ACN from pool
+    if(acn_free)
+    {
+        ACN = acn_free;
+        acn_free = acn_free->next;
+    }
+    else
+        ACN = new ac_node;
     
     // Set pointers for ACN
     ACN->objOnePtr = objOnePtr;
@@ -2158,7 +2097,7 @@ ac_node* collision_module::buildACN(object* objOnePtr, object* objTwoPtr,
     switch(objOnePtr->obj_type)
     {
         case OBJ_TYPE_PROJECTILE:
-            ACN->timeToCollision = cdDataReport->t /
+            ACN->timeToCollision = cdDataReport.t /
                 (((proj_object*)objOnePtr)->velocity * PROJ_VEL_MULTIPLIER);
             break;
         
@@ -2178,8 +2117,10 @@ ac_node* collision_module::buildACN(object* objOnePtr, object* objTwoPtr,
     arguments   :   ACN - Anticipated collision node
     purpose     :   Adds an ACN to the currently handled list of such nodes so
                     that predictive collision detection works.
-    notes       :   From this point forth, ACN deallocation will be handled
-                    internally in the CDR module.
+    notes       :   1) From this point forth, ACN deallocation will be handled
+                       internally in the CDR module.
+                    2) timeToCollision is taken from the last update, and is
+                       turned into the absolute CDR clock time it comes due.
 *******************************************************************************/
 void collision_module::addACN(ac_node* ACN)
 {
@@ -2191,14 +2132,13 @@ void collision_module::addACN(ac_node* ACN)
     if(ACN->timeToCollision <= 0.0)
     {
         handle(ACN);
-        delete ACN->cdDataReport;
-        delete ACN;
+        killACN(ACN);
     }
     else
     {
-        // Add ACN into linked list
-        ACN->next = acl_head;
-        acl_head = ACN;
+        // Add ACN into ACL
+        ACN->collisionTime = cdr_clock + ACN->timeToCollision;
+        acl_push(ACN);
         
         // Handle special cased cdr passes variable
         if(ACN->objOnePtr->obj_type == OBJ_TYPE_PROJECTILE)
@@ -2208,6 +2148,93 @@ void collision_module::addACN(ac_node* ACN)
     }
 }
 
+/*******************************************************************************
+    function    :   collision_module::acl_push
+    arguments   :   ACN - Anticipated collision node
+    purpose     :   Inserts an ACN into the ACL heap, growing the heap as needed.
+    notes       :   ACN's collisionTime must already be set.
+*******************************************************************************/
+void collision_module::acl_push(ac_node* ACN)
+{
+    ac_node** new_heap;
+    int i, parent;
+    
+    // Grow heap if full
+    if(acl_count == acl_size)
+    {
+        new_heap = new ac_node* [acl_size * 2];
+        for(i = 0; i < acl_count; i++)
+            new_heap[i] = acl_heap[i];
+        delete [] acl_heap;
+        acl_heap = new_heap;
+        acl_size *= 2;
+    }
+    
+    ACN->sequence = acl_sequence++;
+    
+    // Sift up
+    i = acl_count++;
+    while(i > 0)
+    {
+        parent = (i - 1) / 2;
+        if(!acl_before(ACN, acl_heap[parent]))
+            break;
+        acl_heap[i] = acl_heap[parent];
+        i = parent;
+    }
+    acl_heap[i] = ACN;
+}
+
+/*******************************************************************************
+    function    :   collision_module::acl_pop
+    arguments   :   <none>
+    purpose     :   Removes and returns the earliest due ACN from the ACL heap.
+    notes       :   Returns NULL if the ACL is empty.
+*******************************************************************************/
+ac_node* collision_module::acl_pop()
+{
+    ac_node* top;
+    ac_node* last;
+    int i, child;
+    
+    if(acl_count == 0)
+        return NULL;
+    
+    top = acl_heap[0];
+    last = acl_heap[--acl_count];
+    
+    // Sift down
+    i = 0;
+    while((child = 2 * i + 1) < acl_count)
+    {
+        if(child + 1 < acl_count && acl_before(acl_heap[child + 1], acl_heap[child]))
+            child++;
+        if(!acl_before(acl_heap[child], last))
+            break;
+        acl_heap[i] = acl_heap[child];
+        i = child;
+    }
+    if(acl_count > 0)
+        acl_heap[i] = last;
+    
+    return top;
+}
+
+/*******************************************************************************
+    function    :   collision_module::killACN
+    arguments   :   ACN - Anticipated collision node
+    purpose     :   Releases an ACN back to the free list for reuse.
+    notes       :   ACN must not be in the ACL.
+*******************************************************************************/
+void collision_module::killACN(ac_node* ACN)
+{
+    if(!ACN)
+        return;
+    
+    ACN->next = acn_free;
+    acn_free = ACN;
+}
+
 /*******************************************************************************
     function    :   collision_module::handle
     arguments   :   objOnePtr - Pointer to first object
@@ -2344,7 +2371,7 @@ void collision_module::handle(ac_node* ACN)
     }
     
     // Set CD data report pointer
-    cd_dr = ACN->cdDataReport;
+    cd_dr = &ACN->cdDataReport;
     
     switch(((object*)(ACN->objOnePtr))->obj_type)
     {
@@ -2635,14 +2662,10 @@ void collision_module::handle(ac_node* ACN)
                             // Note: also need some code here to increment
                             // distance traveled.
                             handle(rcACN);
-                            delete rcACN->cdDataReport;
-                            delete rcACN;
+                            killACN(rcACN);
                         }
                         else
-                        {
-                            rcACN->next = acl_pending;
-                            acl_pending = rcACN;
-                        }
+                            addACN(rcACN);
                     }
                 }
                 
@@ -2664,58 +2687,34 @@ void collision_module::handle(ac_node* ACN)
 /*******************************************************************************
     function    :   collision_module::update
     arguments   :   deltaT - # of seconds elapsed since last update
-    purpose     :   Updates the list of ACNs currently being held for later
-                    handling.
-    notes       :   <none>
+    purpose     :   Advances the CDR clock and handles every ACN which has come
+                    due, earliest first.
+    notes       :   1) ACNs added while handling (ricochets) are never due in
+                       the same update, as they have a positive time until
+                       collision, so they wait for a following update just as
+                       they did when they were held on a pending list.
+                    2) timeToCollision is set (to zero or below) before each
+                       ACN is handled, as the handler uses the overshoot.
 *******************************************************************************/
 void collision_module::update(float deltaT)
 {
-    ac_node* curr = acl_head;
-    ac_node* prev = NULL;
+    ac_node* curr;
     
-    while(curr)
+    cdr_clock += deltaT;
+    
+    while(acl_count > 0 && acl_heap[0]->collisionTime <= cdr_clock)
     {
-        curr->timeToCollision -= deltaT;        // Decrement timer
+        curr = acl_pop();
+        curr->timeToCollision = (float)(curr->collisionTime - cdr_clock);
         
-        if(curr->timeToCollision <= 0.0)        // Check for timer timeout
-        {
-            handle(curr);                       // Pass ACN to handler function
-            
-            // Handle special cased cdr passes variable
-            if(curr->objOnePtr->obj_type == OBJ_TYPE_PROJECTILE)
-                ((proj_object*)curr->objOnePtr)->cdr_passes--;
-            if(curr->objTwoPtr->obj_type == OBJ_TYPE_PROJECTILE)
-                ((proj_object*)curr->objTwoPtr)->cdr_passes--;
-            
-            delete curr->cdDataReport;          // Delete the CD data report
-            
-            // Maintain linked list
-            if(prev == NULL)
-            {
-                acl_head = acl_head->next;
-                delete curr;
-                curr = acl_head;
-                continue;
-            }
-            else
-            {
-                prev->next = curr->next;
-                delete curr;
-                curr = prev->next;
-                continue;
-            }
-        }
+        handle(curr);                           // Pass ACN to handler function
         
-        prev = curr;
-        curr = curr->next;
-    }
-    
-    // Move all nodes from the pending list to main list for next time.
-    while(acl_pending)
-    {
-        curr = acl_pending->next;
-        acl_pending->next = acl_head;
-        acl_head = acl_pending;
-        acl_pending = curr;
+        // Handle special cased cdr passes variable
+        if(curr->objOnePtr->obj_type == OBJ_TYPE_PROJECTILE)
+            ((proj_object*)curr->objOnePtr)->cdr_passes--;
+        if(curr->objTwoPtr->obj_type == OBJ_TYPE_PROJECTILE)
+            ((proj_object*)curr->objTwoPtr)->cdr_passes--;
+        
+        killACN(curr);
     }
 }
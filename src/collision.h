@@ -17,6 +17,9 @@
 
 #define CD_EXCLUDE_NO_MESHES            -1
 
+// Anticipated Collision List
+#define CD_ACL_INITIAL                  64      // Initial ACL heap capacity
+
 // Slope Effect Fixes (to slope formulas for small-caliber ops)
 #define CR_SLOPE_ADDFIX                 0.06    // Slope multiplier fix
 #define CR_SLOPE_DIAFIX_MULTIPLIER      0.7     // Diameter fix multiplier
@@ -99,10 +102,12 @@ struct ac_node
 {
     object* objOnePtr;
     object* objTwoPtr;
-    cd_data* cdDataReport;
-    float timeToCollision;
+    cd_data cdDataReport;
+    float timeToCollision;              // Relative to now (<= 0 when handled)
+    double collisionTime;               // Absolute CDR clock time (in ACL)
+    unsigned int sequence;              // ACL insertion order (ties)
     
-    ac_node* next;
+    ac_node* next;                      // Free list link
 };
 
 /*******************************************************************************
@@ -114,13 +119,35 @@ struct ac_node
     notes       :   1) Since object control and storage is done in the object
                        handler, the collision module does not handle the supply
                        of object pointers - that is the job of the handler.
+                    2) ACNs are pooled. Nodes released through killACN (and by
+                       the module itself once handled) go on a free list and
+                       are reused by buildACN, so steady state collision
+                       handling does no heap allocation. CD data reports are
+                       carried by value inside of ACNs.
+                    3) The anticipated collision list is a binary min-heap on
+                       the absolute CDR clock time each ACN comes due, so an
+                       update only touches the ACNs which are due. ACNs due at
+                       the same time are handled in the order they were added
+                       (by sequence), keeping resolution deterministic.
 *******************************************************************************/
 class collision_module
 {
     private:
         /* Anticipated Impact List */
-        ac_node* acl_head;
-        ac_node* acl_pending;
+        ac_node** acl_heap;                 // ACL (min-heap on collisionTime)
+        int acl_count;                      // ACNs in ACL
+        int acl_size;                       // ACL capacity
+        unsigned int acl_sequence;          // Next ACL insertion sequence #
+        double cdr_clock;                   // CDR clock (s)
+        ac_node* acn_free;                  // Free ACNs (pool)
+        
+        /* ACL Routines */
+        bool acl_before(ac_node* one, ac_node* two)
+            { return one->collisionTime < two->collisionTime ||
+                (one->collisionTime == two->collisionTime &&
+                 one->sequence < two->sequence); }
+        void acl_push(ac_node* ACN);
+        ac_node* acl_pop();
         
         bool pen_log;                       // Armor penetration logging
         
@@ -145,16 +172,18 @@ class collision_module
         
         /* CD Routines */
         bool checkMeshAABB(kVector rayPos, kVector rayDir, int id, int mesh, float t_min, float t_max);
-        cd_data* checkMeshPB(kVector rayPos, kVector rayDir, int id, int mesh, float t_min, float t_max);
+        bool checkMeshPB(kVector rayPos, kVector rayDir, int id, int mesh, float t_min, float t_max, cd_data &cdReport);
         ac_node* checkMeshes(object* objOnePtr, object* objTwoPtr, float moveBack, int meshExclude);
+        bool checkMeshes(object* objOnePtr, object* objTwoPtr, float moveBack, int meshExclude, cd_data &cdReport);
         
         /* CR Routines */
         void handle(object* objOnePtr, object* objTwoPtr);
         void handle(ac_node* ACN);
         
         /* Functionality */
-        ac_node* buildACN(object* objOnePtr, object* objTwoPtr, cd_data* cddReport);
+        ac_node* buildACN(object* objOnePtr, object* objTwoPtr, cd_data &cddReport);
         void addACN(ac_node* ACN);
+        void killACN(ac_node* ACN);
         
         /* Mutators */
         void setPenLog(bool enable = true)
@@ -220,168 +249,129 @@ inline bool cdr_checkCS(object* objOnePtr, object* objTwoPtr)
 }
 
 /*******************************************************************************
-    function    :   bool cdr_checkIABB
+    function    :   bool cdr_checkOBB
     arguments   :   objOnePtr - Pointer to first object
                     objTwoPtr - Pointer to second object
-    purpose     :   Collision inversely aligned bounding box inline function
-                    check. Checks to see if  two objects collide using an
-                    inverse from one's LCS to the other's LCS and checks the
-                    end points against an axis alligned bounding box (AABB).
-    notes       :   Inverse must be done to both objects since end points might
-                    exist inside an AABB only in one inversed direction.
+    purpose     :   Collision oriented bounding box inline function check.
+                    Checks to see if two objects collide using a separating
+                    axis test of their oriented bounding boxes (the model's
+                    min/max extents placed by each object's hull matrix).
+    notes       :   1) Candidate axes are the three face normals of each box
+                       and the nine cross products of their edges. The boxes
+                       overlap only if no candidate separates them, so edge-
+                       to-edge overlaps (which corner tests miss) are found.
+                    2) Axes are tried in order of how likely they are to
+                       separate ground units - object one's faces, then object
+                       two's, then the edge crosses - and the test returns as
+                       soon as one does, so most pairs passed on by
+                       cdr_checkCS are rejected within the first few axes.
+                    3) Everything is worked from hull_matrix, no GL calls.
+                       FP_ERROR is added to the rotation terms so near
+                       parallel edges (whose cross product degenerates) do
+                       not cause false separation.
 *******************************************************************************/
-inline bool cdr_checkIABB(object* objOnePtr, object* objTwoPtr)
+inline bool cdr_checkOBB(object* objOnePtr, object* objTwoPtr)
 {
-    GLfloat inversing_matrix[16];
-    kVector front_left;
-    kVector front_right;
-    kVector rear_left;
-    kVector rear_right;
+    float* matrix_one = objOnePtr->hull_matrix;
+    float* matrix_two = objTwoPtr->hull_matrix;
     float* min_size;
     float* max_size;
+    float extent_one[3];            // Half size of box one (LCS one)
+    float extent_two[3];            // Half size of box two (LCS two)
+    kVector center_one;             // Center of box one (WCS)
+    kVector center_two;             // Center of box two (WCS)
+    float offset[3];                // Center offset (LCS one)
+    float rotation[3][3];           // Axes of two in LCS one
+    float abs_rotation[3][3];
+    float radius_one;
+    float radius_two;
+    int i, j;
+    int i1, i2, j1, j2;
     
     // Check object one and two are unique
     if(objOnePtr == objTwoPtr)
         return false;
-        
-    // Switch to modelview matrix and save current matrix onto stack
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
     
-    // Build LCSIM from object one to object two
-    glLoadIdentity();
-    glRotatef(-objTwoPtr->roll * radToDeg, 0.0, 0.0, 1.0);
-    glRotatef(-((objTwoPtr->dir[1] * radToDeg) - 90.0), 1.0, 0.0, 0.0);
-    glRotatef(-objTwoPtr->dir[2] * radToDeg, 0.0, 1.0, 0.0);
-    glTranslatef(-objTwoPtr->pos[0], -objTwoPtr->pos[1], -objTwoPtr->pos[2]);
-    glMultMatrixf(objOnePtr->hull_matrix);
-    glGetFloatv(GL_MODELVIEW_MATRIX, inversing_matrix);
-    
-    // Get endpoints from model library
+    // Get box extents and centers from model library
     min_size = models.getMinSize(objOnePtr->model_id);
     max_size = models.getMaxSize(objOnePtr->model_id);
-    
-    // Initialize endpoint position vectors
-    front_left = kVector(max_size[0], objOnePtr->size[1]/2.0, max_size[2]);
-    front_right = kVector(min_size[0], objOnePtr->size[1]/2.0, max_size[2]);
-    rear_left = kVector(max_size[0], objOnePtr->size[1]/2.0, min_size[2]);
-    rear_right = kVector(min_size[0], objOnePtr->size[1]/2.0, min_size[2]);
-    
-    // Transform endpoints based on LCSIM
-    front_left.transform((float*)inversing_matrix);
-    front_right.transform((float*)inversing_matrix);
-    rear_left.transform((float*)inversing_matrix);
-    rear_right.transform((float*)inversing_matrix);    
-    
-    // Get endpoints for AABB
-    min_size = models.getMinSize(objTwoPtr->model_id);
-    max_size = models.getMaxSize(objTwoPtr->model_id);
-    
-    // Check front left against the AABB
-    if(front_left[0] >= min_size[0]  && front_left[0] <= max_size[0] &&
-       front_left[1] >= min_size[1]  && front_left[1] <= max_size[1] &&
-       front_left[2] >= min_size[2]  && front_left[2] <= max_size[2])
+    for(i = 0; i < 3; i++)
     {
-        glPopMatrix();  // Restore matrix
-        return true;
-    }
-        
-    // Check front right against the AABB
-    if(front_right[0] >= min_size[0]  && front_right[0] <= max_size[0] &&
-       front_right[1] >= min_size[1]  && front_right[1] <= max_size[1] &&
-       front_right[2] >= min_size[2]  && front_right[2] <= max_size[2])
-    {
-        glPopMatrix();  // Restore matrix
-        return true;
+        extent_one[i] = 0.5 * (max_size[i] - min_size[i]);
+        center_one[i] = 0.5 * (max_size[i] + min_size[i]);
     }
+    center_one.transform(matrix_one);
     
-    // Check rear left against the AABB
-    if(rear_left[0] >= min_size[0]  && rear_left[0] <= max_size[0] &&
-       rear_left[1] >= min_size[1]  && rear_left[1] <= max_size[1] &&
-       rear_left[2] >= min_size[2]  && rear_left[2] <= max_size[2])
+    min_size = models.getMinSize(objTwoPtr->model_id);
+    max_size = models.getMaxSize(objTwoPtr->model_id);
+    for(i = 0; i < 3; i++)
     {
-        glPopMatrix();  // Restore matrix
-        return true;
+        extent_two[i] = 0.5 * (max_size[i] - min_size[i]);
+        center_two[i] = 0.5 * (max_size[i] + min_size[i]);
     }
+    center_two.transform(matrix_two);
     
-    // Check rear right against the AABB
-    if(rear_right[0] >= min_size[0]  && rear_right[0] <= max_size[0] &&
-       rear_right[1] >= min_size[1]  && rear_right[1] <= max_size[1] &&
-       rear_right[2] >= min_size[2]  && rear_right[2] <= max_size[2])
+    // Express box two's axes and center offset in box one's axes (the axes
+    // of each box are the first three columns of its hull matrix).
+    for(i = 0; i < 3; i++)
     {
-        glPopMatrix();  // Restore matrix
-        return true;
+        for(j = 0; j < 3; j++)
+        {
+            rotation[i][j] = matrix_one[i*4 + 0] * matrix_two[j*4 + 0] +
+                             matrix_one[i*4 + 1] * matrix_two[j*4 + 1] +
+                             matrix_one[i*4 + 2] * matrix_two[j*4 + 2];
+            abs_rotation[i][j] = fabsf(rotation[i][j]) + FP_ERROR;
+        }
+        
+        offset[i] = matrix_one[i*4 + 0] * (center_two[0] - center_one[0]) +
+                    matrix_one[i*4 + 1] * (center_two[1] - center_one[1]) +
+                    matrix_one[i*4 + 2] * (center_two[2] - center_one[2]);
     }
     
-    // Build LCSIM from object two to object one
-    glLoadIdentity();
-    glRotatef(-objOnePtr->roll * radToDeg, 0.0, 0.0, 1.0);
-    glRotatef(-((objOnePtr->dir[1] * radToDeg) - 90.0), 1.0, 0.0, 0.0);
-    glRotatef(-objOnePtr->dir[2] * radToDeg, 0.0, 1.0, 0.0);
-    glTranslatef(-objOnePtr->pos[0], -objOnePtr->pos[1], -objOnePtr->pos[2]);
-    glMultMatrixf(objTwoPtr->hull_matrix);
-    glGetFloatv(GL_MODELVIEW_MATRIX, inversing_matrix);
-    
-    // Get endpoints from model library
-    min_size = models.getMinSize(objTwoPtr->model_id);
-    max_size = models.getMaxSize(objTwoPtr->model_id);
-    
-    // Initialize endpoint position vectors
-    front_left = kVector(max_size[0], objTwoPtr->size[1]/2.0, max_size[2]);
-    front_right = kVector(min_size[0], objTwoPtr->size[1]/2.0, max_size[2]);
-    rear_left = kVector(max_size[0], objTwoPtr->size[1]/2.0, min_size[2]);
-    rear_right = kVector(min_size[0], objTwoPtr->size[1]/2.0, min_size[2]);
-    
-    // Transform endpoints based on LCSIM
-    front_left.transform((float*)inversing_matrix);
-    front_right.transform((float*)inversing_matrix);
-    rear_left.transform((float*)inversing_matrix);
-    rear_right.transform((float*)inversing_matrix);    
-    
-    // Get endpoints for AABB
-    min_size = models.getMinSize(objOnePtr->model_id);
-    max_size = models.getMaxSize(objOnePtr->model_id);
-    
-    // Check front left against the AABB
-    if(front_left[0] >= min_size[0]  && front_left[0] <= max_size[0] &&
-       front_left[1] >= min_size[1]  && front_left[1] <= max_size[1] &&
-       front_left[2] >= min_size[2]  && front_left[2] <= max_size[2])
+    // Check face axes of box one
+    for(i = 0; i < 3; i++)
     {
-        glPopMatrix();  // Restore matrix
-        return true;
-    }
-        
-    // Check front right against the AABB
-    if(front_right[0] >= min_size[0]  && front_right[0] <= max_size[0] &&
-       front_right[1] >= min_size[1]  && front_right[1] <= max_size[1] &&
-       front_right[2] >= min_size[2]  && front_right[2] <= max_size[2])
-    {
-        glPopMatrix();  // Restore matrix
-        return true;
+        radius_two = extent_two[0] * abs_rotation[i][0] +
+                     extent_two[1] * abs_rotation[i][1] +
+                     extent_two[2] * abs_rotation[i][2];
+        if(fabsf(offset[i]) > extent_one[i] + radius_two)
+            return false;
     }
     
-    // Check rear left against the AABB
-    if(rear_left[0] >= min_size[0]  && rear_left[0] <= max_size[0] &&
-       rear_left[1] >= min_size[1]  && rear_left[1] <= max_size[1] &&
-       rear_left[2] >= min_size[2]  && rear_left[2] <= max_size[2])
+    // Check face axes of box two
+    for(j = 0; j < 3; j++)
     {
-        glPopMatrix();  // Restore matrix
-        return true;
+        radius_one = extent_one[0] * abs_rotation[0][j] +
+                     extent_one[1] * abs_rotation[1][j] +
+                     extent_one[2] * abs_rotation[2][j];
+        if(fabsf(offset[0] * rotation[0][j] + offset[1] * rotation[1][j] +
+                 offset[2] * rotation[2][j]) > radius_one + extent_two[j])
+            return false;
     }
     
-    // Check rear right against the AABB
-    if(rear_right[0] >= min_size[0]  && rear_right[0] <= max_size[0] &&
-       rear_right[1] >= min_size[1]  && rear_right[1] <= max_size[1] &&
-       rear_right[2] >= min_size[2]  && rear_right[2] <= max_size[2])
+    // Check cross products of edge i of box one with edge j of box two
+    for(i = 0; i < 3; i++)
     {
-        glPopMatrix();  // Restore matrix
-        return true;
-    }
+        i1 = (i + 1) % 3;
+        i2 = (i + 2) % 3;
         
-    glPopMatrix();  // Restore matrix
+        for(j = 0; j < 3; j++)
+        {
+            j1 = (j + 1) % 3;
+            j2 = (j + 2) % 3;
+            
+            radius_one = extent_one[i1] * abs_rotation[i2][j] +
+                         extent_one[i2] * abs_rotation[i1][j];
+            radius_two = extent_two[j1] * abs_rotation[i][j2] +
+                         extent_two[j2] * abs_rotation[i][j1];
+            if(fabsf(offset[i2] * rotation[i1][j] -
+                     offset[i1] * rotation[i2][j]) > radius_one + radius_two)
+                return false;
+        }
+    }
     
-    // All possibility of collision has been exhausted, thus no collision.
-    return false;
+    // No separating axis exists, thus the boxes overlap.
+    return true;
 }
 
 #endif
@@ -29,7 +29,6 @@ database_module::database_module()
     
     // Initialize our tracking variables to 0
     memory_allocated = 0;
-    queries = 0;
     
     // Initially enable load log
     load_log = true;
@@ -55,7 +54,6 @@ database_module::~database_module()
     // the runtime of the program.
     fout.open("Reference/load.log", ios::app);  // Open load log
     fout << "Exit: DB Statistics" << endl
-         << "  Number of Queries  : " << queries << endl
          << "  Hash Table Size    : " << MAX_RECORDS << endl
          << "  Hash Table Usage   : " << record_count << endl
          << "  Data Memory Usage  : "
@@ -112,15 +110,13 @@ unsigned int database_module::hash(char* s1, char* s2)
                     table name and element name, which resultantly hashes
                     into the hash table and finds the record and returns its
                     corresponding value.
-    notes       :   <none>
+    notes       :   Called from the job worker threads as well, so it must not
+                    write to the module.
 *******************************************************************************/
 char* database_module::query(char* table, char* element)
 {
     int insert_pos;
     
-    // Keep track of # of queries
-    queries++;
-    
     // Hash the query string to determine where the record was inserted, loop
     // through until the record is found (or not).
     for(insert_pos = hash(table, element); record[insert_pos].table != NULL;
@@ -140,6 +136,28 @@ char* database_module::query(char* table, char* element)
     return NULL;
 }
 
+/*******************************************************************************
+    function    :   int database_module::listTables
+    arguments   :   element - element to look for
+                    tables - array of table names (returned)
+                    maxTables - size of tables array
+    purpose     :   Lists the tables that define the given element (such as all
+                    rounds, by an element only rounds have). Returns the number
+                    of tables listed.
+    notes       :   Walks the entire hash table, so meant for load time only.
+*******************************************************************************/
+int database_module::listTables(char* element, char** tables, int maxTables)
+{
+    int i;
+    int count = 0;
+    
+    for(i = 0; i < MAX_RECORDS && count < maxTables; i++)
+        if(record[i].table != NULL && strcmp(record[i].element, element) == 0)
+            tables[count++] = record[i].table;
+    
+    return count;
+}
+
 /*******************************************************************************
     function    :   
     arguments   :   
@@ -49,7 +49,6 @@ class database_module
         
         bool load_log;                      // Load logging
         int memory_allocated;               // Bytes of memory allocated so far
-        int queries;                        // # of queries performed
         
         unsigned int hash(char* s1, char* s2);      // Hash function (djb2)
         
@@ -62,13 +61,14 @@ class database_module
         void insert(char* table, char* element, char* value);
         void update(char* table, char* element, char* value);
         
+        /* Table Listing Routine */
+        int listTables(char* element, char** tables, int maxTables);
+        
         /* .dat Loading Routines */
         void loadDirectory(char* directory);
         void loadDatFile(char* fileName);
         
         /* Accessors */
-        int getQueryCount()
-            { return queries; }
         int getMemoryUsage()
             { return memory_allocated + (MAX_RECORDS * sizeof(record_node)); }
         
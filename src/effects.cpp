@@ -9,6 +9,7 @@
 #include "texture.h"
 #include "scenery.h"
 #include "script.h"
+#include "snapshot.h"
 
 /*******************************************************************************
     function    :   effect::effect
@@ -501,9 +502,6 @@ effect::effect(int effectType, kVector position, kVector direction,
     
     // Image slice
     image_slice = float(1) / tex_frame_count;
-
-    // Culling handling
-    draw = true;
 }
 
 /*******************************************************************************
@@ -661,7 +659,6 @@ void effect::getClosestAndFarthest( float &closest, float &farthest )
     kVector temp;
     // Go through buckets and find the particle that is the farthest 
     // away from the camera and the particle that is closest to the camera
-    // We do not consider particles that are being culled
     while( curr != NULL )
     {
         // Calculate distance from camera
@@ -671,10 +668,10 @@ void effect::getClosestAndFarthest( float &closest, float &farthest )
                                            temp[2] * temp[2] );
 
         // Check to see if closest or farthest away from camera
-        if( (curr->distance_from_camera < closest) && (draw ==  true) )
+        if( curr->distance_from_camera < closest )
             closest = curr->distance_from_camera;
             
-        if( (curr->distance_from_camera > farthest) && (draw ==  true) )
+        if( curr->distance_from_camera > farthest )
             farthest = curr->distance_from_camera;
             
         curr = curr->next;
@@ -700,13 +697,6 @@ void effect::sortIntoBuckets()
     // Place each particle into the correct bucket
     while( curr != NULL )
     {
-        // Don't insert particles your not going to draw
-        if( draw == false )
-        {
-            curr = curr->next;
-            continue;
-        }
-        
         perc_distance = curr->distance_from_camera - effects.closest;
         perc_distance = perc_distance / (effects.farthest - effects.closest);
        
@@ -733,7 +723,6 @@ void effect::sortIntoBuckets()
 void effect::update(float deltaT)
 {
     kVector temp;
-    float temp_array[3];
 
     particle* curr;
     particle* prev;
@@ -921,27 +910,8 @@ void effect::update(float deltaT)
     curr = pl_head;
     prev = NULL;
     
-    draw = false;   // Set culling to false until a particle falls in view
-    
     while(curr)
     {
-        // Check for camera culling, if any particle is in view then the system
-        // must be entirely drawn out.
-        if(effect_type == SE_RAIN || effect_type == SE_SNOW )
-        {
-            temp_array[0] = camera.getCamPos()[0] + curr->pos()[0];
-            temp_array[1] = camera.getCamPos()[1] + curr->pos()[1];
-            temp_array[2] = camera.getCamPos()[2] + curr->pos()[2];
-
-            if(!draw && camera.sphereInView(temp_array, curr->size))
-                draw = true;
-        }
-        else
-        {
-            if(!draw && camera.sphereInView(curr->pos(), curr->size))
-                draw = true;
-        }
-            
         // Update the time left for this particle
         curr->time_left -= deltaT;
         
@@ -1274,603 +1244,614 @@ void se_module::update(float deltaT)
     }
 }
 
+/*******************************************************************************
+    function    :   se_module::snapshot
+    arguments   :   snap - Render snapshot to fill
+    purpose     :   Records the particles of all effects into a render snapshot,
+                    in draw order (farthest bucket first).
+    notes       :   Culling is done by the snapshot module.
+*******************************************************************************/
+void se_module::snapshot(render_snapshot* snap)
+{
+    snap_particle* rec;
+    particle* curr;
+    
+    for( int i = SE_NUM_BUCKETS - 1; i >= 0 ; i-- )
+    {
+        for( curr = buckets[i]; curr != NULL; curr = curr->next_in_bucket )
+        {
+            rec = snap->addParticle();
+            rec->pos = curr->pos;
+            rec->roll = curr->roll;
+            rec->size = curr->size;
+            rec->time_left = curr->time_left;
+            rec->tex_num = curr->tex_num;
+            rec->effect_type = curr->parent->effect_type;
+            rec->life_time = curr->parent->life_time;
+            rec->image_slice = curr->parent->image_slice;
+            rec->tex_frame = curr->parent->tex_frame;
+        }
+    }
+}
+
 /*******************************************************************************
     function    :   se_module::display
-    arguments   :   <none>
-    purpose     :   Displays all currently running effects.
-    notes       :   <none>
+    arguments   :   particle - Particle record (of a render snapshot)
+                    camPos - Camera position of frame
+    purpose     :   Displays a particle of a currently running effect.
+    notes       :   1) The snapshot module calls this for each particle in
+                       view, in draw order (farthest bucket first).
+                    2) Expects textures and color material to be enabled.
 *******************************************************************************/
-void se_module::display()
+void se_module::display(snap_particle* particle, kVector camPos)
 {
-    particle*  curr;
+    snap_particle* curr = particle;
     kVector orientate;
     kVector temp_vector;
     float temp_size;
     float expand_rate;
     float curr_slice;           // Current image in animation
     
-    // Enable textures and color material mapping
-    glEnable(GL_TEXTURE_2D);
-    glEnable(GL_COLOR_MATERIAL);
+    glAlphaFunc(GL_GEQUAL, 0.1);
     
+    // Perform type based display routines
+    switch(curr->effect_type)
+    {
+        case SE_DEBRIS:
+        case SE_SMOKE_DEBRIS:
+        case SE_FIRE_DEBRIS:
+        case SE_SPARKS:
+        case SE_MG_DIRT:
+        case SE_LARGE_DIRT:
+
+            orientate = vectorIn(curr->pos - camPos, CS_SPHERICAL);
+            orientate[1] *= radToDeg;
+            orientate[2] *= radToDeg;
+
+            glAlphaFunc(GL_GEQUAL, ALPHA_PASS);
+            glColor4f(1.0, 1.0, 1.0, 1.0);
+
+            // Draw particle
+            glPushMatrix();
+            glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
+            glRotatef(orientate[2], 0.0, 1.0, 0.0);
+            glRotatef(orientate[1], 1.0, 0.0, 0.0);
+            glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
+            glScalef(curr->size, curr->size, curr->size);
+            
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_QUADS);
+                glNormal3f(0.0, 1.0, 0.0);
+                glTexCoord2f( curr_slice , 0.0);
+                glVertex3f(-0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 0.0);
+                glVertex3f(0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.5, 0.0, -0.5);
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.5, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            break;
+
+        case SE_FIRING_BLAST:
+            orientate = vectorIn(curr->pos - camPos, CS_SPHERICAL);
+            orientate[1] *= radToDeg;
+            orientate[2] *= radToDeg;
+
+            if(curr->time_left > 0.5 * curr->life_time)
+            {
+                glAlphaFunc(GL_GEQUAL, ALPHA_PASS);
+                glColor4f(1.0, 1.0, 1.0, 1.0);
+            }
+            else
+            {
+                glAlphaFunc(GL_GEQUAL, ALPHA_PASS * curr->time_left / (0.5 * curr->life_time));
+                glColor4f(1.0, 1.0, 1.0, curr->time_left / (0.5 * curr->life_time));
+            }
+            
+            // Draw particle
+            glPushMatrix();
+            glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
+            glRotatef(orientate[2], 0.0, 1.0, 0.0);
+            glRotatef(orientate[1], 1.0, 0.0, 0.0);
+            glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
+            glScalef(curr->size, curr->size, curr->size);
+            
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_QUADS);
+                glNormal3f(0.0, 1.0, 0.0);
+                glTexCoord2f( curr_slice , 0.0);
+                glVertex3f(-0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 0.0);
+                glVertex3f(0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.5, 0.0, -0.5);
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.5, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            break;
     
+        case SE_MG_FIRING:
+            orientate = vectorIn(curr->pos - camPos, CS_SPHERICAL);
+            orientate[1] *= radToDeg;
+            orientate[2] *= radToDeg;
 
-    for( int i = SE_NUM_BUCKETS - 1; i >= 0 ; i-- )
-    {    
-        curr = buckets[i];
-        while( curr != NULL )
-        {        
+            if(curr->time_left > 0.5 * curr->life_time)
+            {
+                glAlphaFunc(GL_GEQUAL, ALPHA_PASS);
+                glColor4f(1.0, 1.0, 1.0, 1.0);
+            }
+            else
+            {
+                glAlphaFunc(GL_GEQUAL, ALPHA_PASS * curr->time_left / (0.5 * curr->life_time));
+                glColor4f(1.0, 1.0, 1.0, curr->time_left / (0.5 * curr->life_time));
+            }
+            
+            // Draw particle
+            glPushMatrix();
+            glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
+            glRotatef(orientate[2], 0.0, 1.0, 0.0);
+            glRotatef(orientate[1], 1.0, 0.0, 0.0);
+            glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
+            glScalef(curr->size, curr->size, curr->size);
+            
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_QUADS);
+                glNormal3f(0.0, 1.0, 0.0);
+                glTexCoord2f( curr_slice , 0.0);
+                glVertex3f(-0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 0.0);
+                glVertex3f(0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.5, 0.0, -0.5);
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.5, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            break;
+
+        case SE_BASE_EXPLOSION:
             glAlphaFunc(GL_GEQUAL, 0.1);
-        
-            // Culling check
-            if(!curr->parent->draw)
+
+            if(curr->time_left > 0.5 * curr->life_time)
             {
-                curr = curr->next;
-                continue;
+                glColor4f(1.0, 1.0, 1.0, 1.0);
             }
+            else
+            {
+                glColor4f(1.0, 1.0, 1.0, curr->time_left / (0.5 * curr->life_time));
+            }
+            
+            // Draw particle
+            glPushMatrix();
+            glTranslatef(curr->pos[0], 0.3 + map.getHeight(curr->pos[0], curr->pos[2]), curr->pos[2]);
+            glScalef(curr->size, curr->size, curr->size);
             
-            // Perform type based display routines
-            switch(curr->parent->effect_type)
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_QUADS);
+                glNormal3f(0.0, 1.0, 0.0);
+                glTexCoord2f( curr_slice , 0.0);
+                glVertex3f(-0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 0.0);
+                glVertex3f(0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.5, 0.0, -0.5);
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.5, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            break;
+
+        case SE_MG_GROUND:
+            orientate = vectorIn(curr->pos - camPos, CS_SPHERICAL);
+            orientate[1] *= radToDeg;
+            orientate[2] *= radToDeg;
+
+            glAlphaFunc(GL_GEQUAL, 0.1);
+            glColor4f(1.0, 1.0, 1.0, 1.0);
+
+            // Draw particle
+            glPushMatrix();
+            glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
+            glRotatef(orientate[2], 0.0, 1.0, 0.0);
+            glRotatef(90, 1.0, 0.0, 0.0);
+            glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
+            glScalef(curr->size, curr->size, curr->size);
+            
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_QUADS);
+                glNormal3f(0.0, 1.0, 0.0);
+                glTexCoord2f( curr_slice , 0.0);
+                glVertex3f(-0.125, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 0.0);
+                glVertex3f(0.125, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.125, 0.0, -0.5);
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.125, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            break;
+
+        case SE_FIRE:
+            // Display objects from special effects
+            orientate = vectorIn(curr->pos - camPos, CS_SPHERICAL);
+            orientate[1] *= radToDeg;
+            orientate[2] *= radToDeg;
+            
+            glAlphaFunc(GL_GEQUAL, 0.08);
+                
+            if(curr->time_left > 0.8 * curr->life_time)
             {
-                case SE_DEBRIS:
-                case SE_SMOKE_DEBRIS:
-                case SE_FIRE_DEBRIS:
-                case SE_SPARKS:
-                case SE_MG_DIRT:
-                case SE_LARGE_DIRT:
-        
-                    orientate = vectorIn(curr->pos - camera.getCamPosV(), CS_SPHERICAL);
-                    orientate[1] *= radToDeg;
-                    orientate[2] *= radToDeg;
-        
-                    glAlphaFunc(GL_GEQUAL, ALPHA_PASS);
-                    glColor4f(1.0, 1.0, 1.0, 1.0);
-
-                    // Draw particle
-                    glPushMatrix();
-                    glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
-                    glRotatef(orientate[2], 0.0, 1.0, 0.0);
-                    glRotatef(orientate[1], 1.0, 0.0, 0.0);
-                    glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
-                    glScalef(curr->size, curr->size, curr->size);
-                    
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_QUADS);
-                        glNormal3f(0.0, 1.0, 0.0);
-                        glTexCoord2f( curr_slice , 0.0);
-                        glVertex3f(-0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 0.0);
-                        glVertex3f(0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.5, 0.0, -0.5);
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.5, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    break;
-        
-                case SE_FIRING_BLAST:
-                    orientate = vectorIn(curr->pos - camera.getCamPosV(), CS_SPHERICAL);
-                    orientate[1] *= radToDeg;
-                    orientate[2] *= radToDeg;
+                glColor4f(1.0, 1.0, 1.0, 1.0);
+            }
+            else
+            {
+                glColor4f(1.0, 1.0, 1.0, curr->time_left / (0.8 * curr->life_time));
+            }
 
-                    if(curr->time_left > 0.5 * curr->parent->life_time)
-                    {
-                        glAlphaFunc(GL_GEQUAL, ALPHA_PASS);
-                        glColor4f(1.0, 1.0, 1.0, 1.0);
-                    }
-                    else
-                    {
-                        glAlphaFunc(GL_GEQUAL, ALPHA_PASS * curr->time_left / (0.5 * curr->parent->life_time));
-                        glColor4f(1.0, 1.0, 1.0, curr->time_left / (0.5 * curr->parent->life_time));
-                    }
-                    
-                    // Draw particle
-                    glPushMatrix();
-                    glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
-                    glRotatef(orientate[2], 0.0, 1.0, 0.0);
-                    glRotatef(orientate[1], 1.0, 0.0, 0.0);
-                    glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
-                    glScalef(curr->size, curr->size, curr->size);
-                    
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_QUADS);
-                        glNormal3f(0.0, 1.0, 0.0);
-                        glTexCoord2f( curr_slice , 0.0);
-                        glVertex3f(-0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 0.0);
-                        glVertex3f(0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.5, 0.0, -0.5);
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.5, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    break;
             
-                case SE_MG_FIRING:
-                    orientate = vectorIn(curr->pos - camera.getCamPosV(), CS_SPHERICAL);
-                    orientate[1] *= radToDeg;
-                    orientate[2] *= radToDeg;
+            // Draw particle
+            glPushMatrix();
+            glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
+            glRotatef(orientate[2], 0.0, 1.0, 0.0);
+            glRotatef(orientate[1], 1.0, 0.0, 0.0);
+            glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
+
+            expand_rate = 0.05;
+
+            if(curr->time_left > (curr->life_time - expand_rate * curr->life_time))
+                temp_size = curr->size * ( 1.0 - curr->time_left / curr->life_time)/expand_rate;
+            else if(curr->time_left > expand_rate * curr->life_time)
+                temp_size = curr->size;
+            else
+                temp_size = curr->size * curr->time_left / (expand_rate * curr->life_time);
+            glScalef(temp_size, temp_size, temp_size);
+
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_QUADS);
+                glNormal3f(0.0, 1.0, 0.0);
+                glTexCoord2f( curr_slice , 0.0);
+                glVertex3f(-0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 0.0);
+                glVertex3f(0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.5, 0.0, -0.5);
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.5, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            break;
 
-                    if(curr->time_left > 0.5 * curr->parent->life_time)
-                    {
-                        glAlphaFunc(GL_GEQUAL, ALPHA_PASS);
-                        glColor4f(1.0, 1.0, 1.0, 1.0);
-                    }
-                    else
-                    {
-                        glAlphaFunc(GL_GEQUAL, ALPHA_PASS * curr->time_left / (0.5 * curr->parent->life_time));
-                        glColor4f(1.0, 1.0, 1.0, curr->time_left / (0.5 * curr->parent->life_time));
-                    }
-                    
-                    // Draw particle
-                    glPushMatrix();
-                    glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
-                    glRotatef(orientate[2], 0.0, 1.0, 0.0);
-                    glRotatef(orientate[1], 1.0, 0.0, 0.0);
-                    glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
-                    glScalef(curr->size, curr->size, curr->size);
-                    
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_QUADS);
-                        glNormal3f(0.0, 1.0, 0.0);
-                        glTexCoord2f( curr_slice , 0.0);
-                        glVertex3f(-0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 0.0);
-                        glVertex3f(0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.5, 0.0, -0.5);
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.5, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    break;
-        
-                case SE_BASE_EXPLOSION:
-                    glAlphaFunc(GL_GEQUAL, 0.1);
-    
-                    if(curr->time_left > 0.5 * curr->parent->life_time)
-                    {
-                        glColor4f(1.0, 1.0, 1.0, 1.0);
-                    }
-                    else
-                    {
-                        glColor4f(1.0, 1.0, 1.0, curr->time_left / (0.5 * curr->parent->life_time));
-                    }
-                    
-                    // Draw particle
-                    glPushMatrix();
-                    glTranslatef(curr->pos[0], 0.3 + map.getHeight(curr->pos[0], curr->pos[2]), curr->pos[2]);
-                    glScalef(curr->size, curr->size, curr->size);
-                    
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_QUADS);
-                        glNormal3f(0.0, 1.0, 0.0);
-                        glTexCoord2f( curr_slice , 0.0);
-                        glVertex3f(-0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 0.0);
-                        glVertex3f(0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.5, 0.0, -0.5);
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.5, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    break;
-        
-                case SE_MG_GROUND:
-                    orientate = vectorIn(curr->pos - camera.getCamPosV(), CS_SPHERICAL);
-                    orientate[1] *= radToDeg;
-                    orientate[2] *= radToDeg;
-        
-                    glAlphaFunc(GL_GEQUAL, 0.1);
-                    glColor4f(1.0, 1.0, 1.0, 1.0);
-
-                    // Draw particle
-                    glPushMatrix();
-                    glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
-                    glRotatef(orientate[2], 0.0, 1.0, 0.0);
-                    glRotatef(90, 1.0, 0.0, 0.0);
-                    glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
-                    glScalef(curr->size, curr->size, curr->size);
-                    
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_QUADS);
-                        glNormal3f(0.0, 1.0, 0.0);
-                        glTexCoord2f( curr_slice , 0.0);
-                        glVertex3f(-0.125, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 0.0);
-                        glVertex3f(0.125, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.125, 0.0, -0.5);
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.125, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    break;
-        
-                case SE_FIRE:
-                    // Display objects from special effects
-                    orientate = vectorIn(curr->pos - camera.getCamPosV(), CS_SPHERICAL);
-                    orientate[1] *= radToDeg;
-                    orientate[2] *= radToDeg;
-                    
-                    glAlphaFunc(GL_GEQUAL, 0.08);
-                        
-                    if(curr->time_left > 0.8 * curr->parent->life_time)
-                    {
-                        glColor4f(1.0, 1.0, 1.0, 1.0);
-                    }
-                    else
-                    {
-                        glColor4f(1.0, 1.0, 1.0, curr->time_left / (0.8 * curr->parent->life_time));
-                    }
-    
-                    
-                    // Draw particle
-                    glPushMatrix();
-                    glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
-                    glRotatef(orientate[2], 0.0, 1.0, 0.0);
-                    glRotatef(orientate[1], 1.0, 0.0, 0.0);
-                    glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
-    
-                    expand_rate = 0.05;
-    
-                    if(curr->time_left > (curr->parent->life_time - expand_rate * curr->parent->life_time))
-                        temp_size = curr->size * ( 1.0 - curr->time_left / curr->parent->life_time)/expand_rate;
-                    else if(curr->time_left > expand_rate * curr->parent->life_time)
-                        temp_size = curr->size;
-                    else
-                        temp_size = curr->size * curr->time_left / (expand_rate * curr->parent->life_time);
-                    glScalef(temp_size, temp_size, temp_size);
-    
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_QUADS);
-                        glNormal3f(0.0, 1.0, 0.0);
-                        glTexCoord2f( curr_slice , 0.0);
-                        glVertex3f(-0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 0.0);
-                        glVertex3f(0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.5, 0.0, -0.5);
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.5, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    break;
-        
-                case SE_EXPLOSION:
-                case SE_BL_DEBRIS_SMOKE:
-                case SE_FIRE_DEBRIS_SMOKE:
-                    // Display objects from special effects
-                    
-                    orientate = vectorIn(curr->pos - camera.getCamPosV(), CS_SPHERICAL);
-                    orientate[1] *= radToDeg;
-                    orientate[2] *= radToDeg;
-                    
-                    if(curr->time_left > 0.8 * curr->parent->life_time)
-                    {
-                        glAlphaFunc(GL_GEQUAL, ALPHA_PASS);
-                        glColor4f(1.0, 1.0, 1.0, 1.0);
-                    }
-                    else
-                    {
-                        glAlphaFunc(GL_GEQUAL, ALPHA_PASS * curr->time_left / (0.8 * curr->parent->life_time));
-                        glColor4f(1.0, 1.0, 1.0, curr->time_left / (0.8 * curr->parent->life_time));
-                    }
-                    if( curr->parent->effect_type == SE_FIRE )
-                        glAlphaFunc(GL_GEQUAL, 0.08);
+        case SE_EXPLOSION:
+        case SE_BL_DEBRIS_SMOKE:
+        case SE_FIRE_DEBRIS_SMOKE:
+            // Display objects from special effects
+            
+            orientate = vectorIn(curr->pos - camPos, CS_SPHERICAL);
+            orientate[1] *= radToDeg;
+            orientate[2] *= radToDeg;
+            
+            if(curr->time_left > 0.8 * curr->life_time)
+            {
+                glAlphaFunc(GL_GEQUAL, ALPHA_PASS);
+                glColor4f(1.0, 1.0, 1.0, 1.0);
+            }
+            else
+            {
+                glAlphaFunc(GL_GEQUAL, ALPHA_PASS * curr->time_left / (0.8 * curr->life_time));
+                glColor4f(1.0, 1.0, 1.0, curr->time_left / (0.8 * curr->life_time));
+            }
+            if( curr->effect_type == SE_FIRE )
+                glAlphaFunc(GL_GEQUAL, 0.08);
 
-                    
-                    // Draw particle
-                    glPushMatrix();
-                    glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
-                    glRotatef(orientate[2], 0.0, 1.0, 0.0);
-                    glRotatef(orientate[1], 1.0, 0.0, 0.0);
-                    glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
-
-                    expand_rate = 0.05;
-
-                    if(curr->time_left > (curr->parent->life_time - expand_rate * curr->parent->life_time))
-                        temp_size = curr->size * ( 1.0 - curr->time_left / curr->parent->life_time)/expand_rate;
-                    else if(curr->time_left > expand_rate * curr->parent->life_time)
-                        temp_size = curr->size;
-                    else
-                        temp_size = curr->size * curr->time_left / (expand_rate * curr->parent->life_time);
-                    glScalef(temp_size, temp_size, temp_size);
-
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_QUADS);
-                        glNormal3f(0.0, 1.0, 0.0);
-                        glTexCoord2f( curr_slice , 0.0);
-                        glVertex3f(-0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 0.0);
-                        glVertex3f(0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.5, 0.0, -0.5);
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.5, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    break;
+            
+            // Draw particle
+            glPushMatrix();
+            glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
+            glRotatef(orientate[2], 0.0, 1.0, 0.0);
+            glRotatef(orientate[1], 1.0, 0.0, 0.0);
+            glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
+
+            expand_rate = 0.05;
+
+            if(curr->time_left > (curr->life_time - expand_rate * curr->life_time))
+                temp_size = curr->size * ( 1.0 - curr->time_left / curr->life_time)/expand_rate;
+            else if(curr->time_left > expand_rate * curr->life_time)
+                temp_size = curr->size;
+            else
+                temp_size = curr->size * curr->time_left / (expand_rate * curr->life_time);
+            glScalef(temp_size, temp_size, temp_size);
+
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_QUADS);
+                glNormal3f(0.0, 1.0, 0.0);
+                glTexCoord2f( curr_slice , 0.0);
+                glVertex3f(-0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 0.0);
+                glVertex3f(0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.5, 0.0, -0.5);
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.5, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            break;
+
+        case SE_DIRT:
+        case SE_SHRAPNEL:
+            orientate = vectorIn(curr->pos - camPos, CS_SPHERICAL);
+            orientate[1] *= radToDeg;
+            orientate[2] *= radToDeg;
+
+            if(curr->time_left > 0.75)
+            {
+                glAlphaFunc(GL_GEQUAL, ALPHA_PASS * 0.75);
+                glColor4f(1.0, 1.0, 1.0, 0.75);
+            }
+            else
+            {
+                glAlphaFunc(GL_GEQUAL, ALPHA_PASS * curr->time_left);
+                glColor4f(1.0, 1.0, 1.0, curr->time_left);
+            }
+            
+            // Draw particle
+            glPushMatrix();
+            glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
+            glRotatef(orientate[2], 0.0, 1.0, 0.0);
+            glRotatef(orientate[1], 1.0, 0.0, 0.0);
+            glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
+            glScalef(curr->size, curr->size, curr->size);
+
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_QUADS);
+                glNormal3f(0.0, 1.0, 0.0);
+                glTexCoord2f( curr_slice , 0.0);
+                glVertex3f(-0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 0.0);
+                glVertex3f(0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.5, 0.0, -0.5);
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.5, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            break;
         
-                case SE_DIRT:
-                case SE_SHRAPNEL:
-                    orientate = vectorIn(curr->pos - camera.getCamPosV(), CS_SPHERICAL);
-                    orientate[1] *= radToDeg;
-                    orientate[2] *= radToDeg;
+        case SE_MG_GROUND_SMOKE:
+        case SE_FIRING_SMOKE:
+        case SE_WH_BILLOWING_SMOKE:
+        case SE_BK_BILLOWING_SMOKE:
+        case SE_WH_DISPENSER_SMOKE:
         
-                    if(curr->time_left > 0.75)
-                    {
-                        glAlphaFunc(GL_GEQUAL, ALPHA_PASS * 0.75);
-                        glColor4f(1.0, 1.0, 1.0, 0.75);
-                    }
-                    else
-                    {
-                        glAlphaFunc(GL_GEQUAL, ALPHA_PASS * curr->time_left);
-                        glColor4f(1.0, 1.0, 1.0, curr->time_left);
-                    }
-                    
-                    // Draw particle
-                    glPushMatrix();
-                    glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
-                    glRotatef(orientate[2], 0.0, 1.0, 0.0);
-                    glRotatef(orientate[1], 1.0, 0.0, 0.0);
-                    glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
-                    glScalef(curr->size, curr->size, curr->size);
-
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_QUADS);
-                        glNormal3f(0.0, 1.0, 0.0);
-                        glTexCoord2f( curr_slice , 0.0);
-                        glVertex3f(-0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 0.0);
-                        glVertex3f(0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.5, 0.0, -0.5);
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.5, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    break;
+            orientate = vectorIn(curr->pos - camPos, CS_SPHERICAL);
+            
+            if( curr->effect_type == SE_WH_DISPENSER_SMOKE )
+                glAlphaFunc(GL_GEQUAL, 0.0);
+            else
+                glAlphaFunc(GL_GEQUAL, ALPHA_PASS * curr->time_left / curr->life_time);
+
+            glColor4f(1.0, 1.0, 1.0, curr->time_left / curr->life_time);
+            
+            // Display particle
+            glPushMatrix();
+            glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
+            glRotatef(orientate[2] * radToDeg, 0.0, 1.0, 0.0);
+            glRotatef(orientate[1] * radToDeg, 1.0, 0.0, 0.0);
+            glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
+            glScalef(curr->size, curr->size, curr->size);
+            
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_QUADS);
+                glNormal3f(0.0, 1.0, 0.0);
+                glTexCoord2f( curr_slice , 0.0);
+                glVertex3f(-0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 0.0);
+                glVertex3f(0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.5, 0.0, -0.5);
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.5, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            break;
+            
+        case SE_QF_WH_SMOKE:
+        case SE_QF_BR_SMOKE:
+        case SE_DUST_CLOUD:
+        case SE_DUST_TRAIL:
+
+            orientate = vectorIn(curr->pos - camPos, CS_SPHERICAL);
+            
+            glAlphaFunc(GL_GEQUAL, ALPHA_PASS * 0.35 * (curr->time_left / curr->life_time));
+            glColor4f(1.0, 1.0, 1.0, 0.35 * (curr->time_left / curr->life_time));
+            
+            // Display particle
+            glPushMatrix();
+            glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
+            glRotatef(orientate[2] * radToDeg, 0.0, 1.0, 0.0);
+            glRotatef(orientate[1] * radToDeg, 1.0, 0.0, 0.0);
+            glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
+            glScalef(curr->size, curr->size, curr->size);
+            
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_QUADS);
+                glNormal3f(0.0, 1.0, 0.0);
+                glTexCoord2f(curr_slice, 0.0);
+                glVertex3f(-0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 0.0);
+                glVertex3f(0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.5, 0.0, -0.5);
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.5, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            break;
+            
+        case SE_RAIN:
+            temp_vector = camPos;
+            
+            glColor4f(1.0, 1.0, 1.0, 1.0);
+            glAlphaFunc(GL_GEQUAL, 0.1);
+
+            orientate = vectorIn(curr->pos, CS_SPHERICAL);
+            orientate[1] *= radToDeg;
+            orientate[2] *= radToDeg;
+            
+            // Draw particle
+            glPushMatrix();
+            glTranslatef(temp_vector[0] + curr->pos[0], temp_vector[1] + curr->pos[1], temp_vector[2] + curr->pos[2]);
+            glRotatef(orientate[2] + curr->roll * radToDeg, 0.0, 1.0, 0.0);
+            glRotatef(90, 1.0, 0.0, 0.0);
+            
+            glScalef(curr->size, curr->size, 7);
+            
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_TRIANGLES);
+                glNormal3f(0.0, 1.0, 0.0);
+
+                glTexCoord2f( curr_slice + curr->image_slice / 2.0, 0.0);
+                glVertex3f(0.0, 0.0, 0.5);
                 
-                case SE_MG_GROUND_SMOKE:
-                case SE_FIRING_SMOKE:
-                case SE_WH_BILLOWING_SMOKE:
-                case SE_BK_BILLOWING_SMOKE:
-                case SE_WH_DISPENSER_SMOKE:
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.5, 0.0, -0.5);
                 
-                    orientate = vectorIn(curr->pos - camera.getCamPosV(), CS_SPHERICAL);
-                    
-                    if( curr->parent->effect_type == SE_WH_DISPENSER_SMOKE )
-                        glAlphaFunc(GL_GEQUAL, 0.0);
-                    else
-                        glAlphaFunc(GL_GEQUAL, ALPHA_PASS * curr->time_left / curr->parent->life_time);
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.5, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            
+            break;
 
-                    glColor4f(1.0, 1.0, 1.0, curr->time_left / curr->parent->life_time);
-                    
-                    // Display particle
-                    glPushMatrix();
-                    glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
-                    glRotatef(orientate[2] * radToDeg, 0.0, 1.0, 0.0);
-                    glRotatef(orientate[1] * radToDeg, 1.0, 0.0, 0.0);
-                    glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
-                    glScalef(curr->size, curr->size, curr->size);
-                    
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_QUADS);
-                        glNormal3f(0.0, 1.0, 0.0);
-                        glTexCoord2f( curr_slice , 0.0);
-                        glVertex3f(-0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 0.0);
-                        glVertex3f(0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.5, 0.0, -0.5);
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.5, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    break;
-                    
-                case SE_QF_WH_SMOKE:
-                case SE_QF_BR_SMOKE:
-                case SE_DUST_CLOUD:
-                case SE_DUST_TRAIL:
-        
-                    orientate = vectorIn(curr->pos - camera.getCamPosV(), CS_SPHERICAL);
-                    
-                    glAlphaFunc(GL_GEQUAL, ALPHA_PASS * 0.35 * (curr->time_left / curr->parent->life_time));
-                    glColor4f(1.0, 1.0, 1.0, 0.35 * (curr->time_left / curr->parent->life_time));
-                    
-                    // Display particle
-                    glPushMatrix();
-                    glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
-                    glRotatef(orientate[2] * radToDeg, 0.0, 1.0, 0.0);
-                    glRotatef(orientate[1] * radToDeg, 1.0, 0.0, 0.0);
-                    glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
-                    glScalef(curr->size, curr->size, curr->size);
-                    
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_QUADS);
-                        glNormal3f(0.0, 1.0, 0.0);
-                        glTexCoord2f(curr_slice, 0.0);
-                        glVertex3f(-0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 0.0);
-                        glVertex3f(0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.5, 0.0, -0.5);
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.5, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    break;
-                    
-                case SE_RAIN:
-                    temp_vector = camera.getCamPosV();
-                    
-                    glColor4f(1.0, 1.0, 1.0, 1.0);
-                    glAlphaFunc(GL_GEQUAL, 0.1);
-        
-                    orientate = vectorIn(curr->pos, CS_SPHERICAL);
-                    orientate[1] *= radToDeg;
-                    orientate[2] *= radToDeg;
-                    
-                    // Draw particle
-                    glPushMatrix();
-                    glTranslatef(temp_vector[0] + curr->pos[0], temp_vector[1] + curr->pos[1], temp_vector[2] + curr->pos[2]);
-                    glRotatef(orientate[2] + curr->roll * radToDeg, 0.0, 1.0, 0.0);
-                    glRotatef(90, 1.0, 0.0, 0.0);
-                    
-                    glScalef(curr->size, curr->size, 7);
-                    
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_TRIANGLES);
-                        glNormal3f(0.0, 1.0, 0.0);
-    
-                        glTexCoord2f( curr_slice + curr->parent->image_slice / 2.0, 0.0);
-                        glVertex3f(0.0, 0.0, 0.5);
-                        
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.5, 0.0, -0.5);
-                        
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.5, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    
-                    break;
-        
-                case SE_SNOW:
-                    temp_vector = camera.getCamPosV();
-        
-                    // Could change alpha based on distance from camera
-                    glColor4f(1.0, 1.0, 1.0, 1.0);
-                    glAlphaFunc(GL_GEQUAL, ALPHA_PASS);
+        case SE_SNOW:
+            temp_vector = camPos;
 
-                    orientate = vectorIn(curr->pos, CS_SPHERICAL);
-                    orientate[1] *= radToDeg;
-                    orientate[2] *= radToDeg;
-                
-                    
-                    
-                    // Draw particle
-                    glPushMatrix();
-                    glTranslatef(temp_vector[0] + curr->pos[0], temp_vector[1] + curr->pos[1], temp_vector[2] + curr->pos[2]);
-                    glRotatef(orientate[2], 0.0, 1.0, 0.0);
-                    glRotatef(90, 1.0, 0.0, 0.0);
-                    
-                    glScalef(curr->size, curr->size, curr->size);
-    
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_TRIANGLES);
-                        glNormal3f(0.0, 1.0, 0.0);
-    
-                        glTexCoord2f( curr_slice + curr->parent->image_slice / 2.0, 0.0);
-                        glVertex3f(0.0, 0.0, 0.5);
-    
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.5, 0.0, -0.5);
-    
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.5, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    break;
-        
-                case SE_SUB_EXPLOSION:
-                    orientate = vectorIn(curr->pos - camera.getCamPosV(), CS_SPHERICAL);
-                    orientate[1] *= radToDeg;
-                    orientate[2] *= radToDeg;
+            // Could change alpha based on distance from camera
+            glColor4f(1.0, 1.0, 1.0, 1.0);
+            glAlphaFunc(GL_GEQUAL, ALPHA_PASS);
+
+            orientate = vectorIn(curr->pos, CS_SPHERICAL);
+            orientate[1] *= radToDeg;
+            orientate[2] *= radToDeg;
         
-                    if(curr->time_left > 0.3 * curr->parent->life_time)
-                    {
-                        glColor4f(1.0, 1.0, 1.0, 0.7);
-                        glAlphaFunc(GL_GEQUAL, ALPHA_PASS * 0.7);
-                    }
-                    else
-                    {
-                        glColor4f(1.0, 1.0, 1.0, 0.7 * curr->time_left / (0.3 * curr->parent->life_time));
-                        glAlphaFunc(GL_GEQUAL, ALPHA_PASS * 0.7 * curr->time_left / (0.3 * curr->parent->life_time));
-                    }
+            
+            
+            // Draw particle
+            glPushMatrix();
+            glTranslatef(temp_vector[0] + curr->pos[0], temp_vector[1] + curr->pos[1], temp_vector[2] + curr->pos[2]);
+            glRotatef(orientate[2], 0.0, 1.0, 0.0);
+            glRotatef(90, 1.0, 0.0, 0.0);
+            
+            glScalef(curr->size, curr->size, curr->size);
 
-                    // Draw particle
-                    glPushMatrix();
-                    glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
-                    glRotatef(orientate[2], 0.0, 1.0, 0.0);
-                    glRotatef(orientate[1], 1.0, 0.0, 0.0);
-                    glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_TRIANGLES);
+                glNormal3f(0.0, 1.0, 0.0);
 
-                    expand_rate = 0.05;
+                glTexCoord2f( curr_slice + curr->image_slice / 2.0, 0.0);
+                glVertex3f(0.0, 0.0, 0.5);
 
-                    if(curr->time_left > (curr->parent->life_time - expand_rate * curr->parent->life_time))
-                        temp_size = curr->size * ( 1.0 - curr->time_left / curr->parent->life_time)/expand_rate;
-                    else if(curr->time_left > expand_rate * curr->parent->life_time)
-                        temp_size = curr->size;
-                    else
-                        temp_size = curr->size * curr->time_left / (expand_rate * curr->parent->life_time);
-                    glScalef(temp_size, temp_size, temp_size);
-
-                    // Since all the frames are stored in one image we must break apart
-                    // the image and adjust the uv mapping appropriatly
-                    curr_slice = curr->parent->image_slice * curr->tex_num;
-                    glBindTexture(GL_TEXTURE_2D, curr->parent->tex_frame);
-                    glBegin(GL_QUADS);
-                        glNormal3f(0.0, 1.0, 0.0);
-                        glTexCoord2f( curr_slice , 0.0);
-                        glVertex3f(-0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 0.0);
-                        glVertex3f(0.5, 0.0, 0.5);
-                        glTexCoord2f(curr_slice + curr->parent->image_slice, 1.0);
-                        glVertex3f(0.5, 0.0, -0.5);
-                        glTexCoord2f(curr_slice, 1.0);
-                        glVertex3f(-0.5, 0.0, -0.5);
-                    glEnd();
-                    glPopMatrix();
-                    break;
-        
-                default:
-                    break;
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.5, 0.0, -0.5);
+
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.5, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            break;
+
+        case SE_SUB_EXPLOSION:
+            orientate = vectorIn(curr->pos - camPos, CS_SPHERICAL);
+            orientate[1] *= radToDeg;
+            orientate[2] *= radToDeg;
+
+            if(curr->time_left > 0.3 * curr->life_time)
+            {
+                glColor4f(1.0, 1.0, 1.0, 0.7);
+                glAlphaFunc(GL_GEQUAL, ALPHA_PASS * 0.7);
             }
-            
-            curr = curr->next_in_bucket;
-        }
+            else
+            {
+                glColor4f(1.0, 1.0, 1.0, 0.7 * curr->time_left / (0.3 * curr->life_time));
+                glAlphaFunc(GL_GEQUAL, ALPHA_PASS * 0.7 * curr->time_left / (0.3 * curr->life_time));
+            }
+
+            // Draw particle
+            glPushMatrix();
+            glTranslatef(curr->pos[0], curr->pos[1], curr->pos[2]);
+            glRotatef(orientate[2], 0.0, 1.0, 0.0);
+            glRotatef(orientate[1], 1.0, 0.0, 0.0);
+            glRotatef(curr->roll * radToDeg, 0.0, 1.0, 0.0);
+
+            expand_rate = 0.05;
+
+            if(curr->time_left > (curr->life_time - expand_rate * curr->life_time))
+                temp_size = curr->size * ( 1.0 - curr->time_left / curr->life_time)/expand_rate;
+            else if(curr->time_left > expand_rate * curr->life_time)
+                temp_size = curr->size;
+            else
+                temp_size = curr->size * curr->time_left / (expand_rate * curr->life_time);
+            glScalef(temp_size, temp_size, temp_size);
+
+            // Since all the frames are stored in one image we must break apart
+            // the image and adjust the uv mapping appropriatly
+            curr_slice = curr->image_slice * curr->tex_num;
+            glBindTexture(GL_TEXTURE_2D, curr->tex_frame);
+            glBegin(GL_QUADS);
+                glNormal3f(0.0, 1.0, 0.0);
+                glTexCoord2f( curr_slice , 0.0);
+                glVertex3f(-0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 0.0);
+                glVertex3f(0.5, 0.0, 0.5);
+                glTexCoord2f(curr_slice + curr->image_slice, 1.0);
+                glVertex3f(0.5, 0.0, -0.5);
+                glTexCoord2f(curr_slice, 1.0);
+                glVertex3f(-0.5, 0.0, -0.5);
+            glEnd();
+            glPopMatrix();
+            break;
+
+        default:
+            break;
     }
 }
         
@@ -1888,7 +1869,6 @@ void se_module::set_bucket_parameters()
     
     // Go through buckets and find the particle that is the farthest 
     // away from the camera and the particle that is closest to the camera
-    // We do not consider particles that are being culled
     while( curr != NULL )
     {
         curr->getClosestAndFarthest( closest, farthest );
@@ -59,6 +59,8 @@
 
 // Class prototype
 class effect;
+struct snap_particle;           // Particle record (snapshot.h)
+struct render_snapshot;         // Render snapshot (snapshot.h)
 
 struct particle
 {
@@ -127,8 +129,6 @@ class effect
         int tex_frame_count;    // Frame count for animated textures
         float tex_cycle_time;   // Cycle time between frames
         bool tex_cycle_repeat;  // Repeat frames (ex: fire)
-        
-        bool draw;              // Culling control
 
         
         
@@ -227,9 +227,10 @@ class se_module
         void setEffectPosition(int id, kVector position);
         void setEffectDirection(int id, kVector direction);
         
-        /* Base Update and Display Routines */
+        /* Base Update, Snapshot and Display Routines */
         void update(float deltaT);
-        void display();
+        void snapshot(render_snapshot* snap);
+        void display(snap_particle* particle, kVector camPos);
 
         // Used in Rain and Snow effects to detect change in camera location
         kVector prevCamPos;
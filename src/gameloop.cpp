@@ -3,25 +3,45 @@
 *******************************************************************************/
 #include "main.h"
 #include "gameloop.h"
+#include "astar.h"
 #include "atg.h"
+#include "bullets.h"
 #include "camera.h"
 #include "collision.h"
 #include "console.h"
 #include "effects.h"
 #include "fonts.h"
 #include "metrics.h"
+#include "misc.h"
 #include "model.h"
 #include "objhandler.h"
+#include "projectile.h"
 #include "scenery.h"
 #include "script.h"
+#include "snapshot.h"
 #include "sounds.h"
 #include "tank.h"
 #include "texture.h"
+#include "visibility.h"
 #include "ui.h"
 
 bool debugMode;
 int game_speed = 0;
 
+/*******************************************************************************
+    Simulation Thread State
+*******************************************************************************/
+
+static SDL_mutex* world_lock = NULL;    // Guards the simulation (world) state
+static SDL_Thread* sim_thread = NULL;   // Simulation thread (NULL for none)
+static volatile bool sim_quit = false;  // Set to stop simulation thread
+
+// Input event queue, from the main thread to the simulation thread
+static SDL_mutex* event_lock = NULL;    // Guards event queue
+static SDL_Event sim_events[SIM_EVENT_QUEUE];
+static int sim_event_head = 0;          // Next event to handle
+static int sim_event_tail = 0;          // Next free slot
+
 /*******************************************************************************
     Screen Update Routines
 *******************************************************************************/
@@ -46,11 +66,14 @@ inline void reshape(int w, int h)
     arguments   :   <none>
     purpose     :   Sets up OpenGL to display 3D objects & then displays those
                     such objects.
-    notes       :   <none>
+    notes       :   Objects, MG bullets and effects are drawn from the render
+                    snapshots published by the simulation (see snapshot.h).
 *******************************************************************************/
 inline void display_3d()
 {
     static GLfloat position[4] = {0.0, 5000.0, 0.0, 1.0};
+    bool drawn;                     // Render snapshots held
+    kVector cam_pos;                // Camera position of frame
     
     // Setup GL for 3D rendering
     glMatrixMode(GL_PROJECTION);    // Select The Projection Matrix
@@ -63,21 +86,28 @@ inline void display_3d()
     glEnable(GL_DEPTH_TEST);        // Enable depth testing
     glEnable(GL_LIGHTING);          // Enable lighting
 
-    // Orient the camera
+    // Orient the camera and take its position for the frame (under the world
+    // lock, as scripts may move it)
+    SDL_mutexP(world_lock);
     camera.orient();
+    cam_pos = camera.getCamPosV();
+    SDL_mutexV(world_lock);
     
     glLightfv(GL_LIGHT0, GL_POSITION, position);
     
     glAlphaFunc(GL_GEQUAL, ALPHA_PASS);
     
+    // Take hold of the latest render snapshots to draw from
+    drawn = snapshots.acquire(SDL_GetTicks(), cam_pos);
+    
     // Display the map (first pass)
     glPushAttrib(GL_ALL_ATTRIB_BITS);
-    map.displayFirstPass();
+    map.displayFirstPass(cam_pos());
     glPopAttrib();
     
-    // Display objects from object handler (first pass)
+    // Display objects from render snapshots (first pass)
     glPushAttrib(GL_ALL_ATTRIB_BITS);
-    objects.displayFirstPass();
+    snapshots.displayFirstPass();
     glPopAttrib();
     
     // Display scenery elements of map (second pass)
@@ -87,14 +117,34 @@ inline void display_3d()
     
     glAlphaFunc(GL_GREATER, 0.0);
     
-    // Display objects from object handler (second pass)
+    // Display objects from render snapshots (second pass)
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    snapshots.displaySecondPass();
+    glPopAttrib();
+    
+    // Display MG bullets
     glPushAttrib(GL_ALL_ATTRIB_BITS);
-    objects.displaySecondPass();
+    snapshots.displayBullets();
+    glPopAttrib();
+    
+    // Display tracers gathered from projectiles and MG bullets
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    tracers.draw();
     glPopAttrib();
     
     // Display objects from special effects
     glPushAttrib(GL_ALL_ATTRIB_BITS);
-    effects.display();
+    snapshots.displayEffects();
+    glPopAttrib();
+    
+    if(drawn)
+        snapshots.release();
+    
+    // Display waypoints of selected units (read from the units themselves)
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    SDL_mutexP(world_lock);
+    objects.displayWaypoints();
+    SDL_mutexV(world_lock);
     glPopAttrib();
 }
 
@@ -103,7 +153,8 @@ inline void display_3d()
     arguments   :   <none>
     purpose     :   Sets up OpenGL to display 2D objects & then displays those
                     such objects.
-    notes       :   <none>
+    notes       :   Reads the simulation directly, so must only be called while
+                    holding the world lock.
 *******************************************************************************/
 inline void display_2d()
 {
@@ -165,8 +216,6 @@ inline void display_2d()
             fonts.renderText(buffer, FONT_COURIER_12, 20, y); y += 12;
             sprintf(buffer, "  Roll     : %.2f", ui.getSelection()->getHeadPtr()->obj_ptr->roll);
             fonts.renderText(buffer, FONT_COURIER_12, 20, y); y += 12;
-            sprintf(buffer, "  Draw     : %i", (int)(ui.getSelection()->getHeadPtr()->obj_ptr->draw));
-            fonts.renderText(buffer, FONT_COURIER_12, 20, y); y += 12;
             
             if(ui.getSelection()->getHeadPtr()->obj_ptr->obj_type == OBJ_TYPE_TANK)
             {
@@ -278,40 +327,44 @@ inline void display()
     // Display 3D objects
     display_3d();
 
-    // Display 2D overlay objects
+    // Display 2D overlay objects, and take a screen capture if one has been
+    // asked for
+    SDL_mutexP(world_lock);
     display_2d();
+    ui.captureScreen();
+    SDL_mutexV(world_lock);
 
     // Swap buffers for output display
     SDL_GL_SwapBuffers();
 }
 
 /*******************************************************************************
-    Timer Routine
+    Timer Routines
 *******************************************************************************/
 
 /*******************************************************************************
-    function    :   <inline> timer
+    function    :   <inline> view_timer
     arguments   :   unsigned int time_elapsed
-    purpose     :   Timer function. Runs the update calls to the different
-                    modules.
-    notes       :   <none>
+    purpose     :   View timer function. Runs the update calls to the modules
+                    which follow the display rather than the simulation.
+    notes       :   Called from the main (render) thread, while holding the
+                    world lock.
 *******************************************************************************/
-inline void timer(unsigned int time_elapsed)
+inline void view_timer(unsigned int time_elapsed)
 {
-    static int timers[] = {0,15000,5,10,20,50};
-    static int interval[] = {0,15000,5,10,20,50};
+    static int timers[] = {0,15000,5,10};
+    static int interval[] = {0,15000,5,10};
     static int previous = time_elapsed;
     static int start_index = 0;
     int time_passed;
     
     int i;
     float deltaT;
-    float speed;
     
     time_passed = time_elapsed - previous;
     previous = time_elapsed;
     
-    for(i = start_index; i < 6; i++)
+    for(i = start_index; i < 4; i++)
     {
         timers[i] -= time_passed;
         
@@ -326,10 +379,8 @@ inline void timer(unsigned int time_elapsed)
                 case 0:
                     start_index = 1;    // Disable timer 0 from firing again
                     
-                    // Run an initial update on the scenery module and
-                    // through the objects
+                    // Run an initial update on the scenery module
                     map.update(0.0);
-                    objects.update(0.0);
                     
                     return;
                     break;
@@ -351,6 +402,74 @@ inline void timer(unsigned int time_elapsed)
                 
                 // Case 2 is our 5ms update control
                 case 2:
+                    // Update camera
+                    camera.update(deltaT);
+                    break;
+                
+                // Case 3 is our 10ms update control
+                case 3:
+                    // Update scenery
+                    map.update(deltaT);
+                    break;
+                
+                default:
+                    break;
+            }
+            
+            timers[i] = interval[i];        // Reset timer
+        }
+    }
+}
+
+/*******************************************************************************
+    function    :   <inline> sim_timer
+    arguments   :   unsigned int time_elapsed
+    purpose     :   Simulation timer function. Runs the update calls to the
+                    different simulation modules.
+    notes       :   1) Called from the simulation thread (or the main thread,
+                       when there is none), while holding the world lock.
+                    2) Returns true if any update was run, i.e. a render
+                       snapshot should be taken.
+*******************************************************************************/
+inline bool sim_timer(unsigned int time_elapsed)
+{
+    static int timers[] = {0,5,10,20,50};
+    static int interval[] = {0,5,10,20,50};
+    static int previous = time_elapsed;
+    static int start_index = 0;
+    int time_passed;
+    bool stepped = false;
+    
+    int i;
+    float deltaT;
+    float speed;
+    
+    time_passed = time_elapsed - previous;
+    previous = time_elapsed;
+    
+    for(i = start_index; i < 5; i++)
+    {
+        timers[i] -= time_passed;
+        
+        if(timers[i] <= FP_ERROR)
+        {
+            // Calculate deltaT
+            deltaT = (float)(interval[i] - timers[i]) / 1000.0;
+            
+            switch(i)
+            {
+                // Case 0 is our timer initialize function
+                case 0:
+                    start_index = 1;    // Disable timer 0 from firing again
+                    
+                    // Run an initial update through the objects
+                    objects.update(0.0);
+                    
+                    return true;
+                    break;
+                
+                // Case 1 is our 5ms update control
+                case 1:
                     if(game_speed == 0)
                         speed = 1.0;
                     else
@@ -361,18 +480,21 @@ inline void timer(unsigned int time_elapsed)
                             speed = 1.0 / powf(2.0, fabs((float)game_speed));
                     }
                     
-                    // Update camera
-                    camera.update(deltaT);
-                    
                     deltaT *= speed;
                     
+                    // Apply finished path requests
+                    astar.update();
+                    
                     // Update objects
                     objects.update(deltaT);
                     
+                    // Update MG bullets
+                    bullets.update(deltaT);
+                    
                     break;
                 
-                // Case 3 is our 10ms update control
-                case 3:
+                // Case 2 is our 10ms update control
+                case 2:
                     if(game_speed == 0)
                         speed = 1.0;
                     else
@@ -389,9 +511,6 @@ inline void timer(unsigned int time_elapsed)
                     // Update user interface
                     ui.update(deltaT);
                     
-                    // Update scenery
-                    map.update(deltaT);
-                    
                     deltaT *= speed;
                     
                     // Update collision detection/response engine
@@ -405,8 +524,8 @@ inline void timer(unsigned int time_elapsed)
                     
                     break;
                 
-                // Case 4 is our 20ms update control
-                case 4:
+                // Case 3 is our 20ms update control
+                case 3:
                     if(game_speed == 0)
                         speed = 1.0;
                     else
@@ -422,11 +541,12 @@ inline void timer(unsigned int time_elapsed)
                     
                     deltaT *= speed;
                     
+                    visibility.update(deltaT);
                     script.update(deltaT);
                     break;
                 
                 // Case 4 is our 50ms update control
-                case 5:
+                case 4:
                     // Perform CD for objects
                     objects.cdObjPass(OBJ_TYPE_TANK, OBJ_TYPE_VEHICLE);
                     break;
@@ -436,8 +556,158 @@ inline void timer(unsigned int time_elapsed)
             }
             
             timers[i] = interval[i];        // Reset timer
+            stepped = true;
         }
     }
+    
+    return stepped;
+}
+
+/*******************************************************************************
+    Simulation Thread Routines
+*******************************************************************************/
+
+/*******************************************************************************
+    function    :   <inline> push_event
+    arguments   :   event - Input event to queue
+    purpose     :   Queues an input event for the simulation. Returns false if
+                    the queue is full.
+    notes       :   Only ever called from the main thread.
+*******************************************************************************/
+inline bool push_event(SDL_Event* event)
+{
+    int next;
+    
+    SDL_mutexP(event_lock);
+    
+    next = (sim_event_tail + 1) & (SIM_EVENT_QUEUE - 1);
+    if(next == sim_event_head)
+    {
+        SDL_mutexV(event_lock);
+        return false;
+    }
+    
+    sim_events[sim_event_tail] = *event;
+    sim_event_tail = next;
+    
+    SDL_mutexV(event_lock);
+    
+    return true;
+}
+
+/*******************************************************************************
+    function    :   <inline> pop_event
+    arguments   :   event - Input event taken from queue
+    purpose     :   Takes the oldest queued input event. Returns false if the
+                    queue is empty.
+    notes       :   Only ever called from whichever thread runs the simulation.
+*******************************************************************************/
+inline bool pop_event(SDL_Event* event)
+{
+    SDL_mutexP(event_lock);
+    
+    if(sim_event_head == sim_event_tail)
+    {
+        SDL_mutexV(event_lock);
+        return false;
+    }
+    
+    *event = sim_events[sim_event_head];
+    sim_event_head = (sim_event_head + 1) & (SIM_EVENT_QUEUE - 1);
+    
+    SDL_mutexV(event_lock);
+    
+    return true;
+}
+
+/*******************************************************************************
+    function    :   <inline> sim_step
+    arguments   :   <none>
+    purpose     :   Handles queued input events, runs the simulation timer, and
+                    publishes a render snapshot if anything was updated.
+    notes       :   <none>
+*******************************************************************************/
+inline void sim_step()
+{
+    SDL_Event event;
+    unsigned int ticks;
+    
+    SDL_mutexP(world_lock);
+    
+    // Handle queued input events
+    while(pop_event(&event))
+    {
+        // switch to corresponding event handler
+        switch(event.type)
+        {
+            /*  Keystroke Press  */
+            case SDL_KEYDOWN:
+                ui.keystrokeDown(event.key);
+                break;
+            
+            /*  Keystroke Release  */
+            case SDL_KEYUP:
+                ui.keystrokeUp(event.key);
+                break;
+            
+            /*  Mouse Motion  */
+            case SDL_MOUSEMOTION:
+                ui.mouseMove(event.motion);
+                break;
+            
+            /*  Mouse Button Press  */
+            case SDL_MOUSEBUTTONDOWN:
+                ui.mouseButtonDown(event.button);
+                break;
+            
+            /*  Mouse Button Release  */
+            case SDL_MOUSEBUTTONUP:
+                ui.mouseButtonUp(event.button);
+                break;
+        }
+    }
+    
+    // Perform timer functions, and publish what they did
+    ticks = SDL_GetTicks();
+    if(sim_timer(ticks))
+        snapshots.capture(ticks);
+    
+    SDL_mutexV(world_lock);
+}
+
+/*******************************************************************************
+    function    :   sim_main
+    arguments   :   data - <unused>
+    purpose     :   Simulation thread routine. Steps the simulation until told
+                    to quit.
+    notes       :   The thread sleeps between steps, which also lets the main
+                    thread in on the world lock.
+*******************************************************************************/
+static int sim_main(void* data)
+{
+    while(!sim_quit)
+    {
+        sim_step();
+        SDL_Delay(1);
+    }
+    
+    return 0;
+}
+
+/*******************************************************************************
+    function    :   <inline> stop_sim
+    arguments   :   <none>
+    purpose     :   Stops the simulation thread (if running) and waits for it.
+    notes       :   <none>
+*******************************************************************************/
+inline void stop_sim()
+{
+    if(!sim_thread)
+        return;
+    
+    sim_quit = true;
+    SDL_WaitThread(sim_thread, NULL);
+    sim_thread = NULL;
 }
 
 /*******************************************************************************
@@ -449,21 +719,50 @@ inline void timer(unsigned int time_elapsed)
     arguments   :   argc - # of cmd line arguments
                     argv - string of cmd line arguments
     purpose     :   Main game execution loop.
-    notes       :   All event handlers are all inline functions, which makes
-                    this function look a whole lot nicer.
+    notes       :   1) All event handlers are all inline functions, which makes
+                       this function look a whole lot nicer.
+                    2) The simulation runs on its own thread (unless disabled
+                       by SIM_THREAD in the settings), and the main thread only
+                       handles window events and draws. Input events are
+                       passed to the simulation through the event queue, and
+                       the simulation passes back what is to be drawn through
+                       render snapshots. Anything else shared between the two
+                       is done under the world lock.
 *******************************************************************************/
 void gameMainLoop(int argc, char* argv[])
 {
     SDL_Event event;    // Our event storage variable
     
-    // Initialize timer events (first call to this function will essentially
-    // do such).
-    timer(SDL_GetTicks());
+    // Create our world and event queue locks, and render snapshot buffers
+    world_lock = SDL_CreateMutex();
+    event_lock = SDL_CreateMutex();
+    if(!world_lock || !event_lock)
+    {
+        write_error("Gameloop: Could not create world locks.");
+        exit(1);
+    }
+    snapshots.start();
+    
+    // Initialize timer events (first call to these functions will
+    // essentially do such), and publish the first snapshot.
+    view_timer(SDL_GetTicks());
+    sim_step();
     
     // Before entering our game loop, kill all currently pending events
     while(SDL_PollEvent(&event))
         ;
     
+    // Start simulation thread. If it can't be started, the simulation is
+    // stepped from the main thread between frames, as before.
+    if(game_options.sim_thread)
+    {
+        sim_quit = false;
+        sim_thread = SDL_CreateThread(sim_main, NULL);
+        
+        if(!sim_thread)
+            write_error("Gameloop: Could not create simulation thread.");
+    }
+    
     // Enter our main game loop event handler - this is not that
     // complicated of a structure, but it serves it's purpose.
     while(1)
@@ -474,59 +773,57 @@ void gameMainLoop(int argc, char* argv[])
             // switch to corresponding event handler
             switch(event.type)
             {
-                /* ----- Keyboard Events ----- */
-            
-                /*  Keystroke Press  */
-                case SDL_KEYDOWN:
-                    ui.keystrokeDown(event.key);
-                    break;
+                /* ----- Keyboard & Mouse Events ----- */
                 
-                /*  Keystroke Release  */
+                /*  Handled by the simulation  */
+                case SDL_KEYDOWN:
                 case SDL_KEYUP:
-                    ui.keystrokeUp(event.key);
-                    break;
-
-                /* ----- Mouse Events ----- */
-            
-                /*  Mouse Motion  */
                 case SDL_MOUSEMOTION:
-                    ui.mouseMove(event.motion);
-                    break;
-                
-                /*  Mouse Button Press  */
                 case SDL_MOUSEBUTTONDOWN:
-                    ui.mouseButtonDown(event.button);
-                    break;
-                
-                /*  Mouse Button Release  */
                 case SDL_MOUSEBUTTONUP:
-                    ui.mouseButtonUp(event.button);
+                    while(!push_event(&event))
+                    {
+                        // Queue is full - let the simulation catch up
+                        if(sim_thread)
+                            SDL_Delay(1);
+                        else
+                            sim_step();
+                    }
                     break;
-
+                
                 /* ----- Window Events ----- */
-            
+                
                 /*  Portion of Window Unhidden  */
                 case SDL_VIDEOEXPOSE:
                     break;
                 
                 /*  Window Resized  */
                 case SDL_VIDEORESIZE:
+                    SDL_mutexP(world_lock);
                     reshape(event.resize.w, event.resize.h);
+                    SDL_mutexV(world_lock);
                     break;
                 
                 /*  Window Focus Lost/Gained  */
                 case SDL_ACTIVEEVENT:
                     break;
-
-                /*  OS Quit Message  */
+                
+                /*  OS Quit Message (also raised by the simulation)  */
                 case SDL_QUIT:
+                    stop_sim();
                     exit(0);
                     break;
             }
         }
         
-        // Perform timer functions
-        timer(SDL_GetTicks());
+        // Step the simulation here if it has no thread of its own
+        if(!sim_thread)
+            sim_step();
+        
+        // Perform view timer functions
+        SDL_mutexP(world_lock);
+        view_timer(SDL_GetTicks());
+        SDL_mutexV(world_lock);
         
         // Perform redisplay functions
         display();
@@ -5,6 +5,9 @@
 #ifndef GAMELOOP_H
 #define GAMELOOP_H
 
+// Simulation Thread
+#define SIM_EVENT_QUEUE             256     // Input events queued (power of 2)
+
 extern bool debugMode;
 extern int game_speed;
 
@@ -0,0 +1,545 @@
+/*******************************************************************************
+                        Job System Module - Implementation
+*******************************************************************************/
+#include "main.h"
+#include "jobs.h"
+#include "console.h"
+#include "misc.h"
+#include "objunit.h"
+#include "projectile.h"
+
+/*******************************************************************************
+    function    :   job_module::job_module
+    arguments   :   <none>
+    purpose     :   Constructor.
+    notes       :   The main thread is always thread 0, so runs may be made
+                    (serially) before any workers are started.
+*******************************************************************************/
+job_module::job_module()
+{
+    int i;
+
+    for(i = 0; i <= JS_MAX_THREADS; i++)
+    {
+        threads[i].module = this;
+        threads[i].thread = NULL;
+        threads[i].thread_id = 0;
+        threads[i].run = 0;
+        threads[i].item = 0;
+        threads[i].command = NULL;
+        threads[i].cmd_count = threads[i].cmd_max = threads[i].cmd_read = 0;
+    }
+
+    threads[0].command = new job_command[JS_CMD_INITIAL];
+    threads[0].cmd_max = JS_CMD_INITIAL;
+    thread_count = 1;
+    in_run = false;
+
+    run_mutex = NULL;
+    start_cond = done_cond = NULL;
+    run_number = 0;
+    busy = 0;
+    quit = false;
+    run_routine = NULL;
+    run_data = NULL;
+    run_delta = 0.0;
+    run_count = run_next = run_chunk = 0;
+
+    for(i = 0; i < JS_LOCK_COUNT; i++)
+        locks[i] = NULL;
+}
+
+/*******************************************************************************
+    function    :   job_module::~job_module
+    arguments   :   <none>
+    purpose     :   Deconstructor.
+    notes       :   <none>
+*******************************************************************************/
+job_module::~job_module()
+{
+    stop();
+
+    if(threads[0].command)
+        delete [] threads[0].command;
+}
+
+/*******************************************************************************
+    function    :   job_module::start
+    arguments   :   workerCount - Worker threads to start (JS_AUTO_THREADS to
+                                  start one less than the number of CPUs)
+    purpose     :   Creates the run locks and starts the worker threads.
+    notes       :   If no threads can be made, the main thread does every run
+                    by itself.
+*******************************************************************************/
+void job_module::start(int workerCount)
+{
+    int i;
+    long cpus;
+
+    if(run_mutex)
+        return;
+
+    // Size from the hardware if not given
+    if(workerCount < 0)
+    {
+        #if !defined(_WIN32)
+        // Linux Version
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        #else
+        // Win32 Version
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        cpus = (long)info.dwNumberOfProcessors;
+        #endif
+
+        if(cpus < 1)
+            workerCount = JS_DEFAULT_THREADS;
+        else
+            workerCount = (int)cpus - 1;
+    }
+    if(workerCount > JS_MAX_THREADS)
+        workerCount = JS_MAX_THREADS;
+
+    threads[0].thread_id = SDL_ThreadID();
+
+    if(workerCount == 0)
+        return;
+
+    run_mutex = SDL_CreateMutex();
+    start_cond = SDL_CreateCond();
+    done_cond = SDL_CreateCond();
+    quit = false;
+
+    if(!run_mutex || !start_cond || !done_cond)
+    {
+        write_error("Jobs: Could not create run locks.");
+        exit(1);
+    }
+
+    for(i = 0; i < JS_LOCK_COUNT; i++)
+    {
+        locks[i] = SDL_CreateMutex();
+
+        if(!locks[i])
+        {
+            write_error("Jobs: Could not create cache locks.");
+            exit(1);
+        }
+    }
+
+    for(i = 1; i <= workerCount; i++)
+    {
+        threads[i].run = run_number;
+        threads[i].command = new job_command[JS_CMD_INITIAL];
+        threads[i].cmd_max = JS_CMD_INITIAL;
+        threads[i].cmd_count = threads[i].cmd_read = 0;
+        threads[i].thread = SDL_CreateThread(worker, (void*)&threads[i]);
+
+        if(!threads[i].thread)
+        {
+            delete [] threads[i].command;
+            threads[i].command = NULL;
+            break;
+        }
+
+        threads[i].thread_id = SDL_GetThreadID(threads[i].thread);
+        thread_count++;
+    }
+}
+
+/*******************************************************************************
+    function    :   job_module::stop
+    arguments   :   <none>
+    purpose     :   Stops the worker threads and frees the run and cache locks.
+    notes       :   <none>
+*******************************************************************************/
+void job_module::stop()
+{
+    int i;
+
+    if(!run_mutex)
+        return;
+
+    SDL_mutexP(run_mutex);
+    quit = true;
+    SDL_CondBroadcast(start_cond);
+    SDL_mutexV(run_mutex);
+
+    for(i = 1; i < thread_count; i++)
+    {
+        SDL_WaitThread(threads[i].thread, NULL);
+        threads[i].thread = NULL;
+        delete [] threads[i].command;
+        threads[i].command = NULL;
+        threads[i].cmd_count = threads[i].cmd_max = threads[i].cmd_read = 0;
+    }
+    thread_count = 1;
+
+    for(i = 0; i < JS_LOCK_COUNT; i++)
+    {
+        SDL_DestroyMutex(locks[i]);
+        locks[i] = NULL;
+    }
+
+    SDL_DestroyCond(done_cond);
+    SDL_DestroyCond(start_cond);
+    SDL_DestroyMutex(run_mutex);
+    done_cond = start_cond = NULL;
+    run_mutex = NULL;
+}
+
+/*******************************************************************************
+    function    :   job_module::worker
+    arguments   :   data - Thread (job_thread*) the worker runs as
+    purpose     :   Worker thread body. Waits for a run to start, works on it
+                    until it has no items left, and reports back done, until
+                    told to quit.
+    notes       :   <none>
+*******************************************************************************/
+int job_module::worker(void* data)
+{
+    job_thread* self = (job_thread*)data;
+    job_module* module = self->module;
+
+    SDL_mutexP(module->run_mutex);
+
+    while(!module->quit)
+    {
+        if(module->run_number == self->run)
+        {
+            SDL_CondWait(module->start_cond, module->run_mutex);
+            continue;
+        }
+        self->run = module->run_number;
+
+        SDL_mutexV(module->run_mutex);
+
+        module->work(self);
+
+        SDL_mutexP(module->run_mutex);
+        if(--module->busy == 0)
+            SDL_CondSignal(module->done_cond);
+    }
+
+    SDL_mutexV(module->run_mutex);
+
+    return 0;
+}
+
+/*******************************************************************************
+    function    :   job_module::work
+    arguments   :   self - Thread doing the work
+    purpose     :   Takes chunks of the current run and calls the run's routine
+                    for each item of them, until every item has been taken.
+    notes       :   Chunks are taken in order, so each thread's items (and so
+                    its commands) are in increasing order.
+*******************************************************************************/
+void job_module::work(job_thread* self)
+{
+    int first, last;
+    int i;
+
+    for(;;)
+    {
+        SDL_mutexP(run_mutex);
+        first = run_next;
+        if(first < run_count)
+            run_next += run_chunk;
+        SDL_mutexV(run_mutex);
+
+        if(first >= run_count)
+            break;
+
+        last = first + run_chunk;
+        if(last > run_count)
+            last = run_count;
+
+        for(i = first; i < last; i++)
+        {
+            self->item = i;
+            run_routine(run_data, i, run_delta);
+        }
+    }
+}
+
+/*******************************************************************************
+    function    :   job_module::this_thread
+    arguments   :   <none>
+    purpose     :   Returns the job thread of the calling thread.
+    notes       :   Anything not a worker is taken to be the main thread.
+*******************************************************************************/
+job_thread* job_module::this_thread()
+{
+    Uint32 id;
+    int i;
+
+    if(thread_count == 1)
+        return &threads[0];
+
+    id = SDL_ThreadID();
+    for(i = 1; i < thread_count; i++)
+        if(threads[i].thread_id == id)
+            return &threads[i];
+
+    return &threads[0];
+}
+
+/*******************************************************************************
+    function    :   job_module::run
+    arguments   :   routine - Routine to call for each item
+                    data - Data passed to routine (e.g. list of items)
+                    count - Number of items
+                    deltaT - Number of seconds elapsed since last update
+    purpose     :   Calls the routine for items [0, count) across the worker
+                    threads and the main thread, waits for them all to be done,
+                    then applies the commands they deferred in item order.
+    notes       :   1) Items must only write to state of their own, everything
+                       shared is to be read only or reached through the
+                       deferring routines (or locked).
+                    2) Small runs are done on the main thread alone. Commands
+                       are deferred all the same, so the outcome never depends
+                       on the number of threads.
+*******************************************************************************/
+void job_module::run(job_routine routine, void* data, int count, float deltaT)
+{
+    int i;
+
+    if(count <= 0)
+        return;
+
+    in_run = true;
+
+    if(thread_count == 1 || count < JS_MIN_PARALLEL)
+    {
+        for(i = 0; i < count; i++)
+        {
+            threads[0].item = i;
+            routine(data, i, deltaT);
+        }
+    }
+    else
+    {
+        SDL_mutexP(run_mutex);
+        run_routine = routine;
+        run_data = data;
+        run_delta = deltaT;
+        run_count = count;
+        run_next = 0;
+        run_chunk = count / (thread_count * JS_CHUNKS_PER_THREAD);
+        if(run_chunk < 1)
+            run_chunk = 1;
+        busy = thread_count - 1;
+        run_number++;
+        SDL_CondBroadcast(start_cond);
+        SDL_mutexV(run_mutex);
+
+        // Main thread works on the run as well
+        work(&threads[0]);
+
+        SDL_mutexP(run_mutex);
+        while(busy > 0)
+            SDL_CondWait(done_cond, run_mutex);
+        SDL_mutexV(run_mutex);
+    }
+
+    in_run = false;
+
+    merge();
+}
+
+/*******************************************************************************
+    function    :   job_module::add_command
+    arguments   :   self - Thread raising the command
+                    type - Command type (JS_CMD_xxx)
+    purpose     :   Adds a command to the thread's buffer for its current item,
+                    growing the buffer if full, and returns it to be filled in.
+    notes       :   <none>
+*******************************************************************************/
+job_command* job_module::add_command(job_thread* self, short type)
+{
+    job_command* temp;
+    int i;
+
+    if(self->cmd_count >= self->cmd_max)
+    {
+        temp = new job_command[self->cmd_max * 2];
+        for(i = 0; i < self->cmd_count; i++)
+            temp[i] = self->command[i];
+        delete [] self->command;
+        self->command = temp;
+        self->cmd_max *= 2;
+    }
+
+    temp = &self->command[self->cmd_count++];
+    temp->item = self->item;
+    temp->type = type;
+    temp->ptr = NULL;
+    temp->arg[0] = temp->arg[1] = temp->arg[2] = 0;
+    temp->value = 0.0;
+
+    return temp;
+}
+
+/*******************************************************************************
+    function    :   job_module::apply
+    arguments   :   cmd - Command to apply
+    purpose     :   Carries out a deferred command.
+    notes       :   Texts are freed once used.
+*******************************************************************************/
+void job_module::apply(job_command* cmd)
+{
+    switch(cmd->type)
+    {
+        case JS_CMD_FIRE_GUN:
+            ((firing_object*)cmd->ptr)->fireGun(cmd->arg[0], cmd->arg[1],
+                cmd->arg[2]);
+            break;
+
+        case JS_CMD_COM_MESSAGE:
+            console.addComMessage((char*)cmd->ptr);
+            free(cmd->ptr);
+            break;
+
+        case JS_CMD_ERROR:
+            write_error((char*)cmd->ptr);
+            free(cmd->ptr);
+            break;
+
+        case JS_CMD_PROJ_EVENTS:
+            ((proj_object*)cmd->ptr)->updateEvents(cmd->arg[0], cmd->value);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*******************************************************************************
+    function    :   job_module::merge
+    arguments   :   <none>
+    purpose     :   Applies the commands of every thread's buffer, lowest item
+                    first, then empties the buffers.
+    notes       :   Each item is done by only one thread, and each buffer is in
+                    item order, so this gives the commands in the order a
+                    serial pass would have raised them.
+*******************************************************************************/
+void job_module::merge()
+{
+    job_thread* next;
+    int i;
+
+    for(;;)
+    {
+        next = NULL;
+
+        for(i = 0; i < thread_count; i++)
+            if(threads[i].cmd_read < threads[i].cmd_count &&
+               (next == NULL || threads[i].command[threads[i].cmd_read].item <
+                next->command[next->cmd_read].item))
+                next = &threads[i];
+
+        if(next == NULL)
+            break;
+
+        apply(&next->command[next->cmd_read++]);
+    }
+
+    for(i = 0; i < thread_count; i++)
+        threads[i].cmd_count = threads[i].cmd_read = 0;
+}
+
+/*******************************************************************************
+    function    :   job_module::fireGun
+    arguments   :   unit - Unit firing
+                    gunNum - gun number
+                    fromAmmoPool - ammo pool number to fire from
+                    modifiers - modifiers to add to the round (AMMO_MOD_xxxx)
+    purpose     :   Fires the unit's gun, deferred until the end of the run if
+                    called from one.
+    notes       :   Firing adds projectiles/bullets, effects and sounds.
+*******************************************************************************/
+void job_module::fireGun(firing_object* unit, int gunNum, int fromAmmoPool,
+    int modifiers)
+{
+    job_command* cmd;
+
+    if(!in_run)
+    {
+        unit->fireGun(gunNum, fromAmmoPool, modifiers);
+        return;
+    }
+
+    cmd = add_command(this_thread(), JS_CMD_FIRE_GUN);
+    cmd->ptr = (void*)unit;
+    cmd->arg[0] = gunNum;
+    cmd->arg[1] = fromAmmoPool;
+    cmd->arg[2] = modifiers;
+}
+
+/*******************************************************************************
+    function    :   job_module::addComMessage
+    arguments   :   text - Message text
+    purpose     :   Adds a communications message to the console, deferred
+                    until the end of the run if called from one.
+    notes       :   <none>
+*******************************************************************************/
+void job_module::addComMessage(char* text)
+{
+    job_command* cmd;
+
+    if(!in_run)
+    {
+        console.addComMessage(text);
+        return;
+    }
+
+    cmd = add_command(this_thread(), JS_CMD_COM_MESSAGE);
+    cmd->ptr = (void*)strdup(text);
+}
+
+/*******************************************************************************
+    function    :   job_module::writeError
+    arguments   :   text - Error text
+    purpose     :   Writes an error to the error log, deferred until the end
+                    of the run if called from one.
+    notes       :   <none>
+*******************************************************************************/
+void job_module::writeError(char* text)
+{
+    job_command* cmd;
+
+    if(!in_run)
+    {
+        write_error(text);
+        return;
+    }
+
+    cmd = add_command(this_thread(), JS_CMD_ERROR);
+    cmd->ptr = (void*)strdup(text);
+}
+
+/*******************************************************************************
+    function    :   job_module::projEvents
+    arguments   :   proj - Projectile
+                    events - Events raised by its flight (PROJ_EVENT_xxx)
+                    deltaT - Number of seconds elapsed since last update
+    purpose     :   Has the projectile make the effects and sounds of its
+                    flight events, deferred until the end of the run if called
+                    from one.
+    notes       :   <none>
+*******************************************************************************/
+void job_module::projEvents(proj_object* proj, int events, float deltaT)
+{
+    job_command* cmd;
+
+    if(!in_run)
+    {
+        proj->updateEvents(events, deltaT);
+        return;
+    }
+
+    cmd = add_command(this_thread(), JS_CMD_PROJ_EVENTS);
+    cmd->ptr = (void*)proj;
+    cmd->arg[0] = events;
+    cmd->value = deltaT;
+}
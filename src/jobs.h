@@ -0,0 +1,139 @@
+/*******************************************************************************
+                          Job System Module - Definition
+*******************************************************************************/
+#ifndef JOBS_H
+#define JOBS_H
+
+// Worker Threads
+#define JS_MAX_THREADS              15      // Max worker threads (plus main)
+#define JS_DEFAULT_THREADS          3       // Worker threads if CPUs unknown
+#define JS_AUTO_THREADS             -1      // Size workers from CPU count
+#define JS_CHUNKS_PER_THREAD        4       // Run chunks per thread
+#define JS_MIN_PARALLEL             8       // Min items to use worker threads
+
+// Deferred Commands
+#define JS_CMD_FIRE_GUN             0       // firing_object::fireGun
+#define JS_CMD_COM_MESSAGE          1       // console.addComMessage
+#define JS_CMD_ERROR                2       // write_error
+#define JS_CMD_PROJ_EVENTS          3       // proj_object::updateEvents
+#define JS_CMD_INITIAL              64      // Initial command buffer size
+
+// Locks (for shared caches reached from jobs)
+#define JS_LOCK_RANGE_TABLE         0       // Ballistic range tables
+#define JS_LOCK_COUNT               1
+
+struct firing_object;                   // Firing object (objunit.h)
+struct proj_object;                     // Projectile object (projectile.h)
+class job_module;
+
+// Job Routine (called once per item of a run)
+typedef void (*job_routine)(void* data, int item, float deltaT);
+
+// Deferred Command
+struct job_command
+{
+    int item;                           // Item of run raising command
+    short type;                         // Command type (JS_CMD_xxx)
+    void* ptr;                          // Object, or text (strdup'ed)
+    int arg[3];                         // Arguments
+    float value;
+};
+
+// Job Thread (workers, and the main thread as thread 0)
+struct job_thread
+{
+    job_module* module;                 // Owning module
+    SDL_Thread* thread;                 // Thread (NULL for main thread)
+    Uint32 thread_id;                   // SDL thread ID
+    unsigned int run;                   // Last run number seen
+    int item;                           // Item being worked on
+    job_command* command;               // Command buffer
+    int cmd_count;                      // Commands in buffer
+    int cmd_max;                        // Size of command buffer
+    int cmd_read;                       // Merge position
+};
+
+/*******************************************************************************
+    class       :   job_module
+    purpose     :   Runs per-item update routines over the worker threads and
+                    the main thread at once, recording the side effects they
+                    cause in per-thread command buffers and applying them
+                    afterwards, on the main thread, in item order.
+    notes       :   1) A run is cut up into chunks of consecutive items, which
+                       threads take from a shared counter as they go idle (so
+                       a thread stuck on a slow chunk has the rest of the run
+                       taken from it by the others). Each thread therefore
+                       works through its items in increasing order.
+                    2) Commands are tagged with the item raising them, and the
+                       buffers are merged by item once the run is done, so
+                       side effects happen in exactly the order a serial pass
+                       over the items would make them, whatever the timing.
+                    3) The deferring routines (fireGun, addComMessage, etc.)
+                       act at once when called outside of a run, so code may
+                       call them without knowing which it is in.
+                    4) Locks are only made when there are worker threads, and
+                       lock/unlock do nothing without them.
+*******************************************************************************/
+class job_module
+{
+    private:
+        job_thread threads[JS_MAX_THREADS + 1]; // Main thread, then workers
+        int thread_count;               // Threads running (incl. main)
+        bool in_run;                    // Run is in progress
+
+        /* Run State */
+        SDL_mutex* run_mutex;           // Guards run state below
+        SDL_cond* start_cond;           // Signals new run/quit
+        SDL_cond* done_cond;            // Signals workers done
+        unsigned int run_number;        // Run number
+        int busy;                       // Workers still working
+        bool quit;                      // Set to stop workers
+        job_routine run_routine;        // Routine of run
+        void* run_data;                 // Data of run
+        float run_delta;                // deltaT of run
+        int run_count;                  // Items of run
+        int run_next;                   // Next item not yet taken
+        int run_chunk;                  // Items taken at once
+
+        SDL_mutex* locks[JS_LOCK_COUNT];    // Shared cache locks
+
+        /* Thread Routines */
+        static int worker(void* data);
+        void work(job_thread* self);
+        job_thread* this_thread();
+
+        /* Command Routines */
+        job_command* add_command(job_thread* self, short type);
+        void apply(job_command* cmd);
+        void merge();
+
+    public:
+        job_module();                   // Constructor
+        ~job_module();                  // Deconstructor
+
+        /* Worker Routines */
+        void start(int workerCount);
+        void stop();
+        int getThreadCount()
+            { return thread_count; }
+
+        /* Run Routine */
+        void run(job_routine routine, void* data, int count, float deltaT);
+
+        /* Lock Routines */
+        void lock(int lockNum)
+            { if(locks[lockNum]) SDL_mutexP(locks[lockNum]); }
+        void unlock(int lockNum)
+            { if(locks[lockNum]) SDL_mutexV(locks[lockNum]); }
+
+        /* Deferring Routines */
+        void fireGun(firing_object* unit, int gunNum, int fromAmmoPool,
+            int modifiers);
+        void addComMessage(char* text);
+        void writeError(char* text);
+        void projEvents(proj_object* proj, int events, float deltaT);
+};
+
+extern job_module jobs;
+
+#endif
@@ -3,11 +3,14 @@
 *******************************************************************************/
 #include "main.h"
 #include "load.h"
+#include "astar.h"
+#include "ballistics.h"
 #include "camera.h"
 #include "database.h"
 #include "effects.h"
 #include "fonts.h"
 #include "gameloop.h"
+#include "jobs.h"
 #include "misc.h"
 #include "object.h"
 #include "objhandler.h"
@@ -26,7 +29,7 @@
 loader_module::loader_module()
 {
     load_value = 0;                             // Init bar loading at 0
-    max_load_value = 130;                       // Max bar loading (changes!)
+    max_load_value = 135;                       // Max bar loading (changes!)
     strcpy(display_text, "Initializing...");    // Default start up message
     loading = true;                             // We are initially loading
 }
@@ -43,6 +46,10 @@ void loader_module::loadGameSettings(int argc, char *argv[])
     char buffer[128];
     char value[64];
     
+    // Defaults for settings which may be left out
+    game_options.worker_threads = JS_AUTO_THREADS;
+    game_options.sim_thread = true;
+    
     // Open up settings file and load settings
     fin.open("settings.ini", ios::in);
     
@@ -166,6 +173,22 @@ void loader_module::loadGameSettings(int argc, char *argv[])
             else
                 game_options.diameter_fix = false;
         }
+        // Performance Options
+        else if(sscanf(buffer, "WORKER_THREADS = %s", value))
+        {
+            if(strstr(value, "AUTO") || strstr(value, "auto"))
+                game_options.worker_threads = JS_AUTO_THREADS;
+            else
+                game_options.worker_threads = atoi(value);
+        }
+        else if(sscanf(buffer, "SIM_THREAD = %s", value))
+        {
+            if(strstr(value, "ENABLED") || strstr(value, "enabled") ||
+               strstr(value, "T") || strstr(value, "t"))
+                game_options.sim_thread = true;
+            else
+                game_options.sim_thread = false;
+        }
         
         // Clean through whitespace
         eatjunk(fin);
@@ -232,6 +255,9 @@ void loader_module::loadGame()
     sounds.setSystemVolume(game_options.sound_volume);
     sounds.setSystemMaxSounds(game_options.max_sounds);
     
+    // Start job system workers
+    jobs.start(game_options.worker_threads);
+    
     // Apply texturing settings
     textures.setAnisotropicy(game_setup.anisotropic);
     textures.setFiltering(game_setup.filtering);
@@ -276,6 +302,7 @@ void loader_module::loadGame()
     strcpy(display_text, "Loading Reference Data");         // Load DB
     display();
     db.loadDirectory("Reference");
+    ballistics.buildAmmoTables();
     load_value += 10;
     
     strcpy(display_text, "Loading Special Effects");        // Load SE
@@ -296,6 +323,11 @@ void loader_module::loadGame()
     display();
     map.buildScenery();
     
+    strcpy(display_text, "Building Pathfinding Graph");     // Build PF graph
+    display();
+    astar.buildGraph();
+    load_value += 5;
+    
     strcpy(display_text, "Loading Objects");                // Load objects
     display();
     objects.loadMission(game_setup.mission_folder);
@@ -139,6 +139,13 @@ END TERMS AND CONDITIONS
 #include "collision.h"          // Collision Detection & Response Module
 #include "ui.h"                 // User Interface Module
 #include "script.h"             // Scripting Module
+#include "astar.h"              // Pathfinding Module
+#include "visibility.h"         // Visibility Module
+#include "ballistics.h"         // Ballistics Module
+#include "bullets.h"            // MG Bullet Pool Module
+#include "jobs.h"               // Job System Module
+#include "projectile.h"         // Projectile Tracer Pass
+#include "snapshot.h"           // Render Snapshot Module
 #include "gameloop.h"           // Game Execution Loop Base
 
 /*******************************************************************************
@@ -158,6 +165,13 @@ collision_module cdr;           // Collision Detection & Response Module
 se_module effects;              // Special Effects Module
 sound_module sounds;            // Sound Module
 script_module script;           // Scripting Module
+astar_module astar;             // Pathfinding Module
+visibility_module visibility;   // Visibility Module
+ballistic_module ballistics;    // Ballistics Module
+bullet_module bullets;          // MG Bullet Pool Module
+job_module jobs;                // Job System Module
+tracer_pass tracers;            // Projectile Tracer Pass
+snapshot_module snapshots;      // Render Snapshot Module
 
 /*******************************************************************************
                        Global Variable Declarations
@@ -124,6 +124,10 @@ struct korps_options
     // Realism
     int pen_system;
     bool diameter_fix;
+    
+    // Performance
+    int worker_threads;
+    bool sim_thread;
 };
 
 extern korps_options game_options;
@@ -949,6 +949,38 @@ kVector transform(kVector &v, float* matrix)
     return (v = transformed(v, matrix));
 }
 
+/*******************************************************************************
+    function    :   kVector untransformed
+    arguments   :   v - vector data
+                    matrix - OpenGL based 4x4 matrix
+    purpose     :   Produces the form of v before it was passed through matrix,
+                    i.e. passes v through the inverse of matrix.
+    notes       :   The matrix must be made up of rotations and translations
+                    only, so that its inverse is the transpose of its rotation
+                    applied after undoing its translation.
+*******************************************************************************/
+kVector untransformed(kVector v, float* matrix)
+{
+    float offset[3];
+    float resultant[3];
+    
+    offset[0] = v[0] - matrix[12];
+    offset[1] = v[1] - matrix[13];
+    offset[2] = v[2] - matrix[14];
+    
+    resultant[0] = matrix[0]  * offset[0] +
+                   matrix[1]  * offset[1] +
+                   matrix[2]  * offset[2];
+    resultant[1] = matrix[4]  * offset[0] +
+                   matrix[5]  * offset[1] +
+                   matrix[6]  * offset[2];
+    resultant[2] = matrix[8]  * offset[0] +
+                   matrix[9]  * offset[1] +
+                   matrix[10] * offset[2];
+    
+    return kVector(resultant);
+}
+
 /*******************************************************************************
     function    :   kVector crossProduct
     arguments   :   v1 - first vector data
@@ -1014,3 +1046,136 @@ float distanceBetween(kVector v1, kVector v2)
 {
     return magnitude(v2 - v1);
 }
+
+/*******************************************************************************
+    function    :   matrixIdentity
+    arguments   :   matrix - OpenGL based 4x4 matrix
+    purpose     :   Loads the identity matrix (as glLoadIdentity).
+    notes       :   <none>
+*******************************************************************************/
+void matrixIdentity(float* matrix)
+{
+    matrix[0] = matrix[5] = matrix[10] = matrix[15] = 1.0;
+    matrix[1] = matrix[2] = matrix[3] = matrix[4] = 
+    matrix[6] = matrix[7] = matrix[8] = matrix[9] = 
+    matrix[11] = matrix[12] = matrix[13] = matrix[14] = 0.0;
+}
+
+/*******************************************************************************
+    function    :   matrixCopy
+    arguments   :   dest - OpenGL based 4x4 matrix copied to
+                    src - OpenGL based 4x4 matrix copied from
+    purpose     :   Copies a matrix (as glLoadMatrixf).
+    notes       :   <none>
+*******************************************************************************/
+void matrixCopy(float* dest, float* src)
+{
+    int i;
+    
+    for(i = 0; i < 16; i++)
+        dest[i] = src[i];
+}
+
+/*******************************************************************************
+    function    :   matrixMultiply
+    arguments   :   dest - OpenGL based 4x4 matrix for result
+                    m1 - left hand matrix
+                    m2 - right hand matrix
+    purpose     :   Produces m1 * m2 (as glLoadMatrixf(m1), glMultMatrixf(m2)).
+    notes       :   dest must not be m1 or m2.
+*******************************************************************************/
+void matrixMultiply(float* dest, float* m1, float* m2)
+{
+    int i, j;
+    
+    for(i = 0; i < 4; i++)          // Column of m2
+        for(j = 0; j < 4; j++)      // Row of m1
+            dest[i*4 + j] = m1[j]      * m2[i*4 + 0] +
+                            m1[4 + j]  * m2[i*4 + 1] +
+                            m1[8 + j]  * m2[i*4 + 2] +
+                            m1[12 + j] * m2[i*4 + 3];
+}
+
+/*******************************************************************************
+    function    :   matrixTranslate
+    arguments   :   matrix - OpenGL based 4x4 matrix
+                    x, y, z - translation
+    purpose     :   Multiplies matrix by a translation (as glTranslatef).
+    notes       :   <none>
+*******************************************************************************/
+void matrixTranslate(float* matrix, float x, float y, float z)
+{
+    int i;
+    
+    for(i = 0; i < 4; i++)
+        matrix[12 + i] += matrix[i] * x + matrix[4 + i] * y + matrix[8 + i] * z;
+}
+
+/*******************************************************************************
+    function    :   matrixRotateX
+    arguments   :   matrix - OpenGL based 4x4 matrix
+                    angle - angle of rotation (radians)
+    purpose     :   Multiplies matrix by a rotation about the X axis (as
+                    glRotatef(angle * radToDeg, 1.0, 0.0, 0.0)).
+    notes       :   <none>
+*******************************************************************************/
+void matrixRotateX(float* matrix, float angle)
+{
+    int i;
+    float c = cos(angle);
+    float s = sin(angle);
+    float temp;
+    
+    for(i = 0; i < 4; i++)
+    {
+        temp = matrix[4 + i];
+        matrix[4 + i] = temp * c + matrix[8 + i] * s;
+        matrix[8 + i] = matrix[8 + i] * c - temp * s;
+    }
+}
+
+/*******************************************************************************
+    function    :   matrixRotateY
+    arguments   :   matrix - OpenGL based 4x4 matrix
+                    angle - angle of rotation (radians)
+    purpose     :   Multiplies matrix by a rotation about the Y axis (as
+                    glRotatef(angle * radToDeg, 0.0, 1.0, 0.0)).
+    notes       :   <none>
+*******************************************************************************/
+void matrixRotateY(float* matrix, float angle)
+{
+    int i;
+    float c = cos(angle);
+    float s = sin(angle);
+    float temp;
+    
+    for(i = 0; i < 4; i++)
+    {
+        temp = matrix[i];
+        matrix[i] = temp * c - matrix[8 + i] * s;
+        matrix[8 + i] = temp * s + matrix[8 + i] * c;
+    }
+}
+
+/*******************************************************************************
+    function    :   matrixRotateZ
+    arguments   :   matrix - OpenGL based 4x4 matrix
+                    angle - angle of rotation (radians)
+    purpose     :   Multiplies matrix by a rotation about the Z axis (as
+                    glRotatef(angle * radToDeg, 0.0, 0.0, 1.0)).
+    notes       :   <none>
+*******************************************************************************/
+void matrixRotateZ(float* matrix, float angle)
+{
+    int i;
+    float c = cos(angle);
+    float s = sin(angle);
+    float temp;
+    
+    for(i = 0; i < 4; i++)
+    {
+        temp = matrix[i];
+        matrix[i] = temp * c + matrix[4 + i] * s;
+        matrix[4 + i] = matrix[4 + i] * c - temp * s;
+    }
+}
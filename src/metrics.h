@@ -55,6 +55,11 @@
                             by passing it through a 4x4 OpenGL based matrix
                             (such as the MODELVIEW matrix). Do note that this
                             does modify the source vector.
+                       - untransformed: Returns the vector as it was before
+                            being passed through a 4x4 OpenGL based matrix,
+                            for matrices made of rotations and translations
+                            only (no scaling). Note that this doesn't modify
+                            the source vector.
                        - crossProduct: Returns the crossProduct of two vectors.
                             Note that this doesn't modify the source vectors.
                        - dotProduct: Returns the dotProduct of two vectors.
@@ -172,6 +177,9 @@ class kVector
         friend kVector transform(kVector &v, float* matrix);
         inline kVector transform(float* matrix)
             { return ::transform(*this, matrix); }
+        
+        // Inverse of a Rigid Linear Transform (does not effect vector)
+        friend kVector untransformed(kVector v, float* matrix);
 
         // Cross Product of two Vectors (does not effect either vector)
         friend kVector crossProduct(kVector v1, kVector v2);
@@ -197,4 +205,19 @@ class kVector
             { return ::distanceBetween(*this, v); }
 };
 
+/*******************************************************************************
+    Matrix Routines - 4x4 OpenGL based (column major) matrices, built on the
+    CPU so that no GL context is needed. Translate and rotate post-multiply
+    the passed matrix just as glTranslatef and glRotatef do to the current
+    matrix, so GL stack code converts over line for line. Angles are in
+    radians.
+*******************************************************************************/
+void matrixIdentity(float* matrix);
+void matrixCopy(float* dest, float* src);
+void matrixMultiply(float* dest, float* m1, float* m2);
+void matrixTranslate(float* matrix, float x, float y, float z);
+void matrixRotateX(float* matrix, float angle);
+void matrixRotateY(float* matrix, float angle);
+void matrixRotateZ(float* matrix, float angle);
+
 #endif
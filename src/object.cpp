@@ -10,6 +10,7 @@
 #include "misc.h"
 #include "model.h"
 #include "scenery.h"
+#include "snapshot.h"
 #include "tank.h"
 
 /*******************************************************************************
@@ -157,6 +158,7 @@ object::object()
     obj_type = OBJ_TYPE_STATIC;
     obj_status = OBJ_STATUS_REMOVE;     // Set to remove unless initObj called
     obj_modifiers = OBJ_MOD_NONE;
+    obj_handle = OBJ_HANDLE_NONE;       // Given by object handler
     
     // Give 0.0 to orientation
     pos[0] = pos[1] = pos[2] = 0.0;
@@ -175,8 +177,7 @@ object::object()
     hull_matrix[6] = hull_matrix[7] = hull_matrix[8] = hull_matrix[9] = 
     hull_matrix[11] = hull_matrix[12] = hull_matrix[13] = hull_matrix[14] = 0.0;
     
-    // No draw, 1.0 culling radius
-    draw = false;
+    // 1.0 culling radius
     radius = 1.0;
 }
 
@@ -244,6 +245,7 @@ void object::initObj(float xPos, float zPos, float heading)
     kVector rear_left(size[0]/2.0, 0.0, -size[2]/2.0);
     kVector rear_right(-size[0]/2.0, 0.0, -size[2]/2.0);
     char* temp;
+    float corner_x[4], corner_z[4], corner_y[4];    // Batched height query
     
     // Set up position vector
     pos[0] = xPos;
@@ -274,11 +276,16 @@ void object::initObj(float xPos, float zPos, float heading)
     rear_left.transform((float*)hull_matrix);
     rear_right.transform((float*)hull_matrix);
     
-    // Get new height values for transformed values
-    front_left[1] = map.getOverlayHeight(front_left[0], front_left[2]);
-    front_right[1] = map.getOverlayHeight(front_right[0], front_right[2]);
-    rear_left[1] = map.getOverlayHeight(rear_left[0], rear_left[2]);
-    rear_right[1] = map.getOverlayHeight(rear_right[0], rear_right[2]);
+    // Get new height values for transformed values (batched)
+    corner_x[0] = front_left[0];   corner_z[0] = front_left[2];
+    corner_x[1] = front_right[0];  corner_z[1] = front_right[2];
+    corner_x[2] = rear_left[0];    corner_z[2] = rear_left[2];
+    corner_x[3] = rear_right[0];   corner_z[3] = rear_right[2];
+    map.getOverlayHeights(4, corner_x, corner_z, corner_y);
+    front_left[1] = corner_y[0];
+    front_right[1] = corner_y[1];
+    rear_left[1] = corner_y[2];
+    rear_right[1] = corner_y[3];
     
     // Determine whenever or not this is a special cased object
     temp = db.query(obj_model, "TAG");
@@ -396,29 +403,41 @@ kVector object::transform(kVector position, int attachLevelFrom, int attachLevel
 *******************************************************************************/
 void object::update(float deltaT)
 {
-    // Camera culling
-    draw = camera.sphereInView(pos(), radius);
+    return;
+}
+
+/*******************************************************************************
+    function    :   object::snapshot
+    arguments   :   snap - Render snapshot record to fill
+    purpose     :   Records what is displayed of the object.
+    notes       :   <none>
+*******************************************************************************/
+void object::snapshot(snap_object* snap)
+{
+    snap->kind = SNAP_OBJ_MODEL;
+    snap->selected = false;
+    snap->radius = radius;
+    snap->model_id = model_id;
+    matrixCopy((float*)snap->hull_matrix, (float*)hull_matrix);
+    snap->turret_count = 0;
+    snap->gun_count = 0;
 }
 
 /*******************************************************************************
     function    :   object::display
-    arguments   :   <none>
+    arguments   :   snap - Render snapshot record of object
     purpose     :   Base display function.
-    notes       :   <none>
+    notes       :   Culling is done by the snapshot module.
 *******************************************************************************/
-void object::display()
+void object::display(snap_object* snap)
 {
-    // Draw object if in view.
-    if(draw)
-    {
-        glPushMatrix();
-        
-        // Orient object
-        glMultMatrixf(hull_matrix);
-        
-        // Draw model (from model library)
-        models.drawModel(model_id, MDL_DRW_VERTEXARRAY);
-        
-        glPopMatrix();
-    }
+    glPushMatrix();
+    
+    // Orient object
+    glMultMatrixf(snap->hull_matrix);
+    
+    // Draw model (from model library)
+    models.drawModel(snap->model_id, MDL_DRW_VERTEXARRAY);
+    
+    glPopMatrix();
 }
@@ -102,12 +102,17 @@
 #define OBJ_AMMOPOOL_A5         4       // Fifth pool
 #define OBJ_AMMOPOOL_MG         5       // Machine gun ammo pool    (reserved)
 
+// Object Handles
+#define OBJ_HANDLE_NONE         0       // Handle to no object
+
 // Max count defines
 #define OBJ_CREW_MAX            10      // Crew members         (do not change!)
 #define OBJ_TURRET_MAX          3       // Turret devices       (do not change!)
 #define OBJ_SIGHT_MAX           3       // Sighting devices     (do not change!)
 #define OBJ_GUN_MAX             5       // Gun devices          (do not change!)
 
+struct snap_object;                     // Render snapshot record (snapshot.h)
+
 /* Helper Functions */
 unsigned short objType(char* designationStr);
 unsigned short objStatus(char* statusStr);
@@ -127,6 +132,7 @@ struct object
     unsigned short obj_type;        // Object type identifier
     unsigned short obj_status;      // Object status identifier
     unsigned int obj_modifiers;     // Object modifiers (32 bit binary)
+    unsigned int obj_handle;        // Object handle (given by object handler)
     
     // Orientation Attributes
     kVector pos;                    // Position vector (CARTESIAN)
@@ -141,7 +147,6 @@ struct object
     kVector size;                   // Size of object (WIDTH, HEIGHT, LENGTH)
     
     // Culling Attributes
-    bool draw;                      // Object in view (yes/no)
     float radius;                   // Culling radius
     
     /* Functions */
@@ -162,7 +167,8 @@ struct object
     
     /* Base Update and Display Routines */
     virtual void update(float deltaT);      // Virtual update
-    virtual void display();                 // Virtual display
+    void snapshot(snap_object* snap);       // Render snapshot record
+    static void display(snap_object* snap); // Display (from snapshot)
 };
 
 #endif
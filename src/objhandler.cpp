@@ -8,6 +8,7 @@
 #include "collision.h"
 #include "console.h"
 #include "database.h"
+#include "jobs.h"
 #include "metrics.h"
 #include "misc.h"
 #include "model.h"
@@ -15,7 +16,9 @@
 #include "objunit.h"
 #include "projectile.h"
 #include "scenery.h"
+#include "snapshot.h"
 #include "tank.h"
+#include "visibility.h"
 
 /*******************************************************************************
     function    :   object_handler::object_handler
@@ -56,6 +59,39 @@ object_handler::object_handler()
             obj_count[i] = -1;
         }
     }
+    
+    // Allocate typed lists (kept the same size as their object lists)
+    tanks = new tank_object* [obj_max[OBJ_TYPE_TANK]];
+    atgs = new atg_object* [obj_max[OBJ_TYPE_ATG]];
+    
+    // No component lists built yet
+    crews = NULL;
+    motors = NULL;
+    sights = NULL;
+    guns = NULL;
+    sight_first = NULL;
+    gun_first = NULL;
+    crew_count = motor_count = sight_count = gun_count = 0;
+    comp_max = 0;
+    comp_dirty = true;
+    
+    // Allocate handle slots
+    slots = new obj_slot[OBJ_HANDLE_SLOTS];
+    slot_max = OBJ_HANDLE_SLOTS;
+    slot_count = 0;
+    slot_free = -1;
+    
+    // No CDTL nodes pooled yet
+    cdtl_free = NULL;
+    
+    // Projectile CD pass
+    cdp_size = 0;
+    cdp_proj = NULL;
+    cdp_hit_obj = NULL;
+    cdp_hit_report = NULL;
+    cdp_released = NULL;
+    cdp_count = 0;
+    cdp_resize(OBJ_MAX_PROJECTILE);
 }
 
 /*******************************************************************************
@@ -66,23 +102,44 @@ object_handler::object_handler()
 *******************************************************************************/
 object_handler::~object_handler()
 {
-    int i, j, k;
+    int i, j;
+    
+    // Free projectile CD pass buffers
+    delete [] cdp_proj;
+    delete [] cdp_hit_obj;
+    delete [] cdp_hit_report;
+    delete [] cdp_released;
     
     // Deallocate all lists
     for(i = 0; i < 10; i++)
         if(objects[i] != NULL)
         {
-            for(j = k = 0; k < obj_count[i]; j++)
-            {
-                if(objects[i][j])
-                {
-                    delete objects[i][j];
-                    k++;
-                }
-            }
+            for(j = 0; j < obj_count[i]; j++)
+                delete objects[i][j];
             
-            delete objects[i];
+            delete [] objects[i];
         }
+    
+    // Deallocate typed lists and handle slots
+    delete [] tanks;
+    delete [] atgs;
+    delete [] slots;
+    
+    // Deallocate component lists
+    delete [] crews;
+    delete [] motors;
+    delete [] sights;
+    delete [] guns;
+    delete [] sight_first;
+    delete [] gun_first;
+    
+    // Deallocate CDTL pool (after objects, which return their CDTLs to it)
+    while(cdtl_free)
+    {
+        cdtl_node* curr = cdtl_free;
+        cdtl_free = cdtl_free->next;
+        delete curr;
+    }
 }
 
 /*******************************************************************************
@@ -311,173 +368,386 @@ void object_handler::loadMission(char* directory)
 *******************************************************************************/
 object* object_handler::addObject(int objType)
 {
-    int j;
     object* obj_ptr = NULL;
+    tank_object* tank_ptr = NULL;
+    atg_object* atg_ptr = NULL;
     
-    // Check for valid object type
-    if(objType < 0 || objType > 9)
+    // Check for valid object type (and that object level is defined)
+    if(objType < 0 || objType > 9 || objects[objType] == NULL)
         return NULL;
     
-    // Add new object in appropriate object level
-    if(objects[objType] && obj_count[objType] < obj_max[objType])
-        for(j = 0; j < obj_max[objType]; j++)
-            if(objects[objType][j] == NULL)
-            {
-                switch(objType)
-                {
-                    case OBJ_TYPE_TANK:
-                        obj_ptr = (object*)(new tank_object);
-                        break;
-                    
-                    case OBJ_TYPE_VEHICLE:
-                        //obj_ptr = (object*)(new vehicle_object);
-                        break;
-                    
-                    case OBJ_TYPE_ATG:
-                        obj_ptr = (object*)(new atg_object);
-                        break;
-                    
-                    case OBJ_TYPE_ATR:
-                        //obj_ptr = (object*)(new atr_object);
-                        break;
-                    
-                    case OBJ_TYPE_STATIC:
-                        obj_ptr = new object;
-                        break;
-                    
-                    case OBJ_TYPE_PROJECTILE:
-                        obj_ptr = (object*)(new proj_object);
-                        break;
-                    
-                    default:
-                        return NULL;
-                        break;
-                }
-                
-                // Check for allocate
-                if(obj_ptr == NULL)
-                    return NULL;
-                
-                // Place object into list
-                objects[objType][j] = obj_ptr;
-                obj_count[objType]++;
-                
-                return obj_ptr;
-            }
+    switch(objType)
+    {
+        case OBJ_TYPE_TANK:
+            tank_ptr = new tank_object;
+            obj_ptr = (object*)tank_ptr;
+            break;
+        
+        case OBJ_TYPE_VEHICLE:
+            //obj_ptr = (object*)(new vehicle_object);
+            break;
+        
+        case OBJ_TYPE_ATG:
+            atg_ptr = new atg_object;
+            obj_ptr = (object*)atg_ptr;
+            break;
+        
+        case OBJ_TYPE_ATR:
+            //obj_ptr = (object*)(new atr_object);
+            break;
+        
+        case OBJ_TYPE_STATIC:
+            obj_ptr = new object;
+            break;
+        
+        case OBJ_TYPE_PROJECTILE:
+            obj_ptr = (object*)(new proj_object);
+            break;
+        
+        default:
+            return NULL;
+            break;
+    }
     
-    // Otherwise return NULL (e.g. too many objects, no object level of the
-    // type defined, etc.)
-    return NULL;
+    // Check for allocate
+    if(obj_ptr == NULL)
+        return NULL;
+    
+    // Give object its handle
+    obj_ptr->obj_handle = new_handle(obj_ptr);
+    if(obj_ptr->obj_handle == OBJ_HANDLE_NONE)
+    {
+        delete obj_ptr;
+        return NULL;
+    }
+    
+    // Place object at end of list (growing list if full)
+    if(obj_count[objType] >= obj_max[objType])
+        grow_list(objType);
+    if(objType == OBJ_TYPE_TANK)
+        tanks[obj_count[objType]] = tank_ptr;
+    else if(objType == OBJ_TYPE_ATG)
+        atgs[obj_count[objType]] = atg_ptr;
+    objects[objType][obj_count[objType]++] = obj_ptr;
+    
+    // Units change the component lists
+    if(objType >= OBJ_TYPE_TANK && objType <= OBJ_TYPE_ATR)
+        comp_dirty = true;
+    
+    // Units are also placed on the visibility roster
+    if(objType >= OBJ_TYPE_TANK && objType <= OBJ_TYPE_ATR)
+        visibility.addUnit(obj_ptr);
+    
+    return obj_ptr;
 }
 
 /*******************************************************************************
-    Object Grabbing Routines
+    function    :   object_handler::grow_list
+    arguments   :   objType - type of object list to grow
+    purpose     :   Doubles the size of an object list (and its typed list).
+    notes       :   Objects themselves do not move, only the list of pointers
+                    to them, so object pointers stay valid.
 *******************************************************************************/
+void object_handler::grow_list(int objType)
+{
+    object** list;
+    tank_object** tank_list;
+    atg_object** atg_list;
+    int j;
+    
+    if(objType == OBJ_TYPE_TANK)
+    {
+        tank_list = new tank_object* [obj_max[objType] * 2];
+        for(j = 0; j < obj_count[objType]; j++)
+            tank_list[j] = tanks[j];
+        
+        delete [] tanks;
+        tanks = tank_list;
+    }
+    else if(objType == OBJ_TYPE_ATG)
+    {
+        atg_list = new atg_object* [obj_max[objType] * 2];
+        for(j = 0; j < obj_count[objType]; j++)
+            atg_list[j] = atgs[j];
+        
+        delete [] atgs;
+        atgs = atg_list;
+    }
+    
+    list = new object* [obj_max[objType] * 2];
+    for(j = 0; j < obj_count[objType]; j++)
+        list[j] = objects[objType][j];
+    for(; j < obj_max[objType] * 2; j++)
+        list[j] = NULL;
+    
+    delete [] objects[objType];
+    objects[objType] = list;
+    obj_max[objType] *= 2;
+}
 
 /*******************************************************************************
-    function    :   object_handler::getUnitAt
-    arguments   :   x,y - screen coordinates to perform selection on
-    purpose     :   Grabs a unit based on the given mouse coordinates on the
-                    screen. Returns NULL if no object satisfies selection.
-    notes       :   1) Relies on the OpenGL selection buffer.
-                    2) Chooses object closest to view camera if multiple
-                       objects result from the OpenGL selection buffer.
+    function    :   object_handler::remove_at
+    arguments   :   objType - type of object list
+                    index - index of object in list
+    purpose     :   Takes an object out of its list (and frees its handle),
+                    moving the last object of the list into its place.
+    notes       :   Does not delete the object.
 *******************************************************************************/
-object* object_handler::getUnitAt(int x, int y)
+void object_handler::remove_at(int objType, int index)
 {
-    GLuint buffer[64];
-    GLint viewport[4];
-    int hits;
+    free_handle(objects[objType][index]->obj_handle);
     
-    int i, j, k;
+    obj_count[objType]--;
+    objects[objType][index] = objects[objType][obj_count[objType]];
+    objects[objType][obj_count[objType]] = NULL;
     
-    GLuint* parsingPtr;
-    GLuint name_count;
-    GLuint closest_dist = 0xFFFFFFFF;
-    object* unit = NULL;
+    if(objType == OBJ_TYPE_TANK)
+        tanks[index] = tanks[obj_count[objType]];
+    else if(objType == OBJ_TYPE_ATG)
+        atgs[index] = atgs[obj_count[objType]];
+}
+
+/*******************************************************************************
+    function    :   object_handler::delete_at
+    arguments   :   objType - type of object list
+                    index - index of object in list
+    purpose     :   Takes an object out of its list (see remove_at) and out of
+                    the visibility roster, then deletes it.
+    notes       :   <none>
+*******************************************************************************/
+void object_handler::delete_at(int objType, int index)
+{
+    object* obj_ptr = objects[objType][index];
+    
+    //cout << SDL_GetTicks() << ": [" << (unsigned int)obj_ptr << "]: Object handler CATCH removing." << endl;
+    if(objType >= OBJ_TYPE_TANK && objType <= OBJ_TYPE_ATR)
+    {
+        visibility.removeUnit(obj_ptr);
+        comp_dirty = true;
+    }
+    
+    remove_at(objType, index);
+    delete obj_ptr;                     // (virtual deconstructor)
+}
+
+/*******************************************************************************
+    function    :   object_handler::build_components
+    arguments   :   <none>
+    purpose     :   Rebuilds the component lists (crews, motors, sights and
+                    guns) from the unit lists.
+    notes       :   1) Modules are set up by the unit's initializers, after
+                       the unit is added, so lists are built at the next update
+                       rather than in addObject.
+                    2) There is one crew per unit, in unit order, and unit j's
+                       sights and guns are [sight_first[j], sight_first[j+1])
+                       and [gun_first[j], gun_first[j+1]) of their lists.
+*******************************************************************************/
+void object_handler::build_components()
+{
+    int j, k;
+    int size;
+    int sight_total = 0;
+    int gun_total = 0;
     
-    /* Begin OpenGL Selection Mode */
+    // Size lists to fit the largest
+    for(j = 0; j < obj_count[OBJ_TYPE_TANK]; j++)
+    {
+        sight_total += tanks[j]->sight_count;
+        gun_total += tanks[j]->gun_count;
+    }
+    for(j = 0; j < obj_count[OBJ_TYPE_ATG]; j++)
+    {
+        sight_total += atgs[j]->sight_count;
+        gun_total += atgs[j]->gun_count;
+    }
     
-    // Initialize a selection buffer
-    glSelectBuffer(64, buffer);
+    size = obj_count[OBJ_TYPE_TANK] + obj_count[OBJ_TYPE_ATG];
+    if(sight_total > size)
+        size = sight_total;
+    if(gun_total > size)
+        size = gun_total;
     
-    // Change rendering mode to the selection mode
-    glRenderMode(GL_SELECT);
+    if(crews == NULL || size > comp_max)
+    {
+        delete [] crews;
+        delete [] motors;
+        delete [] sights;
+        delete [] guns;
+        delete [] sight_first;
+        delete [] gun_first;
+        
+        comp_max = size * 2;
+        crews = new crew_module* [comp_max];
+        motors = new motor_device* [comp_max];
+        sights = new sight_device* [comp_max];
+        guns = new gun_device* [comp_max];
+        sight_first = new int[comp_max + 1];
+        gun_first = new int[comp_max + 1];
+    }
     
-    // Save current modelview and projection matricies
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
+    // Fill lists (tanks, then ATGs)
+    crew_count = motor_count = sight_count = gun_count = 0;
     
-    // Set up new projection matrix for clipping
-    glLoadIdentity();
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    gluPickMatrix(x, viewport[3] - y, 5, 5, viewport);
-    camera.orient(false);   // Do NOT update frustum culling
+    for(j = 0; j < obj_count[OBJ_TYPE_TANK]; j++)
+    {
+        sight_first[crew_count] = sight_count;
+        gun_first[crew_count] = gun_count;
+        crews[crew_count++] = &(tanks[j]->crew);
+        motors[motor_count++] = &(tanks[j]->motor);
+        for(k = 0; k < tanks[j]->sight_count; k++)
+            sights[sight_count++] = &(tanks[j]->sight[k]);
+        for(k = 0; k < tanks[j]->gun_count; k++)
+            guns[gun_count++] = &(tanks[j]->gun[k]);
+    }
     
-    // Initialize OpenGL name stack
-    glInitNames();
+    for(j = 0; j < obj_count[OBJ_TYPE_ATG]; j++)
+    {
+        sight_first[crew_count] = sight_count;
+        gun_first[crew_count] = gun_count;
+        crews[crew_count++] = &(atgs[j]->crew);
+        for(k = 0; k < atgs[j]->sight_count; k++)
+            sights[sight_count++] = &(atgs[j]->sight[k]);
+        for(k = 0; k < atgs[j]->gun_count; k++)
+            guns[gun_count++] = &(atgs[j]->gun[k]);
+    }
     
-    // Switch back to modelview for displaying
-    glMatrixMode(GL_MODELVIEW);
+    // Ends of last unit's ranges
+    sight_first[crew_count] = sight_count;
+    gun_first[crew_count] = gun_count;
     
-    // Draw objects
-    for(i = OBJ_TYPE_TANK; i <= OBJ_TYPE_ATR; i++)
-        if(objects[i])
-            for(j = k = 0; k < obj_count[i]; j++)
-                if(objects[i][j] != NULL)
-                {
-                    (dynamic_cast<unit_object*>(objects[i][j]))->displayForSelection();
-                    k++;
-                }
+    comp_dirty = false;
+}
+
+/*******************************************************************************
+    Handle Routines
+*******************************************************************************/
+
+/*******************************************************************************
+    function    :   unsigned int object_handler::new_handle
+    arguments   :   objPtr - object to give a handle to
+    purpose     :   Places an object into a handle slot, returning its handle
+                    (or OBJ_HANDLE_NONE if out of handles).
+    notes       :   A handle is the slot number (plus one, so that no handle is
+                    zero) in the low bits and the slot's generation in the
+                    high bits. Freed slots are reused first.
+*******************************************************************************/
+unsigned int object_handler::new_handle(object* objPtr)
+{
+    obj_slot* list;
+    int slot;
+    int i;
     
-    // Be sure to complete all rendering commands
-    glFlush();
+    if(slot_free != -1)
+    {
+        slot = slot_free;
+        slot_free = slots[slot].next_free;
+    }
+    else
+    {
+        if(slot_count >= OBJ_HANDLE_SLOT_MASK)
+        {
+            write_error("Obj: Out of object handles.");
+            return OBJ_HANDLE_NONE;
+        }
+        
+        // Grow slots if full
+        if(slot_count >= slot_max)
+        {
+            list = new obj_slot[slot_max * 2];
+            for(i = 0; i < slot_count; i++)
+                list[i] = slots[i];
+            
+            delete [] slots;
+            slots = list;
+            slot_max *= 2;
+        }
+        
+        slot = slot_count++;
+        slots[slot].generation = 1;
+    }
+    
+    slots[slot].obj_ptr = objPtr;
+    slots[slot].next_free = -1;
+    
+    return (slots[slot].generation << OBJ_HANDLE_SLOT_BITS) | (slot + 1);
+}
+
+/*******************************************************************************
+    function    :   object_handler::free_handle
+    arguments   :   handle - handle to free
+    purpose     :   Frees an object's handle slot, so that the handle (and any
+                    copies of it) no longer resolve.
+    notes       :   <none>
+*******************************************************************************/
+void object_handler::free_handle(unsigned int handle)
+{
+    int slot = (int)(handle & OBJ_HANDLE_SLOT_MASK) - 1;
     
-    // Restore projection and modelview matricies
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
+    if(slot < 0 || slot >= slot_count)
+        return;
     
-    // Return to normal rendering mode, returning the number of hits recorded
-    hits = glRenderMode(GL_RENDER);
+    slots[slot].obj_ptr = NULL;
+    if(++slots[slot].generation >= OBJ_HANDLE_GENERATIONS)
+        slots[slot].generation = 1;
     
-    /* OpenGL Selection Mode Now Finished */
+    slots[slot].next_free = slot_free;
+    slot_free = slot;
+}
+
+/*******************************************************************************
+    function    :   object* object_handler::getObject
+    arguments   :   handle - object handle
+    purpose     :   Returns the object with the given handle, or NULL if the
+                    object has since been removed.
+    notes       :   <none>
+*******************************************************************************/
+object* object_handler::getObject(unsigned int handle)
+{
+    int slot = (int)(handle & OBJ_HANDLE_SLOT_MASK) - 1;
     
-    // Check for no hits - return NULL if so.
-    if(hits <= 0)
+    if(slot < 0 || slot >= slot_count ||
+       slots[slot].generation != (handle >> OBJ_HANDLE_SLOT_BITS))
         return NULL;
     
-    // Start our parsing pointer at the top of the buffer
-    parsingPtr = buffer;
+    return slots[slot].obj_ptr;
+}
+
+/*******************************************************************************
+    Object Grabbing Routines
+*******************************************************************************/
+
+/*******************************************************************************
+    function    :   object_handler::getUnitAt
+    arguments   :   x,y - screen coordinates to perform selection on
+    purpose     :   Grabs a unit based on the given mouse coordinates on the
+                    screen. Returns NULL if no object satisfies selection.
+    notes       :   1) Casts a ray from the camera through the screen point
+                       and checks it against each unit's selection box.
+                    2) Chooses object closest to view camera if multiple
+                       objects are struck by the ray.
+*******************************************************************************/
+object* object_handler::getUnitAt(int x, int y)
+{
+    int i, j;
+    kVector ray_pos = camera.getCamPosV();
+    kVector ray_dir = normalized(camera.vectorAt(x, y));
+    float closest_dist = 1.0e30;
+    float curr_dist;
+    object* unit = NULL;
     
-    // Parse buffer
-    for(; hits > 0; hits--)
-    {
-        name_count = *parsingPtr;   // Get name count for this hit record
-        
-        if(name_count == 0)
-            parsingPtr += 3;        // Go to next record
-        else
-        {
-            parsingPtr++;           // Go to min depth for hit
-            
-            // Check to see for better min depth
-            if(*parsingPtr < closest_dist)
+    // Check ray against objects
+    for(i = OBJ_TYPE_TANK; i <= OBJ_TYPE_ATR; i++)
+        if(objects[i])
+            for(j = 0; j < obj_count[i]; j++)
             {
-                closest_dist = *parsingPtr;     // Copy over min distance
-                parsingPtr += 2;                // Skip over min & max
-                
-                unit = (object*)(*parsingPtr);  // Assign name (a ptr) to unit
-                
-                parsingPtr += name_count;       // Skip over names
+                if((dynamic_cast<unit_object*>(objects[i][j]))->
+                    checkSelectionRay(ray_pos, ray_dir, curr_dist) &&
+                   curr_dist < closest_dist)
+                {
+                    closest_dist = curr_dist;
+                    unit = objects[i][j];
+                }
             }
-            else
-                parsingPtr += 2 + name_count;   // Skip over min, max, & names
-        }
-    }
     
     return unit;
 }
@@ -493,7 +763,7 @@ object* object_handler::getUnitAt(int x, int y)
 *******************************************************************************/
 object* object_handler::getUnitNear(kVector pos, float distanceTolerance)
 {
-    int i, j, k;
+    int i, j;
     float closest_dist = (distanceTolerance * distanceTolerance) - FP_ERROR;
     float curr_dist;
     object* unit = NULL;
@@ -501,26 +771,23 @@ object* object_handler::getUnitNear(kVector pos, float distanceTolerance)
     // Go through each unit level looking for an object
     for(i = OBJ_TYPE_TANK; i <= OBJ_TYPE_ATR; i++)
         if(objects[i])
-            for(j = k = 0; k < obj_count[i]; j++)
-                if(objects[i][j] != NULL)
+            for(j = 0; j < obj_count[i]; j++)
+            {
+                // Compute manhattan distance to this object
+                curr_dist = ((objects[i][j]->pos[2] - pos[2]) *
+                                (objects[i][j]->pos[2] - pos[2])) +
+                            ((objects[i][j]->pos[1] - pos[1]) *
+                                (objects[i][j]->pos[1] - pos[1])) +
+                            ((objects[i][j]->pos[0] - pos[0]) *
+                                (objects[i][j]->pos[0] - pos[0]));
+                
+                // See if it is better than what we currently have
+                if(curr_dist < closest_dist)
                 {
-                    // Compute manhattan distance to this object
-                    curr_dist = ((objects[i][j]->pos[2] - pos[2]) *
-                                    (objects[i][j]->pos[2] - pos[2])) +
-                                ((objects[i][j]->pos[1] - pos[1]) *
-                                    (objects[i][j]->pos[1] - pos[1])) +
-                                ((objects[i][j]->pos[0] - pos[0]) *
-                                    (objects[i][j]->pos[0] - pos[0]));
-                    
-                    // See if it is better than what we currently have
-                    if(curr_dist < closest_dist)
-                    {
-                        closest_dist = curr_dist;
-                        unit = objects[i][j];
-                    }
-                    
-                    k++;
+                    closest_dist = curr_dist;
+                    unit = objects[i][j];
                 }
+            }
     
     return unit;
 }
@@ -534,20 +801,17 @@ object* object_handler::getUnitNear(kVector pos, float distanceTolerance)
 *******************************************************************************/
 object* object_handler::getUnitWithID(char* idTag)
 {
-    int i, j, k;
+    int i, j;
     
     // Go through each unit level looking for the said object
     for(i = OBJ_TYPE_TANK; i <= OBJ_TYPE_ATR; i++)
         if(objects[i])
-            for(j = k = 0; k < obj_count[i]; j++)
-                if(objects[i][j] != NULL)
-                {
-                    // See if this is our unit
-                    if(strcmp((dynamic_cast<unit_object*>(objects[i][j]))->obj_id, idTag) == 0)
-                        return objects[i][j];
-                    
-                    k++;
-                }
+            for(j = 0; j < obj_count[i]; j++)
+            {
+                // See if this is our unit
+                if(strcmp((dynamic_cast<unit_object*>(objects[i][j]))->obj_id, idTag) == 0)
+                    return objects[i][j];
+            }
     
     // No unit found
     return NULL;
@@ -561,7 +825,9 @@ object* object_handler::getUnitWithID(char* idTag)
                     of a rectangular selection window on the screen. Always
                     will return a newly allocated object list, of which *may*
                     be empty.
-    notes       :   1) Relies on the OpenGL selection buffer.
+    notes       :   1) Builds the four side planes of the sub-frustum formed
+                       by the camera and the selection window, and checks each
+                       unit's bounding sphere against them.
                     2) Returns a NEW allocation, which must be deleted later.
                     3) The object list contains ALL objects in the rectangular
                        selection window, regardless of their type or alignment.
@@ -569,95 +835,56 @@ object* object_handler::getUnitWithID(char* idTag)
 *******************************************************************************/
 object_list* object_handler::getUnitsAt(int x_min, int y_min, int x_max, int y_max)
 {
-    GLuint buffer[64];
-    GLint viewport[4];
-    int hits;
-    
-    int i, j, k;
-    
-    GLuint* parsingPtr;
-    GLuint name_count;
+    int i, j;
+    kVector cam_pos = camera.getCamPosV();
+    kVector corner[4];
+    kVector normal;
+    kVector center;
+    float planes[4][4];
     object_list* list = new object_list;
     
-    /* Begin OpenGL Selection Mode */
-    
-    // Initialize a selection buffer
-    glSelectBuffer(64, buffer);
-    
-    // Change rendering mode to the selection mode
-    glRenderMode(GL_SELECT);
-    
-    // Save current modelview and projection matricies
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    
-    // Set up new projection matrix for clipping
-    glLoadIdentity();
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    gluPickMatrix((x_min + x_max) / 2,                  // Fun little trick heh
-                  viewport[3] - ((y_min + y_max) / 2),
-                  abs(x_max - x_min),
-                  abs(y_max - y_min),
-                  viewport);
-    camera.orient(false);   // Do NOT update frustum culling
+    // Make sure window is ordered (drags may go either way)
+    if(x_min > x_max)
+    {
+        i = x_min; x_min = x_max; x_max = i;
+    }
+    if(y_min > y_max)
+    {
+        i = y_min; y_min = y_max; y_max = i;
+    }
     
-    // Initialize OpenGL name stack
-    glInitNames();
+    // Corner rays of selection window (clockwise around the window)
+    corner[0] = camera.vectorAt(x_min, y_min);
+    corner[1] = camera.vectorAt(x_max, y_min);
+    corner[2] = camera.vectorAt(x_max, y_max);
+    corner[3] = camera.vectorAt(x_min, y_max);
+    center = camera.vectorAt((x_min + x_max) / 2, (y_min + y_max) / 2);
     
-    // Switch back to modelview for displaying
-    glMatrixMode(GL_MODELVIEW);
+    // Build side planes through the camera, facing inward
+    for(i = 0; i < 4; i++)
+    {
+        normal = crossProduct(corner[i], corner[(i + 1) % 4]);
+        if(magnitude(normal) <= FP_ERROR)
+            return list;                // Degenerate (zero-sized) window
+        normal.normalize();
+        if(dotProduct(normal, center) < 0.0)
+            normal = normal * -1.0f;
+        
+        planes[i][0] = normal[0];
+        planes[i][1] = normal[1];
+        planes[i][2] = normal[2];
+        planes[i][3] = -dotProduct(normal, cam_pos);
+    }
     
-    // Draw objects
+    // Check objects against selection volume
     for(i = OBJ_TYPE_TANK; i <= OBJ_TYPE_ATR; i++)
         if(objects[i])
-            for(j = k = 0; k < obj_count[i]; j++)
-                if(objects[i][j] != NULL)
-                {
-                    (dynamic_cast<unit_object*>(objects[i][j]))->displayForSelection();
-                    k++;
-                }
-    
-    // Be sure to complete all rendering commands
-    glFlush();
-    
-    // Restore projection and modelview matricies
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
-    
-    // Return to normal rendering mode, returning the number of hits recorded
-    hits = glRenderMode(GL_RENDER);
-    
-    /* OpenGL Selection Mode Now Finished */
-    
-    // Check for no hits - return if so.
-    if(hits <= 0)
-        return list;
-    
-    // Start our parsing pointer at the top of the buffer
-    parsingPtr = buffer;
-    
-    // Parse buffer
-    for(; hits > 0; hits--)
-    {
-        name_count = *parsingPtr;   // Get name count for this hit record
-        
-        if(name_count == 0)
-            parsingPtr += 3;        // Go to next hit record
-        else
-        {
-            parsingPtr += 3;        // Skip over count, min, & max
-            
-            for(; name_count > 0; name_count--)
+            for(j = 0; j < obj_count[i]; j++)
             {
-                list->add((object*)(*parsingPtr));   // Add names (ptrs) to list
-                parsingPtr++;                       // Next element
+                if((dynamic_cast<unit_object*>(objects[i][j]))->
+                    checkSelectionVolume(planes, 4))
+                    list->add(objects[i][j]);
             }
-        }
-    }
     
     return list;
 }
@@ -675,27 +902,24 @@ object_list* object_handler::getUnitsAt(int x_min, int y_min, int x_max, int y_m
 *******************************************************************************/
 object_list* object_handler::getUnitsNear(kVector pos, float distanceTolerance)
 {
-    int i, j, k;
+    int i, j;
     float tolerance = (distanceTolerance * distanceTolerance) - FP_ERROR;
     object_list* list = new object_list;
     
     // Go through each unit level looking for any objects that satisfy tolerance
     for(i = OBJ_TYPE_TANK; i <= OBJ_TYPE_ATR; i++)
         if(objects[i])
-            for(j = k = 0; k < obj_count[i]; j++)
-                if(objects[i][j] != NULL)
-                {
-                    // Compute manhattan distance to this object & check
-                    if(((objects[i][j]->pos[2] - pos[2]) *
-                            (objects[i][j]->pos[2] - pos[2])) +
-                        ((objects[i][j]->pos[1] - pos[1]) *
-                            (objects[i][j]->pos[1] - pos[1])) +
-                        ((objects[i][j]->pos[0] - pos[0]) *
-                            (objects[i][j]->pos[0] - pos[0])) <= tolerance)
-                        list->fastAdd(objects[i][j]);
-                    
-                    k++;
-                }
+            for(j = 0; j < obj_count[i]; j++)
+            {
+                // Compute manhattan distance to this object & check
+                if(((objects[i][j]->pos[2] - pos[2]) *
+                        (objects[i][j]->pos[2] - pos[2])) +
+                    ((objects[i][j]->pos[1] - pos[1]) *
+                        (objects[i][j]->pos[1] - pos[1])) +
+                    ((objects[i][j]->pos[0] - pos[0]) *
+                        (objects[i][j]->pos[0] - pos[0])) <= tolerance)
+                    list->fastAdd(objects[i][j]);
+            }
     
     return list;
 }
@@ -712,21 +936,18 @@ object_list* object_handler::getUnitsNear(kVector pos, float distanceTolerance)
 *******************************************************************************/
 object_list* object_handler::getUnitsWithID(char* idTag)
 {
-    int i, j, k;
+    int i, j;
     object_list* list = new object_list;
     
     // Go through each unit level looking for the said object
     for(i = OBJ_TYPE_TANK; i <= OBJ_TYPE_ATR; i++)
         if(objects[i])
-            for(j = k = 0; k < obj_count[i]; j++)
-                if(objects[i][j] != NULL)
-                {
-                    // See if this satisfies the id tag sub string
-                    if(strstr((dynamic_cast<unit_object*>(objects[i][j]))->obj_id, idTag) != NULL)
-                        list->fastAdd(objects[i][j]);
-                    
-                    k++;
-                }
+            for(j = 0; j < obj_count[i]; j++)
+            {
+                // See if this satisfies the id tag sub string
+                if(strstr((dynamic_cast<unit_object*>(objects[i][j]))->obj_id, idTag) != NULL)
+                    list->fastAdd(objects[i][j]);
+            }
     
     return list;
 }
@@ -743,8 +964,8 @@ object_list* object_handler::getUnitsWithID(char* idTag)
                     excludeObjPtr - Ptr to object to exclude (otherwise NULL)
     purpose     :   Sets up a collision detection test list for the said object
                     using the provided angle tolerance and AABB area.
-    notes       :   Allocates new memory which must be deleted later using the
-                    killCDTL function.
+    notes       :   Nodes come from the CDTL pool and must be released later
+                    using the killCDTL function.
 *******************************************************************************/
 cdtl_node* object_handler::createCDTL(object* objPtr, float angleTolerance = 15.0f,
     float AABBTolerance = 20.0f, object* excludeObjPtr = NULL)
@@ -752,7 +973,7 @@ cdtl_node* object_handler::createCDTL(object* objPtr, float angleTolerance = 15.
     kVector dir;
     cdtl_node* cdtl_head = NULL;
     cdtl_node* cdtl_tail = NULL;
-    int list, obj, objcnt;
+    int list, obj;
     float init_yaw;
     float x_diff, z_diff;
     
@@ -764,47 +985,43 @@ cdtl_node* object_handler::createCDTL(object* objPtr, float angleTolerance = 15.
     {
         if(objects[list])
         {
-            for(obj = objcnt = 0; objcnt < obj_count[list]; obj++)
+            for(obj = 0; obj < obj_count[list]; obj++)
             {
-                if(objects[list][obj] != NULL)
+                if(objects[list][obj] != excludeObjPtr)
                 {
-                    if(objects[list][obj] != excludeObjPtr)
+                    // Gather data about this object (AABB first then angle)
+                    dir = objects[list][obj]->pos - objPtr->pos;
+                    x_diff = fabsf(dir[0]);
+                    z_diff = fabsf(dir[2]);
+                    dir.convertTo(CS_YAW_ONLY);
+                    init_yaw = dir[2];
+                    dir = dir - objPtr->dir.vectorIn(CS_YAW_ONLY);
+                    
+                    // Normalize direction
+                    if(dir[2] < -PI)
+                        dir[2] += TWOPI;
+                    if(dir[2] > PI)
+                        dir[2] -= TWOPI;
+                    
+                    // Check to see if we should add this to the CDTL
+                    if(fabsf(dir[2]) <= angleTolerance ||
+                       x_diff <= AABBTolerance || z_diff <= AABBTolerance)
                     {
-                        // Gather data about this object (AABB first then angle)
-                        dir = objects[list][obj]->pos - objPtr->pos;
-                        x_diff = fabsf(dir[0]);
-                        z_diff = fabsf(dir[2]);
-                        dir.convertTo(CS_YAW_ONLY);
-                        init_yaw = dir[2];
-                        dir = dir - objPtr->dir.vectorIn(CS_YAW_ONLY);
-                        
-                        // Normalize direction
-                        if(dir[2] < -PI)
-                            dir[2] += TWOPI;
-                        if(dir[2] > PI)
-                            dir[2] -= TWOPI;
-                        
-                        // Check to see if we should add this to the CDTL
-                        if(fabsf(dir[2]) <= angleTolerance ||
-                           x_diff <= AABBTolerance || z_diff <= AABBTolerance)
+                        if(cdtl_head == NULL)
+                        {
+                            cdtl_head = new_cdtl();
+                            cdtl_tail = cdtl_head;
+                        }
+                        else
                         {
-                            if(cdtl_head == NULL)
-                            {
-                                cdtl_head = new cdtl_node;
-                                cdtl_tail = cdtl_head;
-                            }
-                            else
-                            {
-                                cdtl_tail->next = new cdtl_node;
-                                cdtl_tail = cdtl_tail->next;
-                            }
-                            
-                            cdtl_tail->obj_ptr = objects[list][obj];
-                            cdtl_tail->init_yaw = init_yaw;
-                            cdtl_tail->next = NULL;
+                            cdtl_tail->next = new_cdtl();
+                            cdtl_tail = cdtl_tail->next;
                         }
+                        
+                        cdtl_tail->obj_ptr = objects[list][obj];
+                        cdtl_tail->init_yaw = init_yaw;
+                        cdtl_tail->next = NULL;
                     }
-                    objcnt++;
                 }
             }
         }
@@ -816,8 +1033,8 @@ cdtl_node* object_handler::createCDTL(object* objPtr, float angleTolerance = 15.
 /*******************************************************************************
     function    :   cdtl_node* object_handler::killCDTL
     arguments   :   objPtr - pointer to object
-    purpose     :   Deallocates memory allocated through usage of the createCDTL
-                    function.
+    purpose     :   Releases nodes obtained through usage of the createCDTL
+                    function back to the CDTL pool.
     notes       :   <none>
 *******************************************************************************/
 void object_handler::killCDTL(object* objPtr)
@@ -829,12 +1046,63 @@ void object_handler::killCDTL(object* objPtr)
         while(((proj_object*)objPtr)->cdtl_head != NULL)
         {
             ((proj_object*)objPtr)->cdtl_head = ((proj_object*)objPtr)->cdtl_head->next;
-            delete curr;
+            free_cdtl(curr);
             curr = ((proj_object*)objPtr)->cdtl_head;
         }
     }
 }
 
+/*******************************************************************************
+    function    :   int object_handler::getCDTargets
+    arguments   :   targets - array to fill with object pointers
+                    maxTargets - size of targets array
+    purpose     :   Fills the given array with every object a projectile can
+                    collide with (the same objects createCDTL looks through),
+                    returning how many there are.
+    notes       :   1) Used by the MG bullet pool, which does its own testing.
+                    2) If more objects exist than fit in the array, only the
+                       first maxTargets are filled in, but the full count is
+                       still returned (so the caller may grow its array and
+                       ask again).
+*******************************************************************************/
+int object_handler::getCDTargets(object** targets, int maxTargets)
+{
+    int list, obj;
+    int count = 0;
+    
+    for(list = 0; list < OBJ_TYPE_PROJECTILE; list++)
+        if(objects[list])
+            for(obj = 0; obj < obj_count[list]; obj++)
+            {
+                if(count < maxTargets)
+                    targets[count] = objects[list][obj];
+                count++;
+            }
+    
+    return count;
+}
+
+/*******************************************************************************
+    function    :   cdtl_node* object_handler::new_cdtl
+    arguments   :   <none>
+    purpose     :   Grabs a CDTL node from the CDTL pool.
+    notes       :   Every shell fired builds a CDTL, so nodes are recycled
+                    through a free list rather than being allocated and deleted
+                    per shell. The pool only grows when it runs dry.
+*******************************************************************************/
+cdtl_node* object_handler::new_cdtl()
+{
+    cdtl_node* node;
+    
+    if(cdtl_free == NULL)
+        return new cdtl_node;
+    
+    node = cdtl_free;
+    cdtl_free = cdtl_free->next;
+    
+    return node;
+}
+
 /*******************************************************************************
     function    :   object_handler::cdObjPass
     arguments   :   startList - array index to start at
@@ -844,291 +1112,469 @@ void object_handler::killCDTL(object* objPtr)
 *******************************************************************************/
 void object_handler::cdObjPass(int startList, int endList)
 {
-    int list1, list2, obj1, objcnt1, obj2, objcnt2;
+    int list1, list2, obj1, obj2;
     
     for(list1 = startList; list1 <= endList; list1++)
     {
       if(objects[list1])
       {
-        for(obj1 = objcnt1 = 0; objcnt1 < obj_count[list1]; obj1++)
+        for(obj1 = 0; obj1 < obj_count[list1]; obj1++)
         {
-          if(objects[list1][obj1] != NULL)
+          for(list2 = list1; list2 < OBJ_TYPE_PROJECTILE; list2++)
           {
-            for(list2 = list1; list2 < OBJ_TYPE_PROJECTILE; list2++)
+            if(objects[list2])
             {
-              if(objects[list2])
+              for(obj2 = (list1 != list2 ? 0 : obj1 + 1);
+                  obj2 < obj_count[list2]; obj2++)
               {
-                if(list1 != list2)
-                {
-                  obj2 = 0;
-                  objcnt2 = 0;
-                }
-                else
+                if(cdr_checkCS(objects[list1][obj1], objects[list2][obj2]))
                 {
-                  obj2 = obj1 + 1;
-                  objcnt2 = objcnt1 + 1;
-                }
-                for(; objcnt2 < obj_count[list2]; obj2++)
-                {
-                  if(objects[list2][obj2] != NULL)
-                  {
-                    if(cdr_checkCS(objects[list1][obj1], objects[list2][obj2]))
-                    {
-                      if(cdr_checkIABB(objects[list1][obj1], objects[list2][obj2]))
-                          cdr.handle(objects[list1][obj1], objects[list2][obj2]);
-                    }
-                    objcnt2++;
-                  }
+                  if(cdr_checkOBB(objects[list1][obj1], objects[list2][obj2]))
+                      cdr.handle(objects[list1][obj1], objects[list2][obj2]);
                 }
               }
             }
-            objcnt1++;
           }
         }
       }
     }
 }
 
+/*******************************************************************************
+    function    :   object_handler::cdp_resize
+    arguments   :   size - new size of pass buffers
+    purpose     :   Reallocates the pass buffers (projectiles, and the hit and
+                    dropped CDTL nodes of each) to the given size, as the
+                    projectile list grows.
+    notes       :   Only called between passes.
+*******************************************************************************/
+void object_handler::cdp_resize(int size)
+{
+    int i;
+    
+    if(cdp_proj)
+    {
+        delete [] cdp_proj;
+        delete [] cdp_hit_obj;
+        delete [] cdp_hit_report;
+        delete [] cdp_released;
+    }
+    
+    cdp_size = size;
+    cdp_proj = new object* [cdp_size];
+    cdp_hit_obj = new object* [cdp_size];
+    cdp_hit_report = new cd_data[cdp_size];
+    cdp_released = new cdtl_node* [cdp_size];
+    
+    for(i = 0; i < cdp_size; i++)
+    {
+        cdp_hit_obj[i] = NULL;
+        cdp_released[i] = NULL;
+    }
+}
+
+/*******************************************************************************
+    function    :   object_handler::cdp_check
+    arguments   :   item - pass projectile to check
+    purpose     :   Runs the narrow phase for a projectile, walking its CDTL
+                    just as the serial pass did. The first collision found is
+                    recorded as the projectile's hit and ends its walk. CDTL
+                    nodes which are dropped (missed, or turned away from) are
+                    unlinked onto the projectile's dropped list.
+    notes       :   1) Only the projectile's own CDTL and its own entries of
+                       the pass buffers are written, everything else is only
+                       read (mesh checks make no GL calls), so projectiles may
+                       be checked on worker threads.
+                    2) ACNs and the CDTL pool are not touched here, those are
+                       handled in the merge (see cdProjPass).
+*******************************************************************************/
+void object_handler::cdp_check(int item)
+{
+    proj_object* proj_ptr = (proj_object*)cdp_proj[item];
+    cdtl_node* prev = NULL;
+    cdtl_node* curr = proj_ptr->cdtl_head;
+    kVector dir;
+    bool remove_node;
+    
+    cdp_hit_obj[item] = NULL;
+    
+    while(curr)
+    {
+        remove_node = false;
+        
+        // Check against the collision sphere of the object
+        if(cdr_checkCS(proj_ptr, (object*)curr->obj_ptr))
+        {
+            // Run a check meshes against this object and record the hit
+            // (if collision happens).
+            if(cdr.checkMeshes(proj_ptr, curr->obj_ptr, CD_T_OFFSET,
+                CD_EXCLUDE_NO_MESHES, cdp_hit_report[item]))
+            {
+                cdp_hit_obj[item] = curr->obj_ptr;
+                
+                // Also break out of while loop since we're done testing
+                // for this object on this trip.
+                break;
+            }
+            else
+                // Remove this node (since it didn't hit)
+                remove_node = true;
+        }
+        else
+        {
+            // Take an angle measurement to help determine if we need to
+            // remove any objects from the CDTL.
+            dir = vectorIn(((object*)curr->obj_ptr)->pos - proj_ptr->pos,
+                CS_YAW_ONLY);
+            dir[2] = dir[2] - curr->init_yaw;
+            
+            if(dir[2] < -PI)
+                dir[2] += TWOPI;
+            if(dir[2] > PI)
+                dir[2] -= TWOPI;
+        }
+        
+        // See if this node needs removed from the CDTL.
+        if(remove_node || fabsf(dir[2]) >= PIHALF)
+        {
+            if(prev == NULL)
+                proj_ptr->cdtl_head = curr->next;
+            else
+                prev->next = curr->next;
+            
+            curr->next = cdp_released[item];
+            cdp_released[item] = curr;
+            
+            curr = (prev == NULL ? proj_ptr->cdtl_head : prev->next);
+            continue;
+        }
+        
+        prev = curr;
+        curr = curr->next;
+    }
+}
+
 /*******************************************************************************
     function    :   object_handler::cdProjPass
     arguments   :   <none>
     purpose     :   Passes all projectiles currently in system through CDR.
-    notes       :   <none>
+    notes       :   1) The narrow phase of each projectile with a CDTL is run
+                       on the job system, one projectile per item (see
+                       cdp_check).
+                    2) Hits are then merged on the main thread in projectile
+                       order, killing each projectile's CDTL and adding its
+                       ACN into the CDR engine, so results do not depend on
+                    3) The pass has batch semantics: every projectile is
+                       checked before any hit is handled. A hit which is due
+                       at once (and so handled right away by addACN) cannot
+                       change what a later projectile of the same pass hits,
+                       and ricochets added while hits are handled are first
+                       checked on the next pass. A pass checking and handling
+                       one projectile at a time would allow both.
 *******************************************************************************/
 void object_handler::cdProjPass()
 {
-    int obj, objcnt;
-    cdtl_node* prev;
+    int obj;
+    int i;
     cdtl_node* curr;
-    ac_node* ACN;
-    kVector dir;
-    bool remove_node;
+    proj_object* proj_ptr;
     
-    if(objects[OBJ_TYPE_PROJECTILE])
+    if(objects[OBJ_TYPE_PROJECTILE] == NULL)
+        return;
+    
+    // Keep pass buffers as large as the projectile list
+    if(cdp_size < obj_max[OBJ_TYPE_PROJECTILE])
+        cdp_resize(obj_max[OBJ_TYPE_PROJECTILE]);
+    
+    // Gather projectiles which have something to test against
+    cdp_count = 0;
+    for(obj = 0; obj < obj_count[OBJ_TYPE_PROJECTILE]; obj++)
+        if(((proj_object*)(objects[OBJ_TYPE_PROJECTILE][obj]))->cdtl_head != NULL)
+            cdp_proj[cdp_count++] = objects[OBJ_TYPE_PROJECTILE][obj];
+    
+    if(cdp_count == 0)
+        return;
+    
+    // Run narrow phase
+    jobs.run(job_cd_projectile, (void*)this, cdp_count, 0.0);
+    
+    // Merge hits in projectile order
+    for(i = 0; i < cdp_count; i++)
     {
-        for(obj = objcnt = 0; objcnt < obj_count[OBJ_TYPE_PROJECTILE]; obj++)
+        // Return dropped CDTL nodes to the pool
+        while(cdp_released[i])
         {
-            if(objects[OBJ_TYPE_PROJECTILE][obj] != NULL)
-            {
-                if(((proj_object*)(objects[OBJ_TYPE_PROJECTILE][obj]))->cdtl_head != NULL)
-                {
-                    curr = ((proj_object*)(objects[OBJ_TYPE_PROJECTILE][obj]))->cdtl_head;
-                    prev = NULL;
-                    
-                    while(curr)
-                    {
-                        remove_node = false;
-                        
-                        // Check against the collision sphere of the object
-                        if(cdr_checkCS(objects[OBJ_TYPE_PROJECTILE][obj],
-                                       (object*)curr->obj_ptr))
-                        {
-                            // Run a check meshes against this object and get
-                            // an ACN back (if collision happens).
-                            ACN = cdr.checkMeshes(
-                                objects[OBJ_TYPE_PROJECTILE][obj], curr->obj_ptr,
-                                CD_T_OFFSET, CD_EXCLUDE_NO_MESHES);
-                            
-                            // Check for collision
-                            if(ACN != NULL)
-                            {
-                                // Kill testing list before adding in the ACN
-                                // so that the ACN handler, if kicking in,
-                                // can create a new list.
-                                killCDTL(objects[OBJ_TYPE_PROJECTILE][obj]);
-                                
-                                // Add ACN into CDR engine
-                                cdr.addACN(ACN);
-                                
-                                // Also break out of while loop since we're
-                                // done testing for this object on this trip.
-                                break;
-                            }
-                            else
-                                // Remove this node (since it didn't hit)
-                                remove_node = true;
-                        }
-                        else
-                        {
-                            // Take an angle measurement to help determine if
-                            // we need to remove any objects from the CDTL.
-                            dir = vectorIn(((object*)curr->obj_ptr)->pos -
-                                objects[OBJ_TYPE_PROJECTILE][obj]->pos,
-                                CS_YAW_ONLY);
-                            dir[2] = dir[2] - curr->init_yaw;
-                            
-                            if(dir[2] < -PI)
-                                dir[2] += TWOPI;
-                            if(dir[2] > PI)
-                                dir[2] -= TWOPI;
-                        }
-                        
-                        // See if this node needs removed from the CDTL.
-                        if(remove_node || fabsf(dir[2]) >= PIHALF)
-                        {
-                            if(prev == NULL)
-                            {
-                                ((proj_object*)(objects[OBJ_TYPE_PROJECTILE][obj]))->cdtl_head =
-                                    ((proj_object*)(objects[OBJ_TYPE_PROJECTILE][obj]))->cdtl_head->next;
-                                delete curr;
-                                curr = ((proj_object*)(objects[OBJ_TYPE_PROJECTILE][obj]))->cdtl_head;
-                                continue;
-                            }
-                            else
-                            {
-                                prev->next = curr->next;
-                                delete curr;
-                                curr = prev->next;
-                                continue;
-                            }
-                        }
-                        
-                        prev = curr;
-                        curr = curr->next;
-                    }
-                }
-                objcnt++;
-            }
+            curr = cdp_released[i];
+            cdp_released[i] = curr->next;
+            free_cdtl(curr);
         }
+        
+        if(cdp_hit_obj[i] == NULL)
+            continue;
+        
+        proj_ptr = (proj_object*)cdp_proj[i];
+        
+        // Kill testing list before adding in the ACN so that the ACN
+        // handler, if kicking in, can create a new list.
+        killCDTL(proj_ptr);
+        
+        // Add ACN into CDR engine
+        cdr.addACN(cdr.buildACN(proj_ptr, cdp_hit_obj[i], cdp_hit_report[i]));
+        cdp_hit_obj[i] = NULL;
     }
 }
 
 /*******************************************************************************
-    function    :   object_handler::update
-    arguments   :   deltaT - number of seconds elapsed since last update
-    purpose     :   Base object handler update.
+    function    :   object_handler::job_crew
+    arguments   :   data - Object handler (object_handler*)
+                    item - Unit (index of crew list)
+                    deltaT - number of seconds elapsed since last update
+    purpose     :   Update job: crew of a unit.
     notes       :   <none>
 *******************************************************************************/
-void object_handler::update(float deltaT)
+void object_handler::job_crew(void* data, int item, float deltaT)
+{
+    ((object_handler*)data)->crews[item]->update(deltaT);
+}
+
+/*******************************************************************************
+    function    :   object_handler::job_waypoints
+    arguments   :   data - Object handler (object_handler*)
+                    item - Tank (index of tank list)
+                    deltaT - number of seconds elapsed since last update
+    purpose     :   Update job: waypoints of a tank (movement step 1).
+    notes       :   <none>
+*******************************************************************************/
+void object_handler::job_waypoints(void* data, int item, float deltaT)
 {
-    int i, j, k;
+    ((object_handler*)data)->tanks[item]->updateWaypoints(deltaT);
+}
+
+/*******************************************************************************
+    function    :   object_handler::job_orientation
+    arguments   :   data - Object handler (object_handler*)
+                    item - Tank (index of tank list)
+                    deltaT - number of seconds elapsed since last update
+    purpose     :   Update job: orientation of a tank (movement step 2).
+    notes       :   <none>
+*******************************************************************************/
+void object_handler::job_orientation(void* data, int item, float deltaT)
+{
+    ((object_handler*)data)->tanks[item]->updateOrientation(deltaT);
+}
+
+/*******************************************************************************
+    function    :   object_handler::job_sights
+    arguments   :   data - Object handler (object_handler*)
+                    item - Unit (index of crew list)
+                    deltaT - number of seconds elapsed since last update
+    purpose     :   Update job: sights of a unit, in order.
+    notes       :   <none>
+*******************************************************************************/
+void object_handler::job_sights(void* data, int item, float deltaT)
+{
+    object_handler* handler = (object_handler*)data;
+    int j;
     
-    // Make update calls to objects.
-    for(i = 0; i < 10; i++)
-        if(objects[i])
-            for(j = k = 0; k < obj_count[i]; j++)
-                if(objects[i][j] != NULL)
-                {
-                    // Check for special removal tag (member is public).
-                    if(objects[i][j]->obj_status == OBJ_STATUS_REMOVE)
-                    {
-                        //cout << SDL_GetTicks() << ": [" << (unsigned int)objects[i][j] << "]: Object handler CATCH removing." << endl;
-                        switch(objects[i][j]->obj_type)
-                        {
-                            case OBJ_TYPE_TANK:
-                                delete dynamic_cast<tank_object*>(objects[i][j]);
-                                break;
-                            
-                            case OBJ_TYPE_VEHICLE:
-                                //delete dynamic_cast<vehicle_object*>(objects[i][j]);
-                                break;
-                            
-                            case OBJ_TYPE_ATG:
-                                delete dynamic_cast<atg_object*>(objects[i][j]);
-                                break;
-                            
-                            case OBJ_TYPE_ATR:
-                                //delete dynamic_cast<atr_object*>(objects[i][j]);
-                                break;
-                            
-                            case OBJ_TYPE_STATIC:
-                                delete objects[i][j];
-                                break;
-                            
-                            case OBJ_TYPE_PROJECTILE:
-                                // Case: Make sure projectile object is out
-                                // of cdr subsystem entirely before deleting.
-                                if(((proj_object*)objects[i][j])->cdr_passes <= 0)
-                                    delete ((proj_object*)objects[i][j]);
-                                else
-                                {
-                                    // Object still in CD system
-                                    //cout << SDL_GetTicks() << ": [" << (unsigned int)objects[i][j] << "]: Object still in CDR, NOT removing." << endl;
-                                    //console.addComMessage("Catch");
-                                    k++;
-                                    continue;
-                                }
-                                break;
-                        }
-                        objects[i][j] = NULL;
-                        obj_count[i]--;
-                    }
-                    else
-                    {
-                        switch(objects[i][j]->obj_type)
-                        {
-                            case OBJ_TYPE_TANK:
-                                (dynamic_cast<tank_object*>(objects[i][j]))->update(deltaT);
-                                break;
-                            
-                            case OBJ_TYPE_VEHICLE:
-                                //(dynamic_cast<vehicle_object*>(objects[i][j]))->update(deltaT);
-                                break;
-                            
-                            case OBJ_TYPE_ATG:
-                                (dynamic_cast<atg_object*>(objects[i][j]))->update(deltaT);
-                                break;
-                            
-                            case OBJ_TYPE_ATR:
-                                //(dynamic_cast<atr_object*>(objects[i][j]))->update(deltaT);
-                                break;
-                            
-                            case OBJ_TYPE_STATIC:
-                                objects[i][j]->update(deltaT);
-                                break;
-                            
-                            case OBJ_TYPE_PROJECTILE:
-                                ((proj_object*)objects[i][j])->update(deltaT);
-                                break;
-                        }
-                        k++;
-                    }
-                }
+    for(j = handler->sight_first[item]; j < handler->sight_first[item + 1]; j++)
+        handler->sights[j]->update(deltaT);
 }
 
 /*******************************************************************************
-    function    :   object_handler::displayFirstpass
-    arguments   :   <none>
-    purpose     :   Base object handler display.
+    function    :   object_handler::job_guns
+    arguments   :   data - Object handler (object_handler*)
+                    item - Unit (index of crew list)
+                    deltaT - number of seconds elapsed since last update
+    purpose     :   Update job: guns of a unit, in order.
+    notes       :   Firing is deferred (see gun_device::update).
+*******************************************************************************/
+void object_handler::job_guns(void* data, int item, float deltaT)
+{
+    object_handler* handler = (object_handler*)data;
+    int j;
+    
+    for(j = handler->gun_first[item]; j < handler->gun_first[item + 1]; j++)
+        handler->guns[j]->update(deltaT);
+}
+
+/*******************************************************************************
+    function    :   object_handler::job_turrets
+    arguments   :   data - Object handler (object_handler*)
+                    item - Tank (index of tank list)
+                    deltaT - number of seconds elapsed since last update
+    purpose     :   Update job: turrets of a tank.
     notes       :   <none>
 *******************************************************************************/
-void object_handler::displayFirstPass()
+void object_handler::job_turrets(void* data, int item, float deltaT)
 {
-    int i, j, k;
+    ((object_handler*)data)->tanks[item]->updateTurrets(deltaT);
+}
+
+/*******************************************************************************
+    function    :   object_handler::job_projectile
+    arguments   :   data - Object handler (object_handler*)
+                    item - Projectile (index of projectile list)
+                    deltaT - number of seconds elapsed since last update
+    purpose     :   Update job: flight of a projectile, deferring the effects
+                    and sounds of any events it raises.
+    notes       :   <none>
+*******************************************************************************/
+void object_handler::job_projectile(void* data, int item, float deltaT)
+{
+    proj_object* proj_ptr;
+    int events;
     
-    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    proj_ptr = (proj_object*)((object_handler*)data)->
+        objects[OBJ_TYPE_PROJECTILE][item];
     
-    // Make display calls to objects.
-    for(i = 0; i < OBJ_TYPE_PROJECTILE; i++)
-        if(objects[i])
-            for(j = k = 0; k < obj_count[i]; j++)
-                if(objects[i][j] != NULL)
-                {
-                    objects[i][j]->display();
-                    k++;
-                }
+    if(proj_ptr->obj_status != OBJ_STATUS_REMOVE)
+    {
+        events = proj_ptr->updateFlight(deltaT);
+        if(events)
+            jobs.projEvents(proj_ptr, events, deltaT);
+    }
 }
 
 /*******************************************************************************
-    function    :   object_handler::displaySecondPass
-    arguments   :   <none>
-    purpose     :   Base object handler display.
+    function    :   object_handler::job_cd_projectile
+    arguments   :   data - Object handler (object_handler*)
+                    item - Projectile (index of CD pass projectiles)
+                    deltaT - <unused>
+    purpose     :   CD pass job: narrow phase of a projectile.
     notes       :   <none>
 *******************************************************************************/
-void object_handler::displaySecondPass()
+void object_handler::job_cd_projectile(void* data, int item, float deltaT)
 {
-    int j, k;
+    ((object_handler*)data)->cdp_check(item);
+}
+
+/*******************************************************************************
+    function    :   object_handler::update
+    arguments   :   deltaT - number of seconds elapsed since last update
+    purpose     :   Base object handler update.
+    notes       :   Passes run on the job system apply their deferred side
+                    effects (firing, effects, messages) before returning, in
+                    the same order a serial pass would make them.
+*******************************************************************************/
+void object_handler::update(float deltaT)
+{
+    int i, j;
+    
+    // Make update calls to objects, list by list. Objects tagged for removal
+    // (member is public) are deleted instead, and the last object of the list
+    // moved into their place is then done next (hence the j--).
+    for(j = 0; j < obj_count[OBJ_TYPE_TANK]; j++)
+        if(tanks[j]->obj_status == OBJ_STATUS_REMOVE)
+            delete_at(OBJ_TYPE_TANK, j--);
+        else
+            tanks[j]->updateBegin(deltaT);
+    
+    for(j = 0; j < obj_count[OBJ_TYPE_ATG]; j++)
+        if(atgs[j]->obj_status == OBJ_STATUS_REMOVE)
+            delete_at(OBJ_TYPE_ATG, j--);
+        else
+            atgs[j]->updateBegin(deltaT);
+    
+    // Unit modules, one pass per module (see tank_object::update). Passes
+    // are run on the job system, except motors (which move their sounds and
+    // effects every update).
+    if(comp_dirty)
+        build_components();
+    
+    jobs.run(job_crew, (void*)this, crew_count, deltaT);
+    
+    jobs.run(job_waypoints, (void*)this, obj_count[OBJ_TYPE_TANK], deltaT);
+    
+    for(j = 0; j < motor_count; j++)
+        motors[j]->update(deltaT);
+    
+    jobs.run(job_orientation, (void*)this, obj_count[OBJ_TYPE_TANK], deltaT);
+    
+    jobs.run(job_sights, (void*)this, crew_count, deltaT);
+    
+    jobs.run(job_guns, (void*)this, crew_count, deltaT);
+    
+    jobs.run(job_turrets, (void*)this, obj_count[OBJ_TYPE_TANK], deltaT);
     
-    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    for(j = 0; j < obj_count[OBJ_TYPE_TANK]; j++)
+        tanks[j]->updateEnd(deltaT);
+    
+    for(j = 0; j < obj_count[OBJ_TYPE_ATG]; j++)
+        atgs[j]->updateEnd(deltaT);
+    
+    for(j = 0; j < obj_count[OBJ_TYPE_STATIC]; j++)
+        if(objects[OBJ_TYPE_STATIC][j]->obj_status == OBJ_STATUS_REMOVE)
+            delete_at(OBJ_TYPE_STATIC, j--);
+        else
+            objects[OBJ_TYPE_STATIC][j]->object::update(deltaT);
+    
+    // Case: Make sure projectile object is out of cdr subsystem entirely
+    // before deleting (otherwise it is left, without update, until it is).
+    // Removals are done first, leaving the list as it would be left by doing
+    // them along with the updates, then the flights are run as jobs.
+    for(j = 0; j < obj_count[OBJ_TYPE_PROJECTILE]; j++)
+        if(objects[OBJ_TYPE_PROJECTILE][j]->obj_status == OBJ_STATUS_REMOVE &&
+           ((proj_object*)objects[OBJ_TYPE_PROJECTILE][j])->cdr_passes <= 0)
+            delete_at(OBJ_TYPE_PROJECTILE, j--);
+    
+    jobs.run(job_projectile, (void*)this, obj_count[OBJ_TYPE_PROJECTILE],
+        deltaT);
+    
+    // Lists with nothing to update only need removals done
+    for(i = 0; i < 10; i++)
+        if(objects[i] && i != OBJ_TYPE_TANK && i != OBJ_TYPE_ATG &&
+           i != OBJ_TYPE_STATIC && i != OBJ_TYPE_PROJECTILE)
+            for(j = 0; j < obj_count[i]; j++)
+                if(objects[i][j]->obj_status == OBJ_STATUS_REMOVE)
+                    delete_at(i, j--);
+}
+
+/*******************************************************************************
+    function    :   object_handler::snapshot
+    arguments   :   snap - Render snapshot to fill
+    purpose     :   Records what is displayed of all objects into a render
+                    snapshot, list by list (as update).
+    notes       :   Called from the simulation thread, once a step is done.
+*******************************************************************************/
+void object_handler::snapshot(render_snapshot* snap)
+{
+    int i, j;
+    
+    for(j = 0; j < obj_count[OBJ_TYPE_TANK]; j++)
+        tanks[j]->tank_object::snapshot(
+            snap->addObject(tanks[j]->obj_handle));
+    
+    for(j = 0; j < obj_count[OBJ_TYPE_ATG]; j++)
+        atgs[j]->atg_object::snapshot(
+            snap->addObject(atgs[j]->obj_handle));
+    
+    for(i = 0; i < OBJ_TYPE_PROJECTILE; i++)
+        if(objects[i] && i != OBJ_TYPE_TANK && i != OBJ_TYPE_ATG)
+            for(j = 0; j < obj_count[i]; j++)
+                objects[i][j]->snapshot(
+                    snap->addObject(objects[i][j]->obj_handle));
     
-    // Make display calls to objects.
     if(objects[OBJ_TYPE_PROJECTILE])
     {
-        for(j = k = 0; k < obj_count[OBJ_TYPE_PROJECTILE]; j++)
-            if(objects[OBJ_TYPE_PROJECTILE][j] != NULL)
-            {
-                ((proj_object*)objects[OBJ_TYPE_PROJECTILE][j])->display();
-                k++;
-            }
+        for(j = 0; j < obj_count[OBJ_TYPE_PROJECTILE]; j++)
+            ((proj_object*)objects[OBJ_TYPE_PROJECTILE][j])->
+                proj_object::snapshot(snap->addProj(
+                    objects[OBJ_TYPE_PROJECTILE][j]->obj_handle));
     }
 }
+
+/*******************************************************************************
+    function    :   object_handler::displayWaypoints
+    arguments   :   <none>
+    purpose     :   Displays the waypoints of selected tanks.
+    notes       :   Waypoint lists are changed by the simulation, so this must
+                    only be called while holding the world lock.
+*******************************************************************************/
+void object_handler::displayWaypoints()
+{
+    int j;
+    
+    for(j = 0; j < obj_count[OBJ_TYPE_TANK]; j++)
+        if(tanks[j]->selected)
+            tanks[j]->displayWaypoints();
+}
@@ -10,13 +10,25 @@
 
 /* Object Handler Defines */
 
-// Object Count Limits
-#define OBJ_MAX_TANK            35      // Max number of Tank objects
-#define OBJ_MAX_VEHICLE         20      // Max number of Vehicle objects
-#define OBJ_MAX_ATG             15      // Max number of ATG objects
-#define OBJ_MAX_ATR             10      // Max number of ATR objects
-#define OBJ_MAX_STATIC          100     // Max number of Static objects
-#define OBJ_MAX_PROJECTILE      300     // Max number of Projectile objects
+// Object List Sizes (initial, lists grow as needed)
+#define OBJ_MAX_TANK            35      // Initial number of Tank objects
+#define OBJ_MAX_VEHICLE         20      // Initial number of Vehicle objects
+#define OBJ_MAX_ATG             15      // Initial number of ATG objects
+#define OBJ_MAX_ATR             10      // Initial number of ATR objects
+#define OBJ_MAX_STATIC          100     // Initial number of Static objects
+#define OBJ_MAX_PROJECTILE      300     // Initial number of Projectile objects
+
+// Object Handles
+#define OBJ_HANDLE_SLOTS        256     // Initial number of handle slots
+#define OBJ_HANDLE_SLOT_BITS    20      // Handle bits for slot (rest generation)
+#define OBJ_HANDLE_SLOT_MASK    ((1 << OBJ_HANDLE_SLOT_BITS) - 1)
+#define OBJ_HANDLE_GENERATIONS  (1 << (32 - OBJ_HANDLE_SLOT_BITS))
+
+struct cd_data;                         // CD data report (collision.h)
+struct tank_object;                     // Tank object (tank.h)
+struct atg_object;                      // ATG object (atg.h)
+struct render_snapshot;                 // Render snapshot (snapshot.h)
+class object_handler;
 
 // Collision Detection Testing List Structure
 struct cdtl_node
@@ -27,18 +39,122 @@ struct cdtl_node
     cdtl_node* next;
 };
 
+// Object Handle Slot Structure
+struct obj_slot
+{
+    object* obj_ptr;                    // Object in slot (NULL if free)
+    unsigned int generation;            // Bumped each time slot is freed
+    int next_free;                      // Next free slot (-1 for none)
+};
+
 /*******************************************************************************
     class       :   object_handler
     purpose     :   Manages and controls all objects currently being used in
                     the game engine.
-    notes       :   
+    notes       :   1) The projectile CD pass runs the narrow phase of each
+                       projectile on the job system, then merges their hits
+                       in projectile order on the main thread, so the hits
+                       handled never depend on thread timing.
+                    2) Each object list is packed (objects [0, count) are in
+                       use) and grows when full. A removed object is replaced
+                       by the last object of its list, so object order within
+                       a list is not kept.
+                    3) Objects are given a handle when added, which stays valid
+                       until the object is removed, after which getObject
+                       returns NULL for it. Anything which holds onto an
+                       object it did not create, and may outlive it, should
+                       hold its handle rather than its pointer.
+                    4) Each list only ever holds objects of its own type, so
+                       update calls are made list by list straight to that
+                       type's routine. Tanks and ATGs (which sit under a
+                       virtual base) are also kept in typed lists, in the
+                       same order as their object lists, so that no casts
+                       are needed to reach them.
+                    5) Unit modules (crews, motors, sights and guns) are kept
+                       in component lists, built from the unit lists, and
+                       each is updated in one pass over all units. Units are
+                       updated in steps (begin, crew, waypoints, motor,
+                       orientation, sights, guns, turrets, end), one pass
+                       per step, so each unit still sees the same order as
+                       its own update routine gives.
+                    6) The crew, waypoint, orientation, sight, gun and turret
+                       passes, and the projectile flight pass, are run on the
+                       job system, one unit (or projectile) per item. Units'
+                       modules share their crew, so a unit's sights and guns
+                       are always done together by one thread. Motors, and
+                       the begin and end steps, stay on the main thread.
+                    7) Objects are not displayed from here. Once a step is
+                       done, what is displayed of each object is recorded
+                       into a render snapshot (see snapshot.h), which the
+                       render thread draws from.
 *******************************************************************************/
 class object_handler
 {
     private:
-        object** objects[10];       // Object pointers
-        int obj_max[10];            // Max objects per level
+        object** objects[10];       // Object pointers (packed)
+        int obj_max[10];            // List size per level
         int obj_count[10];          // Object count per level
+        tank_object** tanks;        // Tank list (as objects[OBJ_TYPE_TANK])
+        atg_object** atgs;          // ATG list (as objects[OBJ_TYPE_ATG])
+        
+        crew_module** crews;        // Crew modules of all units
+        motor_device** motors;      // Motor devices of all moving units
+        sight_device** sights;      // Sight devices of all firing units
+        gun_device** guns;          // Gun devices of all firing units
+        int crew_count;             // # of crew modules
+        int motor_count;            // # of motor devices
+        int sight_count;            // # of sight devices
+        int gun_count;              // # of gun devices
+        int* sight_first;           // First sight of each unit (and end)
+        int* gun_first;             // First gun of each unit (and end)
+        int comp_max;               // Size of each component list
+        bool comp_dirty;            // Units added/removed since lists built
+        
+        obj_slot* slots;            // Handle slots
+        int slot_max;               // Handle slots allocated
+        int slot_count;             // Handle slots used (in use or free)
+        int slot_free;              // First free handle slot (-1 for none)
+        
+        cdtl_node* cdtl_free;       // Free CDTL nodes (pool)
+        
+        /* List Routines */
+        void grow_list(int objType);
+        void remove_at(int objType, int index);
+        void delete_at(int objType, int index);
+        
+        /* Component Routines */
+        void build_components();
+        
+        /* Update Job Routines (one item each, see update) */
+        static void job_crew(void* data, int item, float deltaT);
+        static void job_waypoints(void* data, int item, float deltaT);
+        static void job_orientation(void* data, int item, float deltaT);
+        static void job_sights(void* data, int item, float deltaT);
+        static void job_guns(void* data, int item, float deltaT);
+        static void job_turrets(void* data, int item, float deltaT);
+        static void job_projectile(void* data, int item, float deltaT);
+        static void job_cd_projectile(void* data, int item, float deltaT);
+        
+        /* Handle Routines */
+        unsigned int new_handle(object* objPtr);
+        void free_handle(unsigned int handle);
+        
+        /* CDTL Pool Routines */
+        cdtl_node* new_cdtl();
+        void free_cdtl(cdtl_node* node)
+            { node->next = cdtl_free; cdtl_free = node; }
+        
+        /* Projectile CD Pass */
+        object** cdp_proj;                  // Projectiles of current pass
+        object** cdp_hit_obj;               // Object hit, per projectile
+        cd_data* cdp_hit_report;            // CD data report, per projectile
+        cdtl_node** cdp_released;           // Dropped CDTL nodes, per projectile
+        int cdp_size;                       // Size of pass buffers
+        int cdp_count;                      // # of projectiles in pass
+        
+        /* Projectile CD Pass Routines */
+        void cdp_resize(int size);
+        void cdp_check(int item);
     
     public:
         object_handler();           // Constructor
@@ -51,6 +167,11 @@ class object_handler
         void removeObject(object* objPtr)
             { if(objPtr) objPtr->obj_status = OBJ_STATUS_REMOVE; }
         
+        /* Handle Routines */
+        unsigned int getHandle(object* objPtr)
+            { return (objPtr ? objPtr->obj_handle : OBJ_HANDLE_NONE); }
+        object* getObject(unsigned int handle);
+        
         /* Unit Grabbing Routines */
         object* getUnitAt(int x, int y);
         object* getUnitNear(kVector pos, float distanceTolerance);
@@ -64,14 +185,15 @@ class object_handler
         cdtl_node* createCDTL(object* objPtr, float angleTolerance,
             float AABBTolerance, object* excludeObjPtr);
         void killCDTL(object* objPtr);
+        int getCDTargets(object** targets, int maxTargets);
         
         void cdObjPass(int startList, int endList);
         void cdProjPass();
         
-        /* Base Update and Display Routines */
+        /* Base Update and Snapshot Routines */
         void update(float deltaT);
-        void displayFirstPass();
-        void displaySecondPass();
+        void snapshot(render_snapshot* snap);
+        void displayWaypoints();
 };
 
 extern object_handler objects;
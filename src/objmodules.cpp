@@ -4,9 +4,11 @@
 #include "main.h"
 #include "objmodules.h"
 #include "atg.h"
+#include "ballistics.h"
 #include "console.h"
 #include "database.h"
 #include "effects.h"
+#include "jobs.h"
 #include "metrics.h"
 #include "misc.h"
 #include "object.h"
@@ -1526,7 +1528,10 @@ sight_device::sight_device()
     target_spot = TARGET_BASE;
     target_assigned = false;
     target_isa_object = false;
-    previous_theta = TWOPI;
+    range_table = NULL;
+    los_cache.viewer = los_cache.target = NULL;
+    los_cache.time = 0.0;
+    los_cache.visible = true;
     
     elevate_min = elevate_std = elevate_max = elevate_speed = elevate_error =
         desired_elevate = elevate = 0.0;
@@ -1774,7 +1779,6 @@ void sight_device::assignTarget(object* objPtr, short targetSpot)
     target_obj_ptr = objPtr;
     target_spot = targetSpot;
     target_position[0] = target_position[1] = target_position[2] = 0.0;
-    previous_theta = 7.0;
     
     // Assign aiming job
     if(job_id != JOB_NULL)
@@ -1915,7 +1919,6 @@ void sight_device::assignTarget(float* position)
     target_position[0] = position[0];   // Set target_position to the passed
     target_position[1] = position[1];   // position value.
     target_position[2] = position[2];
-    previous_theta = 7.0;
     
     // Assign aiming job
     if(job_id != JOB_NULL)
@@ -2050,6 +2053,12 @@ void sight_device::update(float deltaT)
             float time_to_target;
             float distance_to_target;
             
+            // Grab the range table for the velocity we're adjusting towards
+            // (only looked up again when the velocity changes).
+            if(adjust_velocity != 0.0 && (range_table == NULL ||
+               range_table->velocity != adjust_velocity))
+                range_table = ballistics.getRangeTable(adjust_velocity);
+            
             // Determine the device current position and direction based on
             // the linear transformation of itself so that we can get an accurate
             // reading independent of having to do anything fancy for orientation.
@@ -2080,7 +2089,8 @@ void sight_device::update(float deltaT)
                         distance_to_target = distanceBetween(
                             target_obj_ptr->transform(kVector(target_position), 0),
                             device_pos);
-                        time_to_target = distance_to_target / adjust_velocity;
+                        time_to_target = ballistics.tableTime(range_table,
+                            distance_to_target);
                         
                         // Much more complicated aim    
                         target_dir =
@@ -2119,76 +2129,28 @@ void sight_device::update(float deltaT)
                 target_dir = kVector(target_position) - device_pos;
             }
             
-            // Run our inverse kinematic solver - only done if the velocity we're
+            // Run our ballistic solver - only done if the velocity we're
             // adjusting towards exists as not zero.
             if(adjust_velocity != 0.0)
             {
-                float theta;
-                float iterator;
-                float y_offset;
-                float error;
-                
-                // Pick-up from where we last left off (or not).
-                if(previous_theta == 7.0)
-                {
-                    // Start from the beginning :S
-                    theta = 0.0;
-                    iterator = PIHALF;
-                }
-                else
-                {
-                    // Readjust based on previous aiming
-                    theta = previous_theta;
-                    iterator = PI / 8192.0;
-                }
+                float tan_elevate;
                 
                 // X distance (disregarding Yaw, this is a 2D problem)
                 distance_to_target = 
                     sqrt((target_dir[0] * target_dir[0]) +
                          (target_dir[2] * target_dir[2]));
                 
-                // Initialize values for first run through
-                time_to_target = distance_to_target /
-                    (cos(theta) * adjust_velocity);
-                y_offset = sin(theta) * adjust_velocity * time_to_target -
-                    4.905 * time_to_target * time_to_target;
-                
-                error = fabsf(target_dir[1] - y_offset);    // Compute error
-                
-                // While our error is high and our iterator is still large, hom-in
-                // on the appropriate theta value which will give us a hit.
-                while(error > 0.001 && iterator > 2.996056e-6)
+                // Solve for the elevation which hits the target, or if it is
+                // out of reach, go for max range (45 degrees).
+                if(distance_to_target > FP_ERROR)
                 {
-                    iterator /= 2.0;            // Cut iterator in half each time
-                    
-                    // Determine if we need to lower or raise theta
-                    if(y_offset > target_dir[1])
-                        theta -= iterator;
-                    else
-                        theta += iterator;
+                    if(!ballistics.solveElevation(adjust_velocity,
+                        distance_to_target, target_dir[1], tan_elevate))
+                        tan_elevate = 1.0;
                     
-                    // Recalculate values
-                    time_to_target = distance_to_target /
-                        (cos(theta) * adjust_velocity);
-                    y_offset = sin(theta) * adjust_velocity * time_to_target -
-                        4.9 * time_to_target * time_to_target;
-                    
-                    error = fabsf(target_dir[1] - y_offset);    // Compute error
+                    // Aim at the spot the line of bore passes over the target
+                    target_dir[1] = distance_to_target * tan_elevate;
                 }
-                
-                // Determine Y offset to aim at
-                y_offset = sin(theta) * adjust_velocity * time_to_target;
-                
-                // Assign to our target direction vector
-                target_dir[1] = y_offset;
-                
-                // If we had computed a value with minimized error, save this
-                // value for future run-through (efficiency). Otherwise, reset
-                // theta to 7.0 which is seen above as meaning start all over.
-                if(error <= 0.001)
-                    previous_theta = theta;
-                else
-                    previous_theta = 7.0;
             }
             
             // Convert direction vectors to spherical (for pitch and yaw numbers)
@@ -2377,7 +2339,16 @@ void sight_device::update(float deltaT)
     {
         // See if we have the desired trans/elevate (if so, on-target)
         if(trans_on_target && elevate_on_target)
-            status = SIGHT_TRACKING;    // On-target
+        {
+            // Can't track what can't be seen (terrain, trees, foliage). The
+            // sight keeps its own cache entry, as sights are updated by jobs.
+            if(target_isa_object && !map.lineOfSight(&los_cache, (void*)parent,
+                (void*)target_obj_ptr, parent->transform(sight_pivot, sight_attach),
+                target_obj_ptr->transform(kVector(target_position), 0)))
+                status = SIGHT_AQUIRING;    // Target obscured
+            else
+                status = SIGHT_TRACKING;    // On-target
+        }
         // See if it is inside/outside the FOV of the device
         else if(fabsf(elevate - desired_elevate) > field_of_view / 2.0 ||
                 fabsf(transverse - desired_trans) > field_of_view / 2.0)
@@ -2789,7 +2760,7 @@ void gun_device::loadBreech()
                 (dynamic_cast<firing_object*>(parent))->obj_id, gun_type,
                 db.query((dynamic_cast<firing_object*>(parent))->ammo_pool_type[previous_ammo], "TYPE"),
                 db.query((dynamic_cast<firing_object*>(parent))->ammo_pool_type[ammo_in_usage], "TYPE"));
-            console.addComMessage(buffer);
+            jobs.addComMessage(buffer);
         }
         
         // See if we can only grab half a portion of a clip or a full clip
@@ -2929,20 +2900,20 @@ void gun_device::update(float deltaT)
                 // Not on sight queue, see if gun is enabled & target assigned.
                 if(enabled && sight->isTargetAssigned())
                 {
-                    char* temp;
+                    bl_ammo_table* ammo_table;
                     
                     // Sight is assigned to a target and we're not on the queue,
                     // so lets get on it.
                     
-                    // Get the velocity of our round we're firing.
-                    temp = db.query(
-                        (dynamic_cast<firing_object*>(parent))->ammo_pool_type[ammo_in_breech],
-                        "VELOCITY");
-                    if(temp)
+                    // Get the ballistic tables of the round we're firing.
+                    ammo_table = ballistics.getAmmoTable(
+                        (dynamic_cast<firing_object*>(parent))->ammo_pool_type[ammo_in_breech]);
+                    if(ammo_table)
                     {
-                        // Put us on the queue.
+                        // Put us on the queue (at the velocity of the round's
+                        // range table, so the sight reads the same table).
                         sight_id = sight->enqueueDevice(gun_num,
-                            atof(temp) * PROJ_VEL_MULTIPLIER);
+                            ammo_table->range_table->velocity);
                         tracking_time = 0.0;
                     }
                     else
@@ -2950,7 +2921,7 @@ void gun_device::update(float deltaT)
                         char buffer[128];
                         sprintf(buffer, "Gun: Cannot query velocity for %s.",
                             (dynamic_cast<firing_object*>(parent))->ammo_pool_type[ammo_in_breech]);
-                        write_error(buffer);
+                        jobs.writeError(buffer);
                     }
                 }
             }
@@ -2978,26 +2949,26 @@ void gun_device::update(float deltaT)
                     // tracking for at least a second.
                     if(tracking_time >= 1.0)
                     {
-                        object* shell = NULL;
-                        
-                        // Fire gun (returns pointer to new projectile)
-                        shell = (dynamic_cast<firing_object*>(parent))->
-                            fireGun(gun_num, ammo_in_breech);
+                        int modifiers = AMMO_MOD_STANDARD;
                         
                         // Special case for German MG guns, which had a
                         // white tracer every 10 rounds.
-                        if(shell != NULL &&
-                           ammo_in_breech == OBJ_AMMOPOOL_MG &&
+                        if(ammo_in_breech == OBJ_AMMOPOOL_MG &&
                            (dynamic_cast<firing_object*>(parent))->
                                 ammo_pool_type[OBJ_AMMOPOOL_MG][0] == 'D' &&
                            (dynamic_cast<firing_object*>(parent))->
                                 ammo_pool_type[OBJ_AMMOPOOL_MG][1] == 'E' &&
                            clip_left != 0 && clip_left % 10 == 0)
                         {
-                            // Add a white tracer modifier to proj.
-                            ((proj_object*)shell)->addModifier(AMMO_MOD_WHITE_TRACER);
+                            // Fire round with a white tracer modifier.
+                            modifiers = AMMO_MOD_WHITE_TRACER;
                         }
                         
+                        // Fire gun (into the MG bullet pool or as a new
+                        // projectile, once the gun pass is done)
+                        jobs.fireGun(dynamic_cast<firing_object*>(parent),
+                            gun_num, ammo_in_breech, modifiers);
+                        
                         // Decrement clip left over
                         clip_left--;
                         
@@ -4,7 +4,9 @@
 #ifndef OBJMODULES_H
 #define OBJMODULES_H
 
+#include "ballistics.h"
 #include "object.h"
+#include "scenery.h"
 
 /* Object Module Defines */
 
@@ -300,7 +302,8 @@ class sight_device
         short target_spot;                  // Target specific spot (TARGET_X)
         bool target_assigned;               // Defines if target is assigned
         bool target_isa_object;             // Controls usage of target_obj_ptr
-        float previous_theta;               // Previously used theta (PE solver)
+        bl_range_table* range_table;        // Range table of adjust velocity
+        los_entry los_cache;                // Target line of sight cache
         
         // Elevation Data Attributes
         float elevate_min;                  // Minimum elevation
@@ -347,6 +350,9 @@ class sight_device
         /* Accessors */
         bool isTargetAssigned()
             { return target_assigned; }
+        object* getTargetObject()
+            { return (target_assigned && target_isa_object ?
+                  target_obj_ptr : NULL); }
         
         int getSightNum()
             { return sight_num; }
@@ -371,6 +377,9 @@ class sight_device
         float getDeviceAdjustmentVelocity()
             { return queue_velocity[curr_pos]; }
         
+        float getFieldOfView()
+            { return field_of_view; }
+        
         float getTransverse()
             { return transverse; }
         float getElevate()
@@ -3,6 +3,8 @@
 *******************************************************************************/
 #include "main.h"
 #include "objunit.h"
+#include "astar.h"
+#include "bullets.h"
 #include "camera.h"
 #include "database.h"
 #include "effects.h"
@@ -100,6 +102,11 @@ unit_object::unit_object()
     // Did not load picture
     picture_load = false;
     
+    // Matricies not yet built
+    hull_key[0] = hull_key[1] = hull_key[2] = 0.0;
+    hull_key[3] = hull_key[4] = hull_key[5] = 0.0;
+    matrix_dirty = true;
+    
     // No display lists
     hull_dspList = DSPLIST_NULL;
     selected_dspList = DSPLIST_NULL;
@@ -474,77 +481,154 @@ void unit_object::initUnit()
 }
 
 /*******************************************************************************
-    function    :   object::displayForSelection
+    function    :   unit_object::updateHullMatrix
     arguments   :   <none>
-    purpose     :   Displays the object as a rectangular box composing the
-                    object based on its size, & setting up a glPushName for the
-                    OpenGL selection buffer.
-    notes       :   1) The display is based on drawing the sides of the
-                       rectangular box of an object based on its size.
-                    2) The glPushName command pushes an unsigned integer which
-                       turns out to be just a 32 bit pointer to the object.
+    purpose     :   Rebuilds the hull matrix if the hull has moved since it was
+                    last built.
+    notes       :   1) Returns true if the hull matrix was rebuilt.
+                    2) Position is written from many places (movement, terrain
+                       following, placement), so rather than have each of them
+                       flag the matrix, the values it was built at are kept
+                       and compared here.
+                    3) matrix_dirty is left for the caller to clear once the
+                       rest of its matricies have been rebuilt.
+*******************************************************************************/
+bool unit_object::updateHullMatrix()
+{
+    if(!matrix_dirty &&
+       hull_key[0] == pos[0] && hull_key[1] == pos[1] &&
+       hull_key[2] == pos[2] && hull_key[3] == dir[1] &&
+       hull_key[4] == dir[2] && hull_key[5] == roll)
+        return false;
+    
+    hull_key[0] = pos[0];
+    hull_key[1] = pos[1];
+    hull_key[2] = pos[2];
+    hull_key[3] = dir[1];
+    hull_key[4] = dir[2];
+    hull_key[5] = roll;
+    
+    matrixIdentity(hull_matrix);
+    matrixTranslate(hull_matrix, pos[0], pos[1], pos[2]);
+    matrixRotateY(hull_matrix, dir[2]);
+    matrixRotateX(hull_matrix, dir[1] - PIHALF);
+    matrixRotateZ(hull_matrix, roll);
+    
+    return true;
+}
+
+/*******************************************************************************
+    function    :   unit_object::checkSelectionRay
+    arguments   :   rayPos - Ray start position (world)
+                    rayDir - Ray direction (world, normalized)
+                    t - Ray distance to the hit (returned)
+    purpose     :   Checks a picking ray against the rectangular box composing
+                    the object based on its size. Returns true if the box was
+                    struck in front of the ray, with t set to the hit distance.
+    notes       :   1) The bounding sphere is checked first so that the box
+                       test is only done for objects actually near the ray.
+                    2) The ray is brought into the hull LCS by the inverse of
+                       the (rigid) hull matrix, so no GL calls are made.
 *******************************************************************************/
-void unit_object::displayForSelection()
+bool unit_object::checkSelectionRay(kVector rayPos, kVector rayDir, float &t)
 {
-    float size_half[3];
+    kVector offset;
+    float local_pos[3];
+    float local_dir[3];
+    float box_min[3];
+    float box_max[3];
+    float t_min, t_max;
+    float t_one, t_two, t_swap;
+    int i;
+    
+    // Only select if in view
+    if(!camera.sphereInView(pos(), radius))
+        return false;
     
-    // Only display if in view
-    if(draw)
+    // Bounding sphere check (distance of center from ray)
+    offset = pos - rayPos;
+    t_one = dotProduct(offset, rayDir);
+    if(t_one < -radius ||
+       dotProduct(offset, offset) - (t_one * t_one) > radius * radius)
+        return false;
+    
+    // Transform ray into hull LCS (transpose of rotation part)
+    for(i = 0; i < 3; i++)
     {
-        // For ease
-        size_half[0] = size[0] / 2.0;
-        size_half[2] = size[2] / 2.0;
-        
-        // Push an integer tag (as a pointer to this object)
-        glPushName((GLuint)this);
-        
-        // Orient object
-        glPushMatrix();
-        glMultMatrixf(hull_matrix);
-        
-        // Draw sides of rectangular box based on size property
-        glBegin(GL_QUADS);
-            // Front facing
-            glVertex3f(-size_half[0], 0.0, size_half[2]);
-            glVertex3f(size_half[0], 0.0, size_half[2]);
-            glVertex3f(size_half[0], size[1], size_half[2]);
-            glVertex3f(-size_half[0], size[1], size_half[2]);
-            
-            // Rear facing
-            glVertex3f(-size_half[0], 0.0, -size_half[2]);
-            glVertex3f(size_half[0], 0.0, -size_half[2]);
-            glVertex3f(size_half[0], size[1], -size_half[2]);
-            glVertex3f(-size_half[0], size[1], -size_half[2]);
-            
-            // Upward facing
-            glVertex3f(-size_half[0], size[1], -size_half[2]);
-            glVertex3f(size_half[0], size[1], -size_half[2]);
-            glVertex3f(size_half[0], size[1], size_half[2]);
-            glVertex3f(-size_half[0], size[1], size_half[2]);
-            
-            // Downward facing
-            glVertex3f(-size_half[0], 0.0, -size_half[2]);
-            glVertex3f(size_half[0], 0.0, -size_half[2]);
-            glVertex3f(size_half[0], 0.0, size_half[2]);
-            glVertex3f(-size_half[0], 0.0, size_half[2]);
-            
-            // Left facing
-            glVertex3f(-size_half[0], 0.0, -size_half[2]);
-            glVertex3f(-size_half[0], 0.0, size_half[2]);
-            glVertex3f(-size_half[0], size[1], size_half[2]);
-            glVertex3f(-size_half[0], size[1], -size_half[2]);
-            
-            // Right facing
-            glVertex3f(size_half[0], 0.0, -size_half[2]);
-            glVertex3f(size_half[0], 0.0, size_half[2]);
-            glVertex3f(size_half[0], size[1], size_half[2]);
-            glVertex3f(size_half[0], size[1], -size_half[2]);
-        glEnd();
-        
-        glPopMatrix();
-        
-        glPopName();
+        local_pos[i] = hull_matrix[i*4 + 0] * offset[0] +
+                       hull_matrix[i*4 + 1] * offset[1] +
+                       hull_matrix[i*4 + 2] * offset[2];
+        local_dir[i] = hull_matrix[i*4 + 0] * rayDir[0] +
+                       hull_matrix[i*4 + 1] * rayDir[1] +
+                       hull_matrix[i*4 + 2] * rayDir[2];
+        local_pos[i] = -local_pos[i];   // Ray start relative to object
+    }
+    
+    // Box based on size property (same box as used for display)
+    box_min[0] = -size[0] / 2.0; box_max[0] = size[0] / 2.0;
+    box_min[1] = 0.0;            box_max[1] = size[1];
+    box_min[2] = -size[2] / 2.0; box_max[2] = size[2] / 2.0;
+    
+    // Slab test against each axis of the box
+    t_min = 0.0;
+    t_max = 1.0e30;
+    for(i = 0; i < 3; i++)
+    {
+        if(fabsf(local_dir[i]) <= FP_ERROR)
+        {
+            // Parallel to slab - must start within it
+            if(local_pos[i] < box_min[i] || local_pos[i] > box_max[i])
+                return false;
+        }
+        else
+        {
+            t_one = (box_min[i] - local_pos[i]) / local_dir[i];
+            t_two = (box_max[i] - local_pos[i]) / local_dir[i];
+            if(t_one > t_two)
+            {
+                t_swap = t_one;
+                t_one = t_two;
+                t_two = t_swap;
+            }
+            if(t_one > t_min)
+                t_min = t_one;
+            if(t_two < t_max)
+                t_max = t_two;
+            if(t_min > t_max)
+                return false;
+        }
     }
+    
+    t = t_min;
+    return true;
+}
+
+/*******************************************************************************
+    function    :   unit_object::checkSelectionVolume
+    arguments   :   planes - Planes bounding the selection volume (a,b,c,d)
+                    planeCount - Number of planes
+    purpose     :   Checks the object's bounding sphere against a selection
+                    volume, returning true if any portion of the sphere lies
+                    inside of the volume.
+    notes       :   Planes are expected to face inward, same as the camera's
+                    frustum culling planes.
+*******************************************************************************/
+bool unit_object::checkSelectionVolume(float planes[][4], int planeCount)
+{
+    int i;
+    
+    // Only select if in view
+    if(!camera.sphereInView(pos(), radius))
+        return false;
+    
+    for(i = 0; i < planeCount; i++)
+        if(planes[i][0] * pos[0]
+            + planes[i][1] * pos[1]
+            + planes[i][2] * pos[2]
+            + planes[i][3] <= -radius)
+            return false;
+    
+    return true;
 }
 
 /*******************************************************************************
@@ -659,6 +743,9 @@ void moving_object::killWaypoints()
 {
     waypoint_node* wl_curr;
     
+    // Cancel any paths still being found for us
+    astar.cancelPaths(this);
+    
     // Go through our linked list queue and delete allocated memory for WPs
     while((wl_curr = wl_head) != NULL)
     {
@@ -677,20 +764,29 @@ void moving_object::killWaypoints()
     purpose     :   Updates the movement of a moving object. This involves
                     two phases. The first phase updates the waypoint control
                     system. The second phase updates the object orientation.
-    notes       :   <none>
+                    The motor is updated in between.
+    notes       :   The object handler runs the phases itself (see
+                    object_handler::update), one pass over all units each.
 *******************************************************************************/
 void moving_object::updateMovement(float deltaT)
+{
+    updateWaypoints(deltaT);
+    motor.update(deltaT);
+    updateOrientation(deltaT);
+}
+
+/*******************************************************************************
+    function    :   moving_object::updateWaypoints
+    arguments   :   deltaT - number of seconds elapsed since last update.
+    purpose     :   Movement phase 1: updates the waypoint control system,
+                    setting throttle and angular velocity for the motor.
+    notes       :   <none>
+*******************************************************************************/
+void moving_object::updateWaypoints(float deltaT)
 {
     waypoint_node* wl_curr;
     kVector wp_dir;
     float yaw_offset;
-    kVector front_left;
-    kVector front_right;
-    kVector rear_left;
-    kVector rear_right;
-    float desired_pitch;
-    float desired_roll;
-    float desired_height;
     
     // Normalize direction vector
     if(dir[2] >= TWOPI)
@@ -698,8 +794,6 @@ void moving_object::updateMovement(float deltaT)
     else if(dir[2] < 0.0)
         dir[2] += TWOPI;
     
-    /* Phase 1: Update Waypoint System */
-    
     // Movement is controled via waypoints.
     if(wl_head)
     {
@@ -908,8 +1002,25 @@ void moving_object::updateMovement(float deltaT)
         motor.setThrottle(0.0);
     }
     
-    // Call our motor update to compute new speed value.
-    motor.update(deltaT);
+}
+
+/*******************************************************************************
+    function    :   moving_object::updateOrientation
+    arguments   :   deltaT - number of seconds elapsed since last update.
+    purpose     :   Movement phase 2: takes the new speed from the motor (once
+                    it has been updated) and updates the object orientation.
+    notes       :   <none>
+*******************************************************************************/
+void moving_object::updateOrientation(float deltaT)
+{
+    kVector front_left;
+    kVector front_right;
+    kVector rear_left;
+    kVector rear_right;
+    float desired_pitch;
+    float desired_roll;
+    float desired_height;
+    float corner_x[4], corner_z[4], corner_y[4];    // Batched height query
     
     // Get our speed value from the motor
     if((linear_vel >= 0.0 && !wl_head) ||
@@ -919,8 +1030,6 @@ void moving_object::updateMovement(float deltaT)
     else
         linear_vel = -motor.getCurrentSpeed();
     
-    /* Phase 2: Update Orientation of Object */
-    
     // Update position using current direction vector
     pos += vectorIn(dir, CS_CARTESIAN) * linear_vel * deltaT;
     
@@ -937,11 +1046,16 @@ void moving_object::updateMovement(float deltaT)
     rear_left.transform((float*)hull_matrix);
     rear_right.transform((float*)hull_matrix);
     
-    // Get new height values for transformed values
-    front_left[1] = map.getOverlayHeight(front_left[0], front_left[2]);
-    front_right[1] = map.getOverlayHeight(front_right[0], front_right[2]);
-    rear_left[1] = map.getOverlayHeight(rear_left[0], rear_left[2]);
-    rear_right[1] = map.getOverlayHeight(rear_right[0], rear_right[2]);
+    // Get new height values for transformed values (batched)
+    corner_x[0] = front_left[0];   corner_z[0] = front_left[2];
+    corner_x[1] = front_right[0];  corner_z[1] = front_right[2];
+    corner_x[2] = rear_left[0];    corner_z[2] = rear_left[2];
+    corner_x[3] = rear_right[0];   corner_z[3] = rear_right[2];
+    map.getOverlayHeights(4, corner_x, corner_z, corner_y);
+    front_left[1] = corner_y[0];
+    front_right[1] = corner_y[1];
+    rear_left[1] = corner_y[2];
+    rear_right[1] = corner_y[3];
     
     // Perform a quick collision test with scenery and heightmap
     while(
@@ -1051,6 +1165,8 @@ firing_object::firing_object()
     }
     
     gun_matrix = NULL;
+    gun_local_matrix = NULL;
+    gun_key = NULL;
     
     gun_mant_dspList = NULL;
     gun_dspList = NULL;
@@ -1075,6 +1191,10 @@ firing_object::~firing_object()
         delete *gun_matrix;
         delete gun_matrix;
     }
+    if(gun_local_matrix)
+        delete gun_local_matrix;
+    if(gun_key)
+        delete gun_key;
     if(gun_mant_dspList)
         delete gun_mant_dspList;
     if(gun_dspList)
@@ -1142,11 +1262,18 @@ void firing_object::initWeapons()
         return;
     }
     
-    // Allocate memory for gun matrix
+    // Allocate memory for gun matrix (world, then hull relative, in one block)
     gun_matrix = new GLfloat* [gun_count];
-    temp_ptr = (void*)(new GLfloat [gun_count * 16]);
+    gun_local_matrix = new GLfloat* [gun_count];
+    temp_ptr = (void*)(new GLfloat [gun_count * 32]);
     for(i = 0; i < gun_count; i++)
+    {
         gun_matrix[i] = (GLfloat*)temp_ptr + (i * 16);
+        gun_local_matrix[i] = (GLfloat*)temp_ptr + ((gun_count + i) * 16);
+    }
+    gun_key = new float[gun_count * 3];
+    for(i = 0; i < gun_count * 3; i++)
+        gun_key[i] = 0.0;
     
     // Allocate memory for display lists
     gun_mant_dspList = new GLuint[gun_count];
@@ -1288,14 +1415,19 @@ void firing_object::initAmmo(char* ammoLoadStr)
     function    :   firing_object::fireGun
     arguments   :   gunNum - gun number
                     fromAmmoPool - ammo pool number to fire from
+                    modifiers - modifiers to add to the round (AMMO_MOD_xxxx)
     purpose     :   Fires the weapon system given using the given ammo type.
-    notes       :   <none>
+    notes       :   Small-calibre rounds are fired into the MG bullet pool when
+                    there is room, in which case NULL is returned. Otherwise
+                    returns pointer to the new projectile (NULL if in error).
 *******************************************************************************/
-object* firing_object::fireGun(int gunNum, int fromAmmoPool)
+object* firing_object::fireGun(int gunNum, int fromAmmoPool, int modifiers)
 {
     kVector proj_pos;
     kVector proj_dir;
-    proj_object* proj_ptr;
+    proj_object* proj_ptr = NULL;
+    float caliber;
+    int round_id;
     int snd_id;
     char buffer[128];
     
@@ -1321,19 +1453,6 @@ object* firing_object::fireGun(int gunNum, int fromAmmoPool)
         return NULL;
     }
     
-    // Add new projectile object
-    proj_ptr = (proj_object*)objects.addObject(OBJ_TYPE_PROJECTILE);
-    
-    // Check for allocation
-    if(proj_ptr == NULL)
-    {
-        write_error("Unit: Unable to allocate a new projectile.");
-        return NULL;
-    }
-    
-    // Instruct gun to recoil
-    gun[gunNum].recoilGun();
-    
     // Determine position and direction vector for projectile
     proj_pos = kVector(0.0, 0.0,
         gun[gunNum].getGunLength());
@@ -1343,16 +1462,41 @@ object* firing_object::fireGun(int gunNum, int fromAmmoPool)
     proj_dir.transform((float*)gun_matrix[gunNum]);
     proj_dir = proj_dir - proj_pos;
     
-    // Initialize projectile
-    proj_ptr->initProj((object*)this, ammo_pool_type[fromAmmoPool],
-        proj_pos, proj_dir);
+    // Fire small-calibre rounds into the MG bullet pool
+    round_id = bullets.getRound(ammo_pool_type[fromAmmoPool]);
+    if(round_id != -1 && bullets.addBullet(round_id, (object*)this, proj_pos,
+        proj_dir, modifiers))
+    {
+        caliber = bullets.getRoundCaliber(round_id);
+    }
+    else
+    {
+        // Add new projectile object
+        proj_ptr = (proj_object*)objects.addObject(OBJ_TYPE_PROJECTILE);
+        
+        // Check for allocation
+        if(proj_ptr == NULL)
+        {
+            write_error("Unit: Unable to allocate a new projectile.");
+            return NULL;
+        }
+        
+        // Initialize projectile
+        proj_ptr->initProj((object*)this, ammo_pool_type[fromAmmoPool],
+            proj_pos, proj_dir);
+        proj_ptr->addModifier(modifiers);
+        caliber = proj_ptr->diameter;
+    }
+    
+    // Instruct gun to recoil
+    gun[gunNum].recoilGun();
     
     // Add firing specular effect
     if(gun[gunNum].isMainGun())
     {
         // Add firing specular effects for a main gun
         effects.addEffect(SE_CANNON_FIRING, proj_pos, proj_dir,
-            proj_ptr->diameter *
+            caliber *
                 (gun[gunNum].isFlashSupressed() ? 0.25f : 1.0f),
             (obj_type == OBJ_TYPE_TANK || obj_type == OBJ_TYPE_VEHICLE) ?
                 vectorIn(dir, CS_CARTESIAN) * (dynamic_cast<moving_object*>
@@ -1360,7 +1504,7 @@ object* firing_object::fireGun(int gunNum, int fromAmmoPool)
         snd_id = sounds.addSound(SOUND_CANNON, SOUND_HIGH_PRIORITY,
             proj_pos(), SOUND_PLAY_ONCE);
         sounds.setSoundRolloff(snd_id, 0.01f);
-        sounds.auxModOnCaliber(snd_id, proj_ptr->diameter);
+        sounds.auxModOnCaliber(snd_id, caliber);
     }
     else
     {
@@ -1396,6 +1540,32 @@ void firing_object::updateWeapons(float deltaT)
         gun[i].update(deltaT);
 }
 
+/*******************************************************************************
+    function    :   firing_object::gunMoved
+    arguments   :   gunNum - gun number
+                    mantletRecoil - recoil carried by the gun mount matrix
+    purpose     :   Determines if the gun mount has moved since its matricies
+                    were last built, and remembers its current values if so.
+    notes       :   1) Always true while matrix_dirty is set.
+                    2) Recoil of the gun itself is not part of the gun mount
+                       matrix (it is a translation along the bore applied
+                       after it), so only the part the mount carries is given.
+*******************************************************************************/
+bool firing_object::gunMoved(int gunNum, float mantletRecoil)
+{
+    float* key = gun_key + (gunNum * 3);
+    
+    if(!matrix_dirty && key[0] == gun[gunNum].getElevate() &&
+       key[1] == gun[gunNum].getTransverse() && key[2] == mantletRecoil)
+        return false;
+    
+    key[0] = gun[gunNum].getElevate();
+    key[1] = gun[gunNum].getTransverse();
+    key[2] = mantletRecoil;
+    
+    return true;
+}
+
 /*******************************************************************************
     turreted_object
 *******************************************************************************/
@@ -1413,6 +1583,9 @@ turreted_object::turreted_object()
     turret_rotation = NULL;
     turret_pivot = NULL;
     turret_matrix = NULL;
+    turret_local_matrix = NULL;
+    turret_key = NULL;
+    turret_turned = NULL;
     turret_dspList = NULL;
 }
 
@@ -1434,6 +1607,12 @@ turreted_object::~turreted_object()
         delete *turret_matrix;
         delete turret_matrix;
     }
+    if(turret_local_matrix)
+        delete turret_local_matrix;
+    if(turret_key)
+        delete turret_key;
+    if(turret_turned)
+        delete turret_turned;
     if(turret_dspList)
         delete turret_dspList;
 }
@@ -1473,11 +1652,22 @@ void turreted_object::initTurrets()
     // Allocate memory for pivot points
     turret_pivot = new kVector[turret_count];
     
-    // Allocate memory for turret matrix
+    // Allocate memory for turret matrix (world, then hull relative)
     turret_matrix = new GLfloat* [turret_count];
-    temp_ptr = (void*)(new GLfloat [turret_count * 16]);
+    turret_local_matrix = new GLfloat* [turret_count];
+    temp_ptr = (void*)(new GLfloat [turret_count * 32]);
     for(i = 0; i < turret_count; i++)
+    {
         turret_matrix[i] = (GLfloat*)temp_ptr + (i * 16);
+        turret_local_matrix[i] = (GLfloat*)temp_ptr + ((turret_count + i) * 16);
+    }
+    turret_key = new float[turret_count];
+    turret_turned = new bool[turret_count];
+    for(i = 0; i < turret_count; i++)
+    {
+        turret_key[i] = 0.0;
+        turret_turned[i] = true;
+    }
     
     // Allocate memory for display lists
     turret_dspList = new GLuint[turret_count];
@@ -1523,3 +1713,35 @@ void turreted_object::updateTurrets(float deltaT)
                 gun[i].getTransverse();
     }
 }
+
+/*******************************************************************************
+    function    :   turreted_object::updateTurretMatrices
+    arguments   :   hullMoved - hull matrix was rebuilt this update
+    purpose     :   Rebuilds the turret matricies of turrets which have turned
+                    (or all of them while matrix_dirty is set), and the world
+                    matricies of every turret if the hull has moved.
+    notes       :   turret_turned is left set for each turret whose hull
+                    relative matrix was rebuilt, for gun mounts riding on it.
+*******************************************************************************/
+void turreted_object::updateTurretMatrices(bool hullMoved)
+{
+    int i;
+    
+    for(i = 0; i < turret_count; i++)
+    {
+        turret_turned[i] = matrix_dirty || turret_key[i] != turret_rotation[i];
+        
+        if(turret_turned[i])
+        {
+            turret_key[i] = turret_rotation[i];
+            
+            matrixIdentity(turret_local_matrix[i]);
+            matrixTranslate(turret_local_matrix[i], turret_pivot[i][0],
+                turret_pivot[i][1], turret_pivot[i][2]);
+            matrixRotateY(turret_local_matrix[i], turret_rotation[i]);
+        }
+        
+        if(turret_turned[i] || hullMoved)
+            matrixMultiply(turret_matrix[i], hull_matrix, turret_local_matrix[i]);
+    }
+}
@@ -44,6 +44,10 @@ struct unit_object : public object
     bool selected;                      // Object is selected or not
     bool picture_load;                  // Object loaded this picture
     
+    /* Orientation Matrix Cache */
+    float hull_key[6];                  // Pos, dir, roll hull matrix was built at
+    bool matrix_dirty;                  // All matricies need to be rebuilt
+    
     /* Display Lists */
     GLuint hull_dspList;                // Hull display list
     GLuint selected_dspList;            // Drawing to display when selected
@@ -62,7 +66,13 @@ struct unit_object : public object
     
     /* Base Update & Display Routine */
     inline void updateUnit(float deltaT) { crew.update(deltaT); }
-    void displayForSelection();         // Display for OpenGL selection buffer
+    
+    /* Matrix Cache Routines */
+    bool updateHullMatrix();
+    
+    /* Selection Routines */
+    bool checkSelectionRay(kVector rayPos, kVector rayDir, float &t);
+    bool checkSelectionVolume(float planes[][4], int planeCount);
 };
 
 /*******************************************************************************
@@ -94,8 +104,10 @@ struct moving_object : virtual public unit_object
     void addWaypoint(kVector waypoint, unsigned int modifiers = WP_MOD_FORWARD);
     void killWaypoints();
     
-    /* Base Update Routine */
+    /* Base Update Routines */
     void updateMovement(float deltaT);
+    void updateWaypoints(float deltaT);     // Phase 1 (before motor)
+    void updateOrientation(float deltaT);   // Phase 2 (after motor)
 };
 
 /*******************************************************************************
@@ -112,6 +124,9 @@ struct firing_object : virtual public unit_object
     
     /* Orientation Matricies */
     GLfloat** gun_matrix;                   // Gun matricies
+    GLfloat** gun_local_matrix;             // Gun matricies (hull relative)
+    float* gun_key;                         // Elevate, transverse, mantlet
+                                            // recoil gun matricies built at
     
     /* Display Lists */
     GLuint* gun_mant_dspList;               // Gun mantlet display list
@@ -132,7 +147,11 @@ struct firing_object : virtual public unit_object
     void initAmmo(char* ammoLoadStr);
     
     /* Firing Routines */
-    virtual object* fireGun(int gunNum, int fromAmmoPool);
+    virtual object* fireGun(int gunNum, int fromAmmoPool,
+        int modifiers = 0);
+    
+    /* Matrix Cache Routines */
+    bool gunMoved(int gunNum, float mantletRecoil);
     
     /* Base Update Routine */
     void updateWeapons(float deltaT);
@@ -152,6 +171,9 @@ struct turreted_object : virtual public unit_object, virtual public firing_objec
     
     /* Orientation Matricies */
     GLfloat** turret_matrix;                // Turret matricies
+    GLfloat** turret_local_matrix;          // Turret matricies (hull relative)
+    float* turret_key;                      // Rotation turret matricies built at
+    bool* turret_turned;                    // Hull relative matrix rebuilt
     
     /* Display List */
     GLuint* turret_dspList;                 // Turret display list
@@ -163,6 +185,9 @@ struct turreted_object : virtual public unit_object, virtual public firing_objec
     /* Initialization Routine */
     void initTurrets();
     
+    /* Matrix Cache Routines */
+    void updateTurretMatrices(bool hullMoved);
+    
     /* Base Update Routine */
     void updateTurrets(float deltaT);
 };
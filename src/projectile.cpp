@@ -13,6 +13,7 @@
 #include "object.h"
 #include "objhandler.h"
 #include "scenery.h"
+#include "snapshot.h"
 #include "sounds.h"
 #include "texture.h"
 
@@ -76,9 +77,11 @@ proj_object::proj_object()
     velocity = 0.0;
     diameter = 0.0;
     explosive = 0.0;
+    ammo_table = NULL;
     
     tracer_depth = PROJ_MAX_TRACER_TAIL;
     tracer_timer = 0.0;
+    tracer_head = 0;
 }
 
 /*******************************************************************************
@@ -89,17 +92,9 @@ proj_object::proj_object()
 *******************************************************************************/
 proj_object::~proj_object()
 {
+    // Release CDTL back to the object handler's pool
     if(cdtl_head)
-    {
-        cdtl_node* curr = cdtl_head;
-        
-        while(curr)
-        {
-            cdtl_head = cdtl_head->next;
-            delete curr;
-            curr = cdtl_head;
-        }
-    }
+        objects.killCDTL(this);
 }
 
 /*******************************************************************************
@@ -125,38 +120,18 @@ void proj_object::initProj(object* parentPtr, char* roundType, kVector position,
     obj_type = OBJ_TYPE_PROJECTILE;
     obj_modifiers = AMMO_MOD_STANDARD;
     
-    // Grab type of projectile
-    temp = db.query(obj_model, "TYPE");
-    if(temp)
-    {
-        type = ammoType(temp);
-        
-        if(type == AMMO_TYPE_UNKNOWN)
-        {
-            // Check for valid shell type
-            sprintf(buffer, "Proj: Shell type for round \"%s\" invalid.",
-                roundType);
-            write_error(buffer);
-            return;
-        }
-    }
-    else
+    // Grab ballistic tables of projectile (built at DB load), which also
+    // give us its type and velocity (in m/s).
+    ammo_table = ballistics.getAmmoTable(obj_model);
+    if(ammo_table)
     {
-        // Check for valid entry in DB
-        sprintf(buffer, "Proj: Shell type for round \"%s\" not defined.",
-            roundType);
-        write_error(buffer);
-        return;
+        type = ammo_table->type;
+        velocity = ammo_table->velocity;
     }
-    
-    // Grab velocity (in m/s) of projectile
-    temp = db.query(obj_model, "VELOCITY");
-    if(temp)
-        velocity = atof(temp);
     else
     {
         // Check for valid entry in DB
-        sprintf(buffer, "Proj: Velocity for round \"%s\" not defined.",
+        sprintf(buffer, "Proj: Ballistic data for round \"%s\" not defined.",
             roundType);
         write_error(buffer);
         return;
@@ -274,6 +249,7 @@ void proj_object::interupt(kVector newPos, kVector newDir, float newVelocity,
     float timeOver, bool damageShell)
 {
     kVector direction;
+    float* tail_pos;
     int i;
     
     // Only need to handle overshoots for projectiles with tracer tails
@@ -288,29 +264,25 @@ void proj_object::interupt(kVector newPos, kVector newDir, float newVelocity,
             
             for(i = 0; i < PROJ_MAX_TRACER_TAIL; i++)
             {
+                tail_pos = tracerTail(i);
                 if(distanceBetween(pos, kVector(
-                    tracer_tail_pos[i][0], tracer_tail_pos[i][1], tracer_tail_pos[i][2]))
-                   <= overshot)
+                    tail_pos[0], tail_pos[1], tail_pos[2])) <= overshot)
                 {
-                    tracer_tail_pos[i][0] = newPos[0];
-                    tracer_tail_pos[i][1] = newPos[1];
-                    tracer_tail_pos[i][2] = newPos[2];
+                    tail_pos[0] = newPos[0];
+                    tail_pos[1] = newPos[1];
+                    tail_pos[2] = newPos[2];
                 }
                 else    // Done figuring out which overshoot
                     break;
             }
         }
         
-        tracer_tail_pos[0][0] = newPos[0];
-        tracer_tail_pos[0][1] = newPos[1];
-        tracer_tail_pos[0][2] = newPos[2];
+        tail_pos = tracerTail(0);
+        tail_pos[0] = newPos[0];
+        tail_pos[1] = newPos[1];
+        tail_pos[2] = newPos[2];
         
-        for(i = PROJ_MAX_TRACER_TAIL - 1; i > 0; i--)
-        {
-            tracer_tail_pos[i][0] = tracer_tail_pos[i - 1][0];
-            tracer_tail_pos[i][1] = tracer_tail_pos[i - 1][1];
-            tracer_tail_pos[i][2] = tracer_tail_pos[i - 1][2];
-        }
+        advanceTracer();
     }
     
     // Set new values
@@ -342,23 +314,20 @@ void proj_object::interupt(kVector newPos, kVector newDir, float newVelocity,
         
         if((obj_modifiers & AMMO_MOD_TRACER) || diameter > 1.5)
         {
-            tracer_tail_pos[0][0] = pos[0];
-            tracer_tail_pos[0][1] = pos[1];
-            tracer_tail_pos[0][2] = pos[2];
+            tail_pos = tracerTail(0);
+            tail_pos[0] = pos[0];
+            tail_pos[1] = pos[1];
+            tail_pos[2] = pos[2];
         }
     }
     
     // Update Hull Matrix
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
+    matrixIdentity((float*)hull_matrix);
     // Peform orientation
-    glTranslatef(pos[0], pos[1], pos[2]);
-    glRotatef(direction[2] * radToDeg, 0.0, 1.0, 0.0);
-    glRotatef(direction[1] * radToDeg, 1.0, 0.0, 0.0);
-    glRotatef(roll * radToDeg, 0.0, 1.0, 0.0);
-    glGetFloatv(GL_MODELVIEW_MATRIX, hull_matrix);
-    glPopMatrix();
+    matrixTranslate((float*)hull_matrix, pos[0], pos[1], pos[2]);
+    matrixRotateY((float*)hull_matrix, direction[2]);
+    matrixRotateX((float*)hull_matrix, direction[1]);
+    matrixRotateY((float*)hull_matrix, roll);
     
     if(damageShell)
     {
@@ -374,16 +343,40 @@ void proj_object::interupt(kVector newPos, kVector newDir, float newVelocity,
     function    :   proj_object::update
     arguments   :   deltaT - number of seconds elapsed since last update
     purpose     :   Updates the projectile object.
-    notes       :   Minor collision detection is performed if round penetrates
-                    the ground.
+    notes       :   The object handler runs the two steps itself (see
+                    object_handler::update), with the flight step of all
+                    projectiles done on the job system.
 *******************************************************************************/
 void proj_object::update(float deltaT)
 {
-    int i;
+    int events;
+    
+    events = updateFlight(deltaT);
+    if(events)
+        updateEvents(events, deltaT);
+}
+
+/*******************************************************************************
+    function    :   proj_object::updateFlight
+    arguments   :   deltaT - number of seconds elapsed since last update
+    purpose     :   Update step 1: moves the projectile and its tracer tail,
+                    and returns the events (PROJ_EVENT_xxx) its flight raised.
+    notes       :   1) Minor collision detection is performed if round
+                       penetrates the ground (tested along the whole step
+                       taken, not just at the end point).
+                    2) Only writes to the projectile itself (no GL calls, no
+                       effects or sounds), so projectiles may be stepped on
+                       worker threads.
+*******************************************************************************/
+int proj_object::updateFlight(float deltaT)
+{
     kVector direction;
+    kVector last_pos;
+    kVector impact_pos;
+    float* tail_pos;
     bool ground_collision = false;
     bool scenery_collision = false;
-    int snd_id = 0;
+    int events = 0;
     
     // If projectile is still being drawn (tracer not finished), then update
     // orientation of projectile and everything else that is associated when
@@ -391,10 +384,19 @@ void proj_object::update(float deltaT)
     if(projectile_flight)
     {
         // Update position/direction vectors
+        last_pos = pos;
         dir[1] += (-9.81 * deltaT);
         pos += (dir * deltaT);
         roll += (125.6637 * deltaT);
         
+        // Check for projectile passing into the ground anywhere along the
+        // step just taken (a single step may easily span several tiles).
+        if(map.segmentIntersect(last_pos, pos, impact_pos))
+        {
+            pos = impact_pos;
+            ground_collision = true;
+        }
+        
         // Update travel distance value
         travel_distance += (velocity * PROJ_VEL_MULTIPLIER * deltaT);
         
@@ -407,16 +409,12 @@ void proj_object::update(float deltaT)
             radius = 3.0;
         
         // Update Hull Matrix
-        glMatrixMode(GL_MODELVIEW);
-        glPushMatrix();
-        glLoadIdentity();
+        matrixIdentity((float*)hull_matrix);
         // Peform orientation
-        glTranslatef(pos[0], pos[1], pos[2]);
-        glRotatef(direction[2] * radToDeg, 0.0, 1.0, 0.0);
-        glRotatef(direction[1] * radToDeg, 1.0, 0.0, 0.0);
-        glRotatef(roll * radToDeg, 0.0, 1.0, 0.0);
-        glGetFloatv(GL_MODELVIEW_MATRIX, hull_matrix);
-        glPopMatrix();
+        matrixTranslate((float*)hull_matrix, pos[0], pos[1], pos[2]);
+        matrixRotateY((float*)hull_matrix, direction[2]);
+        matrixRotateX((float*)hull_matrix, direction[1]);
+        matrixRotateY((float*)hull_matrix, roll);
         
         // Update the life left for this projectile
         remove_timer -= deltaT;
@@ -426,13 +424,7 @@ void proj_object::update(float deltaT)
         {
             // Check for HE burster arm (to add explosion effect)
             if(obj_modifiers & AMMO_MOD_HE_BURSTER_ARMED)
-            {
-                effects.addEffect(SE_EXPLOSION, pos, dir, explosive);
-                snd_id = sounds.addSound(SOUND_EXPLOSION, SOUND_HIGH_PRIORITY,
-                    pos(), SOUND_PLAY_ONCE);
-                sounds.setSoundRolloff(snd_id, 0.05);
-                sounds.auxModOnExplosive(snd_id, explosive);
-            }
+                events |= PROJ_EVENT_BURST;
             
             // Set to stop projectile flight movement
             projectile_flight = false;
@@ -441,7 +433,7 @@ void proj_object::update(float deltaT)
             if(diameter < 1.5 && !(obj_modifiers & AMMO_MOD_TRACER))
             {
                 obj_status = OBJ_STATUS_REMOVE;
-                return;
+                return events;
             }
         }
         
@@ -451,31 +443,21 @@ void proj_object::update(float deltaT)
             tracer_timer += deltaT;
             
             // Determine whenever we need to advance our tracer tail
-            if(tracer_timer > PROJ_TRACER_TIMER)
+            while(tracer_timer > PROJ_TRACER_TIMER)
             {
-                while(tracer_timer > PROJ_TRACER_TIMER)
-                {
-                    for(i = PROJ_MAX_TRACER_TAIL - 1; i > 0; i--)
-                    {
-                        tracer_tail_pos[i][0] = tracer_tail_pos[i - 1][0];
-                        tracer_tail_pos[i][1] = tracer_tail_pos[i - 1][1];
-                        tracer_tail_pos[i][2] = tracer_tail_pos[i - 1][2];
-                    }
-                    
-                    tracer_timer -= PROJ_TRACER_TIMER;
-                }
+                advanceTracer();
+                tracer_timer -= PROJ_TRACER_TIMER;
             }
             
             // Always update first position
-            tracer_tail_pos[0][0] = pos[0];
-            tracer_tail_pos[0][1] = pos[1];
-            tracer_tail_pos[0][2] = pos[2];
+            tail_pos = tracerTail(0);
+            tail_pos[0] = pos[0];
+            tail_pos[1] = pos[1];
+            tail_pos[2] = pos[2];
         }
         
-        // Check for projectile hitting ground or hitting scenery objects.
-        if(map.groundCollision(pos))
-            ground_collision = true;
-        else if(map.sceneryCollision(pos))
+        // Check for projectile hitting scenery objects.
+        if(!ground_collision && map.sceneryCollision(pos))
             scenery_collision = true;
     }
     else
@@ -486,205 +468,263 @@ void proj_object::update(float deltaT)
             tracer_timer += deltaT;
             
             // Determine whenever we need to advance our tracer tail
-            if(tracer_timer >= PROJ_TRACER_TIMER)
+            while(tracer_timer >= PROJ_TRACER_TIMER)
             {
-                while(tracer_timer >= PROJ_TRACER_TIMER)
-                {
-                    for(i = PROJ_MAX_TRACER_TAIL - 1; i > 0; i--)
-                    {
-                        tracer_tail_pos[i][0] = tracer_tail_pos[i - 1][0];
-                        tracer_tail_pos[i][1] = tracer_tail_pos[i - 1][1];
-                        tracer_tail_pos[i][2] = tracer_tail_pos[i - 1][2];
-                    }
-                    
-                    tracer_timer -= PROJ_TRACER_TIMER;
-                    tracer_depth--;
-                }
+                advanceTracer();
+                tracer_timer -= PROJ_TRACER_TIMER;
+                tracer_depth--;
             }
             
             // See if tracer tail is done drawing
             if(tracer_depth <= 0)
             {
                 obj_status = OBJ_STATUS_REMOVE;
-                return;
+                return events;
             }
         }
         else
         {
             obj_status = OBJ_STATUS_REMOVE;
-            return;
+            return events;
         }
     }
     
     if(ground_collision || scenery_collision)
     {
-        float size;
         projectile_flight = false;
         
         //cout << SDL_GetTicks() << ": [" << (unsigned int)this << "]: G/S Collision Projectile remove" << endl;
         
         if(!projectile_damaged && cdr_passes <= 0)
+            events |= (ground_collision ? PROJ_EVENT_GROUND : PROJ_EVENT_SCENERY);
+    }
+    
+    return events;
+}
+
+/*******************************************************************************
+    function    :   proj_object::updateEvents
+    arguments   :   events - events raised by the flight step (PROJ_EVENT_xxx)
+                    deltaT - number of seconds elapsed since last update
+    purpose     :   Update step 2: adds the effects and sounds of the events
+                    raised by the flight step.
+    notes       :   Main thread only (deferred through the job system).
+*******************************************************************************/
+void proj_object::updateEvents(int events, float deltaT)
+{
+    bool ground_collision = (events & PROJ_EVENT_GROUND) != 0;
+    bool scenery_collision = (events & PROJ_EVENT_SCENERY) != 0;
+    float size;
+    int snd_id = 0;
+    
+    // HE burster went off in flight
+    if(events & PROJ_EVENT_BURST)
+    {
+        effects.addEffect(SE_EXPLOSION, pos, dir, explosive);
+        snd_id = sounds.addSound(SOUND_EXPLOSION, SOUND_HIGH_PRIORITY,
+            pos(), SOUND_PLAY_ONCE);
+        sounds.setSoundRolloff(snd_id, 0.05);
+        sounds.auxModOnExplosive(snd_id, explosive);
+    }
+    
+    if(ground_collision || scenery_collision)
+    {
+        // Add effect for shell hitting ground
+        switch(type)
         {
-            // Add effect for shell hitting ground
-            switch(type)
-            {
-                case AMMO_TYPE_AP:
-                case AMMO_TYPE_APC:
-                case AMMO_TYPE_APBC:
-                case AMMO_TYPE_APCBC:
-                case AMMO_TYPE_APCR:
-                case AMMO_TYPE_SMOKE:
-                    if(diameter >= 1.5)
+            case AMMO_TYPE_AP:
+            case AMMO_TYPE_APC:
+            case AMMO_TYPE_APBC:
+            case AMMO_TYPE_APCBC:
+            case AMMO_TYPE_APCR:
+            case AMMO_TYPE_SMOKE:
+                if(diameter >= 1.5)
+                {
+                    if(obj_modifiers & AMMO_MOD_HE_BURSTER)
                     {
-                        if(obj_modifiers & AMMO_MOD_HE_BURSTER)
+                        size = 10.0 * diameter - 5.0;
+                        if(ground_collision) 
                         {
-                            size = 10.0 * diameter - 5.0;
-                            if(ground_collision) 
-                            {
-                                // Add some dirt and dust cloud effects
-                                effects.addEffect(SE_DIRT, pos, size);
-                                effects.addEffect(SE_QF_BR_SMOKE, pos, size / 5.0f);
-                                snd_id = sounds.addSound(SOUND_GROUND_EXPLOSION,
-                                    SOUND_HIGH_PRIORITY, pos(), SOUND_PLAY_ONCE);
-                            }
-                            else if(scenery_collision)
-                            {
-                                // Add some debris and some dust cloud effects
-                                effects.addEffect(SE_DEBRIS, pos, normalized(dir) * -1.0f, diameter);
-                                effects.addEffect(SE_QF_WH_SMOKE, pos, 2.5f * diameter);
-                                snd_id = sounds.addSound(SOUND_EXPLOSION,
-                                    SOUND_HIGH_PRIORITY, pos(), SOUND_PLAY_ONCE);
-                            }
-                            
-                            // Explosion effect is universal
-                            effects.addEffect(SE_EXPLOSION, pos, explosive);
-                            
-                            // Do some sound modding
-                            sounds.setSoundRolloff(snd_id, 0.05);
-                            sounds.auxModOnExplosive(snd_id, explosive);
+                            // Add some dirt and dust cloud effects
+                            effects.addEffect(SE_DIRT, pos, size);
+                            effects.addEffect(SE_QF_BR_SMOKE, pos, size / 5.0f);
+                            snd_id = sounds.addSound(SOUND_GROUND_EXPLOSION,
+                                SOUND_HIGH_PRIORITY, pos(), SOUND_PLAY_ONCE);
                         }
-                        else
+                        else if(scenery_collision)
                         {
-                            size = 8.16667 * diameter - 11.25;
-                            if(ground_collision) 
-                            {
-                                // Add some dirt and dust cloud effects
-                                effects.addEffect(SE_DIRT, pos, size);
-                                effects.addEffect(SE_QF_BR_SMOKE, pos, size / 7.0f);
-                            }
-                            else if(scenery_collision)
-                            {
-                                // Add some debris and some dust cloud effects
-                                effects.addEffect(SE_DEBRIS, pos, normalized(dir) * -1.0f, diameter);
-                                effects.addEffect(SE_QF_WH_SMOKE, pos, 2.5f * diameter);
-                            }
-                            
-                            // Add a "thud" sound
-                            snd_id = sounds.addSound(
-                                    SOUND_SHELL_THUD,
-                                    SOUND_MID_PRIORITY, pos(), SOUND_PLAY_ONCE);
-                            
-                            // Do some sound modding
-                            sounds.setSoundRolloff(snd_id, 0.05);
+                            // Add some debris and some dust cloud effects
+                            effects.addEffect(SE_DEBRIS, pos, normalized(dir) * -1.0f, diameter);
+                            effects.addEffect(SE_QF_WH_SMOKE, pos, 2.5f * diameter);
+                            snd_id = sounds.addSound(SOUND_EXPLOSION,
+                                SOUND_HIGH_PRIORITY, pos(), SOUND_PLAY_ONCE);
                         }
+                        
+                        // Explosion effect is universal
+                        effects.addEffect(SE_EXPLOSION, pos, explosive);
+                        
+                        // Do some sound modding
+                        sounds.setSoundRolloff(snd_id, 0.05);
+                        sounds.auxModOnExplosive(snd_id, explosive);
                     }
                     else
-                        if(ground_collision)
-                            effects.addEffect(SE_MG_GROUND, pos);
-                        else if(scenery_collision)
-                            effects.addEffect(SE_MG_GROUND_SMOKE, pos);
-                    
-                    // Special case SMOKE projectiles
-                    if(type == AMMO_TYPE_SMOKE)
                     {
-                        char* temp;
-                        float weight;
-                        temp = db.query(obj_model, "WEIGHT");
-                        if(temp)
+                        size = 8.16667 * diameter - 11.25;
+                        if(ground_collision) 
                         {
-                            float amount;
-                            weight = atof(temp);
-                            amount = (58.823529 * weight) + 4.705882;
-                            if(amount > 0)
-                                effects.addEffect(SE_WH_DISPENSER_SMOKE, pos, amount);
+                            // Add some dirt and dust cloud effects
+                            effects.addEffect(SE_DIRT, pos, size);
+                            effects.addEffect(SE_QF_BR_SMOKE, pos, size / 7.0f);
                         }
+                        else if(scenery_collision)
+                        {
+                            // Add some debris and some dust cloud effects
+                            effects.addEffect(SE_DEBRIS, pos, normalized(dir) * -1.0f, diameter);
+                            effects.addEffect(SE_QF_WH_SMOKE, pos, 2.5f * diameter);
+                        }
+                        
+                        // Add a "thud" sound
+                        snd_id = sounds.addSound(
+                                SOUND_SHELL_THUD,
+                                SOUND_MID_PRIORITY, pos(), SOUND_PLAY_ONCE);
+                        
+                        // Do some sound modding
+                        sounds.setSoundRolloff(snd_id, 0.05);
                     }
-                    break;
-                    
-                case AMMO_TYPE_API:
-                case AMMO_TYPE_HE:
-                case AMMO_TYPE_HEAT:
-                case AMMO_TYPE_HESH:
-                    size = 11.1111 * diameter + 3.33333;
+                }
+                else
                     if(ground_collision)
-                    {
-                        effects.addEffect(SE_DIRT, pos, size);
-                        effects.addEffect(SE_QF_BR_SMOKE, pos, size / 5.0f);
-                        effects.addEffect(SE_EXPLOSION, pos, explosive);
-                        snd_id = sounds.addSound(SOUND_GROUND_EXPLOSION,
-                                    SOUND_HIGH_PRIORITY, pos(), SOUND_PLAY_ONCE);
-                    }
+                        effects.addEffect(SE_MG_GROUND, pos);
                     else if(scenery_collision)
+                        effects.addEffect(SE_MG_GROUND_SMOKE, pos);
+                
+                // Special case SMOKE projectiles
+                if(type == AMMO_TYPE_SMOKE)
+                {
+                    char* temp;
+                    float weight;
+                    temp = db.query(obj_model, "WEIGHT");
+                    if(temp)
                     {
-                        // Shrapnel to be replaced with debris later
-                        effects.addEffect(SE_SHRAPNEL, pos + (dir * (-deltaT/2.0f)), normalized(dir) * -1.0f, size);
-                        effects.addEffect(SE_QF_BR_SMOKE, pos + (dir * (-deltaT/2.0f)), normalized(dir) * -1.0f, size / 5.0f);
-                        effects.addEffect(SE_EXPLOSION, pos + (dir * (-deltaT/2.0f)), normalized(dir) * -1.0f, explosive);
-                        snd_id = sounds.addSound(SOUND_EXPLOSION,
-                                    SOUND_HIGH_PRIORITY, pos(), SOUND_PLAY_ONCE);
+                        float amount;
+                        weight = atof(temp);
+                        amount = (58.823529 * weight) + 4.705882;
+                        if(amount > 0)
+                            effects.addEffect(SE_WH_DISPENSER_SMOKE, pos, amount);
                     }
-                    sounds.setSoundRolloff(snd_id, 0.01);
-                    sounds.auxModOnExplosive(snd_id, explosive);
-                    break;
-                    
-                default:
-                    break;
-            }
+                }
+                break;
+                
+            case AMMO_TYPE_API:
+            case AMMO_TYPE_HE:
+            case AMMO_TYPE_HEAT:
+            case AMMO_TYPE_HESH:
+                size = 11.1111 * diameter + 3.33333;
+                if(ground_collision)
+                {
+                    effects.addEffect(SE_DIRT, pos, size);
+                    effects.addEffect(SE_QF_BR_SMOKE, pos, size / 5.0f);
+                    effects.addEffect(SE_EXPLOSION, pos, explosive);
+                    snd_id = sounds.addSound(SOUND_GROUND_EXPLOSION,
+                                SOUND_HIGH_PRIORITY, pos(), SOUND_PLAY_ONCE);
+                }
+                else if(scenery_collision)
+                {
+                    // Shrapnel to be replaced with debris later
+                    effects.addEffect(SE_SHRAPNEL, pos + (dir * (-deltaT/2.0f)), normalized(dir) * -1.0f, size);
+                    effects.addEffect(SE_QF_BR_SMOKE, pos + (dir * (-deltaT/2.0f)), normalized(dir) * -1.0f, size / 5.0f);
+                    effects.addEffect(SE_EXPLOSION, pos + (dir * (-deltaT/2.0f)), normalized(dir) * -1.0f, explosive);
+                    snd_id = sounds.addSound(SOUND_EXPLOSION,
+                                SOUND_HIGH_PRIORITY, pos(), SOUND_PLAY_ONCE);
+                }
+                sounds.setSoundRolloff(snd_id, 0.01);
+                sounds.auxModOnExplosive(snd_id, explosive);
+                break;
+                
+            default:
+                break;
         }
     }
+}
+
+/*******************************************************************************
+    function    :   proj_object::advanceTracer
+    arguments   :   <none>
+    purpose     :   Advances the tracer tail by one position, dropping the
+                    oldest position and starting the newest off as a copy of
+                    the current newest.
+    notes       :   The tail is a ring buffer, so this only moves the head.
+*******************************************************************************/
+void proj_object::advanceTracer()
+{
+    float* newest = tracerTail(0);
     
-    // Camera culling
-    draw = camera.sphereInView(pos(), 2.5);
-    if(!draw && ((obj_modifiers & AMMO_MOD_TRACER) || diameter >= 1.5))
+    tracer_head = (tracer_head + PROJ_MAX_TRACER_TAIL - 1) % PROJ_MAX_TRACER_TAIL;
+    
+    tracer_tail_pos[tracer_head][0] = newest[0];
+    tracer_tail_pos[tracer_head][1] = newest[1];
+    tracer_tail_pos[tracer_head][2] = newest[2];
+}
+
+/*******************************************************************************
+    function    :   proj_object::snapshot
+    arguments   :   snap - Render snapshot record to fill
+    purpose     :   Records what is displayed of the projectile.
+    notes       :   <none>
+*******************************************************************************/
+void proj_object::snapshot(snap_proj* snap)
+{
+    float* tail_pos;
+    int i;
+    
+    snap->radius = radius;
+    matrixCopy((float*)snap->hull_matrix, (float*)hull_matrix);
+    snap->diameter = diameter;
+    snap->modifiers = obj_modifiers;
+    snap->flight = projectile_flight;
+    snap->damaged = projectile_damaged;
+    
+    for(i = 0; i < PROJ_MAX_TRACER_TAIL; i++)
     {
-        for(i = 0; i < PROJ_MAX_TRACER_TAIL && !draw; i++)
-            draw = camera.pointInView(tracer_tail_pos[i]);
+        tail_pos = tracerTail(i);
+        snap->tail[i][0] = tail_pos[0];
+        snap->tail[i][1] = tail_pos[1];
+        snap->tail[i][2] = tail_pos[2];
     }
 }
 
 /*******************************************************************************
     function    :   proj_object::display
-    arguments   :   <none>
+    arguments   :   snap - Render snapshot record of projectile
+                    camPos - Camera position of frame
     purpose     :   Display routine.
-    notes       :   Going into the tracer/trail drawing routine, the matrix
-                    has not been poped off the stack so that the tracer blip
-                    (a GL_POINT) can be drawn in the correct spot behind the
-                    projectile (which requires a transformation).
+    notes       :   1) Tracer blips and tracer/smoke tails are not drawn here,
+                       but gathered into the tracer pass (see tracer_pass),
+                       which is drawn once all projectiles have been displayed.
+                    2) Culling is done by the snapshot module.
 *******************************************************************************/
-void proj_object::display()
+void proj_object::display(snap_proj* snap, float* camPos)
 {
-    //int i;
-    static float* cam_pos = camera.getCamPos();
     static int modlib_id = models.getModelID("shell");
-    
-    // Culling check
-    if(!draw)
-        return;
-
-    // Orient projectile
-    glPushMatrix();
-    
-    // Orient object
-    glMultMatrixf(hull_matrix);
-    
-    // Scale based on a multipler from accurate so that the round does
-    // actually show up on-screen in some fashion.
-    glScalef(diameter * 2.0, diameter * 2.0, diameter * 2.0);
+    float* tail[PROJ_MAX_TRACER_TAIL];
+    float* pos = &snap->hull_matrix[12];    // Position (as drawn)
+    int i;
     
     // Draw projectile
-    if(projectile_flight)
+    if(snap->flight)
     {
-        if(!projectile_damaged)
+        // Orient projectile
+        glPushMatrix();
+        
+        // Orient object
+        glMultMatrixf(snap->hull_matrix);
+        
+        // Scale based on a multipler from accurate so that the round does
+        // actually show up on-screen in some fashion.
+        glScalef(snap->diameter * 2.0, snap->diameter * 2.0,
+            snap->diameter * 2.0);
+        
+        if(!snap->damaged)
             models.drawModel(modlib_id, MDL_DRW_VERTEXARRAY);
         else
         {
@@ -693,288 +733,380 @@ void proj_object::display()
             models.drawModel(modlib_id, MDL_DRW_VERTEXARRAY_NO_MATERIAL);
             glDisable(GL_COLOR_MATERIAL);
         }
+        
+        glPopMatrix();
     }
     
-    // Tracer/trail drawing handler. Although the tracers are used primarily
-    // for tracer proj., it is also used for non-tracers to give a sorta
-    // small smoke trail line.
-    if(diameter >= 2.0 || (obj_modifiers & AMMO_MOD_TRACER))
+    // Tracer/trail handler. Although the tracers are used primarily for
+    // tracer proj., it is also used for non-tracers to give a sorta small
+    // smoke trail line.
+    if(snap->diameter >= 2.0 || (snap->modifiers & AMMO_MOD_TRACER))
     {
         // Sadly, when working with point sizes, we must compute distance.
         float distance =
-            sqrt(((cam_pos[0] - pos[0]) * (cam_pos[0] - pos[0])) +
-            ((cam_pos[1] - pos[1]) * (cam_pos[1] - pos[1])) +
-            ((cam_pos[2] - pos[2]) * (cam_pos[2] - pos[2])));
+            sqrt(((camPos[0] - pos[0]) * (camPos[0] - pos[0])) +
+            ((camPos[1] - pos[1]) * (camPos[1] - pos[1])) +
+            ((camPos[2] - pos[2]) * (camPos[2] - pos[2])));
         float base_size = distance * -0.0055;   // Change size with distance
         float size;
         
-        glEnable(GL_COLOR_MATERIAL);
-        glDisable(GL_TEXTURE_2D);
-        glEnable(GL_LINE_SMOOTH);
-        glEnable(GL_POINT_SMOOTH);
+        for(i = 0; i < PROJ_MAX_TRACER_TAIL; i++)
+            tail[i] = snap->tail[i];
         
-        if(obj_modifiers & AMMO_MOD_TRACER)
+        if(snap->modifiers & AMMO_MOD_TRACER)
         {
-            // Draw specific tracer line
-            switch(obj_modifiers & AMMO_MOD_TRACER)
+            if(snap->flight)
             {
-                case AMMO_MOD_YELLOW_TRACER:    // Draw yellow tracer
-                    if(projectile_flight)
-                    {
-                        // Determine size and clip. Draw smaller blip for MGs.
-                        if(diameter >= 2.0)
-                        {
-                            size = 3.75 + base_size;
-                            if(size < 0.5) size = 0.5;
-                        }
-                        else
-                        {
-                            size = 2.75 + base_size;
-                            if(size < 0.25) size = 0.25;
-                        }
-                        
-                        // Draw tracer blip (using GL_POINT)
-                        glPointSize(size);
-                        glColor4f(1.0, 1.0, 0.0, 1.0);
-                        glBegin(GL_POINTS);
-                            glVertex3f(0.0, -0.02, 0.0);
-                        glEnd();
-                    }
-                    
-                    // Done with blip - don't forget to pop matrix.
-                    glPopMatrix();
-                    
-                    if(diameter >= 2.0)
-                    {
-                        // Draw inner tracer blip run-off line for non-MGs
-                        size = 2.5 + base_size;
-                        if(size < 0.1) size = 0.1;      // Size clip
-                        glLineWidth(size);
-                        glBegin(GL_LINE_STRIP);
-                            glColor4f(1.0, 1.0, 0.2, 0.8);
-                            glVertex3fv(tracer_tail_pos[0]);
-                            glColor4f(1.0, 1.0, 0.3, 0.6);
-                            glVertex3fv(tracer_tail_pos[1]);
-                            glColor4f(1.0, 1.0, 0.4, 0.4);
-                            glVertex3fv(tracer_tail_pos[2]);
-                            glColor4f(1.0, 1.0, 0.5, 0.2);
-                            glVertex3fv(tracer_tail_pos[3]);
-                        glEnd();
-                    }
-                    break;
+                // Tracer blip sits just under the round
+                kVector blip(0.0, -0.02, 0.0);
+                blip.transform((float*)snap->hull_matrix);
                 
-                case AMMO_MOD_WHITE_TRACER:    // Draw white tracer
-                    if(projectile_flight)
-                    {
-                        // Determine size and clip. Draw smaller blip for MGs.
-                        if(diameter >= 2.0)
-                        {
-                            size = 3.75 + base_size;
-                            if(size < 0.5) size = 0.5;
-                        }
-                        else
-                        {
-                            size = 2.75 + base_size;
-                            if(size < 0.25) size = 0.25;
-                        }
-                        
-                        // Draw tracer blip (using GL_POINT)
-                        glPointSize(size);
-                        glColor4f(1.0, 1.0, 1.0, 1.0);
-                        glBegin(GL_POINTS);
-                            glVertex3f(0.0, -0.02, 0.0);
-                        glEnd();
-                    }
-                    
-                    // Done with blip - don't forget to pop matrix.
-                    glPopMatrix();
-                    
-                    if(diameter >= 2.0)
-                    {
-                        // Draw inner tracer blip run-off line for non-MGs
-                        size = 2.5 + base_size;
-                        if(size < 0.1) size = 0.1;      // Size clip
-                        glLineWidth(size);
-                        glBegin(GL_LINE_STRIP);
-                            glColor4f(1.0, 1.0, 1.0, 0.8);
-                            glVertex3fv(tracer_tail_pos[0]);
-                            glColor4f(1.0, 1.0, 1.0, 0.6);
-                            glVertex3fv(tracer_tail_pos[1]);
-                            glColor4f(1.0, 1.0, 1.0, 0.4);
-                            glVertex3fv(tracer_tail_pos[2]);
-                            glColor4f(1.0, 1.0, 1.0, 0.2);
-                            glVertex3fv(tracer_tail_pos[3]);
-                        glEnd();
-                    }
-                    break;
-                    
-                case AMMO_MOD_RED_TRACER:    // Draw red/white tracer
-                    if(projectile_flight)
-                    {
-                        // Determine size and clip. Draw smaller blip for MGs.
-                        if(diameter >= 2.0)
-                        {
-                            size = 3.75 + base_size;
-                            if(size < 0.5) size = 0.5;
-                        }
-                        else
-                        {
-                            size = 2.75 + base_size;
-                            if(size < 0.25) size = 0.25;
-                        }
-                        
-                        // Draw tracer blip (using GL_POINT)
-                        glPointSize(size);
-                        glColor4f(1.0, 0.3, 0.3, 1.0);
-                        glBegin(GL_POINTS);
-                            glVertex3f(0.0, -0.02, 0.0);
-                        glEnd();
-                    }
-                    
-                    // Done with blip - don't forget to pop matrix.
-                    glPopMatrix();
-                    
-                    if(diameter >= 2.0)
-                    {
-                        // Draw inner tracer blip run-off line for non-MGs
-                        size = 2.5 + base_size;
-                        if(size < 0.1) size = 0.1;      // Size clip
-                        glLineWidth(size);
-                        glBegin(GL_LINE_STRIP);
-                            glColor4f(1.0, 0.25, 0.25, 0.9);
-                            glVertex3fv(tracer_tail_pos[0]);
-                            glColor4f(1.0, 0.32, 0.32, 0.7);
-                            glVertex3fv(tracer_tail_pos[1]);
-                            glColor4f(1.0, 0.4, 0.4, 0.5);
-                            glVertex3fv(tracer_tail_pos[2]);
-                            glColor4f(1.0, 0.5, 0.5, 0.3);
-                            glVertex3fv(tracer_tail_pos[3]);
-                        glEnd();
-                    }
-                    break;
-                    
-                case AMMO_MOD_GREEN_TRACER:    // Draw green/white tracer
-                    if(projectile_flight)
-                    {
-                        // Determine size and clip. Draw smaller blip for MGs.
-                        if(diameter >= 2.0)
-                        {
-                            size = 3.75 + base_size;
-                            if(size < 0.5) size = 0.5;
-                        }
-                        else
-                        {
-                            size = 2.75 + base_size;
-                            if(size < 0.25) size = 0.25;
-                        }
-                        
-                        // Draw tracer blip (using GL_POINT)
-                        glPointSize(size);
-                        glColor4f(0.3, 1.0, 0.3, 1.0);
-                        glBegin(GL_POINTS);
-                            glVertex3f(0.0, -0.02, 0.0);
-                        glEnd();
-                    }
-                    
-                    // Done with blip - don't forget to pop matrix.
-                    glPopMatrix();
-                    
-                    if(diameter >= 2.0)
-                    {
-                        // Draw inner tracer blip run-off line for non-MGs
-                        size = 2.5 + base_size;
-                        if(size < 0.1) size = 0.1;      // Size clip
-                        glLineWidth(size);
-                        glBegin(GL_LINE_STRIP);
-                            glColor4f(0.25, 1.0, 0.25, 0.9);
-                            glVertex3fv(tracer_tail_pos[0]);
-                            glColor4f(0.32, 1.0, 0.32, 0.7);
-                            glVertex3fv(tracer_tail_pos[1]);
-                            glColor4f(0.4, 1.0, 0.4, 0.5);
-                            glVertex3fv(tracer_tail_pos[2]);
-                            glColor4f(0.5, 1.0, 0.5, 0.3);
-                            glVertex3fv(tracer_tail_pos[3]);
-                        glEnd();
-                    }
-                    break;
+                // Determine size and clip. Draw smaller blip for MGs.
+                if(snap->diameter >= 2.0)
+                {
+                    size = 3.75 + base_size;
+                    if(size < 0.5) size = 0.5;
+                }
+                else
+                {
+                    size = 2.75 + base_size;
+                    if(size < 0.25) size = 0.25;
+                }
+                
+                tracers.addBlip(snap->modifiers, size, blip());
             }
             
-            if(diameter >= 2.0)
+            if(snap->diameter >= 2.0)
             {
-                // Draw large smoke trail for non-MGs
-                size = 4.0 + base_size;
-                if(size < 0.1) size = 0.1;          // Size clip
-                glLineWidth(size);
-                glBegin(GL_LINE_STRIP);
-                    glColor4f(1.0, 1.0, 1.0, 0.25);
-                    glVertex3fv(tracer_tail_pos[0]);
-                    glVertex3fv(tracer_tail_pos[1]);
-                    glColor4f(1.0, 1.0, 1.0, 0.20);
-                    glVertex3fv(tracer_tail_pos[2]);
-                    glVertex3fv(tracer_tail_pos[3]);
-                    glVertex3fv(tracer_tail_pos[4]);
-                    glVertex3fv(tracer_tail_pos[5]);
-                    glColor4f(1.0, 1.0, 1.0, 0.15);
-                    glVertex3fv(tracer_tail_pos[6]);
-                    glColor4f(1.0, 1.0, 1.0, 0.10);
-                    glVertex3fv(tracer_tail_pos[7]);
-                    glColor4f(1.0, 1.0, 1.0, 0.05);
-                    glVertex3fv(tracer_tail_pos[8]);
-                    glColor4f(1.0, 1.0, 1.0, 0.00);
-                    glVertex3fv(tracer_tail_pos[9]);
-                glEnd();
+                // Inner tracer blip run-off line and large smoke trail for
+                // non-MGs
+                tracers.addTail(snap->modifiers, PROJ_TAIL_RUNOFF,
+                    2.5 + base_size, tail);
+                tracers.addTail(snap->modifiers, PROJ_TAIL_SMOKE,
+                    4.0 + base_size, tail);
             }
             else
+                // Small smoke trail for MGs
+                tracers.addTail(snap->modifiers, PROJ_TAIL_MG_SMOKE,
+                    3.0 + base_size, tail);
+        }
+        else
+            // Small trail line for non-tracers
+            tracers.addTail(snap->modifiers, PROJ_TAIL_PLAIN, 3.0 + base_size,
+                tail);
+    }
+}
+
+/* Tracer pass colours, by tracer colour (yellow, white, red, green) */
+static const float tracer_blip_colour[4][4] = {
+    {1.0, 1.0, 0.0, 1.0}, {1.0, 1.0, 1.0, 1.0},
+    {1.0, 0.3, 0.3, 1.0}, {0.3, 1.0, 0.3, 1.0} };
+static const float tracer_runoff_colour[4][4][4] = {
+    {{1.0, 1.0, 0.2, 0.8}, {1.0, 1.0, 0.3, 0.6},
+     {1.0, 1.0, 0.4, 0.4}, {1.0, 1.0, 0.5, 0.2}},
+    {{1.0, 1.0, 1.0, 0.8}, {1.0, 1.0, 1.0, 0.6},
+     {1.0, 1.0, 1.0, 0.4}, {1.0, 1.0, 1.0, 0.2}},
+    {{1.0, 0.25, 0.25, 0.9}, {1.0, 0.32, 0.32, 0.7},
+     {1.0, 0.4, 0.4, 0.5}, {1.0, 0.5, 0.5, 0.3}},
+    {{0.25, 1.0, 0.25, 0.9}, {0.32, 1.0, 0.32, 0.7},
+     {0.4, 1.0, 0.4, 0.5}, {0.5, 1.0, 0.5, 0.3}} };
+
+/* Tracer pass colours, by trail (same for every tracer colour) */
+static const float tracer_smoke_colour[10][4] = {
+    {1.0, 1.0, 1.0, 0.25}, {1.0, 1.0, 1.0, 0.25}, {1.0, 1.0, 1.0, 0.20},
+    {1.0, 1.0, 1.0, 0.20}, {1.0, 1.0, 1.0, 0.20}, {1.0, 1.0, 1.0, 0.20},
+    {1.0, 1.0, 1.0, 0.15}, {1.0, 1.0, 1.0, 0.10}, {1.0, 1.0, 1.0, 0.05},
+    {1.0, 1.0, 1.0, 0.00} };
+static const float tracer_mg_smoke_colour[7][4] = {
+    {1.0, 1.0, 1.0, 0.20}, {1.0, 1.0, 1.0, 0.20}, {1.0, 1.0, 1.0, 0.15},
+    {1.0, 1.0, 1.0, 0.15}, {1.0, 1.0, 1.0, 0.10}, {1.0, 1.0, 1.0, 0.05},
+    {1.0, 1.0, 1.0, 0.00} };
+static const float tracer_plain_colour[5][4] = {
+    {0.85, 0.85, 0.85, 0.50}, {0.75, 0.75, 0.75, 0.35},
+    {0.65, 0.65, 0.65, 0.25}, {0.65, 0.65, 0.65, 0.10},
+    {0.65, 0.65, 0.65, 0.00} };
+
+/*******************************************************************************
+    function    :   tracer_pass::tracer_pass
+    arguments   :   <none>
+    purpose     :   Constructor.
+    notes       :   <none>
+*******************************************************************************/
+tracer_pass::tracer_pass()
+{
+    int i, j;
+    
+    for(i = 0; i < PROJ_TRACER_BATCHES; i++)
+        for(j = 0; j < PROJ_TRACER_SIZES; j++)
+        {
+            lines[i][j].count = lines[i][j].size = 0;
+            lines[i][j].vertex = lines[i][j].colour = NULL;
+            points[i][j].count = points[i][j].size = 0;
+            points[i][j].vertex = points[i][j].colour = NULL;
+        }
+}
+
+/*******************************************************************************
+    function    :   tracer_pass::~tracer_pass
+    arguments   :   <none>
+    purpose     :   Deconstructor.
+    notes       :   <none>
+*******************************************************************************/
+tracer_pass::~tracer_pass()
+{
+    int i, j;
+    
+    for(i = 0; i < PROJ_TRACER_BATCHES; i++)
+        for(j = 0; j < PROJ_TRACER_SIZES; j++)
+        {
+            if(lines[i][j].vertex)
+            {
+                delete [] lines[i][j].vertex;
+                delete [] lines[i][j].colour;
+            }
+            if(points[i][j].vertex)
             {
-                // Draw small smoke trail for MGs
-                size = 3.0 + base_size;
-                if(size < 0.1) size = 0.1;          // Size clip
-                glLineWidth(size);
-                glBegin(GL_LINE_STRIP);
-                    glColor4f(1.0, 1.0, 1.0, 0.20);
-                    glVertex3fv(tracer_tail_pos[0]);
-                    glVertex3fv(tracer_tail_pos[1]);
-                    glColor4f(1.0, 1.0, 1.0, 0.15);                
-                    glVertex3fv(tracer_tail_pos[2]);
-                    glVertex3fv(tracer_tail_pos[3]);
-                    glColor4f(1.0, 1.0, 1.0, 0.10);
-                    glVertex3fv(tracer_tail_pos[4]);
-                    glColor4f(1.0, 1.0, 1.0, 0.05);
-                    glVertex3fv(tracer_tail_pos[5]);
-                    glColor4f(1.0, 1.0, 1.0, 0.00);
-                    glVertex3fv(tracer_tail_pos[6]);
-                glEnd();
+                delete [] points[i][j].vertex;
+                delete [] points[i][j].colour;
             }
         }
-        else
+}
+
+/*******************************************************************************
+    function    :   tracer_pass::batch_of
+    arguments   :   modifiers - round modifiers (AMMO_MOD_xxxx)
+    purpose     :   Returns the batch (tracer colour) for the given modifiers.
+    notes       :   Rounds without a tracer go into PROJ_TRACER_PLAIN.
+*******************************************************************************/
+int tracer_pass::batch_of(int modifiers)
+{
+    switch(modifiers & AMMO_MOD_TRACER)
+    {
+        case AMMO_MOD_YELLOW_TRACER:
+            return 0;
+        
+        case AMMO_MOD_WHITE_TRACER:
+            return 1;
+        
+        case AMMO_MOD_RED_TRACER:
+            return 2;
+        
+        case AMMO_MOD_GREEN_TRACER:
+            return 3;
+    }
+    
+    return PROJ_TRACER_PLAIN;
+}
+
+/*******************************************************************************
+    function    :   tracer_pass::size_of
+    arguments   :   size - line width/point size
+    purpose     :   Returns the size step the given line width/point size is
+                    drawn with.
+    notes       :   <none>
+*******************************************************************************/
+int tracer_pass::size_of(float size)
+{
+    int step = (int)(size / PROJ_TRACER_SIZE_STEP + 0.5);
+    
+    if(step < 0)
+        return 0;
+    if(step >= PROJ_TRACER_SIZES)
+        return PROJ_TRACER_SIZES - 1;
+    
+    return step;
+}
+
+/*******************************************************************************
+    function    :   tracer_pass::add_vertex
+    arguments   :   batch - batch to add to
+                    position - vertex position
+                    colour - vertex colour (rgba)
+    purpose     :   Adds a vertex to a batch, growing its arrays if needed.
+    notes       :   <none>
+*******************************************************************************/
+void tracer_pass::add_vertex(tracer_batch* batch, float* position,
+    const float* colour)
+{
+    GLfloat* vertex;
+    GLfloat* colours;
+    
+    if(batch->count >= batch->size)
+    {
+        batch->size = (batch->size ? batch->size * 2 : 256);
+        vertex = new GLfloat[batch->size * 3];
+        colours = new GLfloat[batch->size * 4];
+        
+        if(batch->vertex)
         {
-            glPopMatrix();      // Don't forget to pop matrix
-            
-            // Draw small trail line for non-tracers
-            size = 3.0 + base_size;
-            if(size < 0.1) size = 0.1;      // Size clip
-            glLineWidth(size);
-            glBegin(GL_LINE_STRIP);
-                glColor4f(0.85, 0.85, 0.85, 0.50);
-                glVertex3fv(tracer_tail_pos[0]);
-                glColor4f(0.75, 0.75, 0.75, 0.35);
-                glVertex3fv(tracer_tail_pos[1]);
-                glColor4f(0.65, 0.65, 0.65, 0.25);
-                glVertex3fv(tracer_tail_pos[2]);
-                glColor4f(0.65, 0.65, 0.65, 0.10);
-                glVertex3fv(tracer_tail_pos[3]);
-                glColor4f(0.65, 0.65, 0.65, 0.0);
-                glVertex3fv(tracer_tail_pos[4]);
-            glEnd();
+            memcpy(vertex, batch->vertex, sizeof(GLfloat) * 3 * batch->count);
+            memcpy(colours, batch->colour, sizeof(GLfloat) * 4 * batch->count);
+            delete [] batch->vertex;
+            delete [] batch->colour;
         }
         
-        glPointSize(1.0);
-        glLineWidth(1.0);
-        glDisable(GL_COLOR_MATERIAL);
-        glEnable(GL_TEXTURE_2D);    
-        glDisable(GL_LINE_SMOOTH);
-        glDisable(GL_POINT_SMOOTH);
+        batch->vertex = vertex;
+        batch->colour = colours;
     }
-    else
-        glPopMatrix();      // Don't forget to pop matrix
+    
+    vertex = &batch->vertex[batch->count * 3];
+    vertex[0] = position[0];
+    vertex[1] = position[1];
+    vertex[2] = position[2];
+    
+    colours = &batch->colour[batch->count * 4];
+    colours[0] = colour[0];
+    colours[1] = colour[1];
+    colours[2] = colour[2];
+    colours[3] = colour[3];
+    
+    batch->count++;
+}
+
+/*******************************************************************************
+    function    :   tracer_pass::addBlip
+    arguments   :   modifiers - round modifiers (AMMO_MOD_xxxx)
+                    size - point size
+                    position - position of blip
+    purpose     :   Adds a tracer blip to the pass.
+    notes       :   Rounds without a tracer have no blip.
+*******************************************************************************/
+void tracer_pass::addBlip(int modifiers, float size, float* position)
+{
+    int batch = batch_of(modifiers);
+    
+    if(batch == PROJ_TRACER_PLAIN)
+        return;
+    
+    add_vertex(&points[batch][size_of(size)], position,
+        tracer_blip_colour[batch]);
+}
+
+/*******************************************************************************
+    function    :   tracer_pass::addTail
+    arguments   :   modifiers - round modifiers (AMMO_MOD_xxxx)
+                    tail - tail to draw (PROJ_TAIL_xxxx)
+                    size - line width
+                    positions - tail positions (0 is newest)
+    purpose     :   Adds a tracer/smoke tail to the pass, as line segments
+                    joining each tail position to the next.
+    notes       :   positions must hold as many positions as the tail draws
+                    (see PROJ_TAIL_xxxx).
+*******************************************************************************/
+void tracer_pass::addTail(int modifiers, int tail, float size,
+    float** positions)
+{
+    int batch = batch_of(modifiers);
+    tracer_batch* lines_ptr;
+    const float* colour;
+    int count;
+    int i;
+    
+    switch(tail)
+    {
+        case PROJ_TAIL_RUNOFF:
+            if(batch == PROJ_TRACER_PLAIN)
+                return;
+            colour = tracer_runoff_colour[batch][0];
+            count = 4;
+            break;
+        
+        case PROJ_TAIL_SMOKE:
+            colour = tracer_smoke_colour[0];
+            count = 10;
+            break;
+        
+        case PROJ_TAIL_MG_SMOKE:
+            colour = tracer_mg_smoke_colour[0];
+            count = 7;
+            break;
+        
+        case PROJ_TAIL_PLAIN:
+            colour = tracer_plain_colour[0];
+            count = 5;
+            break;
+        
+        default:
+            return;
+    }
+    
+    lines_ptr = &lines[batch][size_of(size)];
+    
+    for(i = 0; i < count - 1; i++)
+    {
+        add_vertex(lines_ptr, positions[i], &colour[i * 4]);
+        add_vertex(lines_ptr, positions[i + 1], &colour[(i + 1) * 4]);
+    }
+}
+
+/*******************************************************************************
+    function    :   tracer_pass::draw_batch
+    arguments   :   batch - batch to draw
+                    mode - GL primitive to draw batch as
+    purpose     :   Draws a batch in one call and empties it.
+    notes       :   Vertex and colour arrays must be enabled.
+*******************************************************************************/
+void tracer_pass::draw_batch(tracer_batch* batch, GLenum mode)
+{
+    glVertexPointer(3, GL_FLOAT, 0, (void*)batch->vertex);
+    glColorPointer(4, GL_FLOAT, 0, (void*)batch->colour);
+    
+    glDrawArrays(mode, 0, batch->count);
+    
+    batch->count = 0;
+}
+
+/*******************************************************************************
+    function    :   tracer_pass::draw
+    arguments   :   <none>
+    purpose     :   Draws everything gathered into the pass, then empties it.
+    notes       :   Tails are drawn before blips, so blips are on top.
+*******************************************************************************/
+void tracer_pass::draw()
+{
+    int i, j;
+    float size;
+    
+    glEnable(GL_COLOR_MATERIAL);
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_LINE_SMOOTH);
+    glEnable(GL_POINT_SMOOTH);
+    
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    
+    for(j = 0; j < PROJ_TRACER_SIZES; j++)
+    {
+        size = j * PROJ_TRACER_SIZE_STEP;
+        if(size < PROJ_TRACER_MIN_SIZE)
+            size = PROJ_TRACER_MIN_SIZE;
+        glLineWidth(size);
+        
+        for(i = 0; i < PROJ_TRACER_BATCHES; i++)
+            if(lines[i][j].count)
+                draw_batch(&lines[i][j], GL_LINES);
+    }
+    
+    for(j = 0; j < PROJ_TRACER_SIZES; j++)
+    {
+        size = j * PROJ_TRACER_SIZE_STEP;
+        if(size < PROJ_TRACER_MIN_SIZE)
+            size = PROJ_TRACER_MIN_SIZE;
+        glPointSize(size);
+        
+        for(i = 0; i < PROJ_TRACER_BATCHES; i++)
+            if(points[i][j].count)
+                draw_batch(&points[i][j], GL_POINTS);
+    }
+    
+    glDisableClientState(GL_COLOR_ARRAY);
+    
+    glPointSize(1.0);
+    glLineWidth(1.0);
+    glDisable(GL_COLOR_MATERIAL);
+    glEnable(GL_TEXTURE_2D);
+    glDisable(GL_LINE_SMOOTH);
+    glDisable(GL_POINT_SMOOTH);
 }
@@ -4,6 +4,7 @@
 #ifndef PROJECTILE_H
 #define PROJECTILE_H
 
+#include "ballistics.h"
 #include "metrics.h"
 #include "object.h"
 #include "objhandler.h"
@@ -35,9 +36,28 @@
 #define PROJ_MAX_TRACER_TAIL    10      // Tracer tail length - DO NOT CHANGE!
 #define PROJ_TRACER_TIMER       0.015   // Tracer tail time per position
 
+// Tracer Pass
+#define PROJ_TRACER_BATCHES     5       // Batches (per tracer colour + plain)
+#define PROJ_TRACER_PLAIN       4       // Batch of non-tracer trails
+#define PROJ_TRACER_SIZES       9       // Line width/point size steps
+#define PROJ_TRACER_SIZE_STEP   0.5     // Line width/point size step
+#define PROJ_TRACER_MIN_SIZE    0.1     // Smallest line width/point size
+
+#define PROJ_TAIL_RUNOFF        0       // Tracer run-off line (4 positions)
+#define PROJ_TAIL_SMOKE         1       // Shell smoke trail (10 positions)
+#define PROJ_TAIL_MG_SMOKE      2       // MG smoke trail (7 positions)
+#define PROJ_TAIL_PLAIN         3       // Non-tracer trail (5 positions)
+
 #define PROJ_FIRE_DISPERSION    0.06    // Dispersion angle (for firing/init)
 #define PROJ_INT_DISPERSION     15.0    // Dispersion angle (for interrupt)
 
+// Flight Events (raised by updateFlight, handled by updateEvents)
+#define PROJ_EVENT_BURST        0x01    // HE burster went off in flight
+#define PROJ_EVENT_GROUND       0x02    // Struck the ground
+#define PROJ_EVENT_SCENERY      0x04    // Struck a scenery object
+
+struct snap_proj;                       // Render snapshot record (snapshot.h)
+
 /* String Parsing Helper Functions */
 short int ammoType(char* typeStr);
 
@@ -68,10 +88,12 @@ struct proj_object : public object
     float velocity;                 // Velocity (in m/s)
     float diameter;                 // Caliber (in cm)
     float explosive;                // Explosive content in shell (in kg)
+    bl_ammo_table* ammo_table;      // Ballistic tables of round
     
     /*/ Tracer/Smoke Trail Extension */
     float tracer_timer;
     int tracer_depth;
+    int tracer_head;                // Newest tail position (ring buffer)
     float tracer_tail_pos[PROJ_MAX_TRACER_TAIL][3];
     
     /* Functions */
@@ -87,6 +109,11 @@ struct proj_object : public object
     void interupt(kVector newPos, kVector newDir, float newVelocity,
         float timeOver, bool damageShell);
     
+    /* Tracer Tail (0 is newest) */
+    float* tracerTail(int position)
+        { return tracer_tail_pos[(tracer_head + position) % PROJ_MAX_TRACER_TAIL]; }
+    void advanceTracer();
+    
     /* Mutators */
     void killProj()
         { projectile_flight = false; }
@@ -97,7 +124,61 @@ struct proj_object : public object
     
     /* Base Update and Display Routines */
     void update(float deltaT);
-    void display();
+    int updateFlight(float deltaT);         // (job safe)
+    void updateEvents(int events, float deltaT);
+    void snapshot(snap_proj* snap);
+    static void display(snap_proj* snap, float* camPos);
+};
+
+// Tracer Pass Batch (vertex array)
+struct tracer_batch
+{
+    int count;                          // Vertices in batch
+    int size;                           // Vertices allocated
+    GLfloat* vertex;                    // Vertex array (xyz)
+    GLfloat* colour;                    // Colour array (rgba)
 };
 
+/*******************************************************************************
+    class       :   tracer_pass
+    purpose     :   Render pass for tracer blips and tracer/smoke tails. As
+                    projectiles and MG bullets are displayed, their blips and
+                    tails are gathered into vertex arrays, which are then all
+                    drawn at once by draw().
+    notes       :   1) Arrays are kept per tracer colour (AMMO_MOD_xxx_TRACER),
+                       plus one for non-tracer trails, and per line width/point
+                       size step, since width and size cannot change inside of
+                       a single draw call. Sizes are rounded to the nearest
+                       PROJ_TRACER_SIZE_STEP.
+                    2) Tails are drawn as line segments with a colour for each
+                       vertex, so fading matches the old line strips.
+                    3) Arrays only grow, so there is no allocation once enough
+                       room has been made.
+*******************************************************************************/
+class tracer_pass
+{
+    private:
+        tracer_batch lines[PROJ_TRACER_BATCHES][PROJ_TRACER_SIZES];
+        tracer_batch points[PROJ_TRACER_BATCHES][PROJ_TRACER_SIZES];
+        
+        int batch_of(int modifiers);
+        int size_of(float size);
+        void add_vertex(tracer_batch* batch, float* position,
+            const float* colour);
+        void draw_batch(tracer_batch* batch, GLenum mode);
+        
+    public:
+        tracer_pass();                  // Constructor
+        ~tracer_pass();                 // Deconstructor
+        
+        /* Gathering Routines */
+        void addBlip(int modifiers, float size, float* position);
+        void addTail(int modifiers, int tail, float size, float** positions);
+        
+        /* Draw Routine */
+        void draw();
+};
+
+extern tracer_pass tracers;
+
 #endif
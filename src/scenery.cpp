@@ -40,6 +40,31 @@ scenery_module::scenery_module()
     tol_head = NULL;
     tree_count = 0;
     bol_head = NULL;
+    plane_data = NULL;
+    blockmap_raster = NULL;
+    tiletype_raster = NULL;
+    raster_width = raster_height = 0;
+    raster_scale = 1.0;
+    maxmip_levels = 0;
+    los_clock = 0.0;
+    atlas_page_count = 0;
+    atlas_slot_count = 0;
+    atlas_slot_width = atlas_slot_height = 0;
+    atlas_pitch_x = atlas_pitch_y = 1;
+    
+    for(i = 0; i < SC_ATLAS_MAX_PAGES; i++)
+    {
+        atlas_image[i] = NULL;
+        atlas_texture_id[i] = TEXTURE_NULL;
+    }
+    
+    for(i = 0; i < SC_MAXMIP_LEVELS; i++)
+    {
+        maxmip[i] = NULL;
+        maxmip_width[i] = maxmip_height[i] = 0;
+    }
+    
+    clearLineOfSight();
     
     for(i = 0; i < 256; i++)
     {
@@ -51,6 +76,8 @@ scenery_module::scenery_module()
         tilemap[i].x_flip = false;
         tilemap[i].y_flip = false;
         tilemap[i].rotate_ccw = false;
+        tilemap[i].atlas_slot = -1;
+        tilemap[i].atlas_page = 0;
     }
     
     for(i = 0; i < 10; i++)
@@ -74,12 +101,27 @@ scenery_module::~scenery_module()
     if(parsec)
         delete parsec;
     
+    for(i = 0; i < SC_ATLAS_MAX_PAGES; i++)
+        if(atlas_image[i])
+            delete [] atlas_image[i];
+    
     if(heightmap)
     {
         delete *heightmap;
         delete heightmap;
     }
     
+    if(plane_data)
+        delete [] plane_data;
+    if(blockmap_raster)
+        delete [] blockmap_raster;
+    if(tiletype_raster)
+        delete [] tiletype_raster;
+    
+    for(i = 0; i < maxmip_levels; i++)
+        if(maxmip[i])
+            delete [] maxmip[i];
+    
     for(z = 0; z < ta_height; z++)
         for(x = 0; x < ta_width; x++)
             if((sel_curr = tile[x][z].sel_head) != NULL)
@@ -205,6 +247,9 @@ void scenery_module::buildScenery()
     build_bridges();
     loader.advanceLoadBar(5);
     loader.display();
+    
+    // Build blockmap/tile type rasters (after bridges)
+    build_rasters();
 }
 
 /*******************************************************************************
@@ -516,7 +561,8 @@ void scenery_module::load_scenery(char* file)
     function    :   scenery_module::load_textures()
     arguments   :   <none>
     purpose     :   Pre-loads all textures associated with the scenery.
-    notes       :   <none>
+    notes       :   Tile textures are not registered one by one, but are packed
+                    into a handful of atlas pages (see atlas_add/build_atlas).
 *******************************************************************************/
 void scenery_module::load_textures()
 {
@@ -529,6 +575,10 @@ void scenery_module::load_textures()
                            {'\0'}, {"wheat"}, {"corn"}, {"vine"}, {'\0'}};
     int tile_type;
     int png_num;
+    GLint max_size;
+    
+    // Free atlas of any previously loaded map
+    free_atlas();
     
     // Load water texture
     water_texture_id = textures.loadTexture("Scenery/Misc/water.png", "Scenery/water.png");
@@ -564,8 +614,19 @@ void scenery_module::load_textures()
     sprintf(buffer, "Scenery/%s/0.png", season_name);
     base_image = loadImage(buffer, 32, width, height);
     if(base_image)
-        tilemap[0].texture_id =
-            textures.addTexture(buffer, base_image, 32, width, height);
+    {
+        // Size atlas pages off of the base tile - all tiles share its size
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+        if(max_size > SC_ATLAS_SIZE)
+            max_size = SC_ATLAS_SIZE;
+        atlas_slot_width = width;
+        atlas_slot_height = height;
+        atlas_pitch_x = (width < max_size ? max_size / width : 1);
+        atlas_pitch_y = (height < max_size ? max_size / height : 1);
+        
+        // Base tile always occupies the first atlas slot
+        tilemap[0].atlas_slot = atlas_add(base_image);
+    }
     else
     {
         sprintf(buffer, "Scenery: FATAL: Tile base Scenery/%s/0.png not found!",
@@ -583,13 +644,13 @@ void scenery_module::load_textures()
                 png_num = tile[x][z].tilemap_ptr->png_num;
                 
                 // Load base tile graphic
-                if(tile[x][z].tilemap_ptr->texture_id == TEXTURE_NULL)
+                if(tile[x][z].tilemap_ptr->atlas_slot == -1)
                 {
-                    if(tilemap[png_num].texture_id != TEXTURE_NULL)
+                    if(tilemap[png_num].atlas_slot != -1)
                     {
-                        // Copy over texture if already loaded
-                        tile[x][z].tilemap_ptr->texture_id =
-                            tilemap[png_num].texture_id;
+                        // Copy over atlas slot if already loaded
+                        tile[x][z].tilemap_ptr->atlas_slot =
+                            tilemap[png_num].atlas_slot;
                     }
                     else
                     {
@@ -610,12 +671,18 @@ void scenery_module::load_textures()
                             }
                         }
                         
-                        // Load image, blend into base, and register with texlib
+                        // Load image, blend into base, and pack into atlas
                         curr_image = loadImage(buffer, 32, width, height);
+                        if(width != atlas_slot_width || height != atlas_slot_height)
+                        {
+                            sprintf(buffer,
+                                "Scenery: FATAL: Tile %i.png does not match base tile size!",
+                                png_num);
+                            write_error(buffer);
+                            exit(1);
+                        }
                         blendImage(base_image, curr_image, 32, width, height);
-                        sprintf(buffer, "Scenery/%i.png", png_num);
-                        tile[x][z].tilemap_ptr->texture_id =
-                            textures.addTexture(buffer, curr_image, 32, width, height);
+                        tile[x][z].tilemap_ptr->atlas_slot = atlas_add(curr_image);
                         
                         // Free current texture
                         delete curr_image;
@@ -865,6 +932,9 @@ void scenery_module::load_textures()
                 }
             }
     
+    // Register atlas pages (still clamped) and bake tile UVs
+    build_atlas();
+    
     // Free base texture
     delete base_image;
     
@@ -872,6 +942,178 @@ void scenery_module::load_textures()
     textures.setWrapping();
 }
 
+/*******************************************************************************
+    function    :   scenery_module::atlas_add
+    arguments   :   image - 32bpp tile image (atlas_slot_width x height)
+    purpose     :   Packs a tile image into the next free slot of the tile
+                    atlas, allocating a new atlas page image if needed.
+                    Returns the slot number used.
+    notes       :   1) Slots fill left to right, top to bottom, page by page.
+                    2) Page images are only kept until build_atlas is called.
+*******************************************************************************/
+int scenery_module::atlas_add(GLubyte* image)
+{
+    int slot = atlas_slot_count;
+    int page = slot / (atlas_pitch_x * atlas_pitch_y);
+    int page_slot = slot % (atlas_pitch_x * atlas_pitch_y);
+    int page_width = atlas_pitch_x * atlas_slot_width;
+    int page_height = atlas_pitch_y * atlas_slot_height;
+    
+    // Check for available page
+    if(page >= SC_ATLAS_MAX_PAGES)
+    {
+        write_error("Scenery: FATAL: Tile atlas page limit reached.");
+        exit(1);
+    }
+    
+    // Allocate (and clear) a new page image if this slot starts one
+    if(atlas_image[page] == NULL)
+    {
+        atlas_image[page] = new GLubyte[page_width * page_height * 4];
+        memset(atlas_image[page], 0, page_width * page_height * 4);
+        atlas_page_count = page + 1;
+    }
+    
+    // Blit tile into its slot (tiles are fully opaque by now)
+    blitImage(image, atlas_image[page], 32, atlas_slot_width,
+        atlas_slot_height, page_width, page_height,
+        (page_slot % atlas_pitch_x) * atlas_slot_width,
+        (page_slot / atlas_pitch_x) * atlas_slot_height);
+    
+    atlas_slot_count++;
+    
+    return slot;
+}
+
+/*******************************************************************************
+    function    :   scenery_module::build_atlas
+    arguments   :   <none>
+    purpose     :   Registers all atlas pages with the texture library and
+                    bakes each tilemap entry's flips and rotation into the
+                    atlas UV coordinates of its four corners.
+    notes       :   1) addTexture flips page images upside-down, which turns
+                       slot rows around (slot row 0 ends up at the top of the
+                       texture, e.g. the highest t values).
+                    2) UVs are inset by SC_ATLAS_INSET texels to keep linear
+                       filtering from sampling neighbouring slots.
+*******************************************************************************/
+void scenery_module::build_atlas()
+{
+    int i, j;
+    int page_slot;
+    int page_width = atlas_pitch_x * atlas_slot_width;
+    int page_height = atlas_pitch_y * atlas_slot_height;
+    float s_min, s_size, t_min, t_size;
+    float u, v;
+    bool x_flip, y_flip;
+    char buffer[64];
+    // Unrotated/unflipped unit UVs for the NW, NE, SW, SE corners
+    static const float corner[4][2] = {{0.0, 1.0}, {1.0, 1.0},
+                                       {0.0, 0.0}, {1.0, 0.0}};
+    
+    // Register atlas pages with texlib and free image data
+    for(i = 0; i < atlas_page_count; i++)
+    {
+        sprintf(buffer, "Scenery/atlas_%i.png", i);
+        atlas_texture_id[i] = textures.addTexture(buffer, atlas_image[i], 32,
+            page_width, page_height);
+        delete [] atlas_image[i];
+        atlas_image[i] = NULL;
+    }
+    
+    // Bake atlas UVs for every tilemap entry in use
+    for(i = 0; i < 256; i++)
+    {
+        if(tilemap[i].atlas_slot == -1)
+            continue;
+        
+        tilemap[i].atlas_page = tilemap[i].atlas_slot /
+            (atlas_pitch_x * atlas_pitch_y);
+        tilemap[i].texture_id = atlas_texture_id[tilemap[i].atlas_page];
+        page_slot = tilemap[i].atlas_slot % (atlas_pitch_x * atlas_pitch_y);
+        
+        // Slot extents inside of the page (in texture coordinates)
+        s_min = ((float)((page_slot % atlas_pitch_x) * atlas_slot_width) +
+            SC_ATLAS_INSET) / (float)page_width;
+        s_size = ((float)atlas_slot_width - (2.0 * SC_ATLAS_INSET)) /
+            (float)page_width;
+        t_min = ((float)((atlas_pitch_y - 1 - (page_slot / atlas_pitch_x)) *
+            atlas_slot_height) + SC_ATLAS_INSET) / (float)page_height;
+        t_size = ((float)atlas_slot_height - (2.0 * SC_ATLAS_INSET)) /
+            (float)page_height;
+        
+        // See build_heightmap in regards to the flips being swapped when the
+        // tile is rotated (flips are done mentally first, then the rotate).
+        if(!tilemap[i].rotate_ccw)
+        {
+            x_flip = tilemap[i].x_flip;
+            y_flip = tilemap[i].y_flip;
+        }
+        else
+        {
+            x_flip = tilemap[i].y_flip;
+            y_flip = tilemap[i].x_flip;
+        }
+        
+        for(j = 0; j < 4; j++)
+        {
+            if(!tilemap[i].rotate_ccw)
+            {
+                u = x_flip ? 1.0 - corner[j][0] : corner[j][0];
+                v = y_flip ? 1.0 - corner[j][1] : corner[j][1];
+            }
+            else
+            {
+                u = x_flip ? 1.0 - corner[j][1] : corner[j][1];
+                v = y_flip ? corner[j][0] : 1.0 - corner[j][0];
+            }
+            
+            tilemap[i].atlas_texel[j][0] = s_min + (u * s_size);
+            tilemap[i].atlas_texel[j][1] = t_min + (v * t_size);
+        }
+    }
+}
+
+/*******************************************************************************
+    function    :   scenery_module::free_atlas
+    arguments   :   <none>
+    purpose     :   Frees the atlas pages of a previously loaded map (page images
+                    and their textures), and clears all tile atlas slots.
+    notes       :   Page textures are removed from the texture library so that
+                    the next map's pages are not resolved to the old ones by
+                    name.
+*******************************************************************************/
+void scenery_module::free_atlas()
+{
+    int i;
+    char buffer[64];
+    
+    for(i = 0; i < SC_ATLAS_MAX_PAGES; i++)
+    {
+        if(atlas_image[i])
+        {
+            delete [] atlas_image[i];
+            atlas_image[i] = NULL;
+        }
+        
+        if(atlas_texture_id[i] != TEXTURE_NULL)
+        {
+            sprintf(buffer, "Scenery/atlas_%i.png", i);
+            textures.removeTexture(buffer);
+            atlas_texture_id[i] = TEXTURE_NULL;
+        }
+    }
+    
+    for(i = 0; i < 256; i++)
+    {
+        tilemap[i].atlas_slot = -1;
+        tilemap[i].atlas_page = 0;
+    }
+    
+    atlas_page_count = 0;
+    atlas_slot_count = 0;
+}
+
 /*******************************************************************************
     Map Building Routines
 *******************************************************************************/
@@ -881,10 +1123,13 @@ void scenery_module::load_textures()
     arguments   :   <none>
     purpose     :   Builds the heightmap planes which are used to calculate
                     the approximate height of the map at any position.
-    notes       :   Is based off of extensive use of the plane eq. Ax+By+Cz=D
-                    as well as the use of a reduced version of the "planer best
-                    fit" algorithm which manufacturers the best fit plane to
-                    four points in 3D space.
+    notes       :   1) Is based off of extensive use of the plane eq. Ax+By+Cz=D
+                       as well as the use of a reduced version of the "planer
+                       best fit" algorithm which manufacturers the best fit
+                       plane to four points in 3D space.
+                    2) Plane data is kept in its own flat array (see
+                       tile_plane) rather than in tile_data, so that height
+                       lookups only touch the 32 bytes per tile they need.
 *******************************************************************************/
 void scenery_module::build_planes()
 {
@@ -892,20 +1137,30 @@ void scenery_module::build_planes()
     kVector u;
     kVector v;
     kVector n;
+    float* plane;
+    
+    // Free any previous plane array (map may differ in size)
+    if(plane_data)
+        delete [] plane_data;
+    
+    // Allocate flat plane array
+    plane_data = new float[ta_width * ta_height * SC_PLANE_STRIDE];
     
     for(z = 0; z < ta_height; z++)
         for(x = 0; x < ta_width; x++)
         {
+            plane = tile_plane(x, z);
+            
             // 0 - North West Trisect
             // U = west edge, V = north edge
             u = kVector(0.0, heightmap[x][z+1] - heightmap[x][z], tile_size);
             v = kVector(tile_size, heightmap[x+1][z] - heightmap[x][z], 0.0);
             // N = cross u,v, D = dot N point
             n = normalized(crossProduct(u, v));
-            tile[x][z].plane[0] = n[0];
-            tile[x][z].plane[1] = n[1];
-            tile[x][z].plane[2] = n[2];
-            tile[x][z].plane[3] = dotProduct(n, kVector(
+            plane[0] = n[0];
+            plane[1] = n[1];
+            plane[2] = n[2];
+            plane[3] = dotProduct(n, kVector(
                 x * tile_size, heightmap[x][z], z * tile_size));
             
             // 1 - South East Trisect
@@ -914,12 +1169,137 @@ void scenery_module::build_planes()
             v = kVector(-tile_size, heightmap[x][z+1] - heightmap[x+1][z+1], 0.0);
             // N = cross u,v, D = dot N point
             n = normalized(crossProduct(u, v));
-            tile[x][z].plane[4] = n[0];
-            tile[x][z].plane[5] = n[1];
-            tile[x][z].plane[6] = n[2];
-            tile[x][z].plane[7] = dotProduct(n, kVector(
+            plane[4] = n[0];
+            plane[5] = n[1];
+            plane[6] = n[2];
+            plane[7] = dotProduct(n, kVector(
                 (x+1) * tile_size, heightmap[x+1][z+1], (z+1) * tile_size));
         }
+    
+    // Build max height pyramid off of the new planes
+    build_maxmip();
+}
+
+/*******************************************************************************
+    function    :   scenery_module::build_maxmip()
+    arguments   :   <none>
+    purpose     :   Builds the max height pyramid used by rayIntersect to skip
+                    over areas of the map which a ray passes above.
+    notes       :   1) Level 0 holds the highest corner of each tile (or the
+                       bridge height, if higher), and each level above holds
+                       the max of the 2x2 cells beneath it, up to a single
+                       cell covering the entire map.
+                    2) Called from build_planes, and again from build_bridges
+                       once bridge heights are known. Safe to call repeatedly.
+*******************************************************************************/
+void scenery_module::build_maxmip()
+{
+    int i, x, z;
+    int w, h;
+    float height;
+    
+    // Free any previous pyramid
+    for(i = 0; i < maxmip_levels; i++)
+    {
+        if(maxmip[i])
+            delete [] maxmip[i];
+        maxmip[i] = NULL;
+    }
+    maxmip_levels = 0;
+    
+    if(ta_width <= 0 || ta_height <= 0)
+        return;
+    
+    // Level 0 - per tile max
+    maxmip_width[0] = ta_width;
+    maxmip_height[0] = ta_height;
+    maxmip[0] = new float[ta_width * ta_height];
+    for(z = 0; z < ta_height; z++)
+        for(x = 0; x < ta_width; x++)
+        {
+            height = max_value(
+                max_value(heightmap[x][z], heightmap[x+1][z]),
+                max_value(heightmap[x][z+1], heightmap[x+1][z+1]));
+            if(tile[x][z].bridge_ptr != NULL)
+                height = max_value(height, tile[x][z].bridge_ptr->height);
+            maxmip[0][z * ta_width + x] = height;
+        }
+    maxmip_levels = 1;
+    
+    // Upper levels - max of 2x2 cells below (odd edges carry over)
+    while((maxmip_width[maxmip_levels-1] > 1 ||
+           maxmip_height[maxmip_levels-1] > 1) &&
+          maxmip_levels < SC_MAXMIP_LEVELS)
+    {
+        i = maxmip_levels;
+        w = maxmip_width[i-1];
+        h = maxmip_height[i-1];
+        maxmip_width[i] = (w + 1) / 2;
+        maxmip_height[i] = (h + 1) / 2;
+        maxmip[i] = new float[maxmip_width[i] * maxmip_height[i]];
+        
+        for(z = 0; z < maxmip_height[i]; z++)
+            for(x = 0; x < maxmip_width[i]; x++)
+            {
+                height = maxmip[i-1][(z*2) * w + (x*2)];
+                if(x*2 + 1 < w)
+                    height = max_value(height, maxmip[i-1][(z*2) * w + (x*2 + 1)]);
+                if(z*2 + 1 < h)
+                {
+                    height = max_value(height, maxmip[i-1][(z*2 + 1) * w + (x*2)]);
+                    if(x*2 + 1 < w)
+                        height = max_value(height,
+                            maxmip[i-1][(z*2 + 1) * w + (x*2 + 1)]);
+                }
+                maxmip[i][z * maxmip_width[i] + x] = height;
+            }
+        
+        maxmip_levels++;
+    }
+}
+
+/*******************************************************************************
+    function    :   scenery_module::build_rasters()
+    arguments   :   <none>
+    purpose     :   Rasterizes the blockmap and tile type data of the map into
+                    byte grids of SC_RASTER_SIZE cells, so that lookups do not
+                    need to go through the tile cut patterns of on_tile.
+    notes       :   1) Each cell takes the value at its center point.
+                    2) Must be called after build_bridges, since bridges
+                       override the blockmap.
+                    3) Grids are row major (z * raster_width + x) and may be
+                       shared read-only through the raster accessors.
+*******************************************************************************/
+void scenery_module::build_rasters()
+{
+    int x, z;
+    float x_val, z_val;
+    
+    // Free any previous rasters
+    if(blockmap_raster)
+        delete [] blockmap_raster;
+    if(tiletype_raster)
+        delete [] tiletype_raster;
+    
+    raster_scale = 1.0 / SC_RASTER_SIZE;
+    raster_width = (int)ceil(map_width * raster_scale);
+    raster_height = (int)ceil(map_height * raster_scale);
+    
+    blockmap_raster = new GLubyte[raster_width * raster_height];
+    tiletype_raster = new GLubyte[raster_width * raster_height];
+    
+    for(z = 0; z < raster_height; z++)
+    {
+        z_val = (z + 0.5) * SC_RASTER_SIZE;
+        for(x = 0; x < raster_width; x++)
+        {
+            x_val = (x + 0.5) * SC_RASTER_SIZE;
+            blockmap_raster[(z * raster_width) + x] =
+                (GLubyte)blockmap_at(x_val, z_val);
+            tiletype_raster[(z * raster_width) + x] =
+                (GLubyte)tile_type_at(x_val, z_val);
+        }
+    }
 }
 
 /*******************************************************************************
@@ -927,20 +1307,25 @@ void scenery_module::build_planes()
     arguments   :   <none>
     purpose     :   Builds the AHM and compiles it into a series of display
                     lists per each parsec cut.
-    notes       :   1) To save from having to rotate the Texture matrix we have
-                       specialized functions which control rotation and flipping
-                       of tiles in terms of the UV mapping coordinates used.
-                    2) glColor is called to set the heightmap to have a unique
-                       brightness based on the height of the vertex - this makes
-                       a very interesting effect in which high portions of the
-                       map are lighter in color than lower portions, giving a
-                       nice touch of depth.
+    notes       :   1) Tile flips and rotation are already baked into the
+                       atlas UVs of each tilemap entry (see build_atlas), so
+                       no texture matrix work is needed.
+                    2) Tiles of a parsec are batched per atlas page, giving a
+                       single texture bind and a single GL_TRIANGLES run for
+                       each page the parsec touches (usually just one).
+                    3) Each tile is split into the same two trisects that
+                       getHeight uses (NW: v0,v1,v2 & SE: v2,v1,v3), with the
+                       normal of the upper edge on v0/v1 and the lower edge
+                       on v2/v3 as it was with the old per-tile strips.
 *******************************************************************************/
 void scenery_module::build_heightmap()
 {
-    int i, x, z;
-    bool x_flip, y_flip, rotate;    // For ease of coding
+    int i, j, x, z;
+    int x_min, x_max, z_min, z_max;
     int parsec_pitch;
+    int page_count;
+    int pages[SC_PARSEC_SIZE * SC_PARSEC_SIZE];   // Atlas pages in parsec
+    tilemap_data* tm_ptr;
     float y_min;                    // For parsec's culling radius detect
     float y_max;
     
@@ -950,134 +1335,81 @@ void scenery_module::build_heightmap()
     // Go through and build each parsec
     for(i = 0; i < parsec_count; i++)
     {   
+        // Determine tile extents of this parsec
+        x_min = (i % parsec_pitch) * SC_PARSEC_SIZE;
+        x_max = x_min + SC_PARSEC_SIZE;
+        if(x_max > ta_width)
+            x_max = ta_width;
+        z_min = (i / parsec_pitch) * SC_PARSEC_SIZE;
+        z_max = z_min + SC_PARSEC_SIZE;
+        if(z_max > ta_height)
+            z_max = ta_height;
+        
         // Set up min/max y finders for this parsec (used for radius detect)
         y_min = max_height;
         y_max = 0.0;
         
+        // Gather the distinct atlas pages used by this parsec as well as
+        // the min/max y values of all its vertices.
+        page_count = 0;
+        for(x = x_min; x < x_max; x++)
+            for(z = z_min; z < z_max; z++)
+            {
+                for(j = 0; j < page_count &&
+                    pages[j] != tile[x][z].tilemap_ptr->atlas_page; j++)
+                    ;
+                if(j == page_count)
+                    pages[page_count++] = tile[x][z].tilemap_ptr->atlas_page;
+                
+                y_min = min_value(y_min, lowest(heightmap[x][z],
+                    heightmap[x+1][z], heightmap[x][z+1], heightmap[x+1][z+1]));
+                y_max = max_value(y_max, max_value(
+                    max_value(heightmap[x][z], heightmap[x+1][z]),
+                    max_value(heightmap[x][z+1], heightmap[x+1][z+1])));
+            }
+        
         // Create a new display list for this parsec
         parsec[i].dspList = glGenLists(1);
         glNewList(parsec[i].dspList, GL_COMPILE);
         
-        for(x = (i % parsec_pitch) * SC_PARSEC_SIZE;
-            x < ((i % parsec_pitch) + 1) * SC_PARSEC_SIZE &&
-            x < ta_width; x++)
-            for(z = (i / parsec_pitch) * SC_PARSEC_SIZE;
-                z < ((i / parsec_pitch) + 1) * SC_PARSEC_SIZE &&
-                z < ta_height; z++)
-            {
-                // Bind an initial texture for the initial row
-                glBindTexture(GL_TEXTURE_2D, tile[x][z].tilemap_ptr->texture_id);
-                
-                // Start heightmap for this tile
-                glBegin(GL_TRIANGLE_STRIP);
-                
-                // Save us the headache of having to type out the big longwinded
-                // line of code.
-                rotate = tile[x][z].tilemap_ptr->rotate_ccw;
-                
-                // In actuality, the x and y flip are flipped if rotate is true.
-                // This is done in relation to the flips being done mentally
-                // first, and then the texture is rotated - even though
-                // technically it works backwards from that.
-                if(!rotate)
-                {
-                    x_flip = tile[x][z].tilemap_ptr->x_flip;
-                    y_flip = tile[x][z].tilemap_ptr->y_flip;
-                }
-                else
+        for(j = 0; j < page_count; j++)
+        {
+            // One bind per atlas page
+            glBindTexture(GL_TEXTURE_2D, atlas_texture_id[pages[j]]);
+            
+            glBegin(GL_TRIANGLES);
+            
+            for(x = x_min; x < x_max; x++)
+                for(z = z_min; z < z_max; z++)
                 {
-                    x_flip = tile[x][z].tilemap_ptr->y_flip;
-                    y_flip = tile[x][z].tilemap_ptr->x_flip;
+                    tm_ptr = tile[x][z].tilemap_ptr;
+                    
+                    if(tm_ptr->atlas_page != pages[j])
+                        continue;
+                    
+                    // 0th trisect (NW, NE, SW) - upper edge normal
+                    glNormal3fv(&tile_plane(x, z)[0]);
+                    glTexCoord2fv(tm_ptr->atlas_texel[0]);
+                    glVertex3f(x * tile_size, heightmap[x][z], z * tile_size);
+                    glTexCoord2fv(tm_ptr->atlas_texel[1]);
+                    glVertex3f((x+1) * tile_size, heightmap[x+1][z], z * tile_size);
+                    glNormal3fv(&tile_plane(x, z)[4]);
+                    glTexCoord2fv(tm_ptr->atlas_texel[2]);
+                    glVertex3f(x * tile_size, heightmap[x][z+1], (z+1) * tile_size);
+                    
+                    // 1st trisect (SW, NE, SE) - lower edge normal, except NE
+                    glTexCoord2fv(tm_ptr->atlas_texel[2]);
+                    glVertex3f(x * tile_size, heightmap[x][z+1], (z+1) * tile_size);
+                    glNormal3fv(&tile_plane(x, z)[0]);
+                    glTexCoord2fv(tm_ptr->atlas_texel[1]);
+                    glVertex3f((x+1) * tile_size, heightmap[x+1][z], z * tile_size);
+                    glNormal3fv(&tile_plane(x, z)[4]);
+                    glTexCoord2fv(tm_ptr->atlas_texel[3]);
+                    glVertex3f((x+1) * tile_size, heightmap[x+1][z+1], (z+1) * tile_size);
                 }
-                
-                // Set the normal vector for this upper edge to 0th trisect.
-                glNormal3fv(&tile[x][z].plane[0]);
-                
-                // Vertex 0 (North West)
-                //glColor3f(0.3 * (heightmap[x][z] / max_height) + 0.7,
-                //          0.3 * (heightmap[x][z] / max_height) + 0.7,
-                //          0.3 * (heightmap[x][z] / max_height) + 0.7);
-                if(!rotate)
-                    glTexCoord2f(               // orig: 0.0, 1.0
-                        x_flip ? 1.0 : 0.0,
-                        y_flip ? 0.0 : 1.0);
-                else
-                    glTexCoord2f(               // orig: 1.0, 1.0
-                        x_flip ? 0.0 : 1.0,
-                        y_flip ? 0.0 : 1.0);
-                glVertex3f(x * tile_size, heightmap[x][z], z * tile_size);
-                
-                // Check for new min/max y value for current vertex
-                if(heightmap[x][z] < y_min)
-                    y_min = heightmap[x][z];
-                if(heightmap[x][z] > y_max)
-                    y_max = heightmap[x][z];
-                
-                // Vertex 1 (North East)
-                //glColor3f(0.3 * (heightmap[x+1][z] / max_height) + 0.7,
-                //          0.3 * (heightmap[x+1][z] / max_height) + 0.7,
-                //          0.3 * (heightmap[x+1][z] / max_height) + 0.7);
-                if(!rotate)
-                    glTexCoord2f(               // orig: 1.0, 1.0
-                        x_flip ? 0.0 : 1.0,
-                        y_flip ? 0.0 : 1.0);
-                else
-                    glTexCoord2f(               // orig: 1.0, 0.0
-                        x_flip ? 0.0 : 1.0,
-                        y_flip ? 1.0 : 0.0);
-                glVertex3f((x+1) * tile_size, heightmap[x+1][z], z * tile_size);
-                
-                // Check for new min/max y value for current vertex
-                if(heightmap[x+1][z] < y_min)
-                    y_min = heightmap[x+1][z];
-                if(heightmap[x+1][z] > y_max)
-                    y_max = heightmap[x+1][z];
-                
-                // Set the normal vector for this lower edge to 1st trisect.
-                glNormal3fv(&tile[x][z].plane[4]);
-                
-                // Vertex 2 (South West)
-                //glColor3f(0.3 * (heightmap[x][z+1] / max_height) + 0.7,
-                //          0.3 * (heightmap[x][z+1] / max_height) + 0.7,
-                //          0.3 * (heightmap[x][z+1] / max_height) + 0.7);
-                if(!rotate)
-                    glTexCoord2f(               // orig: 0.0, 0.0 (tex)
-                        x_flip ? 1.0 : 0.0,
-                        y_flip ? 1.0 : 0.0);
-                else
-                    glTexCoord2f(               // orig: 0.0 (tex), 1.0
-                        x_flip ? 1.0 : 0.0,
-                        y_flip ? 0.0 : 1.0);
-                glVertex3f(x * tile_size, heightmap[x][z+1], (z+1) * tile_size);
-                
-                // Check for new min/max y value for current vertex
-                if(heightmap[x][z+1] < y_min)
-                    y_min = heightmap[x][z+1];
-                if(heightmap[x][z+1] > y_max)
-                    y_max = heightmap[x][z+1];
-                
-                // Vertex 3 (South East)
-                //glColor3f(0.3 * (heightmap[x+1][z+1] / max_height) + 0.7,
-                //          0.3 * (heightmap[x+1][z+1] / max_height) + 0.7,
-                //          0.3 * (heightmap[x+1][z+1] / max_height) + 0.7);
-                if(!rotate)
-                    glTexCoord2f(               // orig: 1.0, 0.0 (tex)
-                        x_flip ? 0.0 : 1.0,
-                        y_flip ? 1.0 : 0.0);
-                else
-                    glTexCoord2f(               // orig: 0.0 (tex), 0.0
-                        x_flip ? 1.0 : 0.0,
-                        y_flip ? 1.0 : 0.0);
-                glVertex3f((x+1) * tile_size, heightmap[x+1][z+1], (z+1) * tile_size);
-                
-                // Check for new min/max y value for current vertex
-                if(heightmap[x+1][z+1] < y_min)
-                    y_min = heightmap[x+1][z+1];
-                if(heightmap[x+1][z+1] > y_max)
-                    y_max = heightmap[x+1][z+1];
-                
-                glEnd();
-            }
+            
+            glEnd();
+        }
         
         // End display list for this parsec
         glEndList();
@@ -1171,7 +1503,7 @@ void scenery_module::build_overlays()
                 glBegin(GL_TRIANGLE_STRIP);
                 
                     // Set the normal vector for this upper edge to 0th trisect.
-                    glNormal3fv(&tile[x][z].plane[0]);
+                    glNormal3fv(&tile_plane(x, z)[0]);
                     
                     // Vertex 0 (North West)
                     glTexCoord2f(0.0, 1.0);
@@ -1186,7 +1518,7 @@ void scenery_module::build_overlays()
                     glVertex3f(x_val, getHeight(x_val, z_val) + 0.6, z_val);
                     
                     // Set the normal vector for this lower edge to 1st trisect.
-                    glNormal3fv(&tile[x][z].plane[4]);
+                    glNormal3fv(&tile_plane(x, z)[4]);
                     
                     // Vertex 2 (South West)
                     glTexCoord2f(0.0, 0.0);
@@ -2125,6 +2457,9 @@ void scenery_module::build_bridges()
                 glEndList();
             }
         }
+    
+    // Bridges overlay the heightmap, so re-build max height pyramid
+    build_maxmip();
 }
 
 /*******************************************************************************
@@ -2337,6 +2672,7 @@ float scenery_module::getHeight(float x_val, float z_val)
 {
     int x, z;
     float x_off, z_off, height;
+    float* plane;
     
     // Bounds checking
     if(x_val < 0.0)
@@ -2357,14 +2693,9 @@ float scenery_module::getHeight(float x_val, float z_val)
     z = (int)z_off;
     z_off = z_off - floor(z_off);
     
-    if(x_off <= (1.0 - z_off))
-        // Use 0th Trisect
-        height = (tile[x][z].plane[3] - (tile[x][z].plane[0] * x_val) -
-            (tile[x][z].plane[2] * z_val)) / tile[x][z].plane[1];
-    else
-        // Use 1st Trisect
-        height = (tile[x][z].plane[7] - (tile[x][z].plane[4] * x_val) -
-            (tile[x][z].plane[6] * z_val)) / tile[x][z].plane[5];
+    // Use 0th Trisect or 1st Trisect
+    plane = tile_plane(x, z) + (x_off <= (1.0 - z_off) ? 0 : 4);
+    height = (plane[3] - (plane[0] * x_val) - (plane[2] * z_val)) / plane[1];
     
     return height;
 }
@@ -2381,6 +2712,7 @@ float scenery_module::getOverlayHeight(float x_val, float z_val)
 {
     int x, z;
     float x_off, z_off, height;
+    float* plane;
     
     // Bounds checking
     if(x_val < 0.0)
@@ -2401,14 +2733,9 @@ float scenery_module::getOverlayHeight(float x_val, float z_val)
     z = (int)z_off;
     z_off = z_off - floor(z_off);
     
-    if(x_off <= (1.0 - z_off))
-        // Use 0th Trisect
-        height = (tile[x][z].plane[3] - (tile[x][z].plane[0] * x_val) -
-            (tile[x][z].plane[2] * z_val)) / tile[x][z].plane[1];
-    else
-        // Use 1st Trisect
-        height = (tile[x][z].plane[7] - (tile[x][z].plane[4] * x_val) -
-            (tile[x][z].plane[6] * z_val)) / tile[x][z].plane[5];
+    // Use 0th Trisect or 1st Trisect
+    plane = tile_plane(x, z) + (x_off <= (1.0 - z_off) ? 0 : 4);
+    height = (plane[3] - (plane[0] * x_val) - (plane[2] * z_val)) / plane[1];
     
     // Account for bridge overlay
     if(tile[x][z].bridge_ptr != NULL)
@@ -2456,12 +2783,111 @@ float scenery_module::getRelativeHeight(float x_val, float z_val)
 }
 
 /*******************************************************************************
-    function    :   int scenery_module::getTileType
+    function    :   scenery_module::getHeights
+    arguments   :   count - number of points
+                    x_vals, z_vals - positions on map (count each)
+                    heights - heights of heightmap at points (returned)
+                    normals - plane normals at points, 3 per point (returned,
+                              may be NULL if not needed)
+    purpose     :   Batched version of getHeight, for callers needing several
+                    heights at once (e.g. the four corners of a hull).
+    notes       :   1) Does NOT provide heightmap overlays, such as bridge
+                       overlay (see getOverlayHeights).
+                    2) Reads only the flat plane array, and the loop body has
+                       no calls or data dependent branching beyond the trisect
+                       select, so the compiler is free to pipeline it.
+*******************************************************************************/
+void scenery_module::getHeights(int count, float* x_vals, float* z_vals,
+    float* heights, float* normals)
+{
+    int i, x, z;
+    float x_val, z_val, x_off, z_off;
+    float x_max = map_width - 0.001;
+    float z_max = map_height - 0.001;
+    float inv_tile_size = 1.0 / tile_size;
+    float* plane;
+    
+    for(i = 0; i < count; i++)
+    {
+        // Bounds checking
+        x_val = x_vals[i];
+        x_val = (x_val < 0.0 ? 0.0 : (x_val > x_max ? x_max : x_val));
+        z_val = z_vals[i];
+        z_val = (z_val < 0.0 ? 0.0 : (z_val > z_max ? z_max : z_val));
+        
+        // Determine corresponding x,z tile array offset (values are positive
+        // so truncation works as floor)
+        x_off = x_val * inv_tile_size;
+        x = (int)x_off;
+        x_off -= (float)x;
+        z_off = z_val * inv_tile_size;
+        z = (int)z_off;
+        z_off -= (float)z;
+        
+        // Use 0th Trisect or 1st Trisect
+        plane = &plane_data[((z * ta_width) + x) * SC_PLANE_STRIDE +
+            (x_off + z_off <= 1.0 ? 0 : 4)];
+        heights[i] = (plane[3] - (plane[0] * x_val) - (plane[2] * z_val)) /
+            plane[1];
+        
+        if(normals)
+        {
+            normals[i*3 + 0] = plane[0];
+            normals[i*3 + 1] = plane[1];
+            normals[i*3 + 2] = plane[2];
+        }
+    }
+}
+
+/*******************************************************************************
+    function    :   scenery_module::getOverlayHeights
+    arguments   :   count - number of points
+                    x_vals, z_vals - positions on map (count each)
+                    heights - heights of heightmap at points (returned)
+    purpose     :   Batched version of getOverlayHeight, for callers needing
+                    several heights at once (e.g. the four corners of a hull).
+    notes       :   <none>
+*******************************************************************************/
+void scenery_module::getOverlayHeights(int count, float* x_vals,
+    float* z_vals, float* heights)
+{
+    int i, x, z;
+    float x_val, z_val;
+    float x_max = map_width - 0.001;
+    float z_max = map_height - 0.001;
+    float inv_tile_size = 1.0 / tile_size;
+    bridge_object* bridge;
+    
+    // Base heights
+    getHeights(count, x_vals, z_vals, heights);
+    
+    // Account for bridge overlays
+    for(i = 0; i < count; i++)
+    {
+        x_val = x_vals[i];
+        x_val = (x_val < 0.0 ? 0.0 : (x_val > x_max ? x_max : x_val));
+        z_val = z_vals[i];
+        z_val = (z_val < 0.0 ? 0.0 : (z_val > z_max ? z_max : z_val));
+        x = (int)(x_val * inv_tile_size);
+        z = (int)(z_val * inv_tile_size);
+        
+        // Check against bridge's AABB
+        if((bridge = tile[x][z].bridge_ptr) != NULL &&
+           x_val >= bridge->x_min && x_val <= bridge->x_max &&
+           z_val >= bridge->z_min && z_val <= bridge->z_max &&
+           heights[i] <= bridge->height)
+            heights[i] = bridge->height;
+    }
+}
+
+/*******************************************************************************
+    function    :   int scenery_module::tile_type_at
     arguments   :   x_val, z_val - position on map
     purpose     :   Returns the tile type of the tile that x,z corresponds to.
-    notes       :   <none>
+    notes       :   Full computation from tile data - used to fill in the
+                    tile type raster (see getTileType).
 *******************************************************************************/
-int scenery_module::getTileType(float x_val, float z_val)
+int scenery_module::tile_type_at(float x_val, float z_val)
 {
     int x, z;
     float x_off, z_off;
@@ -2495,13 +2921,14 @@ int scenery_module::getTileType(float x_val, float z_val)
 }
 
 /*******************************************************************************
-    function    :   int scenery_module::getBlockmap
+    function    :   int scenery_module::blockmap_at
     arguments   :   x_val, z_val - position on map
     purpose     :   Rounds x and z to nearest tile definition and returns the
                     blockmap data at that position.
-    notes       :   <none>
+    notes       :   Full computation from tile data - used to fill in the
+                    blockmap raster (see getBlockmap).
 *******************************************************************************/
-int scenery_module::getBlockmap(float x_val, float z_val)
+int scenery_module::blockmap_at(float x_val, float z_val)
 {
     int x, z;
     float x_off, z_off;
@@ -2545,93 +2972,491 @@ int scenery_module::getBlockmap(float x_val, float z_val)
         return tilemap[0].tile_block;
 }
 
+/*******************************************************************************
+    function    :   int scenery_module::getTileType
+    arguments   :   x_val, z_val - position on map
+    purpose     :   Returns the tile type of the tile that x,z corresponds to.
+    notes       :   Single read from the tile type raster once built (to
+                    within SC_RASTER_SIZE), otherwise computed in full.
+*******************************************************************************/
+int scenery_module::getTileType(float x_val, float z_val)
+{
+    int x, z;
+    
+    if(tiletype_raster == NULL)
+        return tile_type_at(x_val, z_val);
+    
+    // Determine raster cell (with bounds checking)
+    x = (int)(x_val * raster_scale);
+    z = (int)(z_val * raster_scale);
+    if(x < 0)
+        x = 0;
+    else if(x >= raster_width)
+        x = raster_width - 1;
+    if(z < 0)
+        z = 0;
+    else if(z >= raster_height)
+        z = raster_height - 1;
+    
+    return tiletype_raster[(z * raster_width) + x];
+}
+
+/*******************************************************************************
+    function    :   int scenery_module::getBlockmap
+    arguments   :   x_val, z_val - position on map
+    purpose     :   Returns the blockmap data at the x,z position.
+    notes       :   Single read from the blockmap raster once built (to within
+                    SC_RASTER_SIZE), otherwise computed in full.
+*******************************************************************************/
+int scenery_module::getBlockmap(float x_val, float z_val)
+{
+    int x, z;
+    
+    if(blockmap_raster == NULL)
+        return blockmap_at(x_val, z_val);
+    
+    // Determine raster cell (with bounds checking)
+    x = (int)(x_val * raster_scale);
+    z = (int)(z_val * raster_scale);
+    if(x < 0)
+        x = 0;
+    else if(x >= raster_width)
+        x = raster_width - 1;
+    if(z < 0)
+        z = 0;
+    else if(z >= raster_height)
+        z = raster_height - 1;
+    
+    return blockmap_raster[(z * raster_width) + x];
+}
+
 /*******************************************************************************
     Scenery Metrics Routines
 *******************************************************************************/
 
+/*******************************************************************************
+    function    :   bool scenery_module::ray_maxmip
+    arguments   :   level - max height pyramid level of cell
+                    cx,cz - cell offset in level
+                    rayPos - Initial position of ray
+                    rayDir - Direction vector of ray
+                    t_enter,t_exit - Portion of ray left to check
+                    t - Ray parameter of the hit (returned)
+    purpose     :   Recursively checks a ray against a cell of the max height
+                    pyramid, returning true along with the first t at which the
+                    ray reaches the heightmap (or a bridge overlay) in the cell.
+    notes       :   1) Cells the ray passes entirely above are skipped whole.
+                    2) Children are visited near to far along the ray, so the
+                       first hit found is the first hit along the ray.
+                    3) At level 0 the exact trisect test of segment_tile is
+                       used, along with the bridge's AABB top.
+*******************************************************************************/
+bool scenery_module::ray_maxmip(int level, int cx, int cz, kVector &rayPos,
+    kVector &rayDir, float t_enter, float t_exit, float &t)
+{
+    int i;
+    int x, z;
+    float cell_min[2], cell_max[2];
+    float t_one, t_two, t_swap;
+    float t_bridge;
+    int near_x, near_z;
+    bool hit;
+    bridge_object* bridge;
+    
+    // Cell bounds (in m)
+    cell_min[0] = (float)(cx << level) * tile_size;
+    cell_min[1] = (float)(cz << level) * tile_size;
+    x = (cx + 1) << level;
+    z = (cz + 1) << level;
+    cell_max[0] = (float)(x < ta_width ? x : ta_width) * tile_size;
+    cell_max[1] = (float)(z < ta_height ? z : ta_height) * tile_size;
+    
+    // Clip ray portion to cell bounds
+    for(i = 0; i < 2; i++)
+    {
+        if(fabsf(rayDir[i*2]) <= FP_ERROR)
+        {
+            if(rayPos[i*2] < cell_min[i] || rayPos[i*2] > cell_max[i])
+                return false;
+        }
+        else
+        {
+            t_one = (cell_min[i] - rayPos[i*2]) / rayDir[i*2];
+            t_two = (cell_max[i] - rayPos[i*2]) / rayDir[i*2];
+            if(t_one > t_two)
+            {
+                t_swap = t_one;
+                t_one = t_two;
+                t_two = t_swap;
+            }
+            if(t_one > t_enter)
+                t_enter = t_one;
+            if(t_two < t_exit)
+                t_exit = t_two;
+        }
+    }
+    if(t_enter > t_exit)
+        return false;
+    
+    // Ray passes entirely above this cell
+    if(min_value(rayPos[1] + rayDir[1] * t_enter,
+                 rayPos[1] + rayDir[1] * t_exit) >
+       maxmip[level][cz * maxmip_width[level] + cx] + FP_ERROR)
+        return false;
+    
+    if(level == 0)
+    {
+        // Exact test against tile trisects
+        hit = segment_tile(cx, cz, rayPos, rayDir, t_enter, t_exit, t);
+        
+        // Test against bridge overlay top (within this tile)
+        if((bridge = tile[cx][cz].bridge_ptr) != NULL)
+        {
+            cell_min[0] = max_value(cell_min[0], bridge->x_min);
+            cell_max[0] = min_value(cell_max[0], bridge->x_max);
+            cell_min[1] = max_value(cell_min[1], bridge->z_min);
+            cell_max[1] = min_value(cell_max[1], bridge->z_max);
+            
+            for(i = 0; i < 2 && t_enter <= t_exit; i++)
+            {
+                if(fabsf(rayDir[i*2]) <= FP_ERROR)
+                {
+                    if(rayPos[i*2] < cell_min[i] || rayPos[i*2] > cell_max[i])
+                        t_exit = t_enter - 1.0;
+                }
+                else
+                {
+                    t_one = (cell_min[i] - rayPos[i*2]) / rayDir[i*2];
+                    t_two = (cell_max[i] - rayPos[i*2]) / rayDir[i*2];
+                    if(t_one > t_two)
+                    {
+                        t_swap = t_one;
+                        t_one = t_two;
+                        t_two = t_swap;
+                    }
+                    if(t_one > t_enter)
+                        t_enter = t_one;
+                    if(t_two < t_exit)
+                        t_exit = t_two;
+                }
+            }
+            
+            if(t_enter <= t_exit)
+            {
+                t_bridge = -1.0;
+                if(rayPos[1] + rayDir[1] * t_enter <= bridge->height)
+                    t_bridge = t_enter;
+                else if(rayPos[1] + rayDir[1] * t_exit <= bridge->height)
+                    t_bridge = (bridge->height - rayPos[1]) / rayDir[1];
+                
+                if(t_bridge >= 0.0 && (!hit || t_bridge < t))
+                {
+                    t = t_bridge;
+                    hit = true;
+                }
+            }
+        }
+        
+        return hit;
+    }
+    
+    // Visit children near to far (a ray crosses at most three of the four,
+    // so the two off-diagonal children may be visited in either order).
+    near_x = (rayDir[0] < 0.0 ? 1 : 0);
+    near_z = (rayDir[2] < 0.0 ? 1 : 0);
+    for(i = 0; i < 4; i++)
+    {
+        x = cx * 2 + ((i & 1) ? 1 - near_x : near_x);
+        z = cz * 2 + ((i & 2) ? 1 - near_z : near_z);
+        
+        if(x < maxmip_width[level-1] && z < maxmip_height[level-1] &&
+           ray_maxmip(level - 1, x, z, rayPos, rayDir, t_enter, t_exit, t))
+            return true;
+    }
+    
+    return false;
+}
+
 /*******************************************************************************
     function    :   kVector scenery_module::rayIntersect
     arguments   :   rayPos - Initial position of ray
                     rayDir - Direction vector of ray
     purpose     :   Determines where a ray will intersect the heightmap.
-    notes       :   1) May not be too accurate on maps which have rapidly
-                       changing terrain. However, this risk with REAL terrain
-                       is very minimal.
+    notes       :   1) Descends the max height pyramid (see build_maxmip) so
+                       that only tiles the ray passes near to are tested, at
+                       which point the exact trisect planes are used.
                     2) Returned value is a position vector, of which the y
                        value is the value on the ray - not of the scenery.
                     3) The position vector must have a y value which is above
                        the heightmap at the x,z point.
+                    4) Rays which never reach the heightmap return the point
+                       along the ray at the map's diagonal length, clamped to
+                       the map bounds.
 *******************************************************************************/
 kVector scenery_module::rayIntersect(kVector rayPos, kVector rayDir)
 {
     kVector curr_spot;                  // Curr spot on ray
-    float iteration = tile_size;        // Iteration value
-    float multiplier = 0.0;             // Current multiplier
+    float t;                            // Ray parameter of hit
     float max_map_size =                // Maximum map size
         sqrt((map_width * map_width) + (map_height * map_height));
     
-    // First, go along our ray until we go under the scenery or go beyond
-    // the map size. If we do not define a max size, rays going above the
-    // heightmap will result in an infinite loop (since the ray never will
-    // pass underneath the heightmap).
-    do
+    // Check ray against top cell of pyramid (covers entire map)
+    if(maxmip_levels > 0 &&
+       ray_maxmip(maxmip_levels - 1, 0, 0, rayPos, rayDir, 0.0, 1.0e30, t))
+        return rayPos + (rayDir * t);
+    
+    // No intersection - go out the max map size along the ray instead
+    curr_spot = rayPos + (rayDir * max_map_size);
+    
+    // Check bounds
+    if(curr_spot[0] < 0.0)
+        curr_spot[0] = 0.0;
+    else if(curr_spot[0] > map_width)
+        curr_spot[0] = map_width;
+    if(curr_spot[2] < 0.0)
+        curr_spot[2] = 0.0;
+    else if(curr_spot[2] > map_height)
+        curr_spot[2] = map_height;
+    
+    return curr_spot;
+}
+
+/*******************************************************************************
+    function    :   bool scenery_module::segment_tile
+    arguments   :   x,z - tile array offset
+                    segStart - Start of segment
+                    segDir - Segment direction (segEnd - segStart, unnormalized)
+                    t_enter,t_exit - Portion of segment lying over the tile
+                    t - Segment parameter of the hit (returned)
+    purpose     :   Checks the portion of a segment lying over a tile against
+                    the tile's two trisects, returning true along with the
+                    first t at which the segment is at or below the heightmap.
+    notes       :   1) Height above a trisect is linear along the segment, so
+                       only the end points of each run need to be checked.
+                    2) The run is split at the NE/SW diagonal so that each part
+                       is checked against the same trisect getHeight would use.
+*******************************************************************************/
+bool scenery_module::segment_tile(int x, int z, kVector &segStart,
+    kVector &segDir, float t_enter, float t_exit, float &t)
+{
+    int i, p;
+    float t_run[3];
+    int run_count;
+    float u_enter, u_rate;
+    float y_one, y_two;
+    float f_one, f_two;
+    float* plane;
+    
+    // Quick reject - segment run entirely above the highest tile corner
+    y_one = segStart[1] + segDir[1] * t_enter;
+    y_two = segStart[1] + segDir[1] * t_exit;
+    if(min_value(y_one, y_two) > max_value(
+        max_value(heightmap[x][z], heightmap[x+1][z]),
+        max_value(heightmap[x][z+1], heightmap[x+1][z+1])) + FP_ERROR)
+        return false;
+    
+    // Split run at the diagonal (x_off + z_off == 1)
+    u_enter = ((segStart[0] + segDir[0] * t_enter) / tile_size - x) +
+              ((segStart[2] + segDir[2] * t_enter) / tile_size - z);
+    u_rate = (segDir[0] + segDir[2]) / tile_size;
+    
+    t_run[0] = t_enter;
+    run_count = 1;
+    if(fabsf(u_rate) > FP_ERROR)
     {
-        // Add iteration value to multiplier
-        multiplier += iteration;
-        
-        // Calculate new current spot
-        curr_spot = rayPos + (rayDir * multiplier);
-        
-        // Check bounds
-        if(curr_spot[0] < 0.0)
-            curr_spot[0] = 0.0;
-        else if(curr_spot[0] > map_width)
-            curr_spot[0] = map_width;
-        
-        if(curr_spot[2] < 0.0)
-            curr_spot[2] = 0.0;
-        else if(curr_spot[2] > map_height)
-            curr_spot[2] = map_height;
-        
-    } while(curr_spot[1] > getOverlayHeight(curr_spot[0], curr_spot[2]) &&
-            multiplier <= max_map_size);
-    
-    // Second, use the binary search method to "hom"-in on the correct value
-    // along the ray that passes at the heightmap. If the rayPos along the
-    // ray at the given multiplier is above the heightmap, we add onto the
-    // multiplier, but if it is underneath the heightmap, we subtract from
-    // the multiplier. The value added/subtracted is the iteration value, which
-    // is cut by half at each iteration. The end result is a multiplier along
-    // the ray which is quite close to the heightmap - e.g. the intersect.
-    // It is assumed that the ray starts above the heightmap.
-    do
+        t_run[1] = t_enter + ((1.0 - u_enter) / u_rate);
+        if(t_run[1] > t_enter && t_run[1] < t_exit)
+            run_count = 2;
+    }
+    t_run[run_count] = t_exit;
+    
+    // Check each run against its trisect plane
+    for(i = 0; i < run_count; i++)
     {
-        // Cut iteration value in half
-        iteration /= 2.0;
-        
-        // Calculate new current spot
-        curr_spot = rayPos + (rayDir * multiplier);
-        
-        // Check bounds
-        if(curr_spot[0] < 0.0)
-            curr_spot[0] = 0.0;
-        else if(curr_spot[0] > map_width)
-            curr_spot[0] = map_width;
-        if(curr_spot[2] < 0.0)
-            curr_spot[2] = 0.0;
-        else if(curr_spot[2] > map_height)
-            curr_spot[2] = map_height;
-        
-        // Add/subtract multiplier based on if it is below/above the heightmap.
-        if(curr_spot[1] < getOverlayHeight(curr_spot[0], curr_spot[2]))
-            multiplier -= iteration;
+        // Mid-run diagonal value determines trisect (same as getHeight)
+        p = (u_enter + u_rate * (((t_run[i] + t_run[i+1]) / 2.0) - t_enter)
+                <= 1.0 ? 0 : 4);
+        plane = tile_plane(x, z) + p;
+        
+        // Height of segment above trisect plane at run end points
+        f_one = (segStart[1] + segDir[1] * t_run[i]) -
+            (plane[3] - plane[0] * (segStart[0] + segDir[0] * t_run[i]) -
+             plane[2] * (segStart[2] + segDir[2] * t_run[i])) / plane[1];
+        f_two = (segStart[1] + segDir[1] * t_run[i+1]) -
+            (plane[3] - plane[0] * (segStart[0] + segDir[0] * t_run[i+1]) -
+             plane[2] * (segStart[2] + segDir[2] * t_run[i+1])) / plane[1];
+        
+        if(f_one <= FP_ERROR)
+        {
+            t = t_run[i];
+            return true;
+        }
+        else if(f_two <= FP_ERROR)
+        {
+            t = t_run[i] + (t_run[i+1] - t_run[i]) * (f_one / (f_one - f_two));
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/*******************************************************************************
+    function    :   bool scenery_module::segmentIntersect
+    arguments   :   segStart - Start of segment (e.g. last position)
+                    segEnd - End of segment (e.g. current position)
+                    impactPoint - Point of first ground contact (returned)
+    purpose     :   Determines if a segment passes into the heightmap anywhere
+                    along its length, returning the exact first point of
+                    contact. Used for fast movers (e.g. projectiles) that step
+                    farther than a tile per update and could otherwise pass
+                    clean through a ridge between point tests.
+    notes       :   1) Walks only the tiles the segment passes over (grid DDA)
+                       and checks each against its trisect planes.
+                    2) Portions of the segment off the map fall back onto the
+                       clamped point test done by groundCollision.
+                    3) Does not test against scenery objects.
+*******************************************************************************/
+bool scenery_module::segmentIntersect(kVector segStart, kVector segEnd,
+    kVector &impactPoint)
+{
+    int i;
+    int x, z;
+    int step_x, step_z;
+    float t_min = 0.0, t_max = 1.0;
+    float t_enter, t_exit, t_hit;
+    float t_next_x, t_next_z;
+    float t_delta_x, t_delta_z;
+    float bound_min[2], bound_max[2];
+    float seg_start[2], seg_dir[2];
+    kVector seg_dir_v = segEnd - segStart;
+    
+    // Clip segment to map bounds (x,z only)
+    bound_min[0] = bound_min[1] = 0.0;
+    bound_max[0] = map_width - 0.001;
+    bound_max[1] = map_height - 0.001;
+    seg_start[0] = segStart[0];
+    seg_start[1] = segStart[2];
+    seg_dir[0] = seg_dir_v[0];
+    seg_dir[1] = seg_dir_v[2];
+    
+    for(i = 0; i < 2 && t_min <= t_max; i++)
+    {
+        if(fabsf(seg_dir[i]) <= FP_ERROR)
+        {
+            if(seg_start[i] < bound_min[i] || seg_start[i] > bound_max[i])
+                t_min = 2.0;            // Parallel and outside
+        }
+        else
+        {
+            t_enter = (bound_min[i] - seg_start[i]) / seg_dir[i];
+            t_exit = (bound_max[i] - seg_start[i]) / seg_dir[i];
+            if(t_enter > t_exit)
+            {
+                t_hit = t_enter;
+                t_enter = t_exit;
+                t_exit = t_hit;
+            }
+            if(t_enter > t_min)
+                t_min = t_enter;
+            if(t_exit < t_max)
+                t_max = t_exit;
+        }
+    }
+    
+    if(t_min <= t_max)
+    {
+        // Starting tile
+        x = (int)((seg_start[0] + seg_dir[0] * t_min) / tile_size);
+        z = (int)((seg_start[1] + seg_dir[1] * t_min) / tile_size);
+        if(x < 0)
+            x = 0;
+        else if(x >= ta_width)
+            x = ta_width - 1;
+        if(z < 0)
+            z = 0;
+        else if(z >= ta_height)
+            z = ta_height - 1;
+        
+        // DDA set up - t values at which next tile boundary is crossed
+        if(seg_dir[0] > FP_ERROR)
+        {
+            step_x = 1;
+            t_delta_x = tile_size / seg_dir[0];
+            t_next_x = ((x + 1) * tile_size - seg_start[0]) / seg_dir[0];
+        }
+        else if(seg_dir[0] < -FP_ERROR)
+        {
+            step_x = -1;
+            t_delta_x = tile_size / -seg_dir[0];
+            t_next_x = (x * tile_size - seg_start[0]) / seg_dir[0];
+        }
+        else
+        {
+            step_x = 0;
+            t_delta_x = t_next_x = 2.0;
+        }
+        
+        if(seg_dir[1] > FP_ERROR)
+        {
+            step_z = 1;
+            t_delta_z = tile_size / seg_dir[1];
+            t_next_z = ((z + 1) * tile_size - seg_start[1]) / seg_dir[1];
+        }
+        else if(seg_dir[1] < -FP_ERROR)
+        {
+            step_z = -1;
+            t_delta_z = tile_size / -seg_dir[1];
+            t_next_z = (z * tile_size - seg_start[1]) / seg_dir[1];
+        }
         else
-            multiplier += iteration;
+        {
+            step_z = 0;
+            t_delta_z = t_next_z = 2.0;
+        }
+        
+        // Walk tiles along segment
+        t_enter = t_min;
+        while(true)
+        {
+            t_exit = min_value(min_value(t_next_x, t_next_z), t_max);
+            
+            if(segment_tile(x, z, segStart, seg_dir_v, t_enter, t_exit, t_hit))
+            {
+                impactPoint = segStart + (seg_dir_v * t_hit);
+                return true;
+            }
+            
+            if(t_exit >= t_max)
+                break;
+            
+            // Step into next tile
+            if(t_next_x < t_next_z)
+            {
+                x += step_x;
+                t_enter = t_next_x;
+                t_next_x += t_delta_x;
+            }
+            else
+            {
+                z += step_z;
+                t_enter = t_next_z;
+                t_next_z += t_delta_z;
+            }
+            
+            if(x < 0 || x >= ta_width || z < 0 || z >= ta_height)
+                break;
+        }
+    }
+    
+    // Fall back on clamped point test of end point (covers off map)
+    if(groundCollision(segEnd))
+    {
+        impactPoint = segEnd;
+        return true;
     }
-    while(iteration >= 0.05);
     
-    // Return the rayPos vector at the current rayPos, which is curr_spot
-    return kVector(curr_spot());
+    return false;
 }
 
 /*******************************************************************************
@@ -2646,6 +3471,7 @@ bool scenery_module::groundCollision(kVector position)
 {
     int x, z;
     float x_off, z_off, height;
+    float* plane;
     
     // Bounds check
     if(position[0] < 0.0)
@@ -2673,14 +3499,10 @@ bool scenery_module::groundCollision(kVector position)
         x_off = x_off - floor(x_off);
         z_off = z_off - floor(z_off);
         
-        if(x_off <= (1.0 - z_off))
-            // Use 0th Trisect
-            height = (tile[x][z].plane[3] - (tile[x][z].plane[0] * position[0]) -
-                (tile[x][z].plane[2] * position[2])) / tile[x][z].plane[1];
-        else
-            // Use 1st Trisect
-            height = (tile[x][z].plane[7] - (tile[x][z].plane[4] * position[0]) -
-                (tile[x][z].plane[6] * position[2])) / tile[x][z].plane[5];
+        // Use 0th Trisect or 1st Trisect
+        plane = tile_plane(x, z) + (x_off <= (1.0 - z_off) ? 0 : 4);
+        height = (plane[3] - (plane[0] * position[0]) -
+            (plane[2] * position[2])) / plane[1];
         
         if(position[1] <= height + FP_ERROR)
             return true;
@@ -2730,6 +3552,260 @@ bool scenery_module::sceneryCollision(kVector position)
     return false;
 }
 
+/*******************************************************************************
+    function    :   scenery_module::los_trees
+    arguments   :   from - Line start
+                    to - Line end
+    purpose     :   Determines if a line passes through any tree object, with
+                    each tree taken as an upright cylinder of its billboard's
+                    height and SC_LOS_TREE_RADIUS of its width.
+    notes       :   Only the trees of the tiles the line passes over are tested
+                    (grid DDA over the tile array).
+*******************************************************************************/
+bool scenery_module::los_trees(kVector &from, kVector &to)
+{
+    int x, z;
+    int end_x, end_z;
+    int step_x, step_z;
+    float dx = to[0] - from[0];
+    float dz = to[2] - from[2];
+    float len_sqrd = dx * dx + dz * dz;
+    float t_next_x, t_next_z;
+    float t_delta_x, t_delta_z;
+    float t, y;
+    float px, pz;
+    float radius;
+    tree_object* tol_curr;
+    
+    x = (int)(from[0] / tile_size);
+    z = (int)(from[2] / tile_size);
+    end_x = (int)(to[0] / tile_size);
+    end_z = (int)(to[2] / tile_size);
+    step_x = (dx > 0.0 ? 1 : -1);
+    step_z = (dz > 0.0 ? 1 : -1);
+    
+    t_delta_x = (fabsf(dx) > FP_ERROR ? tile_size / fabsf(dx) : 2.0);
+    t_delta_z = (fabsf(dz) > FP_ERROR ? tile_size / fabsf(dz) : 2.0);
+    t_next_x = (fabsf(dx) > FP_ERROR ? ((step_x > 0 ? (float)(x + 1) :
+        (float)x) * tile_size - from[0]) / dx : 2.0);
+    t_next_z = (fabsf(dz) > FP_ERROR ? ((step_z > 0 ? (float)(z + 1) :
+        (float)z) * tile_size - from[2]) / dz : 2.0);
+    
+    for(;;)
+    {
+        if(x >= 0 && x < ta_width && z >= 0 && z < ta_height)
+        {
+            for(tol_curr = tile[x][z].tol_head; tol_curr;
+                tol_curr = tol_curr->t_next)
+            {
+                // Closest approach of line to tree's axis (x,z only)
+                px = tol_curr->pos[0] - from[0];
+                pz = tol_curr->pos[2] - from[2];
+                t = (len_sqrd > FP_ERROR ? (px * dx + pz * dz) / len_sqrd : 0.0);
+                if(t < 0.0) t = 0.0; else if(t > 1.0) t = 1.0;
+                px -= dx * t;
+                pz -= dz * t;
+                
+                radius = SC_LOS_TREE_RADIUS * tol_curr->scale[0];
+                if(px * px + pz * pz > radius * radius)
+                    continue;
+                
+                y = from[1] + (to[1] - from[1]) * t;
+                if(y >= tol_curr->pos[1] &&
+                   y <= tol_curr->pos[1] + tol_curr->scale[1])
+                    return true;
+            }
+        }
+        
+        if((x == end_x && z == end_z) || (t_next_x > 1.0 && t_next_z > 1.0))
+            break;
+        
+        if(t_next_x < t_next_z)
+        {
+            x += step_x;
+            t_next_x += t_delta_x;
+        }
+        else
+        {
+            z += step_z;
+            t_next_z += t_delta_z;
+        }
+    }
+    
+    return false;
+}
+
+/*******************************************************************************
+    function    :   scenery_module::los_foliage
+    arguments   :   from - Line start
+                    to - Line end
+    purpose     :   Determines if a line passes through too much foliage of the
+                    tree tiles it crosses to be seen through.
+    notes       :   The line is stepped a raster cell at a time. Each step taken
+                    beneath the canopy of a tree tile uses up its share of the
+                    sight depth of that tile type, and when all of it is used
+                    up the line is blocked.
+*******************************************************************************/
+bool scenery_module::los_foliage(kVector &from, kVector &to)
+{
+    kVector dir = to - from;
+    kVector curr;
+    float length = sqrt(dir[0] * dir[0] + dir[2] * dir[2]);
+    float opacity = 0.0;
+    int steps;
+    int i;
+    
+    steps = (int)(length / SC_RASTER_SIZE);
+    if(steps < 1)
+        return false;
+    
+    dir = dir / (float)steps;
+    curr = from + dir * 0.5f;
+    
+    for(i = 0; i < steps; i++, curr += dir)
+    {
+        switch(getTileType(curr[0], curr[2]))
+        {
+            case TT_SPARSE_TREES:
+                if(curr[1] - getHeight(curr[0], curr[2]) < SC_LOS_CANOPY_HEIGHT)
+                    opacity += (length / (float)steps) / SC_LOS_SPARSE_DEPTH;
+                break;
+            
+            case TT_DENSE_TREES:
+            case TT_PINE_TREES:
+                if(curr[1] - getHeight(curr[0], curr[2]) < SC_LOS_CANOPY_HEIGHT)
+                    opacity += (length / (float)steps) / SC_LOS_DENSE_DEPTH;
+                break;
+        }
+        
+        if(opacity >= 1.0)
+            return true;
+    }
+    
+    return false;
+}
+
+/*******************************************************************************
+    function    :   scenery_module::lineOfSight
+    arguments   :   from - Viewing position
+                    to - Position being viewed
+    purpose     :   Determines if there is a clear line of sight between two
+                    positions, past the heightmap, tree objects, and the foliage
+                    of tree tiles.
+    notes       :   1) Checks are ordered cheapest first: the heightmap (grid
+                       DDA), then trees of the tiles crossed, then foliage.
+                    2) Only reads data made at load time, so is safe to call
+                       from worker threads.
+*******************************************************************************/
+bool scenery_module::lineOfSight(kVector from, kVector to)
+{
+    kVector impact;
+    
+    if(segmentIntersect(from, to, impact))
+        return false;
+    
+    if(los_trees(from, to))
+        return false;
+    
+    if(los_foliage(from, to))
+        return false;
+    
+    return true;
+}
+
+/*******************************************************************************
+    function    :   scenery_module::lineOfSight
+    arguments   :   viewer - Key of viewer (e.g. its object pointer)
+                    target - Key of target (e.g. its object pointer)
+                    from - Viewing position
+                    to - Position being viewed
+    purpose     :   Cached form of lineOfSight for a viewer/target pair.
+    notes       :   1) The cache is direct mapped on the pair, so a colliding
+                       pair simply replaces the entry.
+                    2) The cache is shared and unlocked, so this form must not
+                       be used from jobs. Jobs keep their own cache entry and
+                       use the form below.
+*******************************************************************************/
+bool scenery_module::lineOfSight(void* viewer, void* target, kVector from,
+    kVector to)
+{
+    unsigned long hash;
+    
+    hash = ((unsigned long)viewer >> 4) * 31 + ((unsigned long)target >> 4);
+    hash ^= hash >> 10;
+    
+    return lineOfSight(&los_cache[hash & (SC_LOS_CACHE_SIZE - 1)], viewer,
+        target, from, to);
+}
+
+/*******************************************************************************
+    function    :   scenery_module::lineOfSight
+    arguments   :   entry - Cache entry to check against and update
+                    viewer - Key of viewer (e.g. its object pointer)
+                    target - Key of target (e.g. its object pointer)
+                    from - Viewing position
+                    to - Position being viewed
+    purpose     :   Cached form of lineOfSight, against a given cache entry.
+    notes       :   A cached result is reused for SC_LOS_CACHE_TIME seconds, so
+                    long as the entry is for the same pair and neither end has
+                    moved by SC_LOS_CACHE_MOVE.
+*******************************************************************************/
+bool scenery_module::lineOfSight(los_entry* entry, void* viewer, void* target,
+    kVector from, kVector to)
+{
+    if(entry->viewer == viewer && entry->target == target &&
+       los_clock - entry->time < SC_LOS_CACHE_TIME &&
+       distanceBetween(kVector(entry->from), from) < SC_LOS_CACHE_MOVE &&
+       distanceBetween(kVector(entry->to), to) < SC_LOS_CACHE_MOVE)
+        return entry->visible;
+    
+    entry->viewer = viewer;
+    entry->target = target;
+    entry->from[0] = from[0]; entry->from[1] = from[1]; entry->from[2] = from[2];
+    entry->to[0] = to[0]; entry->to[1] = to[1]; entry->to[2] = to[2];
+    entry->time = los_clock;
+    entry->visible = lineOfSight(from, to);
+    
+    return entry->visible;
+}
+
+/*******************************************************************************
+    function    :   scenery_module::linesOfSight
+    arguments   :   count - Number of lines
+                    from - Viewing positions
+                    to - Positions being viewed
+                    visible - Results (returned)
+    purpose     :   Batched form of lineOfSight.
+    notes       :   Uncached and thread safe, so a large batch may be split up
+                    between worker threads.
+*******************************************************************************/
+void scenery_module::linesOfSight(int count, kVector* from, kVector* to,
+    bool* visible)
+{
+    int i;
+    
+    for(i = 0; i < count; i++)
+        visible[i] = lineOfSight(from[i], to[i]);
+}
+
+/*******************************************************************************
+    function    :   scenery_module::clearLineOfSight
+    arguments   :   <none>
+    purpose     :   Empties the line of sight cache.
+    notes       :   <none>
+*******************************************************************************/
+void scenery_module::clearLineOfSight()
+{
+    int i;
+    
+    for(i = 0; i < SC_LOS_CACHE_SIZE; i++)
+    {
+        los_cache[i].viewer = los_cache[i].target = NULL;
+        los_cache[i].time = 0.0;
+        los_cache[i].visible = true;
+    }
+}
+
 /*******************************************************************************
     Base Display and Update Routines
 *******************************************************************************/
@@ -2791,6 +3867,8 @@ void scenery_module::update(float deltaT)
     float se_ratio;
     bool se_updated;
     
+    los_clock += deltaT;                // LOS cache invalidation clock
+    
     // Update parsec culling
     for(i = 0; i < parsec_count; i++)
         parsec[i].draw =
@@ -3170,16 +4248,15 @@ void scenery_module::update(float deltaT)
 
 /*******************************************************************************
     function    :   scenery_module::display_firstpass
-    arguments   :   <none>
+    arguments   :   camPos - Camera position of frame
     purpose     :   First pass display: Orients & renders skybox and base map
                     terrain (parsecs).
     notes       :   <none>
 *******************************************************************************/
-void scenery_module::displayFirstPass()
+void scenery_module::displayFirstPass(float* camPos)
 {
     int i;
     static float map_center[3] = {map_width / 2.0, 0.0, map_height / 2.0};
-    static float* cam_pos = camera.getCamPos();
     
     // Setup OpenGL for rendering
     glEnable(GL_COLOR_MATERIAL);
@@ -3194,8 +4271,8 @@ void scenery_module::displayFirstPass()
     // it a nice depth effect. Note that we could make this a part of the
     // updatefunc() if wanted to.
     glTranslatef(
-        map_center[0] + ((cam_pos[0] - map_center[0]) * 0.5), 0.0,
-        map_center[2] + ((cam_pos[2] - map_center[2]) * 0.5));
+        map_center[0] + ((camPos[0] - map_center[0]) * 0.5), 0.0,
+        map_center[2] + ((camPos[2] - map_center[2]) * 0.5));
     
     // Set texture mapping mode to decal so that the skybox doesn't have to
     // worry about materials.
@@ -89,6 +89,32 @@
 
 #define SC_BRIDGE_BLOCKMAP          15
 
+#define SC_ATLAS_SIZE               2048    // Max atlas page width/height
+#define SC_ATLAS_MAX_PAGES          256     // Max atlas pages (1 slot worst case)
+#define SC_ATLAS_INSET              0.5     // Slot UV inset (in texels)
+#define SC_MAXMIP_LEVELS            16      // Max levels in max height pyramid
+#define SC_PLANE_STRIDE             8       // Floats of plane data per tile
+#define SC_RASTER_SIZE              1.0     // Blockmap/tile type raster cell (m)
+
+#define SC_LOS_CACHE_SIZE           1024    // LOS cache entries (power of 2)
+#define SC_LOS_CACHE_TIME           1.0     // Time a cached LOS is good for (s)
+#define SC_LOS_CACHE_MOVE           2.0     // Movement a cached LOS allows (m)
+#define SC_LOS_TREE_RADIUS          0.35    // Tree occluder radius (x width)
+#define SC_LOS_CANOPY_HEIGHT        10.0    // Height of tree tile foliage (m)
+#define SC_LOS_SPARSE_DEPTH         80.0    // Sight depth into sparse trees (m)
+#define SC_LOS_DENSE_DEPTH          30.0    // Sight depth into dense trees (m)
+
+// Line of Sight Cache Entry
+struct los_entry
+{
+    void* viewer;                       // Viewer & target keys (NULL unused)
+    void* target;
+    float from[3];                      // End points when checked
+    float to[3];
+    float time;                         // LOS clock when checked
+    bool visible;
+};
+
 /*******************************************************************************
     class       :   scenery_module
     purpose     :   This is the main structure which controls everything Scenery
@@ -107,6 +133,10 @@
                        Culling is performed in the update() func, thus update()
                        should be called as much as possible throughout exec.
                     5) Base scenery objects are not culled (heightmap & skybox).
+                    6) lineOfSight tests terrain, trees, and tree tile foliage,
+                       with recent viewer/target results kept in a small cache.
+                       The shared cache is not thread safe, so jobs must pass
+                       a cache entry of their own (see sight_device).
 *******************************************************************************/
 class scenery_module
 {
@@ -133,6 +163,10 @@ class scenery_module
             short int tile_type;        // Uses TT_ definitions above
             short int tile_data;        // Stores extra data about tile
             short int tile_block;       // Blockmap data
+            
+            short int atlas_slot;       // Atlas slot (-1 -> not in atlas)
+            short int atlas_page;       // Atlas page slot resides on
+            float atlas_texel[4][2];    // Baked atlas UVs (NW, NE, SW, SE)
         };
         
         // Dynamic scenery element object (LL)
@@ -208,7 +242,6 @@ class scenery_module
         struct tile_data
         {
             short int tile_num;         // Tile number (not used/just incase)
-            float plane[8];             // Plane eq. data (Ax,By,Cz,D x2)
             
             tilemap_data* tilemap_ptr;  // Tilemap link
             parsec_data* parsec_ptr;    // Parsec link
@@ -240,9 +273,27 @@ class scenery_module
         
         float** heightmap;              // Heightmap elevation data
         tile_data** tile;               // Scenery tile data
+        float* plane_data;              // Plane eq. data (Ax,By,Cz,D x2 per tile)
         
         tilemap_data tilemap[256];      // Scenery tile mapper (tilemap file)
         
+        /* Max Height Pyramid (rayIntersect) */
+        float* maxmip[SC_MAXMIP_LEVELS];    // Max heights per level (row major)
+        int maxmip_width[SC_MAXMIP_LEVELS]; // Cell width/height per level
+        int maxmip_height[SC_MAXMIP_LEVELS];
+        int maxmip_levels;                  // # of levels in use
+        
+        /* Terrain Rasters (getBlockmap/getTileType) */
+        GLubyte* blockmap_raster;           // Blockmap per raster cell
+        GLubyte* tiletype_raster;           // Tile type per raster cell
+        int raster_width;                   // Raster cells across/down
+        int raster_height;
+        float raster_scale;                 // Raster cells per m
+        
+        /* Line of Sight Cache */
+        los_entry los_cache[SC_LOS_CACHE_SIZE]; // Viewer/target pair LOS cache
+        float los_clock;                    // Time for cache invalidation
+        
         /* Map Data */
         int ta_width;                   // Width and height of tile array
         int ta_height;
@@ -264,6 +315,16 @@ class scenery_module
         float water_height_offset;          // Water height offset wave
         GLuint sc_textures[10][5];          // Scenery textures ID storage
         
+        /* Tile Atlas Data */
+        GLubyte* atlas_image[SC_ATLAS_MAX_PAGES];   // Page images (load only)
+        GLuint atlas_texture_id[SC_ATLAS_MAX_PAGES];// Page texture IDs
+        int atlas_page_count;               // # of atlas pages in use
+        int atlas_slot_count;               // # of atlas slots in use
+        int atlas_slot_width;               // Slot size (tile image size)
+        int atlas_slot_height;
+        int atlas_pitch_x;                  // Slots across/down a page
+        int atlas_pitch_y;
+        
         /* Object Data */
         tree_object* tol_head;              // Tree list (D-LL)
         int tree_count;
@@ -275,17 +336,32 @@ class scenery_module
         void load_heightmap(char* file);    // Loads heightmap data
         void load_scenery(char* file);      // Loads scenery tile data
         void load_textures();               // Loads base scenery textures
+        int atlas_add(GLubyte* image);      // Packs tile image into atlas
+        void build_atlas();                 // Registers atlas & bakes UVs
+        void free_atlas();                  // Frees atlas of previous map
         
         /* Building Routines */
         void build_planes();                // Builds plane data for getHeights
+        void build_maxmip();                // Builds max height pyramid
         void build_heightmap();             // Builds the heightmap object
         void build_overlays();              // Builds tile overlays
         void build_skybox();                // Builds the skybox object
         void build_trees();                 // Builds tree objects
         void build_bridges();               // Builds bridge objects
+        void build_rasters();               // Builds blockmap/tile type rasters
         
         /* Misc. Routines */
+        inline float* tile_plane(int x, int z)  // Plane data of tile
+            { return &plane_data[((z * ta_width) + x) * SC_PLANE_STRIDE]; }
         bool on_tile(int tile_type, int tile_data, float x_offset, float z_offset);
+        int tile_type_at(float x_val, float z_val);
+        int blockmap_at(float x_val, float z_val);
+        bool segment_tile(int x, int z, kVector &segStart, kVector &segDir,
+            float t_enter, float t_exit, float &t);
+        bool ray_maxmip(int level, int cx, int cz, kVector &rayPos,
+            kVector &rayDir, float t_enter, float t_exit, float &t);
+        bool los_trees(kVector &from, kVector &to);
+        bool los_foliage(kVector &from, kVector &to);
         
     public:
         scenery_module();                   // Constructor
@@ -300,6 +376,11 @@ class scenery_module
         float getHeight(float x_val, float z_val);
         float getOverlayHeight(float x_val, float z_val);
         float getRelativeHeight(float x_val, float z_val);
+        // Batched height routines (count points in x/z arrays)
+        void getHeights(int count, float* x_vals, float* z_vals,
+            float* heights, float* normals = NULL);
+        void getOverlayHeights(int count, float* x_vals, float* z_vals,
+            float* heights);
         
         // Map tile tyle determination
         int getTileType(float x_val, float z_val);
@@ -308,9 +389,19 @@ class scenery_module
         /* Scenery Metric Extensions */
         // Heightmap/Ray Intersection
         kVector rayIntersect(kVector rayPos, kVector rayDir);
+        // Heightmap/Segment Intersection
+        bool segmentIntersect(kVector segStart, kVector segEnd,
+            kVector &impactPoint);
         // Basic Collision Detection
         bool groundCollision(kVector position);
         bool sceneryCollision(kVector position);
+        // Line of Sight (heightmap, trees, and tree tiles)
+        bool lineOfSight(kVector from, kVector to);
+        bool lineOfSight(void* viewer, void* target, kVector from, kVector to);
+        bool lineOfSight(los_entry* entry, void* viewer, void* target,
+            kVector from, kVector to);
+        void linesOfSight(int count, kVector* from, kVector* to, bool* visible);
+        void clearLineOfSight();
         
         /* Accessors */
         char* getSeasonName() { return season_name; }
@@ -328,8 +419,13 @@ class scenery_module
         int getTileArrayWidth() { return ta_width; }
         int getTileArrayHeight() { return ta_height; }
         
+        GLubyte* getBlockmapRaster() { return blockmap_raster; }
+        GLubyte* getTileTypeRaster() { return tiletype_raster; }
+        int getRasterWidth() { return raster_width; }
+        int getRasterHeight() { return raster_height; }
+        
         /* Base Display & Update Routines */
-        void displayFirstPass();
+        void displayFirstPass(float* camPos);
         void displaySecondPass();
         void update(float deltaT);
 };
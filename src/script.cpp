@@ -14,7 +14,8 @@
 #include "object.h"
 #include "tank.h"
 #include "objunit.h"
-//#include "astar.h"
+#include "astar.h"
+#include "visibility.h"
 #include "script.h"
 
 
@@ -1187,6 +1188,31 @@ bool script_module::clockGreaterThanGameTime()
     return false;
 }
 
+/*******************************************************************************
+    function    :   script_module::enemySpotted
+    arguments   :   <none>
+    purpose     :   Function that tests wether the player's side currently sees
+                    any enemy unit or not.
+    notes       :   <none>
+*******************************************************************************/
+bool script_module::enemySpotted()
+{
+    return visibility.getContactCount(game_setup.player_side) > 0;
+}
+
+/*******************************************************************************
+    function    :   script_module::playerSpotted
+    arguments   :   <none>
+    purpose     :   Function that tests wether the enemy side currently sees any
+                    unit of the player's side or not.
+    notes       :   <none>
+*******************************************************************************/
+bool script_module::playerSpotted()
+{
+    return visibility.getContactCount(game_setup.player_side == PS_AXIS ?
+        PS_ALLIED : PS_AXIS) > 0;
+}
+
 /*******************************************************************************
     function    :   script_module::createPredicateList
     arguments   :   <none>
@@ -1199,6 +1225,8 @@ void script_module::createPredicateList()
     // Adding predicate functions to list
     script.addPredicate( "clockGreaterThanGameTime", 
         &script_module::clockGreaterThanGameTime );
+    script.addPredicate( "enemySpotted", &script_module::enemySpotted );
+    script.addPredicate( "playerSpotted", &script_module::playerSpotted );
 }
 
 /*******************************************************************************
@@ -1376,16 +1404,13 @@ void script_module::fillSectionList()
 *******************************************************************************/
 predicate* script_module::getPredicate( char* name )
 {
-    return predicate_head;
     predicate* curr = predicate_head;
 
     while( curr != NULL )
     {
-        if( curr->name != NULL )
-        {
-            if( strcmp( name, curr->name ) == 0 )
-                return curr;
-        }
+        if( strcmp( name, curr->name ) == 0 )
+            return curr;
+        curr = curr->next;
     }
 
     return NULL;
@@ -1513,10 +1538,11 @@ bool script_module::handler( char* command )
         setCamPos                   position                        y           y
         setSideEffected             side                            y           y
         startEffect                 type                            y           y
+        testPath                    x1, z1, x2, z2                  y           n
         winMission                                                  y           y
         winResize                   width, height                   y           n
     */
-    /*if( (strcmp(word, "testPath")) == 0 )
+    if( (strcmp(word, "testPath")) == 0 )
     {
         if( cmd_from_script == false )
         {
@@ -1534,8 +1560,8 @@ bool script_module::handler( char* command )
             return 1;
             }
         }
-        
-    }*/
+        return 1;
+    }
     if( (strcmp(word, "addMessage")) == 0 )
     {
         // We must make sure there's another word after addMessage
@@ -1772,7 +1798,10 @@ bool script_module::handler( char* command )
         }
         else if( cmd_from_script == false )
         {
-            exit(0);
+            // Quit is handled by the main thread (see gameMainLoop)
+            SDL_Event quit_event;
+            quit_event.type = SDL_QUIT;
+            SDL_PushEvent(&quit_event);
             return 1;
         }
         else
@@ -2572,7 +2601,7 @@ bool script_module::handler( char* command )
                objectToMove->obj_type == OBJ_TYPE_ATR
               )
             {          
-                (dynamic_cast<moving_object*>(objectToMove))->addWaypoint(kVector( float_array[0],  map.getHeight(float_array[0], float_array[1]), float_array[1]));
+                astar.requestPath(dynamic_cast<moving_object*>(objectToMove), kVector( float_array[0],  map.getHeight(float_array[0], float_array[1]), float_array[1]));
                 sprintf(buffer, "Point <%f,%f,%f> has been added to tanks path.", float_array[0], map.getHeight(float_array[0], float_array[1]), float_array[1]);
                 console.addSysMessage( buffer );
                 return 1;
@@ -2820,7 +2849,7 @@ bool script_module::handler( char* command )
               )
             {
                 (dynamic_cast<moving_object*>(objectToMove))->killWaypoints();           
-                (dynamic_cast<moving_object*>(objectToMove))->addWaypoint(kVector( float_array[0], map.getHeight(float_array[0], float_array[1]), float_array[1]));
+                astar.requestPath(dynamic_cast<moving_object*>(objectToMove), kVector( float_array[0], map.getHeight(float_array[0], float_array[1]), float_array[1]));
                 sprintf(buffer, "Unit is moving to: <%f,%f,%f>", float_array[0], map.getHeight(float_array[0], float_array[1]), float_array[1]);
                 console.addSysMessage( buffer );
                 return 1;
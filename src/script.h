@@ -409,6 +409,8 @@ public:
     void addTrigger( trigger* trigger_ptr );
     void loadSuccess();
     bool clockGreaterThanGameTime();
+    bool enemySpotted();
+    bool playerSpotted();
     void createPredicateList();
     void displayGoals();
     void displayRoutines();
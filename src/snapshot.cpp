@@ -0,0 +1,632 @@
+/*******************************************************************************
+                      Render Snapshot Module - Implementation
+*******************************************************************************/
+#include "main.h"
+#include "snapshot.h"
+#include "atg.h"
+#include "bullets.h"
+#include "camera.h"
+#include "effects.h"
+#include "misc.h"
+#include "objhandler.h"
+#include "projectile.h"
+#include "tank.h"
+
+/*******************************************************************************
+    function    :   render_snapshot::render_snapshot
+    arguments   :   <none>
+    purpose     :   Constructor.
+    notes       :   <none>
+*******************************************************************************/
+render_snapshot::render_snapshot()
+{
+    int i;
+
+    time = 0;
+
+    object = new snap_object[SNAP_INITIAL];
+    object_count = 0;
+    object_max = SNAP_INITIAL;
+
+    proj = new snap_proj[SNAP_INITIAL];
+    proj_count = 0;
+    proj_max = SNAP_INITIAL;
+
+    bullet = new snap_bullet[SNAP_INITIAL];
+    bullet_count = 0;
+    bullet_max = SNAP_INITIAL;
+
+    particle = new snap_particle[SNAP_INITIAL];
+    particle_count = 0;
+    particle_max = SNAP_INITIAL;
+
+    slot_record = new int[OBJ_HANDLE_SLOTS];
+    slot_max = OBJ_HANDLE_SLOTS;
+    for(i = 0; i < slot_max; i++)
+        slot_record[i] = -1;
+}
+
+/*******************************************************************************
+    function    :   render_snapshot::~render_snapshot
+    arguments   :   <none>
+    purpose     :   Deconstructor.
+    notes       :   <none>
+*******************************************************************************/
+render_snapshot::~render_snapshot()
+{
+    delete [] object;
+    delete [] proj;
+    delete [] bullet;
+    delete [] particle;
+    delete [] slot_record;
+}
+
+/*******************************************************************************
+    function    :   render_snapshot::clear
+    arguments   :   <none>
+    purpose     :   Empties the snapshot, ready to be filled again.
+    notes       :   Only the slots of the records held are reset, rather than
+                    the whole slot table.
+*******************************************************************************/
+void render_snapshot::clear()
+{
+    int i;
+
+    for(i = 0; i < object_count; i++)
+        if(object[i].handle != OBJ_HANDLE_NONE)
+            slot_record[object[i].handle & OBJ_HANDLE_SLOT_MASK] = -1;
+
+    for(i = 0; i < proj_count; i++)
+        if(proj[i].handle != OBJ_HANDLE_NONE)
+            slot_record[proj[i].handle & OBJ_HANDLE_SLOT_MASK] = -1;
+
+    object_count = proj_count = bullet_count = particle_count = 0;
+}
+
+/*******************************************************************************
+    function    :   <static> set_slot
+    arguments   :   snap - Snapshot
+                    handle - Object handle
+                    record - Record of object
+    purpose     :   Records which record an object handle's slot is given,
+                    growing the slot table as needed.
+    notes       :   <none>
+*******************************************************************************/
+static void set_slot(render_snapshot* snap, unsigned int handle, int record)
+{
+    int slot = (int)(handle & OBJ_HANDLE_SLOT_MASK);
+    int* new_record;
+    int new_max;
+    int i;
+
+    if(handle == OBJ_HANDLE_NONE)
+        return;
+
+    if(slot >= snap->slot_max)
+    {
+        new_max = snap->slot_max * 2;
+        while(slot >= new_max)
+            new_max *= 2;
+
+        new_record = new int[new_max];
+        for(i = 0; i < snap->slot_max; i++)
+            new_record[i] = snap->slot_record[i];
+        for(; i < new_max; i++)
+            new_record[i] = -1;
+
+        delete [] snap->slot_record;
+        snap->slot_record = new_record;
+        snap->slot_max = new_max;
+    }
+
+    snap->slot_record[slot] = record;
+}
+
+/*******************************************************************************
+    function    :   render_snapshot::addObject
+    arguments   :   handle - Handle of object
+    purpose     :   Adds an object record to the snapshot.
+    notes       :   The record returned is only good until the next record is
+                    added, as the list may grow.
+*******************************************************************************/
+snap_object* render_snapshot::addObject(unsigned int handle)
+{
+    snap_object* new_object;
+    int i;
+
+    if(object_count == object_max)
+    {
+        new_object = new snap_object[object_max * 2];
+        for(i = 0; i < object_count; i++)
+            new_object[i] = object[i];
+
+        delete [] object;
+        object = new_object;
+        object_max *= 2;
+    }
+
+    set_slot(this, handle, object_count);
+    object[object_count].handle = handle;
+
+    return &object[object_count++];
+}
+
+/*******************************************************************************
+    function    :   render_snapshot::addProj
+    arguments   :   handle - Handle of projectile
+    purpose     :   Adds a projectile record to the snapshot.
+    notes       :   The record returned is only good until the next record is
+                    added, as the list may grow.
+*******************************************************************************/
+snap_proj* render_snapshot::addProj(unsigned int handle)
+{
+    snap_proj* new_proj;
+    int i;
+
+    if(proj_count == proj_max)
+    {
+        new_proj = new snap_proj[proj_max * 2];
+        for(i = 0; i < proj_count; i++)
+            new_proj[i] = proj[i];
+
+        delete [] proj;
+        proj = new_proj;
+        proj_max *= 2;
+    }
+
+    set_slot(this, handle, proj_count);
+    proj[proj_count].handle = handle;
+
+    return &proj[proj_count++];
+}
+
+/*******************************************************************************
+    function    :   render_snapshot::addBullet
+    arguments   :   <none>
+    purpose     :   Adds an MG bullet record to the snapshot.
+    notes       :   The record returned is only good until the next record is
+                    added, as the list may grow.
+*******************************************************************************/
+snap_bullet* render_snapshot::addBullet()
+{
+    snap_bullet* new_bullet;
+    int i;
+
+    if(bullet_count == bullet_max)
+    {
+        new_bullet = new snap_bullet[bullet_max * 2];
+        for(i = 0; i < bullet_count; i++)
+            new_bullet[i] = bullet[i];
+
+        delete [] bullet;
+        bullet = new_bullet;
+        bullet_max *= 2;
+    }
+
+    return &bullet[bullet_count++];
+}
+
+/*******************************************************************************
+    function    :   render_snapshot::addParticle
+    arguments   :   <none>
+    purpose     :   Adds a particle record to the snapshot.
+    notes       :   The record returned is only good until the next record is
+                    added, as the list may grow.
+*******************************************************************************/
+snap_particle* render_snapshot::addParticle()
+{
+    snap_particle* new_particle;
+    int i;
+
+    if(particle_count == particle_max)
+    {
+        new_particle = new snap_particle[particle_max * 2];
+        for(i = 0; i < particle_count; i++)
+            new_particle[i] = particle[i];
+
+        delete [] particle;
+        particle = new_particle;
+        particle_max *= 2;
+    }
+
+    return &particle[particle_count++];
+}
+
+/*******************************************************************************
+    function    :   render_snapshot::findObject
+    arguments   :   handle - Handle of object
+    purpose     :   Returns the record of an object, or NULL if the object is
+                    not in the snapshot.
+    notes       :   <none>
+*******************************************************************************/
+snap_object* render_snapshot::findObject(unsigned int handle)
+{
+    int slot = (int)(handle & OBJ_HANDLE_SLOT_MASK);
+    int record;
+
+    if(handle == OBJ_HANDLE_NONE || slot >= slot_max)
+        return NULL;
+
+    record = slot_record[slot];
+    if(record < 0 || record >= object_count || object[record].handle != handle)
+        return NULL;
+
+    return &object[record];
+}
+
+/*******************************************************************************
+    function    :   render_snapshot::findProj
+    arguments   :   handle - Handle of projectile
+    purpose     :   Returns the record of a projectile, or NULL if the
+                    projectile is not in the snapshot.
+    notes       :   <none>
+*******************************************************************************/
+snap_proj* render_snapshot::findProj(unsigned int handle)
+{
+    int slot = (int)(handle & OBJ_HANDLE_SLOT_MASK);
+    int record;
+
+    if(handle == OBJ_HANDLE_NONE || slot >= slot_max)
+        return NULL;
+
+    record = slot_record[slot];
+    if(record < 0 || record >= proj_count || proj[record].handle != handle)
+        return NULL;
+
+    return &proj[record];
+}
+
+/*******************************************************************************
+    function    :   snapshot_module::snapshot_module
+    arguments   :   <none>
+    purpose     :   Constructor.
+    notes       :   <none>
+*******************************************************************************/
+snapshot_module::snapshot_module()
+{
+    latest = previous = -1;
+    drawing[0] = drawing[1] = -1;
+    mutex = NULL;
+
+    draw_prev = draw_curr = NULL;
+    alpha = 1.0;
+}
+
+/*******************************************************************************
+    function    :   snapshot_module::~snapshot_module
+    arguments   :   <none>
+    purpose     :   Deconstructor.
+    notes       :   <none>
+*******************************************************************************/
+snapshot_module::~snapshot_module()
+{
+    stop();
+}
+
+/*******************************************************************************
+    function    :   snapshot_module::start
+    arguments   :   <none>
+    purpose     :   Creates the snapshot lock.
+    notes       :   <none>
+*******************************************************************************/
+void snapshot_module::start()
+{
+    if(mutex)
+        return;
+
+    mutex = SDL_CreateMutex();
+
+    if(!mutex)
+    {
+        write_error("Snapshot: Could not create snapshot lock.");
+        exit(1);
+    }
+}
+
+/*******************************************************************************
+    function    :   snapshot_module::stop
+    arguments   :   <none>
+    purpose     :   Frees the snapshot lock.
+    notes       :   Neither thread may be using the module once stopped.
+*******************************************************************************/
+void snapshot_module::stop()
+{
+    if(!mutex)
+        return;
+
+    SDL_DestroyMutex(mutex);
+    mutex = NULL;
+}
+
+/*******************************************************************************
+    function    :   snapshot_module::capture
+    arguments   :   time - Ticks at the end of the step (in ms)
+    purpose     :   Takes a snapshot of the simulation and publishes it as the
+                    latest.
+    notes       :   Called from the simulation thread, once a step is done.
+*******************************************************************************/
+void snapshot_module::capture(unsigned int time)
+{
+    render_snapshot* snap;
+    int fill;
+
+    // Pick a buffer which is neither one of the latest two nor being drawn
+    // (there is always at least one, see SNAP_BUFFERS).
+    SDL_mutexP(mutex);
+    for(fill = 0; fill < SNAP_BUFFERS; fill++)
+        if(fill != latest && fill != previous &&
+           fill != drawing[0] && fill != drawing[1])
+            break;
+    SDL_mutexV(mutex);
+
+    // Fill snapshot
+    snap = &snaps[fill];
+    snap->clear();
+    snap->time = time;
+
+    objects.snapshot(snap);
+    bullets.snapshot(snap);
+    effects.snapshot(snap);
+
+    // Publish snapshot as the latest
+    SDL_mutexP(mutex);
+    previous = latest;
+    latest = fill;
+    SDL_mutexV(mutex);
+}
+
+/*******************************************************************************
+    function    :   snapshot_module::acquire
+    arguments   :   time - Ticks the frame is drawn at (in ms)
+                    camPos - Camera position of frame
+    purpose     :   Takes hold of the latest two snapshots for drawing a frame
+                    and works out how far to blend between them.
+    notes       :   Returns false if nothing has been published yet, in which
+                    case there is nothing to draw (and release need not be
+                    called).
+*******************************************************************************/
+bool snapshot_module::acquire(unsigned int time, kVector camPos)
+{
+    int since;
+    int between;
+
+    view_pos = camPos;
+
+    SDL_mutexP(mutex);
+    drawing[0] = previous;
+    drawing[1] = latest;
+    SDL_mutexV(mutex);
+
+    if(drawing[1] == -1)
+        return false;
+
+    draw_curr = &snaps[drawing[1]];
+    draw_prev = (drawing[0] != -1 ? &snaps[drawing[0]] : NULL);
+
+    // Blend by how far the frame is past the latest snapshot, relative to
+    // the time between the two.
+    alpha = 1.0;
+    if(draw_prev)
+    {
+        since = (int)(time - draw_curr->time);
+        between = (int)(draw_curr->time - draw_prev->time);
+
+        if(between > 0)
+        {
+            alpha = (float)since / (float)between;
+
+            if(alpha < 0.0)
+                alpha = 0.0;
+            else if(alpha > 1.0)
+                alpha = 1.0;
+        }
+    }
+
+    return true;
+}
+
+/*******************************************************************************
+    function    :   snapshot_module::release
+    arguments   :   <none>
+    purpose     :   Lets go of the snapshots held for drawing a frame.
+    notes       :   <none>
+*******************************************************************************/
+void snapshot_module::release()
+{
+    SDL_mutexP(mutex);
+    drawing[0] = drawing[1] = -1;
+    SDL_mutexV(mutex);
+
+    draw_prev = draw_curr = NULL;
+}
+
+/*******************************************************************************
+    function    :   snapshot_module::blend_matrix
+    arguments   :   dest - Blended matrix
+                    from - Matrix of earlier snapshot
+                    to - Matrix of later snapshot
+    purpose     :   Blends two matrices by the frame's blend.
+    notes       :   <none>
+*******************************************************************************/
+void snapshot_module::blend_matrix(GLfloat* dest, GLfloat* from, GLfloat* to)
+{
+    int i;
+
+    for(i = 0; i < 16; i++)
+        dest[i] = from[i] + (to[i] - from[i]) * alpha;
+}
+
+/*******************************************************************************
+    function    :   snapshot_module::displayFirstPass
+    arguments   :   <none>
+    purpose     :   Displays the objects of the snapshots (units, etc.).
+    notes       :   <none>
+*******************************************************************************/
+void snapshot_module::displayFirstPass()
+{
+    snap_object blended;
+    snap_object* obj;
+    snap_object* from;
+    int i, j;
+
+    if(!draw_curr)
+        return;
+
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    for(i = 0; i < draw_curr->object_count; i++)
+    {
+        obj = &draw_curr->object[i];
+
+        // Blend from the earlier snapshot, if the object is in it
+        if(draw_prev && alpha < 1.0 &&
+           (from = draw_prev->findObject(obj->handle)) != NULL &&
+           from->turret_count == obj->turret_count &&
+           from->gun_count == obj->gun_count)
+        {
+            blended = *obj;
+            blend_matrix(blended.hull_matrix, from->hull_matrix,
+                obj->hull_matrix);
+            for(j = 0; j < obj->turret_count; j++)
+                blend_matrix(blended.turret_matrix[j], from->turret_matrix[j],
+                    obj->turret_matrix[j]);
+            for(j = 0; j < obj->gun_count; j++)
+                blend_matrix(blended.gun_matrix[j], from->gun_matrix[j],
+                    obj->gun_matrix[j]);
+            obj = &blended;
+        }
+
+        // Culling check (against the position drawn at)
+        if(!camera.sphereInView(&obj->hull_matrix[12], obj->radius))
+            continue;
+
+        switch(obj->kind)
+        {
+            case SNAP_OBJ_TANK:
+                tank_object::display(obj);
+                break;
+
+            case SNAP_OBJ_ATG:
+                atg_object::display(obj);
+                break;
+
+            default:
+                object::display(obj);
+                break;
+        }
+    }
+}
+
+/*******************************************************************************
+    function    :   snapshot_module::displaySecondPass
+    arguments   :   <none>
+    purpose     :   Displays the projectiles of the snapshots.
+    notes       :   Tracers are gathered into the tracer pass.
+*******************************************************************************/
+void snapshot_module::displaySecondPass()
+{
+    snap_proj blended;
+    snap_proj* proj;
+    snap_proj* from;
+    int i;
+
+    if(!draw_curr)
+        return;
+
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    for(i = 0; i < draw_curr->proj_count; i++)
+    {
+        proj = &draw_curr->proj[i];
+
+        // Blend from the earlier snapshot, if the projectile is in it
+        if(draw_prev && alpha < 1.0 &&
+           (from = draw_prev->findProj(proj->handle)) != NULL)
+        {
+            blended = *proj;
+            blend_matrix(blended.hull_matrix, from->hull_matrix,
+                proj->hull_matrix);
+            proj = &blended;
+        }
+
+        // Culling check (against the position drawn at)
+        if(!camera.sphereInView(&proj->hull_matrix[12], proj->radius))
+            continue;
+
+        proj_object::display(proj, view_pos());
+    }
+}
+
+/*******************************************************************************
+    function    :   snapshot_module::displayBullets
+    arguments   :   <none>
+    purpose     :   Displays the MG bullets of the latest snapshot.
+    notes       :   Bullets are blended over their last step. Tracers are
+                    gathered into the tracer pass.
+*******************************************************************************/
+void snapshot_module::displayBullets()
+{
+    snap_bullet* bullet;
+    float pos[3];
+    bool in_view;
+    int i, j;
+
+    if(!draw_curr)
+        return;
+
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    for(i = 0; i < draw_curr->bullet_count; i++)
+    {
+        bullet = &draw_curr->bullet[i];
+
+        // Blend over the bullet's last step
+        for(j = 0; j < 3; j++)
+            pos[j] = bullet->last[j] + (bullet->pos[j] - bullet->last[j]) * alpha;
+
+        // Culling check (against the position drawn at, or any of its tail)
+        in_view = camera.sphereInView(pos, 2.5);
+        if(!in_view && (bullet->modifiers & AMMO_MOD_TRACER))
+            for(j = 0; j < BLT_TRACER_TAIL && !in_view; j++)
+                in_view = camera.pointInView(bullet->tail[j]);
+        if(!in_view)
+            continue;
+
+        bullets.display(bullet, pos, view_pos());
+    }
+}
+
+/*******************************************************************************
+    function    :   snapshot_module::displayEffects
+    arguments   :   <none>
+    purpose     :   Displays the particles of the latest snapshot.
+    notes       :   Rain and snow particles are positioned relative to the
+                    camera, and are culled as drawn.
+*******************************************************************************/
+void snapshot_module::displayEffects()
+{
+    snap_particle* particle;
+    kVector pos;
+    int i;
+
+    if(!draw_curr)
+        return;
+
+    // Enable textures and color material mapping
+    glEnable(GL_TEXTURE_2D);
+    glEnable(GL_COLOR_MATERIAL);
+
+    for(i = 0; i < draw_curr->particle_count; i++)
+    {
+        particle = &draw_curr->particle[i];
+
+        // Culling check (against the position drawn at)
+        pos = particle->pos;
+        if(particle->effect_type == SE_RAIN || particle->effect_type == SE_SNOW)
+            pos += view_pos;
+        if(!camera.sphereInView(pos(), particle->size))
+            continue;
+
+        effects.display(particle, view_pos);
+    }
+}
@@ -0,0 +1,214 @@
+/*******************************************************************************
+                        Render Snapshot Module - Definition
+*******************************************************************************/
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "metrics.h"
+#include "object.h"
+#include "bullets.h"
+#include "projectile.h"
+
+// Snapshot Buffers
+#define SNAP_BUFFERS                5       // Two drawn, latest two, one filled
+#define SNAP_INITIAL                64      // Initial records per list (grows)
+
+// Snapshot Object Kinds (how a snap_object is drawn)
+#define SNAP_OBJ_MODEL              0       // Model only (object::display)
+#define SNAP_OBJ_TANK               1       // Tank (tank_object::display)
+#define SNAP_OBJ_ATG                2       // ATG (atg_object::display)
+
+// Object Record (units, and anything else drawn as a model)
+struct snap_object
+{
+    unsigned int handle;                // Object handle (for interpolation)
+    short kind;                         // Object kind (SNAP_OBJ_xxx)
+    bool selected;                      // Unit is selected
+    float radius;                       // Culling radius
+    int model_id;                       // Model library ID
+    GLfloat hull_matrix[16];            // Hull orientation matrix
+
+    GLuint hull_dspList;                // Hull display list
+    GLuint selected_dspList;            // Selected visual display list
+
+    int track_left_id;                  // Track meshes and texel offsets
+    int track_right_id;
+    float track_left_s_texel;
+    float track_right_s_texel;
+
+    int turret_count;                   // Turrets
+    GLfloat turret_matrix[OBJ_TURRET_MAX][16];
+    GLuint turret_dspList[OBJ_TURRET_MAX];
+
+    int gun_count;                      // Guns
+    GLfloat gun_matrix[OBJ_GUN_MAX][16];
+    GLuint gun_mant_dspList[OBJ_GUN_MAX];
+    GLuint gun_dspList[OBJ_GUN_MAX];
+    float gun_recoil[OBJ_GUN_MAX];
+};
+
+// Projectile Record
+struct snap_proj
+{
+    unsigned int handle;                // Object handle (for interpolation)
+    float radius;                       // Culling radius
+    GLfloat hull_matrix[16];            // Hull orientation matrix
+    float diameter;                     // Caliber (in cm)
+    unsigned int modifiers;             // Modifiers (AMMO_MOD_xxx)
+    bool flight;                        // Projectile is in flight
+    bool damaged;                       // Projectile has been damaged
+    float tail[PROJ_MAX_TRACER_TAIL][3];    // Tracer tail (0 is newest)
+};
+
+// MG Bullet Record
+struct snap_bullet
+{
+    float pos[3];                       // Position
+    float last[3];                      // Position at start of last step
+    float vel[3];                       // Velocity (direction scaled)
+    float caliber;                      // Caliber (in cm)
+    unsigned short modifiers;           // Modifiers (AMMO_MOD_xxx)
+    unsigned char flags;                // Bullet flags (BLT_FLAG_xxx)
+    float tail[BLT_TRACER_TAIL][3];     // Tracer tail (0 is newest)
+};
+
+// Particle Record (particle, plus what is drawn of its effect)
+struct snap_particle
+{
+    kVector pos;                        // Position of particle
+    float roll;                         // Roll of particle
+    float size;                         // Size of particle
+    float time_left;                    // Time left for particle
+    int tex_num;                        // Texture num of particle
+
+    int effect_type;                    // Effect type tag
+    float life_time;                    // Life time of each particle
+    float image_slice;                  // Width of a frame in texture
+    GLuint tex_frame;                   // Texture ID for animation frames
+};
+
+/*******************************************************************************
+    struct      :   render_snapshot
+    purpose     :   Everything the 3D passes draw of the simulation, as of the
+                    end of one simulation step. Filled by the simulation thread
+                    and then only read, by the render thread.
+    notes       :   1) Record lists only grow, so there is no allocation once
+                       enough room has been made.
+                    2) slot_record gives the record of each handle slot, so
+                       an object's record in another snapshot is found without
+                       a search. A slot's record must still be checked for the
+                       same handle, as the slot may have been reused since.
+*******************************************************************************/
+struct render_snapshot
+{
+    unsigned int time;                  // Ticks snapshot was taken at (in ms)
+
+    snap_object* object;                // Objects (units, etc.)
+    int object_count;
+    int object_max;
+
+    snap_proj* proj;                    // Projectiles
+    int proj_count;
+    int proj_max;
+
+    snap_bullet* bullet;                // MG bullets
+    int bullet_count;
+    int bullet_max;
+
+    snap_particle* particle;            // Particles (in draw order)
+    int particle_count;
+    int particle_max;
+
+    int* slot_record;                   // Record of each handle slot (or -1)
+    int slot_max;
+
+    render_snapshot();                  // Constructor
+    ~render_snapshot();                 // Deconstructor
+
+    /* Fill Routines */
+    void clear();
+    snap_object* addObject(unsigned int handle);
+    snap_proj* addProj(unsigned int handle);
+    snap_bullet* addBullet();
+    snap_particle* addParticle();
+
+    /* Lookup Routines */
+    snap_object* findObject(unsigned int handle);
+    snap_proj* findProj(unsigned int handle);
+};
+
+/*******************************************************************************
+    class       :   snapshot_module
+    purpose     :   Hands render snapshots from the simulation thread to the
+                    render (GL) thread, and draws them, interpolating between
+                    the last two.
+    notes       :   1) The simulation thread captures a snapshot after every
+                       step into a buffer which is neither the latest nor one
+                       being drawn, then publishes it as the latest. Neither
+                       thread ever waits on the other for more than the swap
+                       of a few indices.
+                    2) A frame draws the latest two snapshots, blended by how
+                       far the frame is past the latest, relative to the time
+                       between them, so motion is drawn one step behind the
+                       simulation but is smooth at any frame rate.
+                    3) Objects and projectiles are matched between snapshots
+                       by handle, and have their matrices blended directly
+                       (the rotation made in a single step is far too small
+                       for the blend to visibly shrink the model). Anything
+                       not in the earlier snapshot is drawn as it is in the
+                       later one. MG bullets are blended over their last step.
+                    4) Particles, track texel offsets, gun recoil and tracer
+                       tails are drawn as of the latest snapshot.
+                    5) Culling is done here, against the blended position,
+                       so that it always agrees with what is drawn. Nothing
+                       is culled when a snapshot is captured.
+                    6) The camera may be moved by the simulation (scripts),
+                       so the frame's camera position is read once, under
+                       the world lock, and handed to acquire. Display
+                       routines use it rather than reading the camera.
+                       (The culling frustum is only ever set by
+                       camera.orient, on the render thread.)
+*******************************************************************************/
+class snapshot_module
+{
+    private:
+        render_snapshot snaps[SNAP_BUFFERS];    // Snapshot buffers
+        int latest;                     // Latest snapshot (-1 for none)
+        int previous;                   // Snapshot before latest (-1 for none)
+        int drawing[2];                 // Snapshots being drawn (-1 for none)
+        SDL_mutex* mutex;               // Guards indices above
+
+        /* Frame State (render thread) */
+        render_snapshot* draw_prev;     // Earlier snapshot of frame
+        render_snapshot* draw_curr;     // Later snapshot of frame
+        float alpha;                    // Blend from earlier to later
+        kVector view_pos;               // Camera position of frame
+
+        /* Blending Routines */
+        void blend_matrix(GLfloat* dest, GLfloat* from, GLfloat* to);
+
+    public:
+        snapshot_module();              // Constructor
+        ~snapshot_module();             // Deconstructor
+
+        /* Base Routines */
+        void start();
+        void stop();
+
+        /* Simulation Thread Routines */
+        void capture(unsigned int time);
+
+        /* Render Thread Routines */
+        bool acquire(unsigned int time, kVector camPos);
+        void release();
+
+        /* Display Routines (render thread, between acquire and release) */
+        void displayFirstPass();
+        void displaySecondPass();
+        void displayBullets();
+        void displayEffects();
+};
+
+extern snapshot_module snapshots;
+
+#endif
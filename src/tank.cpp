@@ -15,6 +15,7 @@
 #include "objmodules.h"
 #include "projectile.h"
 #include "scenery.h"
+#include "snapshot.h"
 #include "sounds.h"
 
 /*******************************************************************************
@@ -381,12 +382,16 @@ void tank_object::initTank()
                     attachmentLevelTo - conversion to this attachment level
     purpose     :   Function that perform transformations based on attachment
                     levels for 3D coordinate transforms.
-    notes       :   <none>
+    notes       :   1) Every level is a single pass through a matrix cached by
+                       updateMatrices (inverse passes for transforms to turret
+                       and gun levels), so repeated queries from sights, crew
+                       and collision handling cost no GL calls.
+                    2) Gun recoil is a translation along the bore of the gun
+                       mount, so it is applied to the position directly.
 *******************************************************************************/
 kVector tank_object::transform(kVector position, int attachLevelFrom, int attachLevelTo)
 {
-    int i, j;
-    GLfloat matrix[16];
+    int i;
     
     if(attachLevelFrom == attachLevelTo)
         return position;
@@ -420,13 +425,8 @@ kVector tank_object::transform(kVector position, int attachLevelFrom, int attach
                 case OBJ_ATTACH_GUN4:
                 case OBJ_ATTACH_GUN5:
                     i = attachLevelFrom - OBJ_ATTACH_GUN_OFF;
-                    glMatrixMode(GL_MODELVIEW);
-                    glPushMatrix();
-                    glLoadMatrixf(gun_matrix[i]);
-                    glTranslatef(0.0, 0.0, -gun[i].getGunRecoil());
-                    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-                    glPopMatrix();
-                    return transformed(position, (float*)matrix);
+                    position[2] -= gun[i].getGunRecoil();       // Recoil gun
+                    return transformed(position, (float*)gun_matrix[i]);
                     break;
                 
                 default:
@@ -441,16 +441,7 @@ kVector tank_object::transform(kVector position, int attachLevelFrom, int attach
                 case OBJ_ATTACH_TURRET1:
                 case OBJ_ATTACH_TURRET2:
                 case OBJ_ATTACH_TURRET3:
-                    i = attachLevelFrom - OBJ_ATTACH_TURRET_OFF;
-                    glMatrixMode(GL_MODELVIEW);
-                    glPushMatrix();
-                    glLoadIdentity();
-                    glTranslatef(turret_pivot[i][0], turret_pivot[i][1],
-                         turret_pivot[i][2]);
-                    glRotatef(turret_rotation[i] * radToDeg, 0.0, 1.0, 0.0);
-                    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-                    glPopMatrix();
-                    return transformed(position, (float*)matrix);
+                    return transformed(position, (float*)turret_local_matrix[attachLevelFrom - OBJ_ATTACH_TURRET_OFF]);
                     break;
                 
                 case OBJ_ATTACH_GUNMNT1:
@@ -458,30 +449,7 @@ kVector tank_object::transform(kVector position, int attachLevelFrom, int attach
                 case OBJ_ATTACH_GUNMNT3:
                 case OBJ_ATTACH_GUNMNT4:
                 case OBJ_ATTACH_GUNMNT5:
-                    i = attachLevelFrom - OBJ_ATTACH_GUNMNT_OFF;
-                    glMatrixMode(GL_MODELVIEW);
-                    glPushMatrix();
-                    glLoadIdentity();
-                    if(gun[i].getGunAttach() == OBJ_ATTACH_HULL)
-                    {
-                        // Gun is attached to main hull (enabled gun transverse)
-                        glTranslatef(gun[i].getGunPivotV()[0],
-                                     gun[i].getGunPivotV()[1],
-                                     gun[i].getGunPivotV()[2]);
-                        glRotatef(gun[i].getTransverse() * radToDeg, 0.0, 1.0, 0.0);
-                    }
-                    else
-                    {
-                        // Gun is attached to turret (disabled gun transverse)
-                        glLoadMatrixf(turret_matrix[gun[i].getGunAttach() - OBJ_ATTACH_TURRET_OFF]);
-                        glTranslatef(gun[i].getGunPivotV()[0],
-                                     gun[i].getGunPivotV()[1],
-                                     gun[i].getGunPivotV()[2]);
-                    }
-                    glRotatef((gun[i].getElevate() * radToDeg) - 90.0, 1.0, 0.0, 0.0);
-                    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-                    glPopMatrix();
-                    return transformed(position, (float*)matrix);
+                    return transformed(position, (float*)gun_local_matrix[attachLevelFrom - OBJ_ATTACH_GUNMNT_OFF]);
                     break;
                 
                 case OBJ_ATTACH_GUN1:
@@ -490,30 +458,8 @@ kVector tank_object::transform(kVector position, int attachLevelFrom, int attach
                 case OBJ_ATTACH_GUN4:
                 case OBJ_ATTACH_GUN5:
                     i = attachLevelFrom - OBJ_ATTACH_GUN_OFF;
-                    glMatrixMode(GL_MODELVIEW);
-                    glPushMatrix();
-                    glLoadIdentity();
-                    if(gun[i].getGunAttach() == OBJ_ATTACH_HULL)
-                    {
-                        // Gun is attached to main hull (enabled gun transverse)
-                        glTranslatef(gun[i].getGunPivotV()[0],
-                                     gun[i].getGunPivotV()[1],
-                                     gun[i].getGunPivotV()[2]);
-                        glRotatef(gun[i].getTransverse() * radToDeg, 0.0, 1.0, 0.0);
-                    }
-                    else
-                    {
-                        // Gun is attached to turret (disabled gun transverse)
-                        glLoadMatrixf(turret_matrix[gun[i].getGunAttach() - OBJ_ATTACH_TURRET_OFF]);
-                        glTranslatef(gun[i].getGunPivotV()[0],
-                                     gun[i].getGunPivotV()[1],
-                                     gun[i].getGunPivotV()[2]);
-                    }
-                    glRotatef((gun[i].getElevate() * radToDeg) - 90.0, 1.0, 0.0, 0.0);
-                    glTranslatef(0.0, 0.0, -gun[i].getGunRecoil());     // Recoil gun
-                    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-                    glPopMatrix();
-                    return transformed(position, (float*)matrix);
+                    position[2] -= gun[i].getGunRecoil();       // Recoil gun
+                    return transformed(position, (float*)gun_local_matrix[i]);
                     break;
                 
                 default:
@@ -529,15 +475,7 @@ kVector tank_object::transform(kVector position, int attachLevelFrom, int attach
             switch(attachLevelFrom)
             {
                 case OBJ_ATTACH_HULL:
-                    glMatrixMode(GL_MODELVIEW);
-                    glPushMatrix();
-                    glLoadIdentity();
-                    glRotatef(-turret_rotation[i] * radToDeg, 0.0, 1.0, 0.0);
-                    glTranslatef(-turret_pivot[i][0], -turret_pivot[i][1],
-                         -turret_pivot[i][2]);
-                    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-                    glPopMatrix();
-                    return transformed(position, (float*)matrix);
+                    return untransformed(position, (float*)turret_local_matrix[i]);
                     break;
                 
                 case OBJ_ATTACH_TURRET1:
@@ -573,33 +511,7 @@ kVector tank_object::transform(kVector position, int attachLevelFrom, int attach
             switch(attachLevelFrom)
             {
                 case OBJ_ATTACH_HULL:
-                    glMatrixMode(GL_MODELVIEW);
-                    glPushMatrix();
-                    glLoadIdentity();
-                    glRotatef(-((gun[i].getElevate() * radToDeg) - 90.0), 1.0, 0.0, 0.0);
-                    // Handle if gun is attached to turret
-                    if(gun[i].getGunAttach() == OBJ_ATTACH_HULL)
-                    {
-                        // Gun is attached to main hull (enabled gun transverse)
-                        glRotatef(-gun[i].getTransverse() * radToDeg, 0.0, 1.0, 0.0);
-                        glTranslatef(-gun[i].getGunPivotV()[0],
-                                     -gun[i].getGunPivotV()[1],
-                                     -gun[i].getGunPivotV()[2]);
-                    }
-                    else
-                    {
-                        // Gun is attached to turret (disabled gun transverse)
-                        glTranslatef(-gun[i].getGunPivotV()[0],
-                                     -gun[i].getGunPivotV()[1],
-                                     -gun[i].getGunPivotV()[2]);
-                        j = gun[i].getGunAttach() - OBJ_ATTACH_TURRET_OFF;
-                        glRotatef(-turret_rotation[j] * radToDeg, 0.0, 1.0, 0.0);
-                        glTranslatef(-turret_pivot[j][0], -turret_pivot[j][1],
-                            -turret_pivot[j][2]);
-                    }
-                    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-                    glPopMatrix();
-                    return transformed(position, (float*)matrix);
+                    return untransformed(position, (float*)gun_local_matrix[i]);
                     break;
                 
                 case OBJ_ATTACH_TURRET1:
@@ -635,34 +547,9 @@ kVector tank_object::transform(kVector position, int attachLevelFrom, int attach
             switch(attachLevelFrom)
             {
                 case OBJ_ATTACH_HULL:
-                    glMatrixMode(GL_MODELVIEW);
-                    glPushMatrix();
-                    glLoadIdentity();
-                    glTranslatef(0.0, 0.0, gun[i].getGunRecoil());
-                    glRotatef(-((gun[i].getElevate() * radToDeg) - 90.0), 1.0, 0.0, 0.0);
-                    // Handle if gun is attached to turret
-                    if(gun[i].getGunAttach() == OBJ_ATTACH_HULL)
-                    {
-                        // Gun is attached to main hull (enabled gun transverse)
-                        glRotatef(-gun[i].getTransverse() * radToDeg, 0.0, 1.0, 0.0);
-                        glTranslatef(-gun[i].getGunPivotV()[0],
-                                     -gun[i].getGunPivotV()[1],
-                                     -gun[i].getGunPivotV()[2]);
-                    }
-                    else
-                    {
-                        // Gun is attached to turret (disabled gun transverse)
-                        glTranslatef(-gun[i].getGunPivotV()[0],
-                                     -gun[i].getGunPivotV()[1],
-                                     -gun[i].getGunPivotV()[2]);
-                        j = gun[i].getGunAttach() - OBJ_ATTACH_TURRET_OFF;
-                        glRotatef(-turret_rotation[j] * radToDeg, 0.0, 1.0, 0.0);
-                        glTranslatef(-turret_pivot[j][0], -turret_pivot[j][1],
-                            -turret_pivot[j][2]);
-                    }
-                    glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
-                    glPopMatrix();
-                    return transformed(position, (float*)matrix);
+                    position = untransformed(position, (float*)gun_local_matrix[i]);
+                    position[2] += gun[i].getGunRecoil();       // Recoil gun
+                    return position;
                     break;
                 
                 case OBJ_ATTACH_TURRET1:
@@ -695,21 +582,75 @@ kVector tank_object::transform(kVector position, int attachLevelFrom, int attach
     }
 }
 
+/*******************************************************************************
+    function    :   tank_object::updateMatrices
+    arguments   :   <none>
+    purpose     :   Updates the cached hull, turret, and gun mount matricies,
+                    rebuilding only those whose hull, turret, or gun has moved
+                    since they were last built.
+    notes       :   Matricies are built on the CPU in the same order the GL
+                    stack used to build them, so display code multiplies them
+                    in as before.
+*******************************************************************************/
+void tank_object::updateMatrices()
+{
+    int i;
+    int attach;
+    bool hull_moved;
+    bool gun_moved;
+    
+    // Update Hull & Turret Matricies
+    hull_moved = updateHullMatrix();
+    updateTurretMatrices(hull_moved);
+    
+    // Update Gun Matricies
+    for(i = 0; i < gun_count; i++)
+    {
+        attach = gun[i].getGunAttach();
+        gun_moved = gunMoved(i, 0.0);
+        if(attach != OBJ_ATTACH_HULL && turret_turned[attach - OBJ_ATTACH_TURRET_OFF])
+            gun_moved = true;
+        
+        if(gun_moved)
+        {
+            // Handle if gun is attached to turret
+            if(attach == OBJ_ATTACH_HULL)
+            {
+                // Gun is attached to main hull (enabled gun transverse)
+                matrixIdentity(gun_local_matrix[i]);
+                matrixTranslate(gun_local_matrix[i], gun[i].getGunPivotV()[0],
+                    gun[i].getGunPivotV()[1], gun[i].getGunPivotV()[2]);
+                matrixRotateY(gun_local_matrix[i], gun[i].getTransverse());
+            }
+            else
+            {
+                // Gun is attached to turret (disabled gun transverse)
+                matrixCopy(gun_local_matrix[i],
+                    turret_local_matrix[attach - OBJ_ATTACH_TURRET_OFF]);
+                matrixTranslate(gun_local_matrix[i], gun[i].getGunPivotV()[0],
+                    gun[i].getGunPivotV()[1], gun[i].getGunPivotV()[2]);
+            }
+            
+            matrixRotateX(gun_local_matrix[i], gun[i].getElevate() - PIHALF);
+        }
+        
+        if(gun_moved || hull_moved)
+            matrixMultiply(gun_matrix[i], hull_matrix, gun_local_matrix[i]);
+    }
+    
+    matrix_dirty = false;
+}
+
 /*******************************************************************************
     function    :   tank_object::update
     arguments   :   deltaT - number of seconds elapsed since last update
     purpose     :   Updates the entire tank object model.
-    notes       :   <none>
+    notes       :   The object handler runs these steps itself, one pass over
+                    all tanks (or all unit modules) each, in this same order.
 *******************************************************************************/
 void tank_object::update(float deltaT)
 {
-    int i;
-    
-    // Recompute maximum angular velocity based on S-35 test data.
-    max_angular_vel = 0.011656 * fabsf(linear_vel) + angular_offset;
-    // Limit turning max speed for slower movement (clamping)
-    if(max_angular_vel >= fabsf(linear_vel) * 0.274)
-        max_angular_vel = fabsf(linear_vel) * 0.274;
+    updateBegin(deltaT);
     
     // Update unit modules
     updateUnit(deltaT);
@@ -717,6 +658,32 @@ void tank_object::update(float deltaT)
     updateWeapons(deltaT);
     updateTurrets(deltaT);
     
+    updateEnd(deltaT);
+}
+
+/*******************************************************************************
+    function    :   tank_object::updateBegin
+    arguments   :   deltaT - number of seconds elapsed since last update
+    purpose     :   Tank update done before the unit modules are updated.
+    notes       :   <none>
+*******************************************************************************/
+void tank_object::updateBegin(float deltaT)
+{
+    // Recompute maximum angular velocity based on S-35 test data.
+    max_angular_vel = 0.011656 * fabsf(linear_vel) + angular_offset;
+    // Limit turning max speed for slower movement (clamping)
+    if(max_angular_vel >= fabsf(linear_vel) * 0.274)
+        max_angular_vel = fabsf(linear_vel) * 0.274;
+}
+
+/*******************************************************************************
+    function    :   tank_object::updateEnd
+    arguments   :   deltaT - number of seconds elapsed since last update
+    purpose     :   Tank update done after the unit modules are updated.
+    notes       :   <none>
+*******************************************************************************/
+void tank_object::updateEnd(float deltaT)
+{
     // Update track UV offset (for track texture rotate)
     if(fabsf(linear_vel) > 0.0)
     {
@@ -760,135 +727,109 @@ void tank_object::update(float deltaT)
     }
     
     // Update Matricies
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
+    updateMatrices();
+}
+
+/*******************************************************************************
+    function    :   tank_object::snapshot
+    arguments   :   snap - Render snapshot record to fill
+    purpose     :   Records what is displayed of our tank object.
+    notes       :   <none>
+*******************************************************************************/
+void tank_object::snapshot(snap_object* snap)
+{
+    int i;
     
-    // Update Hull Matrix
-    glTranslatef(pos[0], pos[1], pos[2]);
-    glRotatef(dir[2] * radToDeg, 0.0, 1.0, 0.0);
-    glRotatef((dir[1] * radToDeg) - 90.0, 1.0, 0.0, 0.0);
-    glRotatef(roll * radToDeg, 0.0, 0.0, 1.0);
+    object::snapshot(snap);
     
-    glGetFloatv(GL_MODELVIEW_MATRIX, hull_matrix);
+    snap->kind = SNAP_OBJ_TANK;
+    snap->selected = selected;
+    snap->hull_dspList = hull_dspList;
+    snap->selected_dspList = selected_dspList;
     
-    // Update Turret Matricies
+    snap->track_left_id = track_left_id;
+    snap->track_right_id = track_right_id;
+    snap->track_left_s_texel = track_left_s_texel;
+    snap->track_right_s_texel = track_right_s_texel;
+    
+    snap->turret_count = turret_count;
     for(i = 0; i < turret_count; i++)
     {
-        glPushMatrix();
-        
-        glTranslatef(turret_pivot[i][0],
-                     turret_pivot[i][1],
-                     turret_pivot[i][2]);
-        glRotatef(turret_rotation[i] * radToDeg, 0.0, 1.0, 0.0);
-        
-        glGetFloatv(GL_MODELVIEW_MATRIX, turret_matrix[i]);
-        
-        glPopMatrix();
+        matrixCopy((float*)snap->turret_matrix[i], (float*)turret_matrix[i]);
+        snap->turret_dspList[i] = turret_dspList[i];
     }
     
-    // Update Gun Matricies
+    snap->gun_count = gun_count;
     for(i = 0; i < gun_count; i++)
     {
-        glPushMatrix();
-        
-        // Handle if gun is attached to turret
-        if(gun[i].getGunAttach() == OBJ_ATTACH_HULL)
-        {
-            // Gun is attached to main hull (enabled gun transverse)
-            glTranslatef(gun[i].getGunPivotV()[0],
-                         gun[i].getGunPivotV()[1],
-                         gun[i].getGunPivotV()[2]);
-            glRotatef(gun[i].getTransverse() * radToDeg, 0.0, 1.0, 0.0);
-        }
-        else
-        {
-            // Gun is attached to turret (disabled gun transverse)
-            glLoadMatrixf(turret_matrix[gun[i].getGunAttach() - OBJ_ATTACH_TURRET_OFF]);
-            glTranslatef(gun[i].getGunPivotV()[0],
-                         gun[i].getGunPivotV()[1],
-                         gun[i].getGunPivotV()[2]);
-        }
-        
-        glRotatef((gun[i].getElevate() * radToDeg) - 90.0, 1.0, 0.0, 0.0);
-        
-        glGetFloatv(GL_MODELVIEW_MATRIX, gun_matrix[i]);
-        
-        glPopMatrix();
+        matrixCopy((float*)snap->gun_matrix[i], (float*)gun_matrix[i]);
+        snap->gun_mant_dspList[i] = gun_mant_dspList[i];
+        snap->gun_dspList[i] = gun_dspList[i];
+        snap->gun_recoil[i] = gun[i].getGunRecoil();
     }
-    
-    glPopMatrix();      // Restore original matrix
-    
-    // Camera culling
-    draw = camera.sphereInView(pos(), radius);
 }
 
 /*******************************************************************************
     function    :   tank_object::display
-    arguments   :   <none>
+    arguments   :   snap - Render snapshot record of tank
     purpose     :   Base display function which displays our tank object.
-    notes       :   <none>
+    notes       :   Culling is done by the snapshot module, and waypoints are
+                    displayed apart (see displayWaypoints), as they are not
+                    part of the snapshot.
 *******************************************************************************/
-void tank_object::display()
+void tank_object::display(snap_object* snap)
 {
     int i;
     float texelOffset[2] = {0.0, 0.0};
     
-    // If we are inside of drawing view (via frustum culling) then draw.
-    // Otherwise we don't waste time sending the info down to the GPU.
-    if(draw)
+    glPushMatrix();
+    
+    glMultMatrixf(snap->hull_matrix);
+    
+    glCallList(snap->hull_dspList);
+    
+    texelOffset[0] = snap->track_left_s_texel;
+    models.setMeshTexelOffset(snap->model_id, snap->track_left_id,
+        texelOffset);
+    texelOffset[0] = snap->track_right_s_texel;
+    models.setMeshTexelOffset(snap->model_id, snap->track_right_id,
+        texelOffset);
+    
+    models.drawMesh(snap->model_id, snap->track_left_id, MDL_DRW_VERTEXARRAY);
+    models.drawMesh(snap->model_id, snap->track_right_id, MDL_DRW_VERTEXARRAY);
+    
+    // If object is selected, display the "selected" visual
+    if(snap->selected)
+        glCallList(snap->selected_dspList);
+    
+    glPopMatrix();
+    
+    // Draw turret (using its matrix)
+    for(i = 0; i < snap->turret_count; i++)
     {
         glPushMatrix();
         
-        glMultMatrixf(hull_matrix);
+        glMultMatrixf(snap->turret_matrix[i]);
         
-        glCallList(hull_dspList);
+        glCallList(snap->turret_dspList[i]);
         
-        texelOffset[0] = track_left_s_texel;
-        models.setMeshTexelOffset(model_id, track_left_id, texelOffset);
-        texelOffset[0] = track_right_s_texel;
-        models.setMeshTexelOffset(model_id, track_right_id, texelOffset);
+        glPopMatrix();
+    }
+    
+    // Draw gun mantlets and their gun (using their matricies)
+    for(i = 0; i < snap->gun_count; i++)
+    {
+        glPushMatrix();
         
-        models.drawMesh(model_id, track_left_id, MDL_DRW_VERTEXARRAY);
-        models.drawMesh(model_id, track_right_id, MDL_DRW_VERTEXARRAY);
+        glMultMatrixf(snap->gun_matrix[i]);
         
-        // If object is selected, display the "selected" visual
-        if(selected)
-            glCallList(selected_dspList);
+        glCallList(snap->gun_mant_dspList[i]);
         
+        glTranslatef(0.0, 0.0, -snap->gun_recoil[i]);       // Recoil gun
+        glCallList(snap->gun_dspList[i]);
+                      
         glPopMatrix();
-        
-        // Draw turret (using its matrix)
-        for(i = 0; i < turret_count; i++)
-        {
-            glPushMatrix();
-            
-            glMultMatrixf(turret_matrix[i]);
-            
-            glCallList(turret_dspList[i]);
-            
-            glPopMatrix();
-        }
-        
-        // Draw gun mantlets and their gun (using their matricies)
-        for(i = 0; i < gun_count; i++)
-        {
-            glPushMatrix();
-            
-            glMultMatrixf(gun_matrix[i]);
-            
-            glCallList(gun_mant_dspList[i]);
-            
-            glTranslatef(0.0, 0.0, -gun[i].getGunRecoil());     // Recoil gun
-            glCallList(gun_dspList[i]);
-                          
-            glPopMatrix();
-        }
     }
-    
-    // Draw waypoints if the object is selected
-    if(selected)
-        displayWaypoints();
 }
 
 /*******************************************************************************
@@ -42,10 +42,14 @@ struct tank_object : public moving_object, public turreted_object
     
     /* Metrics */
     kVector transform(kVector position, int attachLevelFrom = OBJ_ATTACH_HULL, int attachLevelTo = OBJ_ATTACH_WORLD);
+    void updateMatrices();
     
     /* Base Update & Display Routines */
     void update(float deltaT);
-    void display();
+    void updateBegin(float deltaT);         // (before unit modules)
+    void updateEnd(float deltaT);           // (after unit modules)
+    void snapshot(snap_object* snap);
+    static void display(snap_object* snap);
     void displayWaypoints();
 };
 
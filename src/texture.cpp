@@ -778,6 +778,58 @@ GLuint texture_library::getTextureID(char* textureName)
     return TEXTURE_NULL;
 }
 
+/*******************************************************************************
+    function    :   texture_library::removeTexture
+    arguments   :   textureName - Name of texture to remove
+    purpose     :   Removes a texture from the texture library, freeing its
+                    video memory, so that its name may be added again.
+    notes       :   Entries following the removed one in its probe run are
+                    moved back as needed, so that they can still be found.
+*******************************************************************************/
+void texture_library::removeTexture(char* textureName)
+{
+    int insert_pos;
+    int next_pos;
+    int home_pos;
+    
+    // Find the texture (nothing to do if it is not loaded)
+    for(insert_pos = hash(textureName); texture[insert_pos].texture_name != NULL;
+        insert_pos = (insert_pos + 1) % MAX_TEXTURES)
+    {
+        if(strcmp(texture[insert_pos].texture_name, textureName) == 0)
+            break;
+    }
+    if(texture[insert_pos].texture_name == NULL)
+        return;
+    
+    // Free texture
+    delete texture[insert_pos].texture_name;
+    texture[insert_pos].texture_name = NULL;
+    if(texture[insert_pos].texture_id != TEXTURE_NULL)
+        glDeleteTextures(1, &texture[insert_pos].texture_id);
+    texture[insert_pos].texture_id = TEXTURE_NULL;
+    texture_count--;
+    
+    // Move back any later entry of the run whose hash point is not between
+    // the freed slot and itself
+    for(next_pos = (insert_pos + 1) % MAX_TEXTURES;
+        texture[next_pos].texture_name != NULL;
+        next_pos = (next_pos + 1) % MAX_TEXTURES)
+    {
+        home_pos = hash(texture[next_pos].texture_name);
+        
+        if(insert_pos < next_pos ?
+           (home_pos <= insert_pos || home_pos > next_pos) :
+           (home_pos <= insert_pos && home_pos > next_pos))
+        {
+            texture[insert_pos] = texture[next_pos];
+            texture[next_pos].texture_name = NULL;
+            texture[next_pos].texture_id = TEXTURE_NULL;
+            insert_pos = next_pos;
+        }
+    }
+}
+
 /*******************************************************************************
     function    :   texture_library::setAnisotropicy
     arguments   :   enabled - Flag to enable or disable anisotropic filtering
@@ -86,6 +86,7 @@ class texture_library
             { return loadTexture(fileName, fileName); }
         GLuint addTexture(char* textureName, GLubyte* image, int bpp, int width,
             int height);
+        void removeTexture(char* textureName);
         
         /* Base ID Grab */
         GLuint getTextureID(char* textureName); // Grabs a texture ID
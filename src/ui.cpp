@@ -44,6 +44,8 @@ ui_module::ui_module()
     
     picture_bg = NULL;
     picture_bg_width = picture_bg_height = 0;
+    
+    screen_capture = false;
 }
 
 /*******************************************************************************
@@ -169,7 +171,12 @@ void ui_module::keystrokeDown(SDL_KeyboardEvent &key)
     switch(key.keysym.sym)
     {
         case SDLK_ESCAPE:
-            exit(0);
+            {
+                // Quit is handled by the main thread (see gameMainLoop)
+                SDL_Event quit_event;
+                quit_event.type = SDL_QUIT;
+                SDL_PushEvent(&quit_event);
+            }
             break;            
         
         case SDLK_BACKQUOTE:
@@ -406,54 +413,8 @@ void ui_module::keystrokeDown(SDL_KeyboardEvent &key)
             }
             break;
         
-        case SDLK_F12: // Take a screen capture and save it to disk
-            {
-                GLubyte* screen_shot_gl;
-                SDL_Surface* screen_shot_sdl;
-                char buffer[128];
-                static int curr_cap = 1;
-                ifstream fin;
-                
-                // Allocate memory for the screen capture
-                screen_shot_gl = new GLubyte[game_setup.screen_width * game_setup.screen_height * 3];
-                
-                // Grab screen capture from OpenGL
-                glReadPixels(0, 0, game_setup.screen_width, game_setup.screen_height, GL_BGR,
-                    GL_UNSIGNED_BYTE, screen_shot_gl);
-                
-                // Flip image (since it will be in OpenGL 0,0 and not SDL 0,0)
-                flipImage(screen_shot_gl, 24, game_setup.screen_width, game_setup.screen_height);
-                
-                // Create SDL surface from pixels
-                screen_shot_sdl = SDL_CreateRGBSurfaceFrom(screen_shot_gl,
-                    game_setup.screen_width, game_setup.screen_height, 24, game_setup.screen_width * 3,
-                    0, 0, 0, 0);
-                
-                // Create filename based on capture number
-                sprintf(buffer, "capture%03i.bmp", curr_cap++);
-                
-                // Work around to figure out how many screen caps are currently
-                // residing in the directory without having to do OS-dependent
-                // coding to figure out the capture number.
-                fin.open(buffer);
-                while(fin)
-                {
-                    // While file exists, try next file until we hit one that
-                    // doesn't, and then use that one for the capture.
-                    fin.close();
-                    fin.clear();
-                    sprintf(buffer, "capture%03i.bmp", curr_cap++);
-                    fin.open(buffer);
-                }
-                fin.close();
-                
-                // Save it as a .bmp
-                SDL_SaveBMP(screen_shot_sdl, buffer);
-                
-                // Cleanup used memory
-                SDL_FreeSurface(screen_shot_sdl);
-                delete screen_shot_gl;
-            }
+        case SDLK_F12: // Take a screen capture (see captureScreen)
+            screen_capture = true;
             break;
         
         default:
@@ -461,6 +422,67 @@ void ui_module::keystrokeDown(SDL_KeyboardEvent &key)
     }
 }
 
+/*******************************************************************************
+    function    :   ui_module::captureScreen
+    arguments   :   <none>
+    purpose     :   Takes a screen capture, if one has been asked for, and
+                    saves it to disk.
+    notes       :   Must be called from the render thread, after the frame has
+                    been drawn and before it is swapped.
+*******************************************************************************/
+void ui_module::captureScreen()
+{
+    GLubyte* screen_shot_gl;
+    SDL_Surface* screen_shot_sdl;
+    char buffer[128];
+    static int curr_cap = 1;
+    ifstream fin;
+    
+    if(!screen_capture)
+        return;
+    screen_capture = false;
+    
+    // Allocate memory for the screen capture
+    screen_shot_gl = new GLubyte[game_setup.screen_width * game_setup.screen_height * 3];
+    
+    // Grab screen capture from OpenGL
+    glReadPixels(0, 0, game_setup.screen_width, game_setup.screen_height, GL_BGR,
+        GL_UNSIGNED_BYTE, screen_shot_gl);
+    
+    // Flip image (since it will be in OpenGL 0,0 and not SDL 0,0)
+    flipImage(screen_shot_gl, 24, game_setup.screen_width, game_setup.screen_height);
+    
+    // Create SDL surface from pixels
+    screen_shot_sdl = SDL_CreateRGBSurfaceFrom(screen_shot_gl,
+        game_setup.screen_width, game_setup.screen_height, 24, game_setup.screen_width * 3,
+        0, 0, 0, 0);
+    
+    // Create filename based on capture number
+    sprintf(buffer, "capture%03i.bmp", curr_cap++);
+    
+    // Work around to figure out how many screen caps are currently
+    // residing in the directory without having to do OS-dependent
+    // coding to figure out the capture number.
+    fin.open(buffer);
+    while(fin)
+    {
+        // While file exists, try next file until we hit one that
+        // doesn't, and then use that one for the capture.
+        fin.close();
+        fin.clear();
+        sprintf(buffer, "capture%03i.bmp", curr_cap++);
+        fin.open(buffer);
+    }
+    fin.close();
+    
+    // Save it as a .bmp
+    SDL_SaveBMP(screen_shot_sdl, buffer);
+    
+    // Cleanup used memory
+    SDL_FreeSurface(screen_shot_sdl);
+    delete screen_shot_gl;
+}
+
 /*******************************************************************************
     function    :   ui_module::keystrokeUp
     arguments   :   key - key event structure
@@ -39,6 +39,9 @@ class ui_module
         int picture_bg_width;
         int picture_bg_height;
         
+        // Screen capture asked for (taken by captureScreen)
+        bool screen_capture;
+        
 	public:
 		ui_module();                  // Constructor
 		~ui_module();                 // Deconstructor
@@ -67,6 +70,7 @@ class ui_module
         /* Base Update & Display Routines */
         void display();
         void update(float deltaT);
+        void captureScreen();
 };
 
 extern ui_module ui;
@@ -0,0 +1,546 @@
+/*******************************************************************************
+                      Visibility Module - Implementation
+*******************************************************************************/
+#include "main.h"
+#include "visibility.h"
+#include "metrics.h"
+#include "object.h"
+#include "objmodules.h"
+#include "objunit.h"
+#include "scenery.h"
+
+/*******************************************************************************
+    function    :   visibility_module::visibility_module
+    arguments   :   <none>
+    purpose     :   Constructor.
+    notes       :   <none>
+*******************************************************************************/
+visibility_module::visibility_module()
+{
+    int i, j;
+
+    unit_max = VS_MAX_UNITS;
+    unit = new vs_unit[unit_max];
+    for(i = 0; i < unit_max; i++)
+    {
+        unit[i].obj_ptr = NULL;
+        unit[i].side = -1;
+        unit[i].spot_range = 0.0;
+    }
+    unit_top = 0;
+
+    pair = new vs_pair[unit_max * unit_max];
+    for(i = 0; i < unit_max * unit_max; i++)
+    {
+        pair[i].next_check = 0.0;
+        pair[i].visible = false;
+    }
+    cursor = 0;
+
+    for(i = 0; i < VS_SIDES; i++)
+    {
+        contact[i] = new vs_contact[unit_max];
+        for(j = 0; j < unit_max; j++)
+        {
+            contact[i][j].obj_ptr = NULL;
+            contact[i][j].spotters = 0;
+            contact[i][j].last_seen = -VS_CONTACT_MEMORY;
+        }
+        contact_count[i] = 0;
+    }
+
+    vs_clock = 0.0;
+}
+
+/*******************************************************************************
+    function    :   visibility_module::~visibility_module
+    arguments   :   <none>
+    purpose     :   Deconstructor.
+    notes       :   <none>
+*******************************************************************************/
+visibility_module::~visibility_module()
+{
+    int i;
+
+    delete [] unit;
+    delete [] pair;
+    for(i = 0; i < VS_SIDES; i++)
+        delete [] contact[i];
+}
+
+/*******************************************************************************
+    Roster Routines
+*******************************************************************************/
+
+/*******************************************************************************
+    function    :   visibility_module::slot_of
+    arguments   :   objPtr - Unit
+    purpose     :   Returns the roster slot of the unit (-1 if not on roster).
+    notes       :   <none>
+*******************************************************************************/
+int visibility_module::slot_of(object* objPtr)
+{
+    int i;
+
+    if(objPtr == NULL)
+        return -1;
+
+    for(i = 0; i < unit_top; i++)
+        if(unit[i].obj_ptr == objPtr)
+            return i;
+
+    return -1;
+}
+
+/*******************************************************************************
+    function    :   visibility_module::side_of
+    arguments   :   objPtr - Unit
+    purpose     :   Returns the side of the unit, or -1 if the unit has no side
+                    or can no longer spot or be spotted.
+    notes       :   <none>
+*******************************************************************************/
+int visibility_module::side_of(object* objPtr)
+{
+    if(objPtr->obj_status == OBJ_STATUS_DEAD ||
+       objPtr->obj_status == OBJ_STATUS_REMOVE)
+        return -1;
+
+    if(isUnitSide(objPtr, PS_AXIS))
+        return PS_AXIS;
+    if(isUnitSide(objPtr, PS_ALLIED))
+        return PS_ALLIED;
+
+    return -1;
+}
+
+/*******************************************************************************
+    function    :   visibility_module::spot_range
+    arguments   :   objPtr - Unit
+    purpose     :   Determines the spotting range of a unit from its best optic.
+    notes       :   Range scales with magnification, taken as the reference FOV
+                    over the optic's FOV.
+*******************************************************************************/
+float visibility_module::spot_range(object* objPtr)
+{
+    firing_object* fire_ptr = dynamic_cast<firing_object*>(objPtr);
+    float best_fov = 0.0;
+    float range;
+    int i;
+
+    if(fire_ptr)
+        for(i = 0; i < fire_ptr->sight_count; i++)
+            if(fire_ptr->sight[i].getFieldOfView() > FP_ERROR &&
+               (best_fov == 0.0 || fire_ptr->sight[i].getFieldOfView() < best_fov))
+                best_fov = fire_ptr->sight[i].getFieldOfView();
+
+    if(best_fov == 0.0)
+        return VS_EYE_RANGE;
+
+    range = VS_OPTIC_RANGE * (VS_OPTIC_FOV * degToRad) / best_fov;
+
+    if(range < VS_EYE_RANGE)
+        range = VS_EYE_RANGE;
+    else if(range > VS_MAX_RANGE)
+        range = VS_MAX_RANGE;
+
+    return range;
+}
+
+/*******************************************************************************
+    function    :   visibility_module::grow_roster
+    arguments   :   <none>
+    purpose     :   Doubles the size of the roster, along with the pair matrix
+                    and the contact tables.
+    notes       :   Units keep their slots, so pairs and contacts are copied
+                    over as they are (and the scan cursor stays valid).
+*******************************************************************************/
+void visibility_module::grow_roster()
+{
+    int new_max = unit_max * 2;
+    vs_unit* new_unit;
+    vs_pair* new_pair;
+    vs_contact* new_contact;
+    int i, j;
+
+    new_unit = new vs_unit[new_max];
+    for(i = 0; i < new_max; i++)
+    {
+        if(i < unit_max)
+            new_unit[i] = unit[i];
+        else
+        {
+            new_unit[i].obj_ptr = NULL;
+            new_unit[i].side = -1;
+            new_unit[i].spot_range = 0.0;
+        }
+    }
+
+    new_pair = new vs_pair[new_max * new_max];
+    for(i = 0; i < new_max; i++)
+    {
+        for(j = 0; j < new_max; j++)
+        {
+            if(i < unit_max && j < unit_max)
+                new_pair[i * new_max + j] = pair[i * unit_max + j];
+            else
+            {
+                new_pair[i * new_max + j].next_check = 0.0;
+                new_pair[i * new_max + j].visible = false;
+            }
+        }
+    }
+
+    for(i = 0; i < VS_SIDES; i++)
+    {
+        new_contact = new vs_contact[new_max];
+        for(j = 0; j < new_max; j++)
+        {
+            if(j < unit_max)
+                new_contact[j] = contact[i][j];
+            else
+            {
+                new_contact[j].obj_ptr = NULL;
+                new_contact[j].spotters = 0;
+                new_contact[j].last_seen = -VS_CONTACT_MEMORY;
+            }
+        }
+
+        delete [] contact[i];
+        contact[i] = new_contact;
+    }
+
+    delete [] unit;
+    unit = new_unit;
+    delete [] pair;
+    pair = new_pair;
+    unit_max = new_max;
+}
+
+/*******************************************************************************
+    function    :   visibility_module::addUnit
+    arguments   :   objPtr - Unit
+    purpose     :   Adds a unit to the roster (growing the roster if full).
+    notes       :   Side and spotting range are read on the first update after
+                    the unit is initialized.
+*******************************************************************************/
+void visibility_module::addUnit(object* objPtr)
+{
+    int i, j;
+
+    if(objPtr == NULL || slot_of(objPtr) != -1)
+        return;
+
+    for(i = 0; i < unit_max && unit[i].obj_ptr; i++)
+        ;
+    if(i >= unit_max)
+        grow_roster();
+
+    unit[i].obj_ptr = objPtr;
+    unit[i].side = -1;
+    unit[i].spot_range = 0.0;
+    if(i >= unit_top)
+        unit_top = i + 1;
+
+    // New pairs are due immediately
+    for(j = 0; j < unit_max; j++)
+    {
+        pair[i * unit_max + j].next_check = 0.0;
+        pair[i * unit_max + j].visible = false;
+        pair[j * unit_max + i].next_check = 0.0;
+        pair[j * unit_max + i].visible = false;
+    }
+
+    for(j = 0; j < VS_SIDES; j++)
+    {
+        contact[j][i].obj_ptr = objPtr;
+        contact[j][i].spotters = 0;
+        contact[j][i].last_seen = -VS_CONTACT_MEMORY;
+    }
+}
+
+/*******************************************************************************
+    function    :   visibility_module::removeUnit
+    arguments   :   objPtr - Unit
+    purpose     :   Removes a unit from the roster (and from contact tables).
+    notes       :   Must be called before the unit is deleted.
+*******************************************************************************/
+void visibility_module::removeUnit(object* objPtr)
+{
+    int slot = slot_of(objPtr);
+    int i;
+
+    if(slot == -1)
+        return;
+
+    for(i = 0; i < unit_top; i++)
+    {
+        if(pair[slot * unit_max + i].visible)
+            set_visible(slot, i, false);
+        if(pair[i * unit_max + slot].visible)
+            set_visible(i, slot, false);
+    }
+
+    unit[slot].obj_ptr = NULL;
+    unit[slot].side = -1;
+    for(i = 0; i < VS_SIDES; i++)
+        contact[i][slot].obj_ptr = NULL;
+
+    while(unit_top > 0 && unit[unit_top - 1].obj_ptr == NULL)
+        unit_top--;
+    if(cursor >= unit_top * unit_top)
+        cursor = 0;
+}
+
+/*******************************************************************************
+    Checking Routines
+*******************************************************************************/
+
+/*******************************************************************************
+    function    :   visibility_module::eye_position
+    arguments   :   objPtr - Unit
+    purpose     :   Returns the world position a unit looks out from.
+    notes       :   The first sight of a firing object, otherwise a set height
+                    above the unit.
+*******************************************************************************/
+kVector visibility_module::eye_position(object* objPtr)
+{
+    firing_object* fire_ptr = dynamic_cast<firing_object*>(objPtr);
+
+    if(fire_ptr && fire_ptr->sight_count > 0)
+        return objPtr->transform(fire_ptr->sight[0].getSightPivotV(),
+            fire_ptr->sight[0].getSightAttach());
+
+    return kVector(objPtr->pos[0], objPtr->pos[1] + VS_EYE_HEIGHT,
+        objPtr->pos[2]);
+}
+
+/*******************************************************************************
+    function    :   visibility_module::is_aiming_at
+    arguments   :   objPtr - Unit
+                    targetPtr - Unit possibly being aimed at
+    purpose     :   Determines if any sight of a unit is set on the target.
+    notes       :   <none>
+*******************************************************************************/
+bool visibility_module::is_aiming_at(object* objPtr, object* targetPtr)
+{
+    firing_object* fire_ptr = dynamic_cast<firing_object*>(objPtr);
+    int i;
+
+    if(fire_ptr)
+        for(i = 0; i < fire_ptr->sight_count; i++)
+            if(fire_ptr->sight[i].getTargetObject() == targetPtr)
+                return true;
+
+    return false;
+}
+
+/*******************************************************************************
+    function    :   visibility_module::check_pair
+    arguments   :   viewer - Roster slot of viewer
+                    target - Roster slot of target
+    purpose     :   Rechecks if the viewer can see the target, and schedules
+                    the pair's next check.
+    notes       :   <none>
+*******************************************************************************/
+void visibility_module::check_pair(int viewer, int target)
+{
+    object* view_ptr = unit[viewer].obj_ptr;
+    object* target_ptr = unit[target].obj_ptr;
+    kVector target_pos;
+    float dist;
+    float interval;
+    bool visible = false;
+
+    dist = distanceBetween(kVector(view_ptr->pos), kVector(target_ptr->pos));
+
+    if(dist <= unit[viewer].spot_range)
+    {
+        target_pos = kVector(target_ptr->pos[0],
+            target_ptr->pos[1] + VS_TARGET_HEIGHT, target_ptr->pos[2]);
+        visible = map.lineOfSight((void*)view_ptr, (void*)target_ptr,
+            eye_position(view_ptr), target_pos);
+        interval = VS_MIN_INTERVAL + (VS_MAX_INTERVAL - VS_MIN_INTERVAL) *
+            (dist / unit[viewer].spot_range);
+    }
+    else
+        interval = VS_MAX_INTERVAL;
+
+    // Those aiming at us are watched closer
+    if(is_aiming_at(target_ptr, view_ptr))
+        interval *= VS_THREAT_FACTOR;
+
+    pair[viewer * unit_max + target].next_check = vs_clock + interval;
+    set_visible(viewer, target, visible);
+}
+
+/*******************************************************************************
+    function    :   visibility_module::set_visible
+    arguments   :   viewer - Roster slot of viewer
+                    target - Roster slot of target
+                    visible - Viewer sees target
+    purpose     :   Sets the visibility of a pair, keeping the viewer side's
+                    contact table up to date.
+    notes       :   <none>
+*******************************************************************************/
+void visibility_module::set_visible(int viewer, int target, bool visible)
+{
+    vs_pair* pair_ptr = &pair[viewer * unit_max + target];
+    vs_contact* contact_ptr;
+    int side = unit[viewer].side;
+
+    if(side < 0 || side >= VS_SIDES)
+    {
+        pair_ptr->visible = false;
+        return;
+    }
+
+    contact_ptr = &contact[side][target];
+
+    if(visible)
+    {
+        contact_ptr->last_seen = vs_clock;
+        contact_ptr->last_pos[0] = unit[target].obj_ptr->pos[0];
+        contact_ptr->last_pos[1] = unit[target].obj_ptr->pos[1];
+        contact_ptr->last_pos[2] = unit[target].obj_ptr->pos[2];
+    }
+
+    if(visible == pair_ptr->visible)
+        return;
+
+    pair_ptr->visible = visible;
+
+    if(visible)
+    {
+        if(contact_ptr->spotters++ == 0)
+            contact_count[side]++;
+    }
+    else
+    {
+        if(--contact_ptr->spotters == 0)
+            contact_count[side]--;
+    }
+}
+
+/*******************************************************************************
+    Contact Routines
+*******************************************************************************/
+
+/*******************************************************************************
+    function    :   visibility_module::getContact
+    arguments   :   objPtr - Unit
+                    side - Side whose contact table is read
+    purpose     :   Returns the side's contact entry for the unit, or NULL if
+                    the unit isn't on the roster.
+    notes       :   <none>
+*******************************************************************************/
+vs_contact* visibility_module::getContact(object* objPtr, int side)
+{
+    int slot;
+
+    if(side < 0 || side >= VS_SIDES || (slot = slot_of(objPtr)) == -1)
+        return NULL;
+
+    return &contact[side][slot];
+}
+
+/*******************************************************************************
+    function    :   visibility_module::isSpotted
+    arguments   :   objPtr - Unit
+                    side - Side looking
+    purpose     :   Determines if any unit of the side currently sees the unit.
+    notes       :   <none>
+*******************************************************************************/
+bool visibility_module::isSpotted(object* objPtr, int side)
+{
+    vs_contact* contact_ptr = getContact(objPtr, side);
+
+    return (contact_ptr && contact_ptr->spotters > 0);
+}
+
+/*******************************************************************************
+    function    :   visibility_module::isKnown
+    arguments   :   objPtr - Unit
+                    side - Side looking
+    purpose     :   Determines if the side sees the unit, or has seen it within
+                    the last VS_CONTACT_MEMORY seconds.
+    notes       :   <none>
+*******************************************************************************/
+bool visibility_module::isKnown(object* objPtr, int side)
+{
+    vs_contact* contact_ptr = getContact(objPtr, side);
+
+    return (contact_ptr && (contact_ptr->spotters > 0 ||
+        vs_clock - contact_ptr->last_seen < VS_CONTACT_MEMORY));
+}
+
+/*******************************************************************************
+    Base Update Routine
+*******************************************************************************/
+
+/*******************************************************************************
+    function    :   visibility_module::update
+    arguments   :   deltaT - Time since last update
+    purpose     :   Refreshes the roster, then rechecks pairs that are due,
+                    round-robin under the per-tick budget.
+    notes       :   <none>
+*******************************************************************************/
+void visibility_module::update(float deltaT)
+{
+    int i, j;
+    int side;
+    int scanned, checked;
+    int viewer, target;
+    int pair_count;
+
+    vs_clock += deltaT;
+
+    // Refresh roster sides (units may die or change hands)
+    for(i = 0; i < unit_top; i++)
+    {
+        if(unit[i].obj_ptr == NULL)
+            continue;
+
+        side = side_of(unit[i].obj_ptr);
+
+        if(side != unit[i].side)
+        {
+            // Drop everything the unit saw or was seen by
+            for(j = 0; j < unit_top; j++)
+            {
+                if(pair[i * unit_max + j].visible)
+                    set_visible(i, j, false);
+                if(pair[j * unit_max + i].visible)
+                    set_visible(j, i, false);
+                pair[i * unit_max + j].next_check = 0.0;
+                pair[j * unit_max + i].next_check = 0.0;
+            }
+            unit[i].side = side;
+        }
+
+        if(side != -1 && unit[i].spot_range == 0.0)
+            unit[i].spot_range = spot_range(unit[i].obj_ptr);
+    }
+
+    // Recheck pairs that are due
+    pair_count = unit_top * unit_top;
+    if(pair_count == 0)
+        return;
+
+    for(scanned = checked = 0; scanned < VS_SCAN_BUDGET &&
+        scanned < pair_count && checked < VS_CHECK_BUDGET; scanned++)
+    {
+        if(cursor >= pair_count)
+            cursor = 0;
+        viewer = cursor / unit_top;
+        target = cursor % unit_top;
+        cursor++;
+
+        if(unit[viewer].side == -1 || unit[target].side == -1 ||
+           unit[viewer].side == unit[target].side ||
+           pair[viewer * unit_max + target].next_check > vs_clock)
+            continue;
+
+        check_pair(viewer, target);
+        checked++;
+    }
+}
@@ -0,0 +1,123 @@
+/*******************************************************************************
+                        Visibility Module - Definition
+*******************************************************************************/
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+#include "metrics.h"
+#include "object.h"
+#include "objhandler.h"
+
+// Visibility Roster (initial size, roster grows as needed)
+#define VS_MAX_UNITS                (OBJ_MAX_TANK + OBJ_MAX_VEHICLE + \
+                                     OBJ_MAX_ATG + OBJ_MAX_ATR)
+#define VS_SIDES                    2       // Sides keeping contact tables
+
+// Spotting Ranges
+#define VS_EYE_HEIGHT               2.0     // Eye height of unit w/o sight (m)
+#define VS_TARGET_HEIGHT            1.0     // Height of spot looked for (m)
+#define VS_EYE_RANGE                800.0   // Spotting range w/o optics (m)
+#define VS_OPTIC_RANGE              1200.0  // Spotting range of reference optic
+#define VS_OPTIC_FOV                25.0    // FOV of reference optic (degrees)
+#define VS_MAX_RANGE                3000.0  // Max spotting range (m)
+
+// Scheduling
+#define VS_CHECK_BUDGET             24      // Max pairs checked per tick
+#define VS_SCAN_BUDGET              512     // Max pairs scanned per tick
+#define VS_MIN_INTERVAL             0.25    // Recheck interval at 0m (s)
+#define VS_MAX_INTERVAL             4.0     // Recheck interval at range (s)
+#define VS_THREAT_FACTOR            0.25    // Interval scale if target aims back
+#define VS_CONTACT_MEMORY           30.0    // Time lost contacts are known (s)
+
+// Known Contact (per side, per unit)
+struct vs_contact
+{
+    object* obj_ptr;                    // Contact unit (NULL if unused)
+    short spotters;                     // Units of side currently seeing unit
+    float last_seen;                    // Visibility clock when last seen
+    float last_pos[3];                  // Position when last seen
+};
+
+/*******************************************************************************
+    class       :   visibility_module
+    purpose     :   Decides which units of each side can see which units of the
+                    other, and keeps a known contacts table for each side that
+                    AI and script predicates read without doing any work.
+    notes       :   1) Every viewer/target pair of opposing units is rechecked
+                       when its interval runs out. The interval grows with
+                       distance over the viewer's spotting range, and shrinks
+                       when the target is aiming at the viewer.
+                    2) Spotting range comes from the viewer's best optic (the
+                       narrowest FIELD_OF_VIEW of its sights in optics.dat).
+                       Pairs out of range are dropped without an LOS query.
+                    3) Pairs are walked round-robin, at most VS_SCAN_BUDGET
+                       pairs and VS_CHECK_BUDGET LOS queries a tick, so cost
+                       stays flat as the number of units grows (with more
+                       units, intervals simply stretch).
+                    4) Units are added/removed by the object handler. The
+                       roster, pair matrix, and contact tables double in
+                       size together when the roster is full.
+*******************************************************************************/
+class visibility_module
+{
+    private:
+        // Roster entry
+        struct vs_unit
+        {
+            object* obj_ptr;            // Unit (NULL if unused)
+            int side;                   // Side of unit (-1 none/dead)
+            float spot_range;           // Spotting range (0 until computed)
+        };
+
+        // Viewer/target pair
+        struct vs_pair
+        {
+            float next_check;           // Visibility clock of next check
+            bool visible;               // Viewer sees target
+        };
+
+        vs_unit* unit;                  // Unit roster
+        int unit_max;                   // Size of roster
+        int unit_top;                   // Highest used roster slot + 1
+        vs_pair* pair;                  // Pairs (viewer major, unit_max wide)
+        int cursor;                     // Next pair to scan
+
+        vs_contact* contact[VS_SIDES];  // Contacts (by slot)
+        int contact_count[VS_SIDES];    // Contacts currently seen per side
+
+        float vs_clock;                 // Visibility clock
+
+        /* Roster Routines */
+        int slot_of(object* objPtr);
+        int side_of(object* objPtr);
+        float spot_range(object* objPtr);
+        void grow_roster();
+
+        /* Checking Routines */
+        kVector eye_position(object* objPtr);
+        bool is_aiming_at(object* objPtr, object* targetPtr);
+        void check_pair(int viewer, int target);
+        void set_visible(int viewer, int target, bool visible);
+
+    public:
+        visibility_module();            // Constructor
+        ~visibility_module();           // Deconstructor
+
+        /* Roster Routines */
+        void addUnit(object* objPtr);
+        void removeUnit(object* objPtr);
+
+        /* Contact Routines */
+        bool isSpotted(object* objPtr, int side);
+        bool isKnown(object* objPtr, int side);
+        vs_contact* getContact(object* objPtr, int side);
+        int getContactCount(int side)
+            { return (side >= 0 && side < VS_SIDES ? contact_count[side] : 0); }
+
+        /* Update Routine */
+        void update(float deltaT);
+};
+
+extern visibility_module visibility;
+
+#endif